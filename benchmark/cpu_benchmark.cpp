@@ -0,0 +1,1866 @@
+#include <cpu_benchmark.hpp>
+#include <engine/util/packet_tracking.hpp>
+#include <engine/util/Log.hpp>
+#include <engine/util/read_file.hpp>
+#include <engine/HpmSceneSetup.hpp>
+#include <engine/objects/TransmittanceGrid.hpp>
+#include <engine/objects/SphericalTransmittanceGrid.hpp>
+#include <engine/objects/PhaseFunction.hpp>
+#include <engine/graphics/CpuNrcBackend.hpp>
+#include <glm/gtc/packing.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/combinable.h>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <array>
+#include <functional>
+
+namespace en
+{
+	// Wall clock time of fn in milliseconds, shared by all benchmarks
+	template<typename Fn>
+	static double MeasureMS(const Fn& fn)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	// Mirrors sky_sdf from volume.glsl before the slab intersection replaced it
+	static float SkySdf(const glm::vec3& pos, const glm::vec3& halfSize)
+	{
+		const glm::vec3 d = glm::abs(pos) - halfSize;
+		return glm::length(glm::max(d, glm::vec3(0.0f))) + std::min(std::max(d.x, std::max(d.y, d.z)), 0.0f);
+	}
+
+	// Mirrors the former sphere traced find_entry_exit from volume.glsl
+	static void SphereTraceEntryExit(glm::vec3 ro, glm::vec3 rd, const glm::vec3& halfSize, glm::vec3& entry, glm::vec3& exit)
+	{
+		const float minRayDistance = 0.125f;
+		const float maxRayDistance = 100000.0f;
+
+		float dist;
+		do
+		{
+			dist = SkySdf(ro, halfSize);
+			ro += dist * rd;
+		} while (dist > minRayDistance && dist < maxRayDistance);
+		entry = ro;
+
+		ro += rd * glm::length(4.0f * halfSize);
+		rd *= -1.0f;
+		do
+		{
+			dist = SkySdf(ro, halfSize);
+			ro += dist * rd;
+		} while (dist > minRayDistance && dist < maxRayDistance);
+		exit = ro;
+	}
+
+	// Mirrors find_entry_exit from volume.glsl
+	static glm::vec2 SlabEntryExit(const glm::vec3& ro, const glm::vec3& rd, const glm::vec3& halfSize)
+	{
+		glm::vec3 safeDir = rd;
+		for (int i = 0; i < 3; i++)
+		{
+			if (std::abs(safeDir[i]) < 1e-12f) { safeDir[i] = 1e-12f; }
+		}
+		const glm::vec3 invDir = 1.0f / safeDir;
+		const glm::vec3 t0 = (-halfSize - ro) * invDir;
+		const glm::vec3 t1 = (halfSize - ro) * invDir;
+		const glm::vec3 tNearAxis = glm::min(t0, t1);
+		const glm::vec3 tFarAxis = glm::max(t0, t1);
+		const float tMin = std::max(std::max(tNearAxis.x, tNearAxis.y), std::max(tNearAxis.z, 0.0f));
+		const float tMax = std::min(std::min(tFarAxis.x, tFarAxis.y), tFarAxis.z);
+		return glm::vec2(tMin, tMax);
+	}
+
+	// Per ray delta tracking like CpuHpmRenderer::DeltaTrack in normalized texture coordinates. Returns
+	// the collision distance or a negative value if the ray left the volume.
+	static float ScalarDeltaTrack(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const glm::vec3& origin,
+		const glm::vec3& dir,
+		float tMax,
+		std::mt19937& rng,
+		size_t& fetchCount)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		MajorantGrid::Traversal it;
+		if (!majorantGrid.InitTraversal(origin, dir, tMax, it)) { return -1.0f; }
+
+		uint32_t i = 0;
+		while (i < 128)
+		{
+			const float majorant = densityFactor * majorantGrid.GetCellMajorant(it);
+			const float cellExit = majorantGrid.GetCellExit(it);
+			if (majorant > 0.0f)
+			{
+				it.t -= std::log(1.0f - dist(rng)) / majorant;
+				if (it.t < cellExit)
+				{
+					i++;
+					fetchCount++;
+					const glm::vec3 uvw = origin + (it.t * dir);
+					if (densityFactor * densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) / majorant > dist(rng)) { return it.t; }
+					continue;
+				}
+			}
+
+			if (!majorantGrid.StepTraversal(it)) { return -1.0f; }
+		}
+
+		return dist(rng) * tMax;
+	}
+
+	// Per ray delta tracking with the early accept below the cell minimum like CpuHpmRenderer::DeltaTrack
+	// in normalized texture coordinates. Returns the collision distance or a negative value if the ray
+	// left the volume.
+	static float ScalarMinorantDeltaTrack(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		float densityFactor,
+		const glm::vec3& origin,
+		const glm::vec3& dir,
+		float tMax,
+		std::mt19937& rng,
+		size_t& stepCount,
+		size_t& fetchCount)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		MajorantGrid::Traversal it;
+		if (!majorantGrid.InitTraversal(origin, dir, tMax, it)) { return -1.0f; }
+
+		uint32_t i = 0;
+		while (i < 128)
+		{
+			const float majorant = densityFactor * majorantGrid.GetCellMajorant(it);
+			const float cellExit = majorantGrid.GetCellExit(it);
+			if (majorant > 0.0f)
+			{
+				it.t -= std::log(1.0f - dist(rng)) / majorant;
+				if (it.t < cellExit)
+				{
+					i++;
+					stepCount++;
+					const float u = dist(rng);
+					if (u * majorant < densityFactor * occupancyGrid.GetCellMinimum(it.cell)) { return it.t; }
+					fetchCount++;
+					const glm::vec3 uvw = origin + (it.t * dir);
+					if (densityFactor * densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) / majorant > u) { return it.t; }
+					continue;
+				}
+			}
+
+			if (!majorantGrid.StepTraversal(it)) { return -1.0f; }
+		}
+
+		return dist(rng) * tMax;
+	}
+
+	// Per ray decomposition tracking like CpuHpmRenderer::DecompositionTrack in normalized texture
+	// coordinates. Returns the collision distance or a negative value if the ray left the volume.
+	// stepCount counts tentative collisions of both components, fetchCount only the residual ones.
+	static float ScalarDecompositionTrack(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		float densityFactor,
+		const glm::vec3& origin,
+		const glm::vec3& dir,
+		float tMax,
+		std::mt19937& rng,
+		size_t& stepCount,
+		size_t& fetchCount)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		MajorantGrid::Traversal it;
+		if (!majorantGrid.InitTraversal(origin, dir, tMax, it)) { return -1.0f; }
+
+		uint32_t i = 0;
+		while (i < 128)
+		{
+			const float majorant = densityFactor * majorantGrid.GetCellMajorant(it);
+			const float cellExit = majorantGrid.GetCellExit(it);
+			if (majorant > 0.0f)
+			{
+				const float minorant = densityFactor * occupancyGrid.GetCellMinimum(it.cell);
+				const float residualMajorant = majorant - minorant;
+
+				const float tControl = minorant > 0.0f ? it.t - (std::log(1.0f - dist(rng)) / minorant) : cellExit;
+				const float tResidualEnd = std::min(tControl, cellExit);
+				while (residualMajorant > 0.0f && i < 128)
+				{
+					it.t -= std::log(1.0f - dist(rng)) / residualMajorant;
+					if (it.t >= tResidualEnd) { break; }
+
+					i++;
+					stepCount++;
+					fetchCount++;
+					const glm::vec3 uvw = origin + (it.t * dir);
+					if ((densityFactor * densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) - minorant) / residualMajorant > dist(rng)) { return it.t; }
+				}
+
+				if (tControl < cellExit)
+				{
+					stepCount++;
+					return tControl;
+				}
+			}
+
+			if (!majorantGrid.StepTraversal(it)) { return -1.0f; }
+		}
+
+		return dist(rng) * tMax;
+	}
+
+	// Per ray ratio tracking like CpuHpmRenderer::RatioTrack in normalized texture coordinates
+	static float ScalarRatioTrack(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const glm::vec3& origin,
+		const glm::vec3& dir,
+		float tMax,
+		std::mt19937& rng,
+		size_t& fetchCount)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		float transmittance = 1.0f;
+
+		MajorantGrid::Traversal it;
+		if (!majorantGrid.InitTraversal(origin, dir, tMax, it)) { return transmittance; }
+
+		uint32_t i = 0;
+		while (i < 128)
+		{
+			const float majorant = densityFactor * majorantGrid.GetCellMajorant(it);
+			const float cellExit = majorantGrid.GetCellExit(it);
+			if (majorant > 0.0f)
+			{
+				it.t -= std::log(1.0f - dist(rng)) / majorant;
+				if (it.t < cellExit)
+				{
+					i++;
+					fetchCount++;
+					const glm::vec3 uvw = origin + (it.t * dir);
+					transmittance *= 1.0f - (densityFactor * densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) / majorant);
+					continue;
+				}
+			}
+
+			if (!majorantGrid.StepTraversal(it)) { break; }
+		}
+
+		return transmittance;
+	}
+
+	// Per ray residual ratio tracking like CpuHpmRenderer::ResidualRatioTrack in normalized texture
+	// coordinates. The control density of a cell is its minimum or, if meanGrid is set, its mean.
+	static float ScalarResidualRatioTrack(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		const DensityGrid* meanGrid,
+		float densityFactor,
+		const glm::vec3& origin,
+		const glm::vec3& dir,
+		float tMax,
+		std::mt19937& rng,
+		size_t& fetchCount)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		MajorantGrid::Traversal it;
+		if (!majorantGrid.InitTraversal(origin, dir, tMax, it)) { return 1.0f; }
+
+		float controlOpticalDepth = 0.0f;
+		float residualTransmittance = 1.0f;
+		uint32_t i = 0;
+		do
+		{
+			const float majorant = densityFactor * majorantGrid.GetCellMajorant(it);
+			if (majorant > 0.0f)
+			{
+				const float cellExit = majorantGrid.GetCellExit(it);
+				const float minorant = densityFactor * occupancyGrid.GetCellMinimum(it.cell);
+				const float control = meanGrid != nullptr ?
+					std::clamp(densityFactor * meanGrid->GetValue(it.cell.x, it.cell.y, it.cell.z), minorant, majorant) :
+					minorant;
+				const float residualMajorant = std::max(majorant - control, control - minorant);
+				controlOpticalDepth += control * (cellExit - it.t);
+
+				while (residualMajorant > 0.0f && i < 128)
+				{
+					it.t -= std::log(1.0f - dist(rng)) / residualMajorant;
+					if (it.t >= cellExit) { break; }
+
+					i++;
+					fetchCount++;
+					const glm::vec3 uvw = origin + (it.t * dir);
+					residualTransmittance *= 1.0f - ((densityFactor * densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) - control) / residualMajorant);
+				}
+			}
+		} while (i < 128 && majorantGrid.StepTraversal(it));
+
+		return std::exp(-controlOpticalDepth) * residualTransmittance;
+	}
+
+	// Per ray biased or unbiased ray marching like CpuHpmRenderer::BiasedRayMarch and UnbiasedRayMarch
+	// in normalized texture coordinates. The control optical depth uses the cell means of meanGrid or
+	// the cell minimums if it is not set.
+	static float ScalarRayMarch(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		const DensityGrid* meanGrid,
+		float densityFactor,
+		const glm::vec3& origin,
+		const glm::vec3& dir,
+		float tMax,
+		bool unbiased,
+		std::mt19937& rng,
+		size_t& fetchCount)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		MajorantGrid::Traversal it;
+		if (!majorantGrid.InitTraversal(origin, dir, tMax, it)) { return 1.0f; }
+
+		float tMin = 0.0f;
+		float tLast = 0.0f;
+		float majorantOpticalDepth = 0.0f;
+		float controlOpticalDepth = 0.0f;
+		do
+		{
+			const float majorant = densityFactor * majorantGrid.GetCellMajorant(it);
+			if (majorant > 0.0f)
+			{
+				const float cellExit = majorantGrid.GetCellExit(it);
+				const float mean = densityFactor * (meanGrid != nullptr ?
+					meanGrid->GetValue(it.cell.x, it.cell.y, it.cell.z) :
+					occupancyGrid.GetCellMinimum(it.cell));
+				if (majorantOpticalDepth == 0.0f) { tMin = it.t; }
+				tLast = cellExit;
+				majorantOpticalDepth += majorant * (cellExit - it.t);
+				controlOpticalDepth += std::min(mean, majorant) * (cellExit - it.t);
+			}
+		} while (majorantGrid.StepTraversal(it));
+		if (majorantOpticalDepth <= 0.0f) { return 1.0f; }
+
+		// Same step count and roulette as the RAY_MARCH_* constants in path_trace.glsl
+		const uint32_t stepCount = static_cast<uint32_t>(std::clamp(std::ceil(majorantOpticalDepth), 1.0f, 64.0f));
+		const float continueProb = 0.5f;
+		const float stepSize = (tLast - tMin) / static_cast<float>(stepCount);
+		auto marchOpticalDepth = [&]()
+		{
+			const float jitter = dist(rng);
+			float densitySum = 0.0f;
+			for (uint32_t i = 0; i < stepCount; i++)
+			{
+				const glm::vec3 uvw = origin + ((tMin + ((static_cast<float>(i) + jitter) * stepSize)) * dir);
+				densitySum += densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z);
+			}
+			fetchCount += stepCount;
+			return densityFactor * densitySum * stepSize;
+		};
+
+		if (!unbiased) { return std::exp(-marchOpticalDepth()); }
+
+		float term = 1.0f;
+		float sum = 1.0f;
+		for (uint32_t k = 1; k <= 8; k++)
+		{
+			if (k > 1)
+			{
+				if (dist(rng) >= continueProb) { break; }
+				term /= continueProb;
+			}
+			term *= (controlOpticalDepth - marchOpticalDepth()) / static_cast<float>(k);
+			sum += term;
+		}
+		return std::exp(-controlOpticalDepth) * sum;
+	}
+
+	// Optical depth of the nearest sampled density along a ray in normalized texture coordinates. The
+	// ray is split at every voxel boundary, so each piece has constant density.
+	static double ExactOpticalDepth(
+		const DensityGrid& densityGrid,
+		float densityFactor,
+		const glm::vec3& origin,
+		const glm::vec3& dir,
+		float tMax)
+	{
+		const glm::uvec3 extent(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth());
+		std::vector<float> crossings = { 0.0f, tMax };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (std::abs(dir[axis]) < 1e-12f) { continue; }
+			for (uint32_t plane = 0; plane <= extent[axis]; plane++)
+			{
+				const float t = ((static_cast<float>(plane) / static_cast<float>(extent[axis])) - origin[axis]) / dir[axis];
+				if (t > 0.0f && t < tMax) { crossings.push_back(t); }
+			}
+		}
+		std::sort(crossings.begin(), crossings.end());
+
+		double opticalDepth = 0.0;
+		for (size_t i = 1; i < crossings.size(); i++)
+		{
+			const glm::vec3 uvw = origin + (0.5f * (crossings[i - 1] + crossings[i]) * dir);
+			opticalDepth += static_cast<double>(densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z)) * (crossings[i] - crossings[i - 1]);
+		}
+		return densityFactor * opticalDepth;
+	}
+
+	// Mean and standard error of the per ray estimates. Delta tracking is summarized by the fraction of
+	// rays that left the volume, ratio tracking by the mean transmittance.
+	static glm::vec2 GetTrackingEstimate(const std::vector<float>& results, bool ratioTracking)
+	{
+		double sum = 0.0;
+		double sqrSum = 0.0;
+		for (const float result : results)
+		{
+			const double value = ratioTracking ? result : (result < 0.0f ? 1.0 : 0.0);
+			sum += value;
+			sqrSum += value * value;
+		}
+
+		const double count = static_cast<double>(results.size());
+		const double mean = sum / count;
+		const double variance = std::max(0.0, (sqrSum / count) - (mean * mean));
+		return glm::vec2(static_cast<float>(mean), static_cast<float>(std::sqrt(variance / count)));
+	}
+
+	// Mirrors the former clamping loop of ReadFileHdr4f, which walked the image column by column
+	static std::vector<float> ScalarClampHdr4f(const std::vector<float>& data, size_t width, size_t height, float max, float& maxVal)
+	{
+		std::vector<float> hdrData(data.size());
+		std::memcpy(hdrData.data(), data.data(), data.size() * sizeof(float));
+
+		maxVal = 0.0f;
+		for (size_t x = 0; x < width; x++)
+		{
+			for (size_t y = 0; y < height; y++)
+			{
+				for (size_t c = 0; c < 4; c++)
+				{
+					const size_t linearIndex = (y * width * 4) + (x * 4) + c;
+					maxVal = std::max(maxVal, hdrData[linearIndex]);
+					hdrData[linearIndex] = std::min(max, hdrData[linearIndex]);
+				}
+			}
+		}
+
+		return hdrData;
+	}
+
+	static std::vector<float> ScalarInvertCdf(const std::vector<float>& cdf)
+	{
+		std::vector<float> invCdf(cdf.size());
+		size_t p = 0;
+		for (size_t i = 0; i < invCdf.size(); i++)
+		{
+			const float threshold = static_cast<float>(i) / static_cast<float>(invCdf.size());
+			while (p + 1 < cdf.size() && cdf[p] < threshold) { p++; }
+			invCdf[i] = static_cast<float>(p) / static_cast<float>(cdf.size());
+		}
+		return invCdf;
+	}
+
+	// Mirrors the former Hdr4fToCdf with one vector per row and normalized cdfs
+	static std::array<std::vector<float>, 2> ScalarHdr4fToCdf(const std::vector<float>& hdr4f, size_t width, size_t height)
+	{
+		std::vector<std::vector<float>> cdfX(height, std::vector<float>(width));
+		std::vector<float> pdfY(height);
+		for (size_t y = 0; y < height; y++)
+		{
+			float brightnessSum = 0.0f;
+			for (size_t x = 0; x < width; x++)
+			{
+				brightnessSum += hdr4f[(y * width * 4) + (x * 4) + 0] + hdr4f[(y * width * 4) + (x * 4) + 1] + hdr4f[(y * width * 4) + (x * 4) + 2];
+				cdfX[y][x] = brightnessSum;
+			}
+			for (size_t x = 0; x < width; x++) { cdfX[y][x] /= brightnessSum; }
+			pdfY[y] = brightnessSum;
+		}
+
+		std::vector<float> cdfY(height);
+		float brightnessSum = 0.0f;
+		for (size_t y = 0; y < height; y++)
+		{
+			brightnessSum += pdfY[y];
+			cdfY[y] = brightnessSum;
+		}
+		for (size_t y = 0; y < height; y++) { cdfY[y] /= cdfY[height - 1]; }
+
+		std::vector<float> invCdfX(width * height);
+		for (size_t y = 0; y < height; y++)
+		{
+			const std::vector<float> invCdfXgivenY = ScalarInvertCdf(cdfX[y]);
+			for (size_t x = 0; x < width; x++) { invCdfX[(y * width) + x] = invCdfXgivenY[x]; }
+		}
+
+		return { invCdfX, ScalarInvertCdf(cdfY) };
+	}
+
+	void BenchmarkFindEntryExit(const glm::vec3& volumeSize, uint32_t rayCount)
+	{
+		const glm::vec3 halfSize = volumeSize / 2.0f;
+		const float radius = glm::length(volumeSize);
+
+		// Camera like rays from outside the volume towards a region twice its size, so both hits and
+		// misses are covered, plus rays starting inside like shadow and scatter rays
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<glm::vec3> origins(rayCount);
+		std::vector<glm::vec3> dirs(rayCount);
+		for (uint32_t i = 0; i < rayCount; i++)
+		{
+			if (i % 2 == 0)
+			{
+				const float cosTheta = 2.0f * dist(rng) - 1.0f;
+				const float phi = 2.0f * 3.14159265f * dist(rng);
+				const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+				origins[i] = radius * glm::vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+				const glm::vec3 target = (2.0f * glm::vec3(dist(rng), dist(rng), dist(rng)) - 1.0f) * volumeSize;
+				dirs[i] = glm::normalize(target - origins[i]);
+			}
+			else
+			{
+				origins[i] = (glm::vec3(dist(rng), dist(rng), dist(rng)) - 0.5f) * volumeSize;
+				dirs[i] = glm::normalize(2.0f * glm::vec3(dist(rng), dist(rng), dist(rng)) - 1.0f);
+			}
+		}
+
+		// Sphere tracing
+		float sphereChecksum = 0.0f;
+		std::vector<glm::vec3> sphereEntries(rayCount);
+		const double sphereTimeMS = MeasureMS([&]()
+			{
+				for (uint32_t i = 0; i < rayCount; i++)
+				{
+					glm::vec3 entry;
+					glm::vec3 exit;
+					SphereTraceEntryExit(origins[i], dirs[i], halfSize, entry, exit);
+					sphereEntries[i] = entry;
+					sphereChecksum += exit.x;
+				}
+			});
+
+		// Slab intersection
+		float slabChecksum = 0.0f;
+		std::vector<glm::vec2> slabT(rayCount);
+		const double slabTimeMS = MeasureMS([&]()
+			{
+				for (uint32_t i = 0; i < rayCount; i++)
+				{
+					slabT[i] = SlabEntryExit(origins[i], dirs[i], halfSize);
+					slabChecksum += slabT[i].y;
+				}
+			});
+
+		// Entry points of hits should agree up to the sphere tracing tolerance, which grows for
+		// grazing rays
+		double entryDeviationSum = 0.0;
+		float maxEntryDeviation = 0.0f;
+		uint32_t hitCount = 0;
+		for (uint32_t i = 0; i < rayCount; i++)
+		{
+			if (slabT[i].x > slabT[i].y || SkySdf(sphereEntries[i], halfSize) > 1.0f) { continue; }
+			hitCount++;
+			const glm::vec3 slabEntry = origins[i] + (slabT[i].x * dirs[i]);
+			const float entryDeviation = glm::distance(slabEntry, sphereEntries[i]);
+			entryDeviationSum += entryDeviation;
+			maxEntryDeviation = std::max(maxEntryDeviation, entryDeviation);
+		}
+
+		Log::Info(
+			"FindEntryExit (" + std::to_string(rayCount) + " rays, " + std::to_string(hitCount) + " hits): " +
+			"sphere tracing " + std::to_string(sphereTimeMS * 1e6 / rayCount) + "ns/ray | " +
+			"slab " + std::to_string(slabTimeMS * 1e6 / rayCount) + "ns/ray | " +
+			"speedup " + std::to_string(sphereTimeMS / slabTimeMS) + "x | " +
+			"entry deviation mean " + std::to_string(hitCount > 0 ? entryDeviationSum / hitCount : 0.0) +
+			" max " + std::to_string(maxEntryDeviation) +
+			" (checksums " + std::to_string(sphereChecksum) + ", " + std::to_string(slabChecksum) + ")");
+	}
+
+	void BenchmarkPacketTracking(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		uint32_t rayCount)
+	{
+		// Rays from a bounding sphere to random points in the volume like MajorantGrid::LogFetchStats,
+		// converted to normalized texture coordinates
+		const float radius = glm::length(volumeSize);
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		TrackingRays rays;
+		rays.Resize(rayCount);
+		for (uint32_t i = 0; i < rayCount; i++)
+		{
+			const float cosTheta = 2.0f * dist(rng) - 1.0f;
+			const float phi = 2.0f * 3.14159265f * dist(rng);
+			const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+			const glm::vec3 origin = radius * glm::vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+			const glm::vec3 target = (glm::vec3(dist(rng), dist(rng), dist(rng)) - 0.5f) * volumeSize;
+			const glm::vec3 dir = glm::normalize(target - origin);
+
+			const glm::vec3 uvwOrigin = (origin / volumeSize) + 0.5f;
+			const glm::vec3 uvwDir = dir / volumeSize;
+			rays.originX[i] = uvwOrigin.x;
+			rays.originY[i] = uvwOrigin.y;
+			rays.originZ[i] = uvwOrigin.z;
+			rays.dirX[i] = uvwDir.x;
+			rays.dirY[i] = uvwDir.y;
+			rays.dirZ[i] = uvwDir.z;
+			rays.tMax[i] = 2.0f * radius;
+		}
+
+		for (const bool ratioTracking : { false, true })
+		{
+			const std::string name = ratioTracking ? "RatioTrack" : "DeltaTrack";
+			std::vector<float> results(rayCount);
+
+			// Scalar per ray loop with an independent random sequence
+			size_t scalarFetchCount = 0;
+			std::mt19937 trackRng(1);
+			const double scalarTimeS = 1e-3 * MeasureMS([&]()
+				{
+					for (uint32_t i = 0; i < rayCount; i++)
+					{
+						const glm::vec3 origin(rays.originX[i], rays.originY[i], rays.originZ[i]);
+						const glm::vec3 dir(rays.dirX[i], rays.dirY[i], rays.dirZ[i]);
+						results[i] = ratioTracking ?
+							ScalarRatioTrack(densityGrid, majorantGrid, densityFactor, origin, dir, rays.tMax[i], trackRng, scalarFetchCount) :
+							ScalarDeltaTrack(densityGrid, majorantGrid, densityFactor, origin, dir, rays.tMax[i], trackRng, scalarFetchCount);
+					}
+				});
+			const glm::vec2 scalarEstimate = GetTrackingEstimate(results, ratioTracking);
+
+			Log::Info(
+				name + " per ray: " + std::to_string(rayCount / scalarTimeS * 1e-6) + " M rays/s | " +
+				std::to_string(scalarFetchCount / scalarTimeS * 1e-6) + " M fetches/s | " +
+				(ratioTracking ? "mean transmittance " : "escape ratio ") +
+				std::to_string(scalarEstimate.x) + " +- " + std::to_string(scalarEstimate.y));
+
+			// Packets
+			for (const PacketIsa isa : { PacketIsa::Scalar, PacketIsa::Avx2, PacketIsa::Avx512 })
+			{
+				if (!IsPacketIsaSupported(isa)) { continue; }
+
+				size_t fetchCount = 0;
+				const double timeS = 1e-3 * MeasureMS([&]()
+					{
+						fetchCount = ratioTracking ?
+							RatioTrackPackets(densityGrid, majorantGrid, densityFactor, rays, 2, results.data(), isa) :
+							DeltaTrackPackets(densityGrid, majorantGrid, densityFactor, rays, 2, results.data(), isa);
+					});
+				const glm::vec2 estimate = GetTrackingEstimate(results, ratioTracking);
+
+				// Both estimates are independent, so their difference should be within a few standard errors
+				const float stdErr = std::sqrt((estimate.y * estimate.y) + (scalarEstimate.y * scalarEstimate.y));
+				const float zScore = stdErr > 0.0f ? (estimate.x - scalarEstimate.x) / stdErr : 0.0f;
+
+				Log::Info(
+					name + " " + GetPacketIsaName(isa) + " x" + std::to_string(GetPacketWidth(isa)) + ": " +
+					std::to_string(rayCount / timeS * 1e-6) + " M rays/s | " +
+					std::to_string(fetchCount / timeS * 1e-6) + " M fetches/s | " +
+					"speedup " + std::to_string(scalarTimeS / timeS) + "x | " +
+					(ratioTracking ? "mean transmittance " : "escape ratio ") +
+					std::to_string(estimate.x) + " +- " + std::to_string(estimate.y) +
+					" | z-score to per ray " + std::to_string(zScore) +
+					(std::abs(zScore) < 4.0f ? "" : " (MISMATCH)"));
+			}
+		}
+	}
+
+	void BenchmarkFreeFlight(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		uint32_t rayCount)
+	{
+		// Rays from a bounding sphere to random points in the volume like BenchmarkPacketTracking
+		const float radius = glm::length(volumeSize);
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<glm::vec3> origins(rayCount);
+		std::vector<glm::vec3> dirs(rayCount);
+		for (uint32_t i = 0; i < rayCount; i++)
+		{
+			const float cosTheta = 2.0f * dist(rng) - 1.0f;
+			const float phi = 2.0f * 3.14159265f * dist(rng);
+			const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+			const glm::vec3 origin = radius * glm::vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+			const glm::vec3 target = (glm::vec3(dist(rng), dist(rng), dist(rng)) - 0.5f) * volumeSize;
+			origins[i] = (origin / volumeSize) + 0.5f;
+			dirs[i] = glm::normalize(target - origin) / volumeSize;
+		}
+
+		// All methods sample the same distance distribution, so the fraction of rays that leave the
+		// volume and the mean collision distance have to agree
+		const std::vector<std::string> names = { "delta", "delta with minorant accept", "decomposition" };
+		glm::vec2 deltaEscape;
+		glm::vec2 deltaDistance;
+		for (uint32_t method = 0; method < names.size(); method++)
+		{
+			size_t stepCount = 0;
+			size_t fetchCount = 0;
+			std::vector<float> results(rayCount);
+			std::mt19937 trackRng(1);
+			const double timeMS = MeasureMS([&]()
+				{
+					for (uint32_t i = 0; i < rayCount; i++)
+					{
+						if (method == 2)
+						{
+							results[i] = ScalarDecompositionTrack(
+								densityGrid,
+								majorantGrid,
+								occupancyGrid,
+								densityFactor,
+								origins[i],
+								dirs[i],
+								2.0f * radius,
+								trackRng,
+								stepCount,
+								fetchCount);
+						}
+						else if (method == 1)
+						{
+							results[i] = ScalarMinorantDeltaTrack(
+								densityGrid,
+								majorantGrid,
+								occupancyGrid,
+								densityFactor,
+								origins[i],
+								dirs[i],
+								2.0f * radius,
+								trackRng,
+								stepCount,
+								fetchCount);
+						}
+						else
+						{
+							// Every tentative collision of plain delta tracking fetches the density
+							results[i] = ScalarDeltaTrack(densityGrid, majorantGrid, densityFactor, origins[i], dirs[i], 2.0f * radius, trackRng, fetchCount);
+							stepCount = fetchCount;
+						}
+					}
+				});
+			const double timeNS = timeMS * 1e6 / rayCount;
+
+			std::vector<float> collisionDistances;
+			for (const float result : results)
+			{
+				if (result >= 0.0f) { collisionDistances.push_back(result); }
+			}
+			const glm::vec2 escape = GetTrackingEstimate(results, false);
+			const glm::vec2 distance = collisionDistances.empty() ? glm::vec2(0.0f) : GetTrackingEstimate(collisionDistances, true);
+			const double collisionCount = static_cast<double>(std::max<size_t>(collisionDistances.size(), 1));
+
+			std::string check;
+			if (method > 0)
+			{
+				const float escapeZ = (escape.x - deltaEscape.x) / std::max(std::sqrt(escape.y * escape.y + deltaEscape.y * deltaEscape.y), 1e-12f);
+				const float distanceZ = (distance.x - deltaDistance.x) / std::max(std::sqrt(distance.y * distance.y + deltaDistance.y * deltaDistance.y), 1e-12f);
+				check =
+					" | z-scores to delta tracking " + std::to_string(escapeZ) + ", " + std::to_string(distanceZ) +
+					(std::abs(escapeZ) < 4.0f && std::abs(distanceZ) < 4.0f ? "" : " (MISMATCH)");
+			}
+			else
+			{
+				deltaEscape = escape;
+				deltaDistance = distance;
+			}
+
+			Log::Info(
+				"Free flight " + names[method] + " tracking (" + std::to_string(rayCount) + " rays): " +
+				std::to_string(static_cast<double>(stepCount) / collisionCount) + " steps and " +
+				std::to_string(static_cast<double>(fetchCount) / collisionCount) + " fetches per collision | " +
+				std::to_string(timeNS) + "ns per ray | " +
+				std::to_string(100.0f * escape.x) + "% escape | mean collision distance " + std::to_string(distance.x) + check);
+		}
+	}
+
+	void BenchmarkShadowTransmittance(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		const DensityMipChain& densityMipChain,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		uint32_t rayCount,
+		uint32_t estimateCount)
+	{
+		// Shadow rays start at random points in occupied cells and leave the volume in a random
+		// direction like the rays towards the dir light and the env map
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		const glm::vec3 cellUvwSize = majorantGrid.GetCellUvwSize();
+		const float radius = glm::length(volumeSize);
+		std::vector<glm::vec3> origins;
+		std::vector<glm::vec3> dirs;
+		for (uint32_t attempt = 0; attempt < 64 * rayCount && origins.size() < rayCount; attempt++)
+		{
+			const glm::vec3 uvw(dist(rng), dist(rng), dist(rng));
+			const glm::ivec3 cell = glm::min(glm::ivec3(uvw / cellUvwSize), glm::ivec3(
+				majorantGrid.GetGrid().GetWidth() - 1,
+				majorantGrid.GetGrid().GetHeight() - 1,
+				majorantGrid.GetGrid().GetDepth() - 1));
+			if (majorantGrid.GetGrid().GetValue(cell.x, cell.y, cell.z) <= 0.0f) { continue; }
+
+			const float cosTheta = 2.0f * dist(rng) - 1.0f;
+			const float phi = 2.0f * 3.14159265f * dist(rng);
+			const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+			origins.push_back(uvw);
+			dirs.push_back(glm::vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi)) / volumeSize);
+		}
+		if (origins.empty())
+		{
+			Log::Warn("Shadow transmittance benchmark found no occupied cells");
+			return;
+		}
+
+		std::vector<double> exactTransmittances(origins.size());
+		for (size_t i = 0; i < origins.size(); i++)
+		{
+			exactTransmittances[i] = std::exp(-ExactOpticalDepth(densityGrid, densityFactor, origins[i], dirs[i], radius));
+		}
+
+		const bool hasMeanLevel = densityMipChain.GetLevelCount() >= DensityMipChain::sc_MaxLevelCount;
+		const DensityGrid* meanGrid = hasMeanLevel ? &densityMipChain.GetLevel(DensityMipChain::sc_MaxLevelCount) : nullptr;
+
+		// Every estimator sees the same rays. MSE times time per estimate is proportional to the time
+		// needed to reach a given MSE, so its ratio to ratio tracking is the relative cost at equal MSE.
+		double ratioCost = 0.0;
+		const std::vector<std::string> names = {
+			"ratio",
+			"residual (min control)",
+			"residual (mean control)",
+			"biased ray marching",
+			"unbiased ray marching" };
+		for (uint32_t estimator = 0; estimator < names.size(); estimator++)
+		{
+			if (estimator == 2 && meanGrid == nullptr) { continue; }
+			const std::string& name = names[estimator];
+
+			size_t fetchCount = 0;
+			double sqrErrorSum = 0.0;
+			double errorSum = 0.0;
+			std::mt19937 trackRng(1);
+			const double timeMS = MeasureMS([&]()
+				{
+					for (size_t i = 0; i < origins.size(); i++)
+					{
+						for (uint32_t j = 0; j < estimateCount; j++)
+						{
+							float transmittance;
+							if (estimator == 0)
+							{
+								transmittance = ScalarRatioTrack(densityGrid, majorantGrid, densityFactor, origins[i], dirs[i], radius, trackRng, fetchCount);
+							}
+							else if (estimator <= 2)
+							{
+								transmittance = ScalarResidualRatioTrack(
+									densityGrid,
+									majorantGrid,
+									occupancyGrid,
+									estimator == 2 ? meanGrid : nullptr,
+									densityFactor,
+									origins[i],
+									dirs[i],
+									radius,
+									trackRng,
+									fetchCount);
+							}
+							else
+							{
+								transmittance = ScalarRayMarch(
+									densityGrid,
+									majorantGrid,
+									occupancyGrid,
+									meanGrid,
+									densityFactor,
+									origins[i],
+									dirs[i],
+									radius,
+									estimator == 4,
+									trackRng,
+									fetchCount);
+							}
+							const double error = static_cast<double>(transmittance) - exactTransmittances[i];
+							errorSum += error;
+							sqrErrorSum += error * error;
+						}
+					}
+				});
+
+			const double count = static_cast<double>(origins.size()) * static_cast<double>(estimateCount);
+			const double timeNS = timeMS * 1e6 / count;
+			const double mse = sqrErrorSum / count;
+			const double bias = errorSum / count;
+			const double cost = mse * timeNS;
+			if (estimator == 0) { ratioCost = cost; }
+			Log::Info(
+				"Shadow transmittance " + name + " (" + std::to_string(origins.size()) + " rays x " + std::to_string(estimateCount) + "): " +
+				"MSE " + std::to_string(mse) + " | " +
+				"bias " + std::to_string(bias) + " +- " + std::to_string(std::sqrt(mse / count)) + " | " +
+				std::to_string(static_cast<double>(fetchCount) / count) + " fetches and " +
+				std::to_string(timeNS) + "ns per estimate | " +
+				"cost at equal MSE " + std::to_string(ratioCost > 0.0 ? cost / ratioCost : 0.0) + "x of ratio tracking");
+		}
+	}
+
+	// Random points in occupied majorant cells like the shadow ray origins of BenchmarkShadowTransmittance
+	static std::vector<glm::vec3> SampleOccupiedUvws(const MajorantGrid& majorantGrid, uint32_t count)
+	{
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		const glm::vec3 cellUvwSize = majorantGrid.GetCellUvwSize();
+		std::vector<glm::vec3> uvws;
+		for (uint32_t attempt = 0; attempt < 64 * count && uvws.size() < count; attempt++)
+		{
+			const glm::vec3 uvw(dist(rng), dist(rng), dist(rng));
+			const glm::ivec3 cell = glm::min(glm::ivec3(uvw / cellUvwSize), glm::ivec3(
+				majorantGrid.GetGrid().GetWidth() - 1,
+				majorantGrid.GetGrid().GetHeight() - 1,
+				majorantGrid.GetGrid().GetDepth() - 1));
+			if (majorantGrid.GetGrid().GetValue(cell.x, cell.y, cell.z) > 0.0f) { uvws.push_back(uvw); }
+		}
+		return uvws;
+	}
+
+	// Compares lookup(i) with single ratio tracking estimates of shadow ray i from origins[i] along
+	// dirs[i] (normalized coordinates per world unit) over tMaxes[i] and logs both against the exact
+	// transmittance of the voxel grid
+	template<typename Lookup>
+	static void LogCachedTransmittance(
+		const std::string& name,
+		uint32_t texelCount,
+		double buildMS,
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const std::vector<glm::vec3>& origins,
+		const std::vector<glm::vec3>& dirs,
+		const std::vector<float>& tMaxes,
+		const Lookup& lookup)
+	{
+		std::vector<double> exactTransmittances(origins.size());
+		for (size_t i = 0; i < origins.size(); i++)
+		{
+			exactTransmittances[i] = std::exp(-ExactOpticalDepth(densityGrid, densityFactor, origins[i], dirs[i], tMaxes[i]));
+		}
+
+		// Lookups are repeated so that the timer sees more than a few microseconds
+		const uint32_t lookupRepeats = 64;
+		std::vector<float> cachedTransmittances(origins.size());
+		const double lookupMS = MeasureMS([&]()
+			{
+				for (uint32_t j = 0; j < lookupRepeats; j++)
+				{
+					for (size_t i = 0; i < origins.size(); i++) { cachedTransmittances[i] = lookup(i); }
+				}
+			});
+		const double lookupNS = lookupMS * 1e6 / (static_cast<double>(origins.size()) * lookupRepeats);
+
+		size_t fetchCount = 0;
+		std::vector<float> ratioTransmittances(origins.size());
+		std::mt19937 trackRng(1);
+		const double ratioMS = MeasureMS([&]()
+			{
+				for (size_t i = 0; i < origins.size(); i++)
+				{
+					ratioTransmittances[i] = ScalarRatioTrack(densityGrid, majorantGrid, densityFactor, origins[i], dirs[i], tMaxes[i], trackRng, fetchCount);
+				}
+			});
+		const double ratioNS = ratioMS * 1e6 / static_cast<double>(origins.size());
+
+		double cachedSqrErrorSum = 0.0;
+		double cachedErrorSum = 0.0;
+		double cachedMaxError = 0.0;
+		double ratioSqrErrorSum = 0.0;
+		for (size_t i = 0; i < origins.size(); i++)
+		{
+			const double cachedError = static_cast<double>(cachedTransmittances[i]) - exactTransmittances[i];
+			cachedSqrErrorSum += cachedError * cachedError;
+			cachedErrorSum += cachedError;
+			cachedMaxError = std::max(cachedMaxError, std::abs(cachedError));
+			const double ratioError = static_cast<double>(ratioTransmittances[i]) - exactTransmittances[i];
+			ratioSqrErrorSum += ratioError * ratioError;
+		}
+		const double count = static_cast<double>(origins.size());
+
+		// Shadow rays per rebuild above which the cache saves time
+		const double breakEven = ratioNS > lookupNS ? buildMS * 1e6 / (ratioNS - lookupNS) : 0.0;
+		Log::Info(
+			name + " (" + std::to_string(texelCount) + " texels, " + std::to_string(origins.size()) + " rays): build " +
+			std::to_string(buildMS) + "ms | lookup " + std::to_string(lookupNS) + "ns, MSE " + std::to_string(cachedSqrErrorSum / count) +
+			", bias " + std::to_string(cachedErrorSum / count) + ", max error " + std::to_string(cachedMaxError) + " | ratio tracking " +
+			std::to_string(ratioNS) + "ns, " + std::to_string(static_cast<double>(fetchCount) / count) + " fetches, MSE " +
+			std::to_string(ratioSqrErrorSum / count) + " | " + std::to_string(ratioNS / std::max(lookupNS, 1e-9)) + "x faster per ray" +
+			", faster after " + std::to_string(breakEven) + " shadow rays per rebuild");
+	}
+
+	void BenchmarkTransmittanceGrid(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const DensityMipChain& densityMipChain,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		const glm::vec3& toLight,
+		uint32_t rayCount)
+	{
+		const glm::uvec3 voxelExtent(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth());
+		TransmittanceGrid transmittanceGrid(densityMipChain, voxelExtent, volumeSize, densityFactor);
+		const uint32_t buildCount = 4;
+		const double buildMS = MeasureMS([&]()
+			{
+				for (uint32_t i = 0; i < buildCount; i++) { transmittanceGrid.BuildDirLight(toLight); }
+			}) / buildCount;
+
+		const std::vector<glm::vec3> origins = SampleOccupiedUvws(majorantGrid, rayCount);
+		if (origins.empty())
+		{
+			Log::Warn("Transmittance grid benchmark found no occupied cells");
+			return;
+		}
+		const std::vector<glm::vec3> dirs(origins.size(), glm::normalize(toLight) / volumeSize);
+		const std::vector<float> tMaxes(origins.size(), glm::length(volumeSize));
+
+		LogCachedTransmittance(
+			"Dir light transmittance grid",
+			static_cast<uint32_t>(transmittanceGrid.GetGrid().GetVoxelCount()),
+			buildMS,
+			densityGrid,
+			majorantGrid,
+			densityFactor,
+			origins,
+			dirs,
+			tMaxes,
+			[&](size_t i) { return transmittanceGrid.Sample(origins[i]); });
+	}
+
+	void BenchmarkSphericalTransmittanceGrid(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const DensityMipChain& densityMipChain,
+		const glm::vec3& volumeSize,
+		const glm::vec3& volumePos,
+		float densityFactor,
+		const glm::vec3& lightPos,
+		uint32_t rayCount)
+	{
+		const glm::uvec3 voxelExtent(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth());
+		SphericalTransmittanceGrid transmittanceGrid(densityMipChain, voxelExtent, volumeSize, volumePos, densityFactor);
+		const uint32_t buildCount = 4;
+		const double buildMS = MeasureMS([&]()
+			{
+				for (uint32_t i = 0; i < buildCount; i++) { transmittanceGrid.BuildPointLight(lightPos); }
+			}) / buildCount;
+
+		const std::vector<glm::vec3> origins = SampleOccupiedUvws(majorantGrid, rayCount);
+		if (origins.empty())
+		{
+			Log::Warn("Spherical transmittance grid benchmark found no occupied cells");
+			return;
+		}
+		const glm::vec3 lightUvw = ((lightPos - volumePos) / volumeSize) + 0.5f;
+		std::vector<glm::vec3> positions(origins.size());
+		std::vector<glm::vec3> dirs(origins.size());
+		std::vector<float> tMaxes(origins.size());
+		for (size_t i = 0; i < origins.size(); i++)
+		{
+			positions[i] = ((origins[i] - 0.5f) * volumeSize) + volumePos;
+			tMaxes[i] = glm::length((lightUvw - origins[i]) * volumeSize);
+			dirs[i] = (lightUvw - origins[i]) / std::max(tMaxes[i], 1e-6f);
+		}
+
+		LogCachedTransmittance(
+			"Point light spherical transmittance grid",
+			static_cast<uint32_t>(transmittanceGrid.GetGrid().GetVoxelCount()),
+			buildMS,
+			densityGrid,
+			majorantGrid,
+			densityFactor,
+			origins,
+			dirs,
+			tMaxes,
+			[&](size_t i) { return transmittanceGrid.Sample(positions[i]); });
+	}
+
+	void BenchmarkBrickSampling(const DensityGrid& densityGrid, const BrickGrid& brickGrid, uint32_t sampleCount)
+	{
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		// Random positions are the worst case for caches. Marched positions step about half a voxel
+		// along a ray, which is closer to the access pattern of tracking.
+		const float stepSize = 0.5f / static_cast<float>(std::max(densityGrid.GetWidth(), std::max(densityGrid.GetHeight(), densityGrid.GetDepth())));
+		std::vector<glm::vec3> randomPositions(sampleCount);
+		std::vector<glm::vec3> marchedPositions(sampleCount);
+		glm::vec3 pos(0.5f);
+		glm::vec3 dir(1.0f, 0.0f, 0.0f);
+		for (uint32_t i = 0; i < sampleCount; i++)
+		{
+			randomPositions[i] = glm::vec3(dist(rng), dist(rng), dist(rng));
+
+			pos += stepSize * dir;
+			if (glm::any(glm::lessThan(pos, glm::vec3(0.0f))) || glm::any(glm::greaterThanEqual(pos, glm::vec3(1.0f))))
+			{
+				pos = glm::vec3(dist(rng), dist(rng), dist(rng));
+				dir = glm::normalize(2.0f * glm::vec3(dist(rng), dist(rng), dist(rng)) - 1.0f);
+			}
+			marchedPositions[i] = pos;
+		}
+
+		const double denseMB = static_cast<double>(densityGrid.GetSizeInBytes()) / (1024.0 * 1024.0);
+		const double brickMB = static_cast<double>(brickGrid.GetSizeInBytes()) / (1024.0 * 1024.0);
+		Log::Info(
+			"BrickGrid: " + std::to_string(brickGrid.GetAtlasBrickCount() - 1) + " occupied bricks | " +
+			std::to_string(brickMB) + "MB instead of " + std::to_string(denseMB) + "MB (" +
+			std::to_string(100.0 * brickMB / denseMB) + "%)");
+
+		for (const bool marched : { false, true })
+		{
+			const std::vector<glm::vec3>& positions = marched ? marchedPositions : randomPositions;
+
+			// Untimed pass that pages in mapped voxels of both grids
+			float checksum = 0.0f;
+			for (uint32_t i = 0; i < sampleCount; i++)
+			{
+				checksum += densityGrid.SampleNearest(positions[i].x, positions[i].y, positions[i].z);
+				checksum += brickGrid.SampleNearest(positions[i].x, positions[i].y, positions[i].z);
+			}
+
+			std::vector<float> denseValues(sampleCount);
+			const double denseTimeMS = MeasureMS([&]()
+				{
+					for (uint32_t i = 0; i < sampleCount; i++)
+					{
+						denseValues[i] = densityGrid.SampleNearest(positions[i].x, positions[i].y, positions[i].z);
+					}
+				});
+
+			std::vector<float> brickValues(sampleCount);
+			const double brickTimeMS = MeasureMS([&]()
+				{
+					for (uint32_t i = 0; i < sampleCount; i++)
+					{
+						brickValues[i] = brickGrid.SampleNearest(positions[i].x, positions[i].y, positions[i].z);
+					}
+				});
+
+			const bool match = denseValues == brickValues;
+			Log::Info(
+				std::string("BrickGrid ") + (marched ? "marched" : "random") + " lookups: " +
+				"dense " + std::to_string(denseTimeMS * 1e6 / sampleCount) + "ns | " +
+				"bricks " + std::to_string(brickTimeMS * 1e6 / sampleCount) + "ns | " +
+				"ratio " + std::to_string(brickTimeMS / denseTimeMS) + "x" +
+				" (checksum " + std::to_string(checksum) + ")" +
+				(match ? "" : " (MISMATCH)"));
+		}
+	}
+
+	void BenchmarkHdrEnvMapSampling(const std::vector<float>& hdr4f, uint32_t width, uint32_t height, uint32_t sampleCount)
+	{
+		const size_t texelCount = static_cast<size_t>(width) * height;
+
+		std::array<std::vector<float>, 2> invCdf;
+		const double cdfBuildMS = MeasureMS([&]() { invCdf = Hdr4fToCdf(hdr4f, width, height); });
+
+		std::vector<float> aliasHdr4f = hdr4f;
+		AliasTable aliasTable;
+		const double aliasBuildMS = MeasureMS([&]() { aliasTable = Hdr4fToAliasTable(aliasHdr4f, width, height); });
+
+		// Same texel selection as the former SampleHdrEnvMapDir, two dependent table lookups
+		auto sampleCdf = [&](float u0, float u1)
+		{
+			const uint32_t row = std::min(static_cast<uint32_t>(u0 * static_cast<float>(height)), height - 1);
+			const uint32_t y = std::min(static_cast<uint32_t>((invCdf[1][row] * static_cast<float>(height)) + 0.5f), height - 1);
+			const uint32_t column = std::min(static_cast<uint32_t>(u1 * static_cast<float>(width)), width - 1);
+			const uint32_t x = std::min(static_cast<uint32_t>((invCdf[0][(static_cast<size_t>(y) * width) + column] * static_cast<float>(width)) + 0.5f), width - 1);
+			return (y * width) + x;
+		};
+
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<glm::vec2> randoms(sampleCount);
+		for (glm::vec2& u : randoms) { u = glm::vec2(dist(rng), dist(rng)); }
+
+		uint64_t cdfChecksum = 0;
+		const double cdfSampleMS = MeasureMS([&]()
+			{
+				for (const glm::vec2& u : randoms) { cdfChecksum += sampleCdf(u.x, u.y); }
+			});
+
+		uint64_t aliasChecksum = 0;
+		const double aliasSampleMS = MeasureMS([&]()
+			{
+				for (const glm::vec2& u : randoms) { aliasChecksum += aliasTable.Sample(u.x, u.y); }
+			});
+
+		// Exact sampling probabilities of both paths against the brightness they are built from. The cdf
+		// tables only have one entry per texel, so texels below that resolution are never picked.
+		std::vector<double> cdfPmf(texelCount, 0.0);
+		for (uint32_t row = 0; row < height; row++)
+		{
+			for (uint32_t column = 0; column < width; column++)
+			{
+				const float u0 = (static_cast<float>(row) + 0.5f) / static_cast<float>(height);
+				const float u1 = (static_cast<float>(column) + 0.5f) / static_cast<float>(width);
+				cdfPmf[sampleCdf(u0, u1)] += 1.0 / static_cast<double>(texelCount);
+			}
+		}
+
+		std::vector<double> aliasPmf(texelCount, 0.0);
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			const AliasTable::Entry& entry = aliasTable.GetEntries()[i];
+			aliasPmf[i] += entry.prob / static_cast<double>(texelCount);
+			aliasPmf[entry.alias] += (1.0 - entry.prob) / static_cast<double>(texelCount);
+		}
+
+		double brightnessSum = 0.0;
+		for (size_t i = 0; i < texelCount; i++) { brightnessSum += hdr4f[i * 4] + hdr4f[(i * 4) + 1] + hdr4f[(i * 4) + 2]; }
+
+		double cdfError = 0.0;
+		double cdfLostBrightness = 0.0;
+		double aliasError = 0.0;
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			const double brightness = (hdr4f[i * 4] + hdr4f[(i * 4) + 1] + hdr4f[(i * 4) + 2]) / brightnessSum;
+			cdfError += std::abs(cdfPmf[i] - brightness);
+			if (cdfPmf[i] == 0.0) { cdfLostBrightness += brightness; }
+			aliasError += std::abs(aliasPmf[i] - aliasTable.GetPmf(static_cast<uint32_t>(i)));
+		}
+
+		Log::Info(
+			"Hdr env map sampling (" + std::to_string(width) + "x" + std::to_string(height) + ", " + std::to_string(sampleCount) + " samples): " +
+			"cdf build " + std::to_string(cdfBuildMS) + "ms, " + std::to_string(sampleCount / (cdfSampleMS * 1e3)) + "M samples/s, " +
+			"pmf error " + std::to_string(0.5 * cdfError) + ", never sampled " + std::to_string(100.0 * cdfLostBrightness) + "% of brightness | " +
+			"alias build " + std::to_string(aliasBuildMS) + "ms, " + std::to_string(sampleCount / (aliasSampleMS * 1e3)) + "M samples/s, " +
+			"pmf error " + std::to_string(0.5 * aliasError) +
+			" (checksums " + std::to_string(cdfChecksum) + ", " + std::to_string(aliasChecksum) + ")");
+	}
+
+	// Rotation around axis like rotationMatrix from the former dir_gen.glsl
+	static glm::vec3 MatrixRotate(const glm::vec3& v, glm::vec3 axis, float angle)
+	{
+		axis = glm::normalize(axis);
+		const float s = std::sin(angle);
+		const float c = std::cos(angle);
+		const float oc = 1.0f - c;
+
+		const glm::vec3 col0(oc * axis.x * axis.x + c, oc * axis.x * axis.y - axis.z * s, oc * axis.z * axis.x + axis.y * s);
+		const glm::vec3 col1(oc * axis.x * axis.y + axis.z * s, oc * axis.y * axis.y + c, oc * axis.y * axis.z - axis.x * s);
+		const glm::vec3 col2(oc * axis.z * axis.x - axis.y * s, oc * axis.y * axis.z + axis.x * s, oc * axis.z * axis.z + c);
+		return (col0 * v.x) + (col1 * v.y) + (col2 * v.z);
+	}
+
+	// Henyey-Greenstein sampling of the former NewRayDir, which rotates around an orthogonal vector and
+	// then around the old direction. The orthogonal vector is 0 for directions like (-1, 0, 0).
+	static glm::vec3 MatrixNewRayDir(glm::vec3 oldRayDir, float g, float u0, float u1)
+	{
+		oldRayDir = glm::normalize(oldRayDir);
+		glm::vec3 orthoDir = oldRayDir.z < oldRayDir.x ? glm::vec3(oldRayDir.y, -oldRayDir.x, 0.0f) : glm::vec3(0.0f, -oldRayDir.z, oldRayDir.y);
+		orthoDir = glm::normalize(orthoDir);
+
+		const float sqrTerm = (1.0f - g * g) / (1.0f - g + (2.0f * g * u0));
+		const float cosTheta = (1.0f + (g * g) - (sqrTerm * sqrTerm)) / (2.0f * g);
+		const glm::vec3 newRayDir = MatrixRotate(oldRayDir, orthoDir, std::acos(glm::clamp(cosTheta, -1.0f, 1.0f)));
+		return glm::normalize(MatrixRotate(newRayDir, oldRayDir, 2.0f * 3.14159265358979f * u1));
+	}
+
+	// Samples a direction around every dir and logs the histogram of cos theta against the exact
+	// density. The bins are even in x = ((1 - cos theta) / 2)^(1/4) like the density table, so the
+	// forward peak is split into many bins.
+	static void LogPhaseFunctionHistogram(
+		const std::string& name,
+		const PhaseFunction& phaseFunction,
+		const std::function<double(double)>& density,
+		const std::vector<glm::vec3>& dirs,
+		const std::vector<glm::vec2>& randoms)
+	{
+		const uint32_t binCount = 64;
+		const uint32_t stepsPerBin = 256;
+		auto warpToCosTheta = [](double x) { return 1.0 - (2.0 * x * x * x * x); };
+
+		// Exact probability of every bin with the trapezoidal rule over cos theta
+		std::vector<double> expected(binCount, 0.0);
+		double totalMass = 0.0;
+		for (uint32_t bin = 0; bin < binCount; bin++)
+		{
+			for (uint32_t step = 0; step < stepsPerBin; step++)
+			{
+				const double cos0 = warpToCosTheta(static_cast<double>((bin * stepsPerBin) + step) / (binCount * stepsPerBin));
+				const double cos1 = warpToCosTheta(static_cast<double>((bin * stepsPerBin) + step + 1) / (binCount * stepsPerBin));
+				expected[bin] += 0.5 * (density(cos0) + density(cos1)) * (cos0 - cos1);
+			}
+			totalMass += expected[bin];
+		}
+
+		const size_t sampleCount = dirs.size();
+		std::vector<glm::vec3> newDirs(sampleCount);
+		const double sampleMS = MeasureMS([&]()
+			{
+				for (size_t i = 0; i < sampleCount; i++) { newDirs[i] = phaseFunction.Sample(dirs[i], randoms[i].x, randoms[i].y); }
+			});
+
+		// 1 - cos theta = |newDir - dir|^2 / 2 keeps small angles, which the dot product rounds to 1
+		std::vector<uint64_t> counts(binCount, 0);
+		uint32_t invalidCount = 0;
+		for (size_t i = 0; i < sampleCount; i++)
+		{
+			const glm::vec3 diff = newDirs[i] - dirs[i];
+			const float oneMinusCosTheta = 0.5f * glm::dot(diff, diff);
+			if (!std::isfinite(oneMinusCosTheta) || std::abs(glm::length(newDirs[i]) - 1.0f) > 1e-4f)
+			{
+				invalidCount++;
+				continue;
+			}
+			const float x = std::sqrt(std::sqrt(std::clamp(0.5f * oneMinusCosTheta, 0.0f, 1.0f)));
+			counts[std::min(static_cast<uint32_t>(x * binCount), binCount - 1)]++;
+		}
+
+		// Bins with less than 5 expected samples are left out like in a regular chi-square test
+		double chiSquare = 0.0;
+		double maxZ = 0.0;
+		uint32_t testedBinCount = 0;
+		for (uint32_t bin = 0; bin < binCount; bin++)
+		{
+			const double expectedCount = expected[bin] / totalMass * static_cast<double>(sampleCount);
+			if (expectedCount < 5.0) { continue; }
+			const double diff = static_cast<double>(counts[bin]) - expectedCount;
+			chiSquare += diff * diff / expectedCount;
+			maxZ = std::max(maxZ, std::abs(diff) / std::sqrt(expectedCount));
+			testedBinCount++;
+		}
+		const double chiSquarePerDof = testedBinCount > 1 ? chiSquare / (testedBinCount - 1) : 0.0;
+
+		double maxDensityError = 0.0;
+		const uint32_t densityCheckCount = 4096;
+		for (uint32_t i = 0; i < densityCheckCount; i++)
+		{
+			// At a cos theta that a float holds exactly, the rounding is not the error of the table
+			const float cosTheta = static_cast<float>(warpToCosTheta((static_cast<double>(i) + 0.5) / densityCheckCount));
+			const double exact = density(cosTheta) / totalMass;
+			if (exact <= 0.0) { continue; }
+			maxDensityError = std::max(maxDensityError, std::abs(phaseFunction.Eval(cosTheta) - exact) / exact);
+		}
+
+		Log::Info(
+			"Phase function " + name + " (mean cosine " + std::to_string(phaseFunction.GetG()) + "): " +
+			std::to_string(sampleCount / (sampleMS * 1e3)) + "M samples/s, " +
+			"chi-square/dof " + std::to_string(chiSquarePerDof) + " over " + std::to_string(testedBinCount) + " bins, max |z| " + std::to_string(maxZ) +
+			(maxZ < 5.0 && invalidCount == 0 ? "" : " (MISMATCH)") +
+			", density table max error " + std::to_string(100.0 * maxDensityError) + "%" +
+			", invalid directions " + std::to_string(invalidCount));
+	}
+
+	void BenchmarkPhaseFunctionSampling(float g, uint32_t sampleCount)
+	{
+		// Uniform directions after the axes, which the former NewRayDir got wrong
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<glm::vec3> dirs = {
+			glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, -1.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f) };
+		while (dirs.size() < sampleCount)
+		{
+			const float cosTheta = 1.0f - (2.0f * dist(rng));
+			const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - (cosTheta * cosTheta)));
+			const float phi = 2.0f * 3.14159265358979f * dist(rng);
+			dirs.push_back(glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta));
+		}
+		std::vector<glm::vec2> randoms(dirs.size());
+		for (glm::vec2& u : randoms) { u = glm::vec2(dist(rng), dist(rng)); }
+
+		// NaN directions of the former NewRayDir, counted for all random numbers around (-1, 0, 0)
+		uint32_t matrixInvalidCount = 0;
+		float matrixChecksum = 0.0f;
+		const double matrixMS = MeasureMS([&]()
+			{
+				for (size_t i = 0; i < dirs.size(); i++)
+				{
+					const glm::vec3 newDir = MatrixNewRayDir(dirs[i], g, randoms[i].x, randoms[i].y);
+					matrixChecksum += newDir.x;
+				}
+			});
+		for (const glm::vec2& u : randoms)
+		{
+			const glm::vec3 newDir = MatrixNewRayDir(dirs[0], g, u.x, u.y);
+			if (!std::isfinite(newDir.x + newDir.y + newDir.z)) { matrixInvalidCount++; }
+		}
+
+		const PhaseFunction hg(g);
+		uint32_t basisInvalidCount = 0;
+		float basisChecksum = 0.0f;
+		const double basisMS = MeasureMS([&]()
+			{
+				for (size_t i = 0; i < dirs.size(); i++)
+				{
+					const glm::vec3 newDir = hg.Sample(dirs[i], randoms[i].x, randoms[i].y);
+					basisChecksum += newDir.x;
+				}
+			});
+		for (const glm::vec2& u : randoms)
+		{
+			const glm::vec3 newDir = hg.Sample(dirs[0], u.x, u.y);
+			if (!std::isfinite(newDir.x + newDir.y + newDir.z) || std::abs(glm::length(newDir) - 1.0f) > 1e-4f) { basisInvalidCount++; }
+		}
+
+		Log::Info(
+			"Henyey-Greenstein direction sampling (g " + std::to_string(g) + ", " + std::to_string(dirs.size()) + " samples): " +
+			"matrix rotation " + std::to_string(dirs.size() / (matrixMS * 1e3)) + "M samples/s, " +
+			std::to_string(matrixInvalidCount) + " invalid around (-1, 0, 0) | " +
+			"orthonormal basis " + std::to_string(dirs.size() / (basisMS * 1e3)) + "M samples/s, " +
+			std::to_string(basisInvalidCount) + " invalid around (-1, 0, 0)" +
+			" (checksums " + std::to_string(matrixChecksum) + ", " + std::to_string(basisChecksum) + ")");
+
+		auto hgDensity = [g](double cosTheta) { return HgPhaseFunc(g, cosTheta); };
+		LogPhaseFunctionHistogram("Henyey-Greenstein closed form", hg, hgDensity, dirs, randoms);
+		LogPhaseFunctionHistogram("Henyey-Greenstein table", PhaseFunction(PhaseFuncMode::Tabulated, hgDensity), hgDensity, dirs, randoms);
+
+		for (const float dropletDiameter : { 5.0f, 20.0f, 50.0f })
+		{
+			auto mieDensity = [dropletDiameter](double cosTheta) { return ApproximateMiePhaseFunc(dropletDiameter, cosTheta); };
+			LogPhaseFunctionHistogram(
+				"approximate Mie " + std::to_string(dropletDiameter) + "um",
+				PhaseFunction(PhaseFuncMode::ApproximateMie, mieDensity),
+				mieDensity,
+				dirs,
+				randoms);
+		}
+
+		auto rayleighDensity = [](double cosTheta) { return 0.375 * (1.0 + (cosTheta * cosTheta)); };
+		LogPhaseFunctionHistogram("Rayleigh table", PhaseFunction(PhaseFuncMode::Tabulated, rayleighDensity), rayleighDensity, dirs, randoms);
+	}
+
+	void BenchmarkHdrEnvMapLoad(const std::vector<float>& hdr4f, uint32_t width, uint32_t height, float max)
+	{
+		const double sizeMB = static_cast<double>(hdr4f.size() * sizeof(float)) / (1024.0 * 1024.0);
+
+		float scalarMaxVal;
+		std::vector<float> scalarClamped;
+		const double scalarClampMS = MeasureMS([&]() { scalarClamped = ScalarClampHdr4f(hdr4f, width, height, max, scalarMaxVal); });
+
+		float maxVal;
+		size_t maxX;
+		size_t maxY;
+		std::vector<float> clamped;
+		const double clampMS = MeasureMS([&]() { clamped = ClampHdr4f(hdr4f.data(), width, height, max, false, maxVal, maxX, maxY); });
+
+		std::array<std::vector<float>, 2> scalarInvCdf;
+		const double scalarCdfMS = MeasureMS([&]() { scalarInvCdf = ScalarHdr4fToCdf(clamped, width, height); });
+
+		std::array<std::vector<float>, 2> invCdf;
+		const double cdfMS = MeasureMS([&]() { invCdf = Hdr4fToCdf(clamped, width, height); });
+
+		// The flat path compares against unnormalized cdfs, which can move entries next to a threshold
+		// by one texel
+		size_t invCdfMismatches = 0;
+		for (size_t i = 0; i < invCdf[0].size(); i++) { invCdfMismatches += invCdf[0][i] != scalarInvCdf[0][i]; }
+		for (size_t i = 0; i < invCdf[1].size(); i++) { invCdfMismatches += invCdf[1][i] != scalarInvCdf[1][i]; }
+
+		Log::Info(
+			"Hdr env map load (" + std::to_string(width) + "x" + std::to_string(height) + ", " + std::to_string(sizeMB) + "MB): " +
+			"clamp scalar " + std::to_string(sizeMB * 1e3 / scalarClampMS) + "MB/s, parallel " + std::to_string(sizeMB * 1e3 / clampMS) + "MB/s" +
+			(clamped == scalarClamped && maxVal == scalarMaxVal ? "" : " (MISMATCH)") + " | " +
+			"cdf scalar " + std::to_string(sizeMB * 1e3 / scalarCdfMS) + "MB/s, parallel " + std::to_string(sizeMB * 1e3 / cdfMS) + "MB/s, " +
+			std::to_string(invCdfMismatches) + " of " + std::to_string(invCdf[0].size() + invCdf[1].size()) + " inverse cdf entries differ");
+	}
+
+	void BenchmarkVolumeBounds(
+		const DensityGrid& densityGrid,
+		float densityFactor,
+		const glm::vec3& cameraPos,
+		const glm::vec3& cameraDir,
+		const glm::vec3& cameraUp,
+		float fov,
+		uint32_t width,
+		uint32_t height,
+		uint32_t pixelStep)
+	{
+		struct BoundsStats
+		{
+			size_t rayCount = 0;
+			size_t hitCount = 0;
+			size_t emptyHitCount = 0;
+			double boxDistance = 0.0;
+			double emptyDistance = 0.0;
+		};
+
+		const glm::uvec3 sourceExtent = densityGrid.GetSourceExtent();
+		const glm::vec3 sourceSize = HpmSceneSetup::GetVolumeSize(sourceExtent.x, sourceExtent.y, sourceExtent.z);
+		const glm::vec3 size = HpmSceneSetup::GetVolumeSize(densityGrid);
+		const glm::vec3 pos = HpmSceneSetup::GetVolumePosition(densityGrid);
+		// Voxels outside of the trimmed box are zero, so both boxes can share the same lookup
+		const float stepSize = 0.5f * sourceSize.x / static_cast<float>(sourceExtent.x);
+		const float globalMajorant = densityFactor * densityGrid.GetMaxValue();
+
+		const glm::vec3 forward = glm::normalize(cameraDir);
+		const glm::vec3 right = glm::normalize(glm::cross(forward, cameraUp));
+		const glm::vec3 up = glm::cross(right, forward);
+		const float tanHalfFov = std::tan(fov / 2.0f);
+		const float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+
+		const uint32_t rowCount = (height + pixelStep - 1) / pixelStep;
+		for (const bool trimmed : { false, true })
+		{
+			const glm::vec3 boxPos = trimmed ? pos : glm::vec3(0.0f);
+			const glm::vec3 halfSize = (trimmed ? size : sourceSize) / 2.0f;
+
+			tbb::combinable<BoundsStats> localStats;
+			tbb::parallel_for(0u, rowCount, [&](uint32_t row)
+				{
+					BoundsStats& stats = localStats.local();
+					const uint32_t y = row * pixelStep;
+					for (uint32_t x = 0; x < width; x += pixelStep)
+					{
+						stats.rayCount++;
+
+						const float ndcX = ((static_cast<float>(x) + 0.5f) / static_cast<float>(width)) * 2.0f - 1.0f;
+						const float ndcY = ((static_cast<float>(y) + 0.5f) / static_cast<float>(height)) * 2.0f - 1.0f;
+						const glm::vec3 rd = glm::normalize(forward + (ndcX * tanHalfFov * aspectRatio * right) + (ndcY * tanHalfFov * up));
+						const glm::vec2 entryExit = SlabEntryExit(cameraPos - boxPos, rd, halfSize);
+						if (!(entryExit.x < entryExit.y)) { continue; }
+
+						stats.hitCount++;
+						stats.boxDistance += entryExit.y - entryExit.x;
+
+						float t = entryExit.x;
+						for (; t < entryExit.y; t += stepSize)
+						{
+							const glm::vec3 uvw = ((cameraPos + t * rd - pos) / size) + 0.5f;
+							if (densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) > 0.0f) { break; }
+						}
+
+						if (t >= entryExit.y) { stats.emptyHitCount++; }
+						stats.emptyDistance += std::min(t, entryExit.y) - entryExit.x;
+					}
+				});
+
+			const BoundsStats stats = localStats.combine([](const BoundsStats& a, const BoundsStats& b)
+				{
+					BoundsStats sum;
+					sum.rayCount = a.rayCount + b.rayCount;
+					sum.hitCount = a.hitCount + b.hitCount;
+					sum.emptyHitCount = a.emptyHitCount + b.emptyHitCount;
+					sum.boxDistance = a.boxDistance + b.boxDistance;
+					sum.emptyDistance = a.emptyDistance + b.emptyDistance;
+					return sum;
+				});
+
+			const double hitCount = static_cast<double>(std::max<size_t>(stats.hitCount, 1));
+			Log::Info(
+				std::string("Camera rays vs ") + (trimmed ? "trimmed" : "file_bbox") + " volume box: " +
+				std::to_string(100.0 * static_cast<double>(stats.hitCount) / static_cast<double>(stats.rayCount)) + "% enter | " +
+				std::to_string(100.0 * static_cast<double>(stats.emptyHitCount) / hitCount) + "% of those only see empty space | " +
+				"distance in box " + std::to_string(stats.boxDistance / hitCount) + " | " +
+				"empty distance before the cloud " + std::to_string(stats.emptyDistance / hitCount) +
+				" (" + std::to_string(globalMajorant * stats.emptyDistance / hitCount) + " global majorant steps)");
+		}
+	}
+
+	// Radiance over the nrc inputs, detailed in the position and smooth in the direction angles
+	static void SyntheticNrcRadiance(const float* input, float* radiance)
+	{
+		const float pattern = std::sin(9.0f * input[0]) * std::cos(7.0f * input[1]) * std::sin(11.0f * input[2] + 1.0f);
+		const float angular = 0.5f + (input[3] * (1.0f - input[4]));
+		radiance[0] = angular * (1.0f + pattern);
+		radiance[1] = angular * (1.0f + (0.5f * pattern));
+		radiance[2] = angular * (1.0f - (0.5f * pattern));
+	}
+
+	// Largest difference between the parameter and input gradients of a small CpuMlp and central
+	// differences of the loss sum(weight * output), relative to the largest gradient
+	static float CheckCpuMlpGradients()
+	{
+		const uint32_t inputCount = 7;
+		const uint32_t outputCount = 3;
+		const uint32_t count = 5;
+		const CpuMlp mlp(inputCount, outputCount, 16, 2);
+
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::vector<float> params(mlp.GetParamCount());
+		mlp.InitParams(params.data(), rng);
+		std::vector<float> inputs(count * inputCount);
+		for (float& input : inputs) { input = dist(rng); }
+		std::vector<float> lossWeights(count * outputCount);
+		for (float& weight : lossWeights) { weight = dist(rng); }
+
+		std::vector<float> activations(mlp.GetActivationCount());
+		auto evalLoss = [&]()
+		{
+			std::copy(inputs.begin(), inputs.end(), activations.begin());
+			const float* output = mlp.Forward(params.data(), activations.data(), count);
+			double loss = 0.0;
+			for (uint32_t i = 0; i < count * outputCount; i++) { loss += lossWeights[i] * output[i]; }
+			return loss;
+		};
+
+		evalLoss();
+		std::vector<float> deltas(mlp.GetDeltaCount());
+		std::vector<float> scratch(mlp.GetDeltaCount());
+		std::copy(lossWeights.begin(), lossWeights.end(), deltas.begin());
+		std::vector<float> paramGrads(params.size(), 0.0f);
+		std::vector<float> inputGrads(inputs.size());
+		std::vector<float> transposedWeights(mlp.GetTransposedWeightCount());
+		mlp.TransposeWeights(params.data(), transposedWeights.data());
+		mlp.Backward(transposedWeights.data(), activations.data(), deltas.data(), scratch.data(), count, paramGrads.data(), inputGrads.data());
+
+		const float epsilon = 1e-3f;
+		float maxGrad = 0.0f;
+		float maxError = 0.0f;
+		auto check = [&](std::vector<float>& values, const std::vector<float>& grads)
+		{
+			for (size_t i = 0; i < values.size(); i++)
+			{
+				const float value = values[i];
+				values[i] = value + epsilon;
+				const double upper = evalLoss();
+				values[i] = value - epsilon;
+				const double lower = evalLoss();
+				values[i] = value;
+
+				maxGrad = std::max(maxGrad, std::abs(grads[i]));
+				maxError = std::max(maxError, std::abs(grads[i] - static_cast<float>((upper - lower) / (2.0 * epsilon))));
+			}
+		};
+		check(params, paramGrads);
+		check(inputs, inputGrads);
+		return maxError / maxGrad;
+	}
+
+	// Same as CheckCpuMlpGradients for the parameters of an encoding with the loss sum(weight * encoded)
+	static float CheckCpuNrcEncodingGradients(CpuNrcEncoding& encoding)
+	{
+		const uint32_t count = 16;
+		const uint32_t outputCount = encoding.GetOutputCount();
+
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<float> params(encoding.GetParamCount());
+		encoding.InitParams(params.data(), rng);
+		std::vector<float> inputs(count * CpuNrcEncoding::sc_InputCount);
+		for (float& input : inputs) { input = dist(rng); }
+		std::vector<float> lossWeights(count * outputCount);
+		for (float& weight : lossWeights) { weight = dist(rng) - 0.5f; }
+
+		std::vector<float> grads(params.size(), 0.0f);
+		encoding.Backward(inputs.data(), lossWeights.data(), grads.data(), count);
+
+		std::vector<float> encoded(count * outputCount);
+		auto evalLoss = [&]()
+		{
+			encoding.Encode(params.data(), inputs.data(), encoded.data(), count);
+			double loss = 0.0;
+			for (uint32_t i = 0; i < count * outputCount; i++) { loss += lossWeights[i] * encoded[i]; }
+			return loss;
+		};
+
+		// The loss is linear in the parameters. Checks every touched parameter and as many others.
+		std::vector<size_t> indices;
+		for (size_t i = 0; i < grads.size(); i++)
+		{
+			if (grads[i] != 0.0f) { indices.push_back(i); }
+		}
+		std::uniform_int_distribution<size_t> indexDist(0, params.size() - 1);
+		for (size_t i = indices.size(); i > 0; i--) { indices.push_back(indexDist(rng)); }
+
+		const float epsilon = 1e-2f;
+		float maxGrad = 0.0f;
+		float maxError = 0.0f;
+		for (const size_t i : indices)
+		{
+			const float value = params[i];
+			params[i] = value + epsilon;
+			const double upper = evalLoss();
+			params[i] = value - epsilon;
+			const double lower = evalLoss();
+			params[i] = value;
+
+			maxGrad = std::max(maxGrad, std::abs(grads[i]));
+			maxError = std::max(maxError, std::abs(grads[i] - static_cast<float>((upper - lower) / (2.0 * epsilon))));
+		}
+		return maxError / maxGrad;
+	}
+
+	void BenchmarkCpuNrc(const AppConfig& appConfig, uint32_t stepCount)
+	{
+		const uint32_t inputCount = CpuNrcEncoding::sc_InputCount;
+		const uint32_t outputCount = 3;
+
+		const float mlpError = CheckCpuMlpGradients();
+		CpuNrcEncoding encoding(appConfig.encoding, GetBestPacketIsa());
+		const float encodingError = encoding.GetParamCount() > 0 ? CheckCpuNrcEncodingGradients(encoding) : 0.0f;
+		Log::Info(
+			"CPU NRC gradient check: max relative error mlp " + std::to_string(mlpError) +
+			", encoding " + std::to_string(encodingError) +
+			(mlpError > 1e-2f || encodingError > 1e-2f ? " MISMATCH" : ""));
+
+		// New random samples every step like the train rays of a frame
+		const uint32_t batchSize = 1 << appConfig.log2TrainBatchSize;
+		std::mt19937 rng(3);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<float> inputs(static_cast<size_t>(stepCount) * batchSize * inputCount);
+		std::vector<float> targets(static_cast<size_t>(stepCount) * batchSize * outputCount);
+		for (size_t i = 0; i < static_cast<size_t>(stepCount) * batchSize; i++)
+		{
+			for (uint32_t j = 0; j < inputCount; j++) { inputs[(i * inputCount) + j] = dist(rng); }
+			SyntheticNrcRadiance(&inputs[i * inputCount], &targets[i * outputCount]);
+		}
+
+		// Rounds like packHalf2x16 in the shaders of the fp16 NRC io layout
+		auto toHalf = [](std::vector<float> values)
+		{
+			for (float& value : values) { value = glm::unpackHalf1x16(glm::packHalf1x16(value)); }
+			return values;
+		};
+
+		const uint32_t lastCount = std::max(stepCount / 4, 1u);
+		for (const bool halfIo : { false, true })
+		{
+			// The shaders write inputs and targets and read outputs in the io layout. The error is always
+			// measured against the fp32 targets.
+			const std::vector<float> ioInputs = halfIo ? toHalf(inputs) : inputs;
+			const std::vector<float> ioTargets = halfIo ? toHalf(targets) : targets;
+
+			CpuNrcBackend backend(appConfig, inputCount, outputCount);
+			std::vector<float> losses(stepCount);
+			const double trainSeconds = 1e-3 * MeasureMS([&]()
+				{
+					for (uint32_t step = 0; step < stepCount; step++)
+					{
+						const size_t offset = static_cast<size_t>(step) * batchSize;
+						backend.Train(&ioInputs[offset * inputCount], &ioTargets[offset * outputCount], batchSize);
+						losses[step] = backend.GetLastLoss();
+					}
+				});
+
+			std::vector<float> outputs(targets.size());
+			const double inferSeconds = 1e-3 * MeasureMS([&]() { backend.Inference(ioInputs.data(), outputs.data(), stepCount * batchSize); });
+			if (halfIo) { outputs = toHalf(outputs); }
+
+			// Relative error of the moving average the inference uses, on the training samples
+			double squaredError = 0.0;
+			double squaredTarget = 0.0;
+			for (size_t i = 0; i < targets.size(); i++)
+			{
+				squaredError += (outputs[i] - targets[i]) * (outputs[i] - targets[i]);
+				squaredTarget += targets[i] * targets[i];
+			}
+
+			float lastLoss = 0.0f;
+			for (uint32_t step = stepCount - lastCount; step < stepCount; step++) { lastLoss += losses[step] / static_cast<float>(lastCount); }
+
+			Log::Info(
+				"CPU NRC " + std::string(halfIo ? "fp16" : "fp32") + " io (" + std::to_string(backend.GetParamCount()) +
+				" parameters, batch " + std::to_string(batchSize) + ", " + std::to_string(stepCount) +
+				" steps): loss first step " + std::to_string(losses[0]) +
+				", last " + std::to_string(lastCount) + " steps " + std::to_string(lastLoss) +
+				", inference relative rmse " + std::to_string(std::sqrt(squaredError / squaredTarget)) +
+				" | train " + std::to_string(static_cast<double>(stepCount) * batchSize / trainSeconds) + " samples/s" +
+				", inference " + std::to_string(static_cast<double>(stepCount) * batchSize / inferSeconds) + " samples/s");
+		}
+	}
+
+	void BenchmarkCpuHashGrid(uint32_t sampleCount)
+	{
+		// Hash grid position encoding with the identity direction encoding
+		const AppConfig::NNEncodingConfig config(0, 1);
+		CpuNrcEncoding scalarEncoding(config, PacketIsa::Scalar);
+		CpuNrcEncoding avx2Encoding(config, PacketIsa::Avx2);
+		if (!avx2Encoding.IsHashGridVectorized()) { Log::Warn("BenchmarkCpuHashGrid: AVX2 is not available, both paths are scalar"); }
+
+		const uint32_t inputCount = CpuNrcEncoding::sc_InputCount;
+		const uint32_t outputCount = scalarEncoding.GetOutputCount();
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<float> params(scalarEncoding.GetParamCount());
+		scalarEncoding.InitParams(params.data(), rng);
+		std::vector<float> inputs(static_cast<size_t>(sampleCount) * inputCount);
+		for (float& input : inputs) { input = dist(rng); }
+		std::vector<float> dOutputs(static_cast<size_t>(sampleCount) * outputCount);
+		for (float& dOutput : dOutputs) { dOutput = dist(rng) - 0.5f; }
+
+		// Blocks of the size CpuNrcBackend encodes at once
+		const uint32_t blockSize = CpuMlp::sc_BlockSize;
+		const uint32_t blockCount = (sampleCount + blockSize - 1) / blockSize;
+
+		struct Result
+		{
+			std::vector<float> encoded;
+			std::vector<float> grads;
+			double encodeSeconds;
+			double backwardSeconds;
+		};
+		auto run = [&](CpuNrcEncoding& encoding)
+		{
+			Result result;
+			result.encoded.resize(dOutputs.size());
+			result.grads.resize(params.size(), 0.0f);
+
+			result.encodeSeconds = 1e-3 * MeasureMS([&]()
+				{
+					tbb::parallel_for(0u, blockCount, [&](uint32_t block)
+						{
+							const uint32_t first = block * blockSize;
+							const uint32_t count = std::min(blockSize, sampleCount - first);
+							encoding.Encode(params.data(), &inputs[static_cast<size_t>(first) * inputCount], &result.encoded[static_cast<size_t>(first) * outputCount], count);
+						});
+				});
+
+			result.backwardSeconds = 1e-3 * MeasureMS([&]() { encoding.Backward(inputs.data(), dOutputs.data(), result.grads.data(), sampleCount); });
+			return result;
+		};
+
+		// Once for the page faults of the gradient buckets
+		run(scalarEncoding);
+		run(avx2Encoding);
+		const Result scalar = run(scalarEncoding);
+		const Result avx2 = run(avx2Encoding);
+
+		float maxEncodedDiff = 0.0f;
+		for (size_t i = 0; i < scalar.encoded.size(); i++) { maxEncodedDiff = std::max(maxEncodedDiff, std::abs(scalar.encoded[i] - avx2.encoded[i])); }
+		float maxGrad = 0.0f;
+		float maxGradDiff = 0.0f;
+		for (size_t i = 0; i < scalar.grads.size(); i++)
+		{
+			maxGrad = std::max(maxGrad, std::abs(scalar.grads[i]));
+			maxGradDiff = std::max(maxGradDiff, std::abs(scalar.grads[i] - avx2.grads[i]));
+		}
+
+		const double samples = static_cast<double>(sampleCount);
+		Log::Info(
+			"CPU hash grid (" + std::to_string(sampleCount) + " samples): scalar forward " + std::to_string(samples / scalar.encodeSeconds) +
+			" encodes/s, backward " + std::to_string(samples / scalar.backwardSeconds) +
+			" encodes/s | avx2 forward " + std::to_string(samples / avx2.encodeSeconds) +
+			" encodes/s, backward " + std::to_string(samples / avx2.backwardSeconds) +
+			" encodes/s | max difference encoded " + std::to_string(maxEncodedDiff) +
+			", gradient " + std::to_string(maxGradDiff / std::max(maxGrad, 1e-30f)) + " relative");
+	}
+}
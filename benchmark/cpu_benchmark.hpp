@@ -0,0 +1,126 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/MajorantGrid.hpp>
+#include <engine/objects/BrickGrid.hpp>
+#include <engine/objects/OccupancyGrid.hpp>
+#include <engine/objects/DensityMipChain.hpp>
+#include <engine/AppConfig.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// CPU micro benchmarks for code paths that are shared with the shaders. Results are logged.
+
+	// Compares the sphere traced volume entry/exit search against the analytic slab intersection
+	void BenchmarkFindEntryExit(const glm::vec3& volumeSize, uint32_t rayCount);
+
+	// Delta and ratio tracks the same rays with the scalar per ray loop and with every supported packet
+	// width on one thread. Logs rays/s and density fetches/s per core and whether the estimates agree.
+	void BenchmarkPacketTracking(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		uint32_t rayCount);
+
+	// Samples free flights of random rays through the volume with delta tracking, with and without the
+	// early accept below the cell minimum, and with decomposition tracking. Logs tracking steps and
+	// density fetches per collision and checks that all give the same fraction of escaping rays and
+	// mean collision distance.
+	void BenchmarkFreeFlight(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		uint32_t rayCount);
+
+	// Estimates the transmittance of random shadow rays from inside the volume estimateCount times each
+	// with every TransmittanceMode, residual ratio tracking with both control densities. Logs the MSE
+	// against the exact transmittance of the voxel grid, fetches and time per estimate and the cost
+	// relative to ratio tracking at equal MSE.
+	void BenchmarkShadowTransmittance(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const OccupancyGrid& occupancyGrid,
+		const DensityMipChain& densityMipChain,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		uint32_t rayCount,
+		uint32_t estimateCount);
+
+	// Builds a TransmittanceGrid towards toLight and compares its lookups at random points inside of the
+	// volume with single ratio tracking estimates. Logs the build time, time and MSE against the exact
+	// transmittance of the voxel grid per shadow ray for both and the rays per rebuild at which the
+	// grid is faster.
+	void BenchmarkTransmittanceGrid(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const DensityMipChain& densityMipChain,
+		const glm::vec3& volumeSize,
+		float densityFactor,
+		const glm::vec3& toLight,
+		uint32_t rayCount);
+
+	// Same as BenchmarkTransmittanceGrid for a SphericalTransmittanceGrid around a point light at
+	// lightPos, with shadow rays from random points inside of the volume to the light
+	void BenchmarkSphericalTransmittanceGrid(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		const DensityMipChain& densityMipChain,
+		const glm::vec3& volumeSize,
+		const glm::vec3& volumePos,
+		float densityFactor,
+		const glm::vec3& lightPos,
+		uint32_t rayCount);
+
+	// Compares memory and nearest lookup cost of the dense grid and the sparse brick grid, both for
+	// random positions and for positions marched along random rays. Logs a mismatch if any lookup differs.
+	void BenchmarkBrickSampling(const DensityGrid& densityGrid, const BrickGrid& brickGrid, uint32_t sampleCount);
+
+	// Builds the inverse cdf tables and the alias table of an rgba env map and samples texels from both.
+	// Logs build times, samples/s and the total variation between the exact sampling probabilities and
+	// the weights each table is built from, including the brightness the cdf tables never pick.
+	void BenchmarkHdrEnvMapSampling(const std::vector<float>& hdr4f, uint32_t width, uint32_t height, uint32_t sampleCount);
+
+	// Samples scattering directions with the axis angle matrices of the former NewRayDir and with the
+	// orthonormal basis of PhaseFunction for Henyey-Greenstein with asymmetry g. Then checks the closed
+	// form and the inverse cdf tables of Henyey-Greenstein, approximate Mie and a tabulated phase function.
+	// Logs samples/s, invalid directions, the chi-square of cos theta histograms against the exact
+	// densities and the largest relative error of the density tables.
+	void BenchmarkPhaseFunctionSampling(float g, uint32_t sampleCount);
+
+	// Runs the clamping pass of ReadFileHdr4f and Hdr4fToCdf on an rgba env map with the former scalar
+	// loops and with the parallel flat arrays. Logs the throughput of both in MB of rgba input per second.
+	void BenchmarkHdrEnvMapLoad(const std::vector<float>& hdr4f, uint32_t width, uint32_t height, float max);
+
+	// Checks the backward passes of a small CpuMlp and of the encoding of appConfig against central
+	// differences, then trains a CpuNrcBackend configured like the NRC of appConfig for stepCount steps
+	// on a synthetic radiance field, once with the fp32 and once with the fp16 io layout. Logs the largest
+	// gradient errors and for both layouts the loss of the first and last steps, the inference error and
+	// the training and inference throughput in samples/s.
+	void BenchmarkCpuNrc(const AppConfig& appConfig, uint32_t stepCount);
+
+	// Encodes sampleCount random NrcInput samples with the hash grid encoding of CpuNrcEncoding on the
+	// scalar path and on the AVX2 path and runs the backward pass of both. Logs the encodes/s of the
+	// forward and backward passes and the largest differences between the paths.
+	void BenchmarkCpuHashGrid(uint32_t sampleCount);
+
+	// Casts the rays of a pinhole camera (every pixelStep-th pixel) against the untrimmed source box
+	// and the trimmed box of densityGrid. Logs for both how many rays enter the box, how far they
+	// travel inside of it and how much of that is empty space in front of the first non-zero voxel,
+	// also as expected delta tracking steps with the global majorant.
+	void BenchmarkVolumeBounds(
+		const DensityGrid& densityGrid,
+		float densityFactor,
+		const glm::vec3& cameraPos,
+		const glm::vec3& cameraDir,
+		const glm::vec3& cameraUp,
+		float fov,
+		uint32_t width,
+		uint32_t height,
+		uint32_t pixelStep);
+}
@@ -0,0 +1,110 @@
+#include <cpu_benchmark.hpp>
+#include <engine/util/Log.hpp>
+#include <engine/util/read_file.hpp>
+#include <engine/objects/VolumeCache.hpp>
+#include <engine/HpmSceneSetup.hpp>
+#include <engine/AppConfig.hpp>
+#include <openvdb/openvdb.h>
+#include <cstring>
+
+// Runs the CPU micro benchmarks on the scene of the app config. Takes the same arguments as the renderer
+// and needs no GPU.
+int main(int argc, char** argv)
+{
+	// Init openvdb
+	openvdb::initialize();
+
+	// Read arguments for app config
+	if (argc == 1)
+	{
+		en::Log::Error("No arguments found. The benchmarks take the startup arguments of the renderer", true);
+	}
+
+	std::vector<char*> myargv(argc);
+	std::memcpy(myargv.data(), argv, sizeof(char*) * argc);
+
+	// Create app config
+	en::AppConfig appConfig(myargv);
+
+	// Load the scene like HpmScene
+	const en::VolumeCache volumeCache(en::HpmSceneSetup::sc_DensityFilePath);
+	const en::DensityGrid& densityGrid = volumeCache.GetDensityGrid();
+	const en::MajorantGrid& majorantGrid = volumeCache.GetMajorantGrid();
+	const glm::vec3 volumeSize = en::HpmSceneSetup::GetVolumeSize(densityGrid);
+	const glm::vec3 volumePos = en::HpmSceneSetup::GetVolumePosition(densityGrid);
+	const float density = appConfig.scene.density;
+	const glm::vec3 dirLightDir = VecFromAngles(en::HpmSceneSetup::sc_DirLightZenith, en::HpmSceneSetup::sc_DirLightAzimuth);
+
+	int hdrWidth, hdrHeight;
+	const std::vector<float> hdr4fData = en::ReadFileHdr4f(
+		appConfig.scene.hdrEnvMapPath,
+		hdrWidth,
+		hdrHeight,
+		en::HpmSceneSetup::sc_HdrEnvMapMaxValue,
+		appConfig.hdrEnvMapTestOverwrite);
+
+	// Volume traversal
+	majorantGrid.LogFetchStats(densityGrid, volumeSize, density, 1 << 16);
+	volumeCache.GetOccupancyGrid().LogTraversalStats(1 << 16);
+	en::BenchmarkFindEntryExit(volumeSize, 1 << 20);
+	en::BenchmarkPacketTracking(densityGrid, majorantGrid, volumeSize, density, 1 << 18);
+	en::BenchmarkFreeFlight(
+		densityGrid,
+		majorantGrid,
+		volumeCache.GetOccupancyGrid(),
+		volumeSize,
+		density,
+		1 << 16);
+	en::BenchmarkBrickSampling(densityGrid, volumeCache.GetBrickGrid(), 1 << 22);
+
+	// Start camera of the renderer at 1920x1080
+	en::BenchmarkVolumeBounds(
+		densityGrid,
+		density,
+		en::HpmSceneSetup::sc_CameraPos,
+		en::HpmSceneSetup::sc_CameraViewDir,
+		en::HpmSceneSetup::sc_CameraUp,
+		en::HpmSceneSetup::sc_CameraFov,
+		1920,
+		1080,
+		4);
+
+	// Shadow rays
+	en::BenchmarkShadowTransmittance(
+		densityGrid,
+		majorantGrid,
+		volumeCache.GetOccupancyGrid(),
+		volumeCache.GetDensityMipChain(),
+		volumeSize,
+		density,
+		1 << 12,
+		16);
+	en::BenchmarkTransmittanceGrid(
+		densityGrid,
+		majorantGrid,
+		volumeCache.GetDensityMipChain(),
+		volumeSize,
+		density,
+		-dirLightDir,
+		1 << 12);
+	en::BenchmarkSphericalTransmittanceGrid(
+		densityGrid,
+		majorantGrid,
+		volumeCache.GetDensityMipChain(),
+		volumeSize,
+		volumePos,
+		density,
+		en::HpmSceneSetup::sc_PointLightPos,
+		1 << 12);
+
+	// Sampling
+	en::BenchmarkPhaseFunctionSampling(en::HpmSceneSetup::sc_VolumeG, 1 << 22);
+	en::BenchmarkHdrEnvMapLoad(hdr4fData, hdrWidth, hdrHeight, en::HpmSceneSetup::sc_HdrEnvMapMaxValue);
+	en::BenchmarkHdrEnvMapSampling(hdr4fData, hdrWidth, hdrHeight, 1 << 22);
+
+	// CPU NRC
+	en::BenchmarkCpuNrc(appConfig, 16);
+	en::BenchmarkCpuHashGrid(1 << 18);
+
+	return 0;
+}
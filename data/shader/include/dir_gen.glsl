@@ -1,22 +1,58 @@
+// PhaseFuncMode
+#define PHASE_FUNC_HG 0
+#define PHASE_FUNC_MIE 1
+#define PHASE_FUNC_TABULATED 2
+
+// Entries of each table in phaseTable, PhaseFunction::sc_TableSize
+#define PHASE_TABLE_SIZE 4096
+
 float hg_phase_func(const float cos_theta)
 {
+	// 1 + g^2 - 2g cos theta without the cancellation for g and cos theta close to 1
 	const float g = VOLUME_G;
-	const float g2 = g * g;
-	const float result = 0.5 * (1 - g2) / pow(1 + g2 - (2 * g * cos_theta), 1.5);
-	return result;
+	const float denom = ((1.0 - g) * (1.0 - g)) + (2.0 * g * (1.0 - cos_theta));
+	return 0.5 * (1.0 - (g * g)) / (denom * sqrt(denom));
+}
+
+// Solid angle density of PHASE_FUNC, which is also the pdf of NewRayDir with phase function sampling.
+// cos_theta is between the direction towards the light and the ray direction. hg_phase_func and the
+// tables are densities over cos theta, tables are interpolated at x = ((1 - cos theta) / 2)^(1/4).
+float phase_func(const float cos_theta)
+{
+	if (PHASE_FUNC == PHASE_FUNC_HG) { return hg_phase_func(cos_theta) / (2.0 * PI); }
+
+	const float x = sqrt(sqrt(clamp(0.5 - (0.5 * cos_theta), 0.0, 1.0))) * float(PHASE_TABLE_SIZE - 1);
+	const uint i = min(uint(x), PHASE_TABLE_SIZE - 2);
+	return mix(phaseTable.values[PHASE_TABLE_SIZE + i], phaseTable.values[PHASE_TABLE_SIZE + i + 1], x - float(i)) / (2.0 * PI);
+}
+
+// 1 - cos theta of PHASE_FUNC for u in [0, 1], closed form for Henyey-Greenstein and the inverse cdf
+// table otherwise. Small angles keep their precision, cos theta would round them to 1.
+float sample_phase_one_minus_cos_theta(const float u)
+{
+	if (PHASE_FUNC == PHASE_FUNC_HG)
+	{
+		// Inverse cdf (1 + g^2 - sqrTerm^2) / 2g subtracted from 1 and factored, so nothing cancels
+		const float g = VOLUME_G;
+		if (abs(g) < 0.001) { return 2.0 * u; }
+		const float sqrTerm = (1.0 - (g * g)) / (1.0 - g + (2.0 * g * u));
+		return clamp((1.0 - g) * (1.0 - u) * (sqrTerm + 1.0 - g) / (1.0 - g + (2.0 * g * u)), 0.0, 2.0);
+	}
+
+	const float t = clamp(u, 0.0, 1.0) * float(PHASE_TABLE_SIZE - 1);
+	const uint i = min(uint(t), PHASE_TABLE_SIZE - 2);
+	return mix(phaseTable.values[i], phaseTable.values[i + 1], t - float(i));
 }
 
-mat4 rotationMatrix(vec3 axis, float angle)
+// Orthonormal basis around a unit vector without a singular direction (Duff et al., Building an
+// Orthonormal Basis, Revisited)
+void onb(const vec3 n, out vec3 b1, out vec3 b2)
 {
-    axis = normalize(axis);
-    float s = sin(angle);
-    float c = cos(angle);
-    float oc = 1.0 - c;
-    
-    return mat4(oc * axis.x * axis.x + c,           oc * axis.x * axis.y - axis.z * s,  oc * axis.z * axis.x + axis.y * s,  0.0,
-                oc * axis.x * axis.y + axis.z * s,  oc * axis.y * axis.y + c,           oc * axis.y * axis.z - axis.x * s,  0.0,
-                oc * axis.z * axis.x - axis.y * s,  oc * axis.y * axis.z + axis.x * s,  oc * axis.z * axis.z + c,           0.0,
-                0.0,                                0.0,                                0.0,                                1.0);
+	const float s = n.z >= 0.0 ? 1.0 : -1.0;
+	const float a = -1.0 / (s + n.z);
+	const float b = n.x * n.y * a;
+	b1 = vec3(1.0 + (s * n.x * n.x * a), s * b, -s * n.x);
+	b2 = vec3(b, s + (n.y * n.y * a), -n.y);
 }
 
 vec3 NewRayDir(vec3 oldRayDir, const bool phaseFuncSampling)
@@ -26,39 +62,14 @@ vec3 NewRayDir(vec3 oldRayDir, const bool phaseFuncSampling)
 
 	oldRayDir = normalize(oldRayDir);
 
-	// Get any orthogonal vector
-	//return  c<a  ? (b,-a,0) : (0,-c,b)
-	vec3 orthoDir = oldRayDir.z < oldRayDir.x ? vec3(oldRayDir.y, -oldRayDir.x, 0.0) : vec3(0.0, -oldRayDir.z, oldRayDir.y);
-	orthoDir = normalize(orthoDir);
-
-	// Rotate around that orthoDir
-	float angle;
-	if (phaseFuncSampling)
-	{
-		float g = VOLUME_G;
-		float cosTheta;
-		if (abs(g) < 0.001)
-		{
-			cosTheta = 1 - 2 * RandFloat(1.0);
-		}
-		else
-		{
-			float sqrTerm = (1 - g * g) / (1 - g + (2 * g * RandFloat(1.0)));
-			cosTheta = (1 + (g * g) - (sqrTerm * sqrTerm)) / (2 * g);
-		}
-		angle = acos(cosTheta);
-	}
-	else
-	{
-		angle = RandFloat(PI);
-	}
-	mat4 rotMat = rotationMatrix(orthoDir, angle);
-	vec3 newRayDir = (rotMat * vec4(oldRayDir, 1.0)).xyz;
-
-	// Rotate around oldRayDir
-	angle = RandFloat(2.0 * PI);
-	rotMat = rotationMatrix(oldRayDir, angle);
-	newRayDir = (rotMat * vec4(newRayDir, 1.0)).xyz;
+	// Without phase function sampling the angle to oldRayDir is uniform in [0, pi]
+	const float oneMinusCosTheta = phaseFuncSampling ? sample_phase_one_minus_cos_theta(RandFloat(1.0)) : 1.0 - cos(RandFloat(PI));
+	const float cosTheta = 1.0 - oneMinusCosTheta;
+	const float sinTheta = sqrt(max(0.0, oneMinusCosTheta * (2.0 - oneMinusCosTheta)));
+	const float phi = RandFloat(2.0 * PI);
 
-	return normalize(newRayDir);
+	vec3 b1;
+	vec3 b2;
+	onb(oldRayDir, b1, b2);
+	return normalize((sinTheta * cos(phi) * b1) + (sinTheta * sin(phi) * b2) + (cosTheta * oldRayDir));
 }
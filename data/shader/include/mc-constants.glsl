@@ -10,8 +10,36 @@ layout(constant_id = 7) const float VOLUME_G = 0.7;
 
 layout(constant_id = 8) const float HDR_ENV_MAP_STRENGTH = 1.0;
 
+layout(constant_id = 9) const uint VOLUME_VOXELS_X = 1;
+layout(constant_id = 10) const uint VOLUME_VOXELS_Y = 1;
+layout(constant_id = 11) const uint VOLUME_VOXELS_Z = 1;
+
+layout(constant_id = 12) const uint DENSITY_LOD_MODE = 0;
+layout(constant_id = 13) const float DENSITY_LOD_SPREAD = 0.25;
+
+// Center of the volume box, which is trimmed to the non-zero voxels and therefore not centered
+layout(constant_id = 14) const float VOLUME_POS_X = 0.0;
+layout(constant_id = 15) const float VOLUME_POS_Y = 0.0;
+layout(constant_id = 16) const float VOLUME_POS_Z = 0.0;
+
+// Count traversed and skipped cells in traversalStats, see VolumeData
+layout(constant_id = 17) const bool TRAVERSAL_STATS = false;
+
+// Shadow ray transmittance estimators, TRANSMITTANCE_* in path_trace.glsl
+layout(constant_id = 18) const uint DIR_LIGHT_TRANSMITTANCE = 0;
+layout(constant_id = 19) const uint POINT_LIGHT_TRANSMITTANCE = 0;
+layout(constant_id = 20) const uint HDR_ENV_MAP_TRANSMITTANCE = 0;
+// Control density of residual ratio tracking, RESIDUAL_CONTROL_* in path_trace.glsl
+layout(constant_id = 21) const uint RESIDUAL_CONTROL = 0;
+
+// Free flight sampling of the paths, FREE_FLIGHT_* in path_trace.glsl
+layout(constant_id = 22) const uint FREE_FLIGHT_MODE = 0;
+
+// Phase function of the medium, PHASE_FUNC_* in dir_gen.glsl
+layout(constant_id = 23) const uint PHASE_FUNC = 0;
+
 const vec3 skySize = vec3(VOLUME_SIZE_X, VOLUME_SIZE_Y, VOLUME_SIZE_Z);
-const vec3 skyPos = vec3(0.0);
+const vec3 skyPos = vec3(VOLUME_POS_X, VOLUME_POS_Y, VOLUME_POS_Z);
 
 // TODO: performant?
 #define ONE_OVER_RENDER_WIDTH (1.0 / float(RENDER_WIDTH))
@@ -12,6 +12,33 @@ layout(set = 0, binding = 1) uniform camera_t
 
 layout(set = 1, binding = 0) uniform sampler3D densityTex;
 
+layout(set = 1, binding = 1) uniform sampler3D majorantTex;
+
+layout(set = 1, binding = 2) uniform usampler3D brickIndexTex;
+
+layout(set = 1, binding = 3) uniform sampler3D densityMipTex;
+
+layout(set = 1, binding = 4) uniform usampler3D occupancyTex;
+
+layout(set = 1, binding = 5) uniform sampler3D minorantTex;
+
+layout(std430, set = 1, binding = 6) buffer TraversalStats
+{
+	uint counts[6];
+} traversalStats;
+
+// Transmittance towards the dir light at the cell centers of a TransmittanceGrid
+layout(set = 1, binding = 7) uniform sampler3D dirLightTransmittanceTex;
+
+// Transmittance from the point light on the octahedral map by distance of a SphericalTransmittanceGrid
+layout(set = 1, binding = 8) uniform sampler3D pointLightTransmittanceTex;
+
+// Inverse cdf and density table of a PhaseFunction, see dir_gen.glsl
+layout(std430, set = 1, binding = 9) readonly buffer PhaseTable
+{
+	float values[];
+} phaseTable;
+
 layout(set = 2, binding = 0) uniform dir_light_t
 {
 	vec3 color;
@@ -28,12 +55,25 @@ layout(set = 3, binding = 0) uniform PointLight
 	vec3 color;
 } pointLight;
 
+// Alpha holds the density of SampleHdrEnvMapDir in uv space, see Hdr4fToCdf
 layout(set = 4, binding = 0) uniform sampler2D hdrEnvMap;
 
 layout(set = 4, binding = 1) uniform sampler2D hdrEnvMapInvCdfX;
 
 layout(set = 4, binding = 2) uniform sampler1D hdrEnvMapInvCdfY;
 
+// One entry per texel in row major order, see AliasTable
+struct AliasTableEntry
+{
+	float prob;
+	uint alias;
+};
+
+layout(std430, set = 4, binding = 3) readonly buffer HdrEnvMapAliasTable
+{
+	AliasTableEntry entries[];
+} hdrEnvMapAliasTable;
+
 layout(set = 5, binding = 0, rgba32f) uniform image2D outputImage;
 
 layout(set = 5, binding = 1, rgba32f) uniform image2D infoImage;
@@ -0,0 +1,67 @@
+// Samples of the NRC buffers, fp32 NrcInput and NrcOutput or with NRC_HALF_IO fp16 inputs
+// (pos.xyz, theta, phi, 0, 0, 0) and outputs (r, g, b, 0), see NeuralRadianceCache::UsesHalfIo.
+// fp16 quantizes the normalized position to 1 / 2048 near 1.
+
+uvec4 PackNrcInputHalf(const vec3 normPos, const vec2 normDir)
+{
+	return uvec4(packHalf2x16(normPos.xy), packHalf2x16(vec2(normPos.z, normDir.x)), packHalf2x16(vec2(normDir.y, 0.0)), 0);
+}
+
+uvec2 PackNrcOutputHalf(const vec3 color)
+{
+	return uvec2(packHalf2x16(color.xy), packHalf2x16(vec2(color.z, 0.0)));
+}
+
+void WriteNrcInferInput(const uint index, const vec3 normPos, const vec2 normDir)
+{
+	if (NRC_HALF_IO)
+	{
+		nrcInferInputHalf[index] = PackNrcInputHalf(normPos, normDir);
+		return;
+	}
+
+	nrcInferInput[index].posX = normPos.x;
+	nrcInferInput[index].posY = normPos.y;
+	nrcInferInput[index].posZ = normPos.z;
+	nrcInferInput[index].theta = normDir.x;
+	nrcInferInput[index].phi = normDir.y;
+}
+
+void WriteNrcTrainInput(const uint index, const vec3 normPos, const vec2 normDir)
+{
+	if (NRC_HALF_IO)
+	{
+		nrcTrainInputHalf[index] = PackNrcInputHalf(normPos, normDir);
+		return;
+	}
+
+	nrcTrainInput[index].posX = normPos.x;
+	nrcTrainInput[index].posY = normPos.y;
+	nrcTrainInput[index].posZ = normPos.z;
+	nrcTrainInput[index].theta = normDir.x;
+	nrcTrainInput[index].phi = normDir.y;
+}
+
+void WriteNrcTrainTarget(const uint index, const vec3 target)
+{
+	if (NRC_HALF_IO)
+	{
+		nrcTrainTargetHalf[index] = PackNrcOutputHalf(target);
+		return;
+	}
+
+	nrcTrainTarget[index].r = target.x;
+	nrcTrainTarget[index].g = target.y;
+	nrcTrainTarget[index].b = target.z;
+}
+
+vec3 ReadNrcInferOutput(const uint index)
+{
+	if (NRC_HALF_IO)
+	{
+		const uvec2 halves = nrcInferOutputHalf[index];
+		return vec3(unpackHalf2x16(halves.x), unpackHalf2x16(halves.y).x);
+	}
+
+	return vec3(nrcInferOutput[index].r, nrcInferOutput[index].g, nrcInferOutput[index].b);
+}
@@ -21,56 +21,278 @@ float GetTransmittance(const vec3 start, const vec3 end, const uint count)
 	return transmittance;
 }
 
-float RatioTrack(const vec3 start, const vec3 end)
+// lod selects the density level, see get_density_lod
+float RatioTrack(const vec3 start, const vec3 end, const int lod)
 {
-	const float invMaxDensity = 1.0 / VOLUME_DENSITY_FACTOR;
-	//const float invMaxDensity = 1.0;
-
-	const vec3 dir = normalize(end - start);
 	const float tMax = distance(end, start);
 	float transmittance = 1.0;
-	float t = 0.0;
-	
-	for (uint i = 0; i < 128; i++)
+	if (tMax <= 0.0) { return transmittance; }
+	const vec3 dir = (end - start) / tMax;
+
+	MajorantTraversal it;
+	if (!init_majorant_traversal(start, dir, tMax, it)) { return transmittance; }
+
+	// Free flight distances are sampled per cell with the local majorant. Leaving a cell restarts
+	// the sampling at the cell boundary, which is valid because the exponential is memoryless.
+	uint i = 0;
+	while (i < 128)
 	{
-		t -= log(1.0 - RandFloat(1.0)) * invMaxDensity;
-		if (t >= tMax) { break; }
-		const vec3 nextSamplePoint = start + (t * dir);
-		transmittance *= 1.0 - (getDensity(nextSamplePoint) * invMaxDensity);
+		const float majorant = get_cell_majorant(it);
+		const float cellExit = get_cell_exit(it);
+		if (majorant > 0.0)
+		{
+			it.t -= log(1.0 - RandFloat(1.0)) / majorant;
+			if (it.t < cellExit)
+			{
+				i++;
+				const vec3 nextSamplePoint = start + (it.t * dir);
+				count_traversal_stat(TRAVERSAL_STAT_DENSITY_FETCHES, 1);
+				transmittance *= 1.0 - (getDensity(nextSamplePoint, lod) / majorant);
+				continue;
+			}
+		}
+
+		if (!step_majorant_traversal(it)) { break; }
 	}
 	
 	return transmittance;
 }
 
-vec3 TraceDirLight(const vec3 pos, const vec3 dir)
+// Shadow ray transmittance estimators, selected per light type by the *_TRANSMITTANCE constants
+const uint TRANSMITTANCE_RATIO_TRACKING = 0;
+const uint TRANSMITTANCE_RESIDUAL_RATIO_TRACKING = 1;
+const uint TRANSMITTANCE_BIASED_RAY_MARCHING = 2;
+const uint TRANSMITTANCE_UNBIASED_RAY_MARCHING = 3;
+const uint TRANSMITTANCE_CACHED = 4;
+
+// Voxels per cell of the TransmittanceGrid along each axis
+const int TRANSMITTANCE_GRID_CELL_SIZE = 4;
+
+const uint RESIDUAL_CONTROL_MINIMUM = 0;
+const uint RESIDUAL_CONTROL_MEAN = 1;
+
+// Residual ratio tracking (Novak et al. 2014). Every cell splits the density into a constant control
+// density, whose transmittance exp(-control * length) is known, and a residual. Only the residual is
+// ratio tracked with the residual majorant max(majorant - control, control - minorant), so cells of
+// nearly constant density need few or no density fetches.
+float ResidualRatioTrack(const vec3 start, const vec3 end, const int lod)
+{
+	const float tMax = distance(end, start);
+	if (tMax <= 0.0) { return 1.0; }
+	const vec3 dir = (end - start) / tMax;
+
+	MajorantTraversal it;
+	if (!init_majorant_traversal(start, dir, tMax, it)) { return 1.0; }
+
+	float controlOpticalDepth = 0.0;
+	float residualTransmittance = 1.0;
+	uint i = 0;
+	do
+	{
+		const float majorant = get_cell_majorant(it);
+		if (majorant > 0.0)
+		{
+			const float cellExit = get_cell_exit(it);
+			const float minorant = get_cell_minorant(it);
+			const float control = RESIDUAL_CONTROL == RESIDUAL_CONTROL_MEAN ? clamp(get_cell_mean(it), minorant, majorant) : minorant;
+			const float residualMajorant = max(majorant - control, control - minorant);
+			controlOpticalDepth += control * (cellExit - it.t);
+
+			while (residualMajorant > 0.0 && i < 128)
+			{
+				it.t -= log(1.0 - RandFloat(1.0)) / residualMajorant;
+				if (it.t >= cellExit) { break; }
+
+				i++;
+				const vec3 nextSamplePoint = start + (it.t * dir);
+				count_traversal_stat(TRAVERSAL_STAT_DENSITY_FETCHES, 1);
+				residualTransmittance *= 1.0 - ((getDensity(nextSamplePoint, lod) - control) / residualMajorant);
+			}
+		}
+	} while (i < 128 && step_majorant_traversal(it));
+
+	return exp(-controlOpticalDepth) * residualTransmittance;
+}
+
+// Ray marching estimators (Kettunen et al. 2021). The segment is marched with equidistant steps and
+// one random offset, about one step per unit of majorant optical depth. This estimates the optical
+// depth without bias, but exp(-opticalDepth) of it is biased.
+const float RAY_MARCH_STEPS_PER_OPTICAL_DEPTH = 1.0;
+const uint RAY_MARCH_MAX_STEPS = 64;
+// Orders of the power series in UnbiasedRayMarch beyond the first are evaluated with this probability
+const float RAY_MARCH_CONTINUE_PROB = 0.5;
+const uint RAY_MARCH_MAX_ORDER = 8;
+
+// Part of a shadow ray between its first and last cell with a non-zero majorant
+struct RayMarchSegment
+{
+	vec3 start;
+	vec3 dir;
+	float tMin;
+	float tMax;
+	float controlOpticalDepth;
+	uint stepCount;
+};
+
+// Walks the majorant cells once to clip the segment and to sum the majorant optical depth, which
+// sets the step count, and the control optical depth from the cell means. Returns false if the
+// segment sees no density.
+bool init_ray_march(const vec3 start, const vec3 end, out RayMarchSegment segment)
+{
+	const float tMax = distance(end, start);
+	if (tMax <= 0.0) { return false; }
+	segment.start = start;
+	segment.dir = (end - start) / tMax;
+
+	MajorantTraversal it;
+	if (!init_majorant_traversal(start, segment.dir, tMax, it)) { return false; }
+
+	float majorantOpticalDepth = 0.0;
+	segment.controlOpticalDepth = 0.0;
+	do
+	{
+		const float majorant = get_cell_majorant(it);
+		if (majorant > 0.0)
+		{
+			const float cellExit = get_cell_exit(it);
+			if (majorantOpticalDepth == 0.0) { segment.tMin = it.t; }
+			segment.tMax = cellExit;
+			majorantOpticalDepth += majorant * (cellExit - it.t);
+			segment.controlOpticalDepth += min(get_cell_mean(it), majorant) * (cellExit - it.t);
+		}
+	} while (step_majorant_traversal(it));
+
+	if (majorantOpticalDepth <= 0.0) { return false; }
+	const float stepCount = ceil(majorantOpticalDepth * RAY_MARCH_STEPS_PER_OPTICAL_DEPTH);
+	segment.stepCount = uint(clamp(stepCount, 1.0, float(RAY_MARCH_MAX_STEPS)));
+	return true;
+}
+
+float ray_march_optical_depth(const RayMarchSegment segment, const int lod)
+{
+	const float stepSize = (segment.tMax - segment.tMin) / float(segment.stepCount);
+	const float jitter = RandFloat(1.0);
+	float densitySum = 0.0;
+	for (uint i = 0; i < segment.stepCount; i++)
+	{
+		const float t = segment.tMin + ((float(i) + jitter) * stepSize);
+		densitySum += getDensity(segment.start + (t * segment.dir), lod);
+	}
+	count_traversal_stat(TRAVERSAL_STAT_DENSITY_FETCHES, segment.stepCount);
+	return densitySum * stepSize;
+}
+
+float BiasedRayMarch(const vec3 start, const vec3 end, const int lod)
+{
+	RayMarchSegment segment;
+	if (!init_ray_march(start, end, segment)) { return 1.0; }
+	return exp(-ray_march_optical_depth(segment, lod));
+}
+
+// Expands exp(-opticalDepth) into a power series around the control optical depth. Order k
+// multiplies independent ray marched estimates of (control - opticalDepth) / k. The series is cut by
+// russian roulette, whose continuation probability divides the terms, so it stays unbiased.
+// Estimates can be negative or above 1.
+float UnbiasedRayMarch(const vec3 start, const vec3 end, const int lod)
+{
+	RayMarchSegment segment;
+	if (!init_ray_march(start, end, segment)) { return 1.0; }
+
+	float term = 1.0;
+	float sum = 1.0;
+	for (uint k = 1; k <= RAY_MARCH_MAX_ORDER; k++)
+	{
+		if (k > 1)
+		{
+			if (RandFloat(1.0) >= RAY_MARCH_CONTINUE_PROB) { break; }
+			term /= RAY_MARCH_CONTINUE_PROB;
+		}
+		term *= (segment.controlOpticalDepth - ray_march_optical_depth(segment, lod)) / float(k);
+		sum += term;
+	}
+
+	return exp(-segment.controlOpticalDepth) * sum;
+}
+
+float EstimateTransmittance(const vec3 start, const vec3 end, const int lod, const uint mode)
+{
+	switch (mode)
+	{
+	case TRANSMITTANCE_RESIDUAL_RATIO_TRACKING:
+		return ResidualRatioTrack(start, end, lod);
+	case TRANSMITTANCE_BIASED_RAY_MARCHING:
+		return BiasedRayMarch(start, end, lod);
+	case TRANSMITTANCE_UNBIASED_RAY_MARCHING:
+		return UnbiasedRayMarch(start, end, lod);
+	default:
+		return RatioTrack(start, end, lod);
+	}
+}
+
+// Filtered lookup of a TransmittanceGrid. The grid covers whole cells, so it can reach beyond the volume.
+float get_cached_transmittance(const sampler3D gridTex, const vec3 pos)
+{
+	const vec3 gridVoxelCount = vec3(textureSize(gridTex, 0) * TRANSMITTANCE_GRID_CELL_SIZE);
+	return texture(gridTex, get_sky_uvw(pos) * vec3(get_volume_voxel_count()) / gridVoxelCount).x;
+}
+
+vec2 sign_not_zero(const vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Octahedral map of a normalized direction to [0, 1]^2, see SphericalTransmittanceGrid::OctEncode
+vec2 oct_encode(const vec3 dir)
+{
+	const vec3 n = dir / (abs(dir.x) + abs(dir.y) + abs(dir.z));
+	const vec2 p = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+	return (p * 0.5) + 0.5;
+}
+
+// Filtered lookup of the SphericalTransmittanceGrid around the point light. Distances are mapped
+// linearly up to the farthest corner of the volume.
+float get_cached_point_light_transmittance(const vec3 pos)
+{
+	const vec3 toPos = pos - pointLight.pos;
+	const float dist = length(toPos);
+	const float maxDist = length(abs(pointLight.pos - skyPos) + (skySize / 2.0));
+	return texture(pointLightTransmittanceTex, vec3(oct_encode(toPos / max(dist, 1e-6)), dist / maxDist)).x;
+}
+
+vec3 TraceDirLight(const vec3 pos, const vec3 dir, const int lod)
 {
 	if (dir_light.strength == 0.0)
 	{
 		return vec3(0.0);
 	}
 
-	const float transmittance = RatioTrack(pos, find_entry_exit(pos, -normalize(dir_light.dir))[1]);
-	const float phase = hg_phase_func(dot(dir_light.dir, -dir));
+	const vec3 lightDir = -normalize(dir_light.dir);
+	const float transmittance = DIR_LIGHT_TRANSMITTANCE == TRANSMITTANCE_CACHED ?
+		get_cached_transmittance(dirLightTransmittanceTex, pos) :
+		EstimateTransmittance(pos, pos + (max(find_entry_exit(pos, lightDir).y, 0.0) * lightDir), lod, DIR_LIGHT_TRANSMITTANCE);
+	const float phase = phase_func(dot(lightDir, dir));
 	const vec3 dirLighting = vec3(1.0f) * transmittance * dir_light.strength * phase;
 	return dirLighting;
 }
 
-vec3 TracePointLight(const vec3 pos, const vec3 dir)
+vec3 TracePointLight(const vec3 pos, const vec3 dir, const int lod)
 {
 	if (pointLight.strength == 0.0)
 	{
 		return vec3(0.0);
 	}
 
-	const float transmittance = RatioTrack(pointLight.pos, pos);
-	const float phase = hg_phase_func(dot(normalize(pointLight.pos - pos), -dir));
+	const float transmittance = POINT_LIGHT_TRANSMITTANCE == TRANSMITTANCE_CACHED ?
+		get_cached_point_light_transmittance(pos) :
+		EstimateTransmittance(pointLight.pos, pos, lod, POINT_LIGHT_TRANSMITTANCE);
+	const float phase = phase_func(dot(normalize(pointLight.pos - pos), dir));
 	const vec3 pointLighting = pointLight.color * pointLight.strength * transmittance * phase;
 	return pointLighting;
 }
 
 vec3 SampleHdrEnvMap(const vec2 dir)
 {
-	const vec2 invAtan = vec2(0.1591, 0.3183);
+	const vec2 invAtan = vec2(0.5 / PI, 1.0 / PI);
 
 	vec2 uv = dir;
     uv *= invAtan;
@@ -81,11 +303,40 @@ vec3 SampleHdrEnvMap(const vec2 dir)
 
 vec3 SampleHdrEnvMap(const vec3 dir)
 {
-	vec2 phiTheta = vec2(atan(dir.z, dir.x), asin(dir.y));
+	vec2 phiTheta = vec2(atan(dir.z, dir.x), asin(clamp(dir.y, -1.0, 1.0)));
 	return SampleHdrEnvMap(phiTheta);
 }
 
-vec3 SampleHdrEnvMap(const vec3 pos, const vec3 dir, uint sampleCount)
+// Solid angle density of SampleHdrEnvMapDir. The uv density is stored per texel in the alpha channel
+// and dw = 2 * PI^2 * cos(theta) du dv.
+float GetHdrEnvMapPdf(const vec3 dir)
+{
+	const ivec2 size = textureSize(hdrEnvMap, 0);
+	const float theta = asin(clamp(dir.y, -1.0, 1.0));
+	const vec2 uv = (vec2(atan(dir.z, dir.x), theta) * vec2(0.5 / PI, 1.0 / PI)) + 0.5;
+	const ivec2 texel = clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1);
+	const float uvPdf = texelFetch(hdrEnvMap, texel, 0).w;
+	return uvPdf / (2.0 * PI * PI * max(cos(theta), 1e-6));
+}
+
+// Importance samples the env map brightness times solid angle. A texel is picked with one lookup in
+// the alias table and the direction is uniform inside of it in uv space.
+vec3 SampleHdrEnvMapDir()
+{
+	const ivec2 size = textureSize(hdrEnvMap, 0);
+	const uint texelCount = uint(size.x * size.y);
+	uint texel = min(uint(RandFloat(float(texelCount))), texelCount - 1);
+	const AliasTableEntry entry = hdrEnvMapAliasTable.entries[texel];
+	if (RandFloat(1.0) >= entry.prob) { texel = entry.alias; }
+
+	const ivec2 texelPos = ivec2(texel % uint(size.x), texel / uint(size.x));
+	const vec2 uv = (vec2(texelPos) + vec2(RandFloat(1.0), RandFloat(1.0))) / vec2(size);
+	const float phi = (uv.x - 0.5) * 2.0 * PI;
+	const float theta = (uv.y - 0.5) * PI;
+	return vec3(cos(theta) * cos(phi), sin(theta), cos(theta) * sin(phi));
+}
+
+vec3 SampleHdrEnvMap(const vec3 pos, const vec3 dir, uint sampleCount, const int lod)
 {
 	if (HDR_ENV_MAP_STRENGTH == 0.0)
 	{
@@ -94,81 +345,170 @@ vec3 SampleHdrEnvMap(const vec3 pos, const vec3 dir, uint sampleCount)
 
 	vec3 light = vec3(0.0);
 
+	// One sample MIS with the balance heuristic. Every sample picks env map or phase function sampling
+	// with equal probability and is weighted with the mixture density of both, so bright spots of the
+	// env map and the forward peak of the phase function are both found with a single shadow ray.
 	for (uint i = 0; i < sampleCount; i++)
 	{
-		const vec3 randomDir = NewRayDir(dir, false);
-		const float phase = hg_phase_func(dot(randomDir, -dir));
-		const vec3 exit = find_entry_exit(pos, randomDir)[1];
-		//const float transmittance = GetTransmittance(pos, exit, 16);
-		const float transmittance = RatioTrack(pos, exit);
-		const vec3 sampleLight = SampleHdrEnvMap(randomDir) * phase * transmittance;
+		const vec3 lightDir = RandFloat(1.0) < 0.5 ? SampleHdrEnvMapDir() : NewRayDir(dir, true);
 
-		light += sampleLight;
-	}
+		// Light from lightDir travels along -lightDir and is scattered into -dir
+		const float phasePdf = phase_func(dot(lightDir, dir));
+		const float pdf = 0.5 * (GetHdrEnvMapPdf(lightDir) + phasePdf);
+		if (pdf <= 0.0) { continue; }
 
-	// Half env map importance sampled
-//	for (uint i = 0; i < sampleCount - halfSampleCount; i++)
-//	{
-//		const float thetaNorm = texture(hdrEnvMapInvCdfY, RandFloat(1.0)).x;
-//		const float phiNorm = texture(hdrEnvMapInvCdfX, vec2(RandFloat(1.0), thetaNorm)).x;
-//
-//		//const float thetaNorm = 0.458;
-//		//const float phiNorm = 0.477;
-//
-//		const vec3 randomDir = sin(thetaNorm * PI) * vec3(cos(phiNorm * 2.0 * PI), 1.0, sin(phiNorm * 2.0 * PI));
-//
-//		const float phase = hg_phase_func(dot(randomDir, -dir));
-//		const vec3 exit = find_entry_exit(pos, randomDir)[1];
-//		const float transmittance = GetTransmittance(pos, exit, 16);
-//		const vec3 sampleLight = texture(hdrEnvMap, vec2(phiNorm, thetaNorm)).xyz * hdrEnvMapData.hpmStrength * phase * transmittance;
-//
-//		light += sampleLight;
-//	}
+		const vec3 exit = pos + (max(find_entry_exit(pos, lightDir).y, 0.0) * lightDir);
+		const float transmittance = EstimateTransmittance(pos, exit, lod, HDR_ENV_MAP_TRANSMITTANCE);
+		light += SampleHdrEnvMap(lightDir) * phasePdf * transmittance / pdf;
+	}
 
 	light /= float(sampleCount);
 
 	return light;
 }
 
-vec3 TraceScene(const vec3 pos, const vec3 dir)
+// lod is used for all shadow rays
+vec3 TraceScene(const vec3 pos, const vec3 dir, const int lod)
 {
-	const vec3 totalLight = TraceDirLight(pos, dir) + TracePointLight(pos, dir) + SampleHdrEnvMap(pos, dir, 1);
+	const vec3 totalLight = TraceDirLight(pos, dir, lod) + TracePointLight(pos, dir, lod) + SampleHdrEnvMap(pos, dir, 1, lod);
 	return totalLight;
 }
 
 vec3 TraceScene(const vec3 pos, const vec3 dir, const vec3 hdrEnvMapUniformDir)
 {
-	const vec3 exit = find_entry_exit(pos, hdrEnvMapUniformDir)[1];
+	const vec3 exit = pos + (max(find_entry_exit(pos, hdrEnvMapUniformDir).y, 0.0) * hdrEnvMapUniformDir);
 	const float hdrEnvMapTransmittance = GetTransmittance(pos, exit, 16);
-	const float hdrEnvMapPhase = hg_phase_func(dot(-dir, hdrEnvMapUniformDir));
+	const float hdrEnvMapPhase = phase_func(dot(hdrEnvMapUniformDir, dir));
 	const vec3 hdrEnvMapLight = SampleHdrEnvMap(hdrEnvMapUniformDir) * hdrEnvMapTransmittance * hdrEnvMapPhase;
 
-	const vec3 totalLight = TraceDirLight(pos, dir) + TracePointLight(pos, dir) + hdrEnvMapLight;
+	const vec3 totalLight = TraceDirLight(pos, dir, 0) + TracePointLight(pos, dir, 0) + hdrEnvMapLight;
 	return totalLight;
 }
 
-vec3 DeltaTrack(const vec3 rayOrigin, const vec3 rayDir, out bool volumeExit)
+vec3 DeltaTrack(const vec3 rayOrigin, const vec3 rayDir, const int lod, out bool volumeExit)
+{
+	volumeExit = false;
+
+	const float tMax = max(find_entry_exit(rayOrigin, rayDir).y, 0.0);
+
+	MajorantTraversal it;
+	if (!init_majorant_traversal(rayOrigin, rayDir, tMax, it))
+	{
+		volumeExit = true;
+		return rayOrigin + (RandFloat(tMax) * rayDir);
+	}
+
+	uint i = 0;
+	while (i < 128)
+	{
+		const float majorant = get_cell_majorant(it);
+		const float cellExit = get_cell_exit(it);
+		if (majorant > 0.0)
+		{
+			it.t -= log(1.0 - RandFloat(1.0)) / majorant;
+			if (it.t < cellExit)
+			{
+				i++;
+				count_traversal_stat(TRAVERSAL_STAT_FREE_FLIGHT_STEPS, 1);
+				const vec3 nextSamplePoint = rayOrigin + (it.t * rayDir);
+				// The density never drops below the cell minimum (also not on coarser levels, which are
+				// means), so collisions below it are accepted without a density fetch
+				const float u = RandFloat(1.0);
+				if (u * majorant < get_cell_minorant(it))
+				{
+					count_traversal_stat(TRAVERSAL_STAT_COLLISIONS, 1);
+					return nextSamplePoint;
+				}
+				count_traversal_stat(TRAVERSAL_STAT_DENSITY_FETCHES, 1);
+				if (getDensity(nextSamplePoint, lod) / majorant > u)
+				{
+					count_traversal_stat(TRAVERSAL_STAT_COLLISIONS, 1);
+					return nextSamplePoint;
+				}
+				continue;
+			}
+		}
+
+		if (!step_majorant_traversal(it))
+		{
+			volumeExit = true;
+			break;
+		}
+	}
+
+	return rayOrigin + (RandFloat(tMax) * rayDir);
+}
+
+// Decomposition tracking (Kutz et al. 2017). The density of every cell is split into its minimum, a
+// homogeneous medium whose free flight is sampled in closed form, and a residual up to the majorant
+// that is delta tracked. The earlier of both collisions is a collision with the sum, so null
+// collisions only happen at the rate of the residual majorant.
+vec3 DecompositionTrack(const vec3 rayOrigin, const vec3 rayDir, const int lod, out bool volumeExit)
 {
 	volumeExit = false;
 
-	const float invMaxDensity = 1.0 / VOLUME_DENSITY_FACTOR;
-	//const float invMaxDensity = 1.0;
+	const float tMax = max(find_entry_exit(rayOrigin, rayDir).y, 0.0);
 
-	const vec3 exit = find_entry_exit(rayOrigin, rayDir)[1];
-	const float tMax = distance(exit, rayOrigin);
-	float t = 0.0;
+	MajorantTraversal it;
+	if (!init_majorant_traversal(rayOrigin, rayDir, tMax, it))
+	{
+		volumeExit = true;
+		return rayOrigin + (RandFloat(tMax) * rayDir);
+	}
 
-	for (uint i = 0; i < 128; i++)
+	uint i = 0;
+	while (i < 128)
 	{
-		t -= log(1.0 - RandFloat(1.0)) * invMaxDensity;
-		if (t >= tMax)
+		const float majorant = get_cell_majorant(it);
+		const float cellExit = get_cell_exit(it);
+		if (majorant > 0.0)
+		{
+			const float minorant = get_cell_minorant(it);
+			const float residualMajorant = majorant - minorant;
+
+			// Collision with the homogeneous part, which only counts if it stays inside of the cell
+			const float tControl = minorant > 0.0 ? it.t - (log(1.0 - RandFloat(1.0)) / minorant) : cellExit;
+			const float tResidualEnd = min(tControl, cellExit);
+			while (residualMajorant > 0.0 && i < 128)
+			{
+				it.t -= log(1.0 - RandFloat(1.0)) / residualMajorant;
+				if (it.t >= tResidualEnd) { break; }
+
+				i++;
+				count_traversal_stat(TRAVERSAL_STAT_FREE_FLIGHT_STEPS, 1);
+				count_traversal_stat(TRAVERSAL_STAT_DENSITY_FETCHES, 1);
+				const vec3 nextSamplePoint = rayOrigin + (it.t * rayDir);
+				if ((getDensity(nextSamplePoint, lod) - minorant) / residualMajorant > RandFloat(1.0))
+				{
+					count_traversal_stat(TRAVERSAL_STAT_COLLISIONS, 1);
+					return nextSamplePoint;
+				}
+			}
+
+			if (tControl < cellExit)
+			{
+				count_traversal_stat(TRAVERSAL_STAT_FREE_FLIGHT_STEPS, 1);
+				count_traversal_stat(TRAVERSAL_STAT_COLLISIONS, 1);
+				return rayOrigin + (tControl * rayDir);
+			}
+		}
+
+		if (!step_majorant_traversal(it))
 		{
 			volumeExit = true;
-			break; 
+			break;
 		}
-		const vec3 nextSamplePoint = rayOrigin + (t * rayDir);
-		if (getDensity(nextSamplePoint) * invMaxDensity > RandFloat(1.0)) { return nextSamplePoint; }
 	}
 
 	return rayOrigin + (RandFloat(tMax) * rayDir);
 }
+
+// Free flight sampling of the paths, selected by FREE_FLIGHT_MODE
+const uint FREE_FLIGHT_DELTA_TRACKING = 0;
+const uint FREE_FLIGHT_DECOMPOSITION_TRACKING = 1;
+
+vec3 SampleFreeFlight(const vec3 rayOrigin, const vec3 rayDir, const int lod, out bool volumeExit)
+{
+	if (FREE_FLIGHT_MODE == FREE_FLIGHT_DECOMPOSITION_TRACKING) { return DecompositionTrack(rayOrigin, rayDir, lod, volumeExit); }
+	return DeltaTrack(rayOrigin, rayDir, lod, volumeExit);
+}
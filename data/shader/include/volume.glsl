@@ -1,31 +1,22 @@
-float sky_sdf(vec3 pos)
+vec3 safe_inverse_dir(const vec3 dir)
 {
-	vec3 d = abs(pos - skyPos) - skySize / 2;
-	return length(max(d, 0)) + min(max(d.x, max(d.y, d.z)), 0);
+	// Avoids divisions by zero for axis aligned rays
+	return 1.0 / mix(dir, vec3(1e-12), lessThan(abs(dir), vec3(1e-12)));
 }
 
-vec3[2] find_entry_exit(vec3 ro, vec3 rd)
+// Slab intersection with the volume box. Returns the ray parameters (tMin, tMax) at which
+// ro + t * rd enters and leaves the box. tMin is clamped to 0 for origins inside the box and the
+// ray misses the volume if tMin > tMax. For normalized rd both are distances.
+vec2 find_entry_exit(const vec3 ro, const vec3 rd)
 {
-	// rd should be normalized
-
-	float dist;
-	do
-	{
-		dist = sky_sdf(ro);
-		ro  += dist * rd;
-	} while (dist > MIN_RAY_DISTANCE && dist < MAX_RAY_DISTANCE);
-	vec3 entry = ro;
-
-	ro += rd * length(2 * skySize);//ro += rd * MAX_RAY_DISTANCE * 2;
-	rd *= -1.0;
-	do
-	{
-		dist = sky_sdf(ro);
-		ro += dist * rd;
-	} while (dist > MIN_RAY_DISTANCE && dist < MAX_RAY_DISTANCE);
-	vec3 exit = ro;
-	
-	return vec3[2]( entry, exit );
+	const vec3 invDir = safe_inverse_dir(rd);
+	const vec3 t0 = (skyPos - (skySize / 2.0) - ro) * invDir;
+	const vec3 t1 = (skyPos + (skySize / 2.0) - ro) * invDir;
+	const vec3 tNearAxis = min(t0, t1);
+	const vec3 tFarAxis = max(t0, t1);
+	const float tMin = max(max(tNearAxis.x, tNearAxis.y), max(tNearAxis.z, 0.0));
+	const float tMax = min(min(tFarAxis.x, tFarAxis.y), tFarAxis.z);
+	return vec2(tMin, tMax);
 }
 
 vec3 get_sky_uvw(vec3 pos)
@@ -33,7 +24,220 @@ vec3 get_sky_uvw(vec3 pos)
 	return ((pos - skyPos) / skySize) + vec3(0.5);
 }
 
+ivec3 get_volume_voxel_count()
+{
+	return ivec3(VOLUME_VOXELS_X, VOLUME_VOXELS_Y, VOLUME_VOXELS_Z);
+}
+
+// Sparse density (BrickGrid). brickIndexTex holds the packed atlas position of every 8^3 brick and
+// densityTex is the atlas. Empty bricks point to the zero brick at the atlas origin.
+const int DENSITY_BRICK_SIZE = 8;
+
 float getDensity(vec3 pos)
 {
-	return VOLUME_DENSITY_FACTOR * texture(densityTex, get_sky_uvw(pos)).x;
+	// Same nearest lookup with black border as DensityGrid::SampleNearest
+	const vec3 uvw = get_sky_uvw(pos);
+	if (any(lessThan(uvw, vec3(0.0))) || any(greaterThanEqual(uvw, vec3(1.0)))) { return 0.0; }
+
+	const ivec3 voxelCount = get_volume_voxel_count();
+	const ivec3 voxel = min(ivec3(uvw * vec3(voxelCount)), voxelCount - 1);
+	const uint packedBrick = texelFetch(brickIndexTex, voxel / DENSITY_BRICK_SIZE, 0).x;
+	const ivec3 atlasBrick = ivec3(packedBrick & 0x3FFu, (packedBrick >> 10) & 0x3FFu, packedBrick >> 20);
+	const ivec3 atlasVoxel = atlasBrick * DENSITY_BRICK_SIZE + (voxel % DENSITY_BRICK_SIZE);
+	return VOLUME_DENSITY_FACTOR * texelFetch(densityTex, atlasVoxel, 0).x;
+}
+
+// Density level of detail (DensityMipChain). Level lod > 0 is the mean over blocks of 2^lod voxels and
+// lives in mip level lod - 1 of densityMipTex. The blocks never leave a majorant cell, so the cell
+// majorants stay valid for every level.
+const uint DENSITY_LOD_OFF = 0;
+const uint DENSITY_LOD_BOUNCE_DEPTH = 1;
+const uint DENSITY_LOD_FOOTPRINT = 2;
+
+float getDensity(vec3 pos, int lod)
+{
+	if (lod <= 0) { return getDensity(pos); }
+
+	const vec3 uvw = get_sky_uvw(pos);
+	if (any(lessThan(uvw, vec3(0.0))) || any(greaterThanEqual(uvw, vec3(1.0)))) { return 0.0; }
+
+	const ivec3 voxelCount = get_volume_voxel_count();
+	const ivec3 voxel = min(ivec3(uvw * vec3(voxelCount)), voxelCount - 1);
+	return VOLUME_DENSITY_FACTOR * texelFetch(densityMipTex, voxel >> lod, lod - 1).x;
+}
+
+// Level for density lookups on a segment that starts after bounceCount scattering events, with
+// scatterDistance world units travelled since the first one. BounceDepth keeps everything up to the
+// first shadow rays exact and goes one level coarser per bounce. Footprint treats the path after
+// the first scattering event as a cone that widens by DENSITY_LOD_SPREAD per world unit and picks
+// the level whose voxels are as wide as the cone.
+int get_density_lod(const uint bounceCount, const float scatterDistance)
+{
+	const int maxLod = textureQueryLevels(densityMipTex);
+	if (DENSITY_LOD_MODE == DENSITY_LOD_BOUNCE_DEPTH)
+	{
+		return clamp(int(bounceCount) - 1, 0, maxLod);
+	}
+	else if (DENSITY_LOD_MODE == DENSITY_LOD_FOOTPRINT && bounceCount > 0)
+	{
+		const vec3 voxelSize = skySize / vec3(get_volume_voxel_count());
+		const float footprint = scatterDistance * DENSITY_LOD_SPREAD;
+		const float minVoxelSize = min(voxelSize.x, min(voxelSize.y, voxelSize.z));
+		return clamp(int(floor(log2(max(footprint / minVoxelSize, 1.0)))), 0, maxLod);
+	}
+
+	return 0;
+}
+
+// Majorant grid traversal
+// Voxels per majorant cell along each axis (MajorantGrid::sc_CellSize)
+const float MAJORANT_CELL_SIZE = 8.0;
+
+// Occupancy grid (OccupancyGrid). occupancyTex is a bitmask with one bit per block of
+// OCCUPANCY_BLOCK_SIZE^3 majorant cells, 32 blocks along x share one texel. minorantTex holds the
+// minimum density of every majorant cell.
+const int OCCUPANCY_BLOCK_SIZE = 4;
+
+// Debug counters in traversalStats, only written if TRAVERSAL_STATS is set
+const uint TRAVERSAL_STAT_SAMPLED_CELLS = 0;
+const uint TRAVERSAL_STAT_SKIPPED_CELLS = 1;
+const uint TRAVERSAL_STAT_SKIPPED_BLOCKS = 2;
+const uint TRAVERSAL_STAT_DENSITY_FETCHES = 3;
+const uint TRAVERSAL_STAT_FREE_FLIGHT_STEPS = 4;
+const uint TRAVERSAL_STAT_COLLISIONS = 5;
+
+void count_traversal_stat(const uint stat, const uint count)
+{
+	if (TRAVERSAL_STATS) { atomicAdd(traversalStats.counts[stat], count); }
+}
+
+bool is_block_occupied(const ivec3 cell)
+{
+	const ivec3 block = cell / OCCUPANCY_BLOCK_SIZE;
+	const uint word = texelFetch(occupancyTex, ivec3(block.x >> 5, block.yz), 0).x;
+	return (word & (1u << (block.x & 31))) != 0u;
+}
+
+struct MajorantTraversal
+{
+	ivec3 cell;
+	ivec3 cellStep;
+	vec3 tNext;
+	vec3 tDelta;
+	float t;
+	float tEnd;
+};
+
+// Coarse level of the traversal, same as OccupancyGrid::SkipEmptyBlocks. While the current cell lies
+// in an empty block, the walk is fast forwarded to the first cell behind the block without visiting
+// the cells in between. Returns false once the segment is left.
+bool skip_empty_blocks(inout MajorantTraversal it)
+{
+	const ivec3 cellCount = textureSize(majorantTex, 0);
+	while (!is_block_occupied(it.cell))
+	{
+		const ivec3 blockMin = it.cell - (it.cell % OCCUPANCY_BLOCK_SIZE);
+		const ivec3 blockMax = min(blockMin + OCCUPANCY_BLOCK_SIZE, cellCount) - 1;
+		const ivec3 cellsLeft = mix(it.cell - blockMin, blockMax - it.cell, greaterThan(it.cellStep, ivec3(0)));
+		const vec3 tExit = it.tNext + vec3(cellsLeft) * it.tDelta;
+		const int axis = tExit.x < tExit.y ? (tExit.x < tExit.z ? 0 : 2) : (tExit.y < tExit.z ? 1 : 2);
+		const float t = tExit[axis];
+
+		// Boundaries that the ray crosses on the other axes before it leaves the block. Crossings at
+		// exactly t are left to the next step.
+		ivec3 crossings = min(ivec3((t - it.tNext) / it.tDelta) + 1, cellsLeft);
+		crossings = mix(ivec3(0), crossings, lessThan(it.tNext, vec3(t)));
+		crossings[axis] = cellsLeft[axis] + 1;
+		count_traversal_stat(TRAVERSAL_STAT_SKIPPED_CELLS, uint(crossings.x + crossings.y + crossings.z));
+		count_traversal_stat(TRAVERSAL_STAT_SKIPPED_BLOCKS, 1);
+
+		it.cell += crossings * it.cellStep;
+		it.tNext += vec3(crossings) * it.tDelta;
+		it.t = min(t, it.tEnd);
+		if (t >= it.tEnd || it.cell[axis] < 0 || it.cell[axis] >= cellCount[axis]) { return false; }
+	}
+
+	return true;
+}
+
+// Starts a DDA walk through the majorant cells along ro + t * rd for t in [0, tMax]. t is measured in
+// world units. Returns false if the segment misses the volume.
+bool init_majorant_traversal(const vec3 ro, const vec3 rd, const float tMax, out MajorantTraversal it)
+{
+	// Clip segment against the volume
+	const vec2 entryExit = find_entry_exit(ro, rd);
+	const float tNear = entryExit.x;
+	const float tFar = min(entryExit.y, tMax);
+	// Written as a negation so that NaN directions are rejected as well
+	if (!(tNear < tFar)) { return false; }
+
+	const vec3 uvwOrigin = get_sky_uvw(ro);
+	const vec3 uvwDir = rd / skySize;
+	const vec3 invDir = safe_inverse_dir(uvwDir);
+
+	const vec3 cellUvwSize = MAJORANT_CELL_SIZE / vec3(get_volume_voxel_count());
+	const ivec3 cellCount = textureSize(majorantTex, 0);
+	it.cell = clamp(ivec3(floor((uvwOrigin + tNear * uvwDir) / cellUvwSize)), ivec3(0), cellCount - 1);
+	it.cellStep = ivec3(sign(invDir));
+	it.tNext = ((vec3(it.cell) + vec3(greaterThan(it.cellStep, ivec3(0)))) * cellUvwSize - uvwOrigin) * invDir;
+	it.tDelta = cellUvwSize * abs(invDir);
+	it.t = tNear;
+	it.tEnd = tFar;
+	if (!skip_empty_blocks(it)) { return false; }
+	count_traversal_stat(TRAVERSAL_STAT_SAMPLED_CELLS, 1);
+	return true;
+}
+
+float get_cell_majorant(const MajorantTraversal it)
+{
+	return VOLUME_DENSITY_FACTOR * texelFetch(majorantTex, it.cell, 0).x;
+}
+
+float get_cell_minorant(const MajorantTraversal it)
+{
+	return VOLUME_DENSITY_FACTOR * texelFetch(minorantTex, it.cell, 0).x;
+}
+
+// Mean density of the cell, which is level 3 of the density mip chain. Small volumes with fewer mip
+// levels fall back to the minorant.
+float get_cell_mean(const MajorantTraversal it)
+{
+	if (textureQueryLevels(densityMipTex) < 3) { return get_cell_minorant(it); }
+	return VOLUME_DENSITY_FACTOR * texelFetch(densityMipTex, it.cell, 2).x;
+}
+
+// Ray parameter at which ro + t * rd enters the first cell of an occupied block, or -1 if the ray
+// never touches one. Rays that miss every occupied block can not scatter.
+float find_occupied_entry(const vec3 ro, const vec3 rd)
+{
+	MajorantTraversal it;
+	if (!init_majorant_traversal(ro, rd, MAX_RAY_DISTANCE, it)) { return -1.0; }
+	return it.t;
+}
+
+float get_cell_exit(const MajorantTraversal it)
+{
+	return min(min(it.tNext.x, it.tNext.y), min(it.tNext.z, it.tEnd));
+}
+
+// Moves to the next cell. Returns false once the segment is left.
+bool step_majorant_traversal(inout MajorantTraversal it)
+{
+	it.t = get_cell_exit(it);
+	if (it.t >= it.tEnd) { return false; }
+
+	const int axis = it.tNext.x < it.tNext.y ? (it.tNext.x < it.tNext.z ? 0 : 2) : (it.tNext.y < it.tNext.z ? 1 : 2);
+	it.cell[axis] += it.cellStep[axis];
+	it.tNext[axis] += it.tDelta[axis];
+	if (it.cell[axis] < 0 || it.cell[axis] >= textureSize(majorantTex, 0)[axis]) { return false; }
+
+	// The block only changes when the step crossed a block boundary
+	const int cellInBlock = it.cell[axis] % OCCUPANCY_BLOCK_SIZE;
+	if (cellInBlock == (it.cellStep[axis] > 0 ? 0 : OCCUPANCY_BLOCK_SIZE - 1))
+	{
+		if (!skip_empty_blocks(it)) { return false; }
+	}
+
+	count_traversal_stat(TRAVERSAL_STAT_SAMPLED_CELLS, 1);
+	return true;
 }
@@ -2,10 +2,84 @@
 
 #include <string>
 #include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
 #include <json/json.hpp>
 
 namespace en
 {
+	// Level of detail for density lookups along shadow rays and secondary paths, see DensityMipChain
+	enum class DensityLodMode : uint32_t
+	{
+		Off = 0,
+		BounceDepth = 1,
+		Footprint = 2
+	};
+
+	// Estimator for the transmittance of shadow rays, see EstimateTransmittance in path_trace.glsl.
+	// Cached looks the transmittance up in a TransmittanceGrid for the dir light and in a
+	// SphericalTransmittanceGrid for the point light. The env map does not support it.
+	enum class TransmittanceMode : uint32_t
+	{
+		RatioTracking = 0,
+		ResidualRatioTracking = 1,
+		BiasedRayMarching = 2,
+		UnbiasedRayMarching = 3,
+		Cached = 4
+	};
+
+	// Constant density per majorant cell whose transmittance residual ratio tracking evaluates in
+	// closed form. Only the difference to it is estimated stochastically. The mean leaves a smaller
+	// residual, but its per step weights can exceed 1, which raises the variance in dense noisy cells.
+	enum class ResidualControl : uint32_t
+	{
+		Minimum = 0,
+		Mean = 1
+	};
+
+	// Free flight sampling of the paths, see SampleFreeFlight in path_trace.glsl
+	enum class FreeFlightMode : uint32_t
+	{
+		DeltaTracking = 0,
+		DecompositionTracking = 1
+	};
+
+	// Phase function of the medium, see PhaseFunction. Henyey-Greenstein is sampled in closed form, the
+	// others through an inverse cdf table.
+	enum class PhaseFuncMode : uint32_t
+	{
+		HenyeyGreenstein = 0,
+		ApproximateMie = 1,
+		Tabulated = 2
+	};
+
+	// Implementation of the network and optimizer behind NeuralRadianceCache, see NrcBackend
+	enum class NrcBackendMode : uint32_t
+	{
+		Tcnn = 0,
+		Cpu = 1
+	};
+
+	struct PhaseFuncConfig
+	{
+		PhaseFuncMode mode = PhaseFuncMode::HenyeyGreenstein;
+		// Water droplet diameter in micrometers of PhaseFuncMode::ApproximateMie, in [5, 50]
+		float mieDiameter = 20.0f;
+		// Values over theta of PhaseFuncMode::Tabulated, see ReadFilePhaseFunc
+		std::string tablePath;
+	};
+
+	// Transmittance estimator of the shadow rays towards each light type
+	struct ShadowTransmittance
+	{
+		TransmittanceMode dirLight = TransmittanceMode::RatioTracking;
+		TransmittanceMode pointLight = TransmittanceMode::RatioTracking;
+		TransmittanceMode hdrEnvMap = TransmittanceMode::RatioTracking;
+		ResidualControl residualControl = ResidualControl::Minimum;
+
+		bool UsesResidualRatioTracking() const;
+		bool IsRatioTrackingOnly() const;
+	};
+
 	struct AppConfig
 	{
 		struct NNEncodingConfig
@@ -30,6 +104,7 @@ namespace en
 			float hdrEnvMapStrength = 0.0f;
 			float density = 0.0f;
 			bool dynamic = false;
+			VkFormat densityFormat = VK_FORMAT_R8_UNORM; // R8_UNORM, R16_SFLOAT or R32_SFLOAT
 
 			HpmSceneConfig();
 			HpmSceneConfig(uint32_t id);
@@ -59,11 +134,34 @@ namespace en
 		bool enableBenchmarkOnStart = 0;
 		bool enablePauseOnStart = 0;
 
+		// optional "--name=value" arguments after the positional ones
+		DensityLodMode densityLodMode = DensityLodMode::Off;
+		// Widening of the ray cone per world unit after the first scattering event (DensityLodMode::Footprint)
+		float densityLodSpread = 0.25f;
+		// Count traversed cells and density fetches on the gpu, see VolumeData::RenderImGui
+		bool traversalStats = false;
+		ShadowTransmittance shadowTransmittance;
+		FreeFlightMode freeFlightMode = FreeFlightMode::DeltaTracking;
+		PhaseFuncConfig phaseFunc;
+		NrcBackendMode nrcBackend = NrcBackendMode::Tcnn;
+		// Threads of CpuNrcBackend, 0 uses every core
+		uint32_t nrcThreadCount = 0;
+		// fp16 NRC input and output buffers between the shaders and the backend, see NeuralRadianceCache::UsesHalfIo.
+		// Experimental, the backends still train and infer on floats converted per batch.
+		bool nrcHalfIo = false;
+		// Train the NRC on a frame while the next one is path traced, see NeuralRadianceCache::InferAndTrain
+		bool nrcPipelined = false;
+		// Replace every env map value with 1 after loading, see ReadFileHdr4f
+		bool hdrEnvMapTestOverwrite = true;
+
 		AppConfig();
 		AppConfig(const std::vector<char*>& argv);
 
 		std::string GetName() const;
 
 		void RenderImGui() const;
+
+	private:
+		void ParseOption(const std::string& option);
 	};
 }
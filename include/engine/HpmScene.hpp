@@ -5,12 +5,19 @@
 #include <engine/graphics/PointLight.hpp>
 #include <engine/graphics/HdrEnvMap.hpp>
 #include <engine/graphics/vulkan/Texture3D.hpp>
+#include <engine/graphics/vulkan/CommandPool.hpp>
 #include <engine/objects/VolumeData.hpp>
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/MajorantGrid.hpp>
+#include <engine/objects/VolumeCache.hpp>
+#include <engine/objects/TransmittanceGrid.hpp>
+#include <engine/objects/SphericalTransmittanceGrid.hpp>
 #include <engine/AppConfig.hpp>
+#include <engine/HpmSceneSetup.hpp>
 
 namespace en
 {
-	class HpmScene
+	class HpmScene : public HpmSceneSetup
 	{
 	public:
 		static const std::vector<VkDescriptorSetLayout>& GetDescriptorSetLayout();
@@ -25,6 +32,8 @@ namespace en
 		bool IsDynamic() const;
 		const std::vector<VkDescriptorSet>& GetDescriptorSets() const;
 		const VolumeData* GetVolumeData() const;
+		const DensityGrid* GetDensityGrid() const;
+		const MajorantGrid* GetMajorantGrid() const;
 		const HdrEnvMap* GetHdrEnvMap() const;
 
 	private:
@@ -37,9 +46,28 @@ namespace en
 		PointLight* m_PointLight = nullptr;
 		HdrEnvMap* m_HdrEnvMap = nullptr;
 
+		VolumeCache* m_VolumeCache = nullptr;
 		vk::Texture3D* m_Density3DTex = nullptr;
+		vk::Texture3D* m_Majorant3DTex = nullptr;
+		vk::Texture3D* m_BrickIndex3DTex = nullptr;
+		vk::Texture3D* m_DensityMip3DTex = nullptr;
+		vk::Texture3D* m_Occupancy3DTex = nullptr;
+		vk::Texture3D* m_Minorant3DTex = nullptr;
+		// Only built for TransmittanceMode::Cached, the texture is a single unshadowed texel otherwise
+		TransmittanceGrid* m_DirLightTransmittanceGrid = nullptr;
+		vk::Texture3D* m_DirLightTransmittance3DTex = nullptr;
+		SphericalTransmittanceGrid* m_PointLightTransmittanceGrid = nullptr;
+		vk::Texture3D* m_PointLightTransmittance3DTex = nullptr;
+		// Transmittance uploads are recorded into one command buffer per frame. The fence guards the
+		// staging buffers of the textures, which the next upload reuses.
+		vk::CommandPool* m_UploadCommandPool = nullptr;
+		VkFence m_UploadFence = VK_NULL_HANDLE;
 		VolumeData* m_VolumeData = nullptr;
 
 		std::vector<VkDescriptorSet> m_DescSets;
+
+		// Rebuild the transmittance grid of a light that moved since the last build and record the upload
+		void UpdateDirLightTransmittance(VkCommandBuffer commandBuffer);
+		void UpdatePointLightTransmittance(VkCommandBuffer commandBuffer);
 	};
 }
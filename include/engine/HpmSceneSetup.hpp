@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <cstdint>
+
+// Direction of a dir light from its angles
+glm::vec3 VecFromAngles(float zenith, float azimuth);
+
+namespace en
+{
+	class DensityGrid;
+
+	// Fixed part of the scene. Kept free of Vulkan so that CpuHpmRenderer and the CPU benchmarks can build the same
+	// scene as HpmScene.
+	struct HpmSceneSetup
+	{
+		static const std::string sc_DensityFilePath;
+		static constexpr float sc_VolumeG = 0.8f;
+		static constexpr float sc_DirLightZenith = -1.57f;
+		static constexpr float sc_DirLightAzimuth = 0.0f;
+		static const glm::vec3 sc_PointLightPos;
+		static const glm::vec3 sc_PointLightColor;
+		static constexpr float sc_HdrEnvMapMaxValue = 10000.0f;
+
+		// Start camera of the app, also used for the reference images
+		static const glm::vec3 sc_CameraPos;
+		static const glm::vec3 sc_CameraViewDir;
+		static const glm::vec3 sc_CameraUp;
+		static const float sc_CameraFov;
+		static constexpr float sc_CameraNearPlane = 0.1f;
+		static constexpr float sc_CameraFarPlane = 100.0f;
+
+		// World space size of a volume with the given voxel resolution
+		static glm::vec3 GetVolumeSize(uint32_t width, uint32_t height, uint32_t depth);
+		// World space size and center of a trimmed density grid. The scale is taken from its source
+		// box, so trimming does not move or scale the voxels that are left.
+		static glm::vec3 GetVolumeSize(const DensityGrid& densityGrid);
+		static glm::vec3 GetVolumePosition(const DensityGrid& densityGrid);
+	};
+}
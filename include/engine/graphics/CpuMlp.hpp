@@ -0,0 +1,67 @@
+#pragma once
+
+#include <random>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Fully connected network of CpuNrcBackend with hiddenLayerCount ReLU layers of width neurons and a
+	// linear output layer, like the FullyFusedMLP of tiny-cuda-nn but with biases. Samples go through it
+	// in blocks of up to sc_BlockSize, one layer at a time for the whole block, so the weights of a layer
+	// and the activations of the block stay in cache. Inside of a block the matrix products run on
+	// register tiles of 4 x 16 sums. Weights are stored input major ([input][output]).
+	class CpuMlp
+	{
+	public:
+		static constexpr uint32_t sc_BlockSize = 64;
+
+		CpuMlp(uint32_t inputCount, uint32_t outputCount, uint32_t width, uint32_t hiddenLayerCount);
+
+		size_t GetParamCount() const;
+		// Xavier uniform weights and zero biases
+		void InitParams(float* params, std::mt19937& rng) const;
+
+		// Floats of the activations of a block, its input followed by the output of every layer
+		size_t GetActivationCount() const;
+		// Floats of the gradient buffers of Backward
+		size_t GetDeltaCount() const;
+		// Floats of the output major copy of the weights that Backward needs, without the biases
+		size_t GetTransposedWeightCount() const;
+		void TransposeWeights(const float* params, float* transposedWeights) const;
+
+		// activations starts with count input samples, the outputs of every layer are written behind them.
+		// Returns the network output of the block, outputCount floats per sample.
+		const float* Forward(const float* params, float* activations, uint32_t count) const;
+		// Backpropagates dOutput, the gradient of the loss over the network output of the last Forward of
+		// activations, and adds the gradient of the parameters to gradParams. transposedWeights is the
+		// TransposeWeights of the parameters. dOutput and scratch hold GetDeltaCount floats and are overwritten.
+		// The gradient over the input is written to dInput unless it is nullptr.
+		void Backward(
+			const float* transposedWeights,
+			const float* activations,
+			float* dOutput,
+			float* scratch,
+			uint32_t count,
+			float* gradParams,
+			float* dInput) const;
+
+	private:
+		struct Layer
+		{
+			uint32_t inputCount;
+			uint32_t outputCount;
+			// Weights at paramOffset followed by the biases
+			size_t paramOffset;
+			// Input of the layer in the activations of a block
+			size_t activationOffset;
+			size_t transposedOffset;
+		};
+
+		std::vector<Layer> m_Layers;
+		size_t m_ParamCount = 0;
+		size_t m_ActivationCount = 0;
+		size_t m_DeltaCount = 0;
+		size_t m_TransposedWeightCount = 0;
+	};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <engine/graphics/NrcBackend.hpp>
+#include <engine/graphics/CpuNrcEncoding.hpp>
+#include <engine/graphics/CpuMlp.hpp>
+#include <engine/AppConfig.hpp>
+#include <tbb/task_arena.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <vector>
+
+namespace en
+{
+	// NRC on the CPU without cuda. CpuNrcEncoding in front of a CpuMlp, trained with Adam and inferred
+	// with an exponential moving average of the parameters like the EMA optimizer of tiny-cuda-nn. The
+	// blocks of a batch are spread over the threads of a task arena of AppConfig::nrcThreadCount threads.
+	class CpuNrcBackend : public NrcBackend
+	{
+	public:
+		CpuNrcBackend(const AppConfig& appConfig, uint32_t inputCount, uint32_t outputCount);
+
+		bool UsesHostMemory() const override;
+
+		void Inference(const float* input, float* output, uint32_t count) override;
+		void Train(const float* input, const float* target, uint32_t count) override;
+		float GetLastLoss() override;
+
+		size_t GetParamCount() const;
+
+	private:
+		enum class LossFn
+		{
+			L1,
+			L2,
+			RelativeL2,
+			RelativeL2Luminance
+		};
+
+		// Buffers of one thread for one block
+		struct Workspace
+		{
+			std::vector<float> activations;
+			std::vector<float> deltas;
+			std::vector<float> scratch;
+		};
+
+		static constexpr float sc_AdamBeta1 = 0.9f;
+		static constexpr float sc_AdamBeta2 = 0.999f;
+		static constexpr float sc_AdamEpsilon = 1e-8f;
+
+		const uint32_t m_OutputCount;
+		const LossFn m_LossFn;
+		const float m_LearningRate;
+		const float m_EmaDecay;
+
+		tbb::task_arena m_Arena;
+		CpuNrcEncoding m_Encoding;
+		CpuMlp m_Mlp;
+
+		// Encoding parameters followed by the network parameters
+		std::vector<float> m_Params;
+		std::vector<float> m_Gradients;
+		std::vector<float> m_AdamM;
+		std::vector<float> m_AdamV;
+		// Bias corrected moving average of m_Params, used for inference
+		std::vector<float> m_EmaParams;
+		uint32_t m_Step = 0;
+		float m_LastLoss = 0.0f;
+		// Network weights of m_Params in the layout of CpuMlp::TransposeWeights, rebuilt every step
+		std::vector<float> m_TransposedWeights;
+
+		// Gradient over the encoded samples of the current batch for the encoding backward pass
+		std::vector<float> m_EncodedGradients;
+
+		tbb::enumerable_thread_specific<Workspace> m_Workspaces;
+		tbb::enumerable_thread_specific<std::vector<float>> m_MlpGradients;
+
+		static LossFn ParseLossFn(const std::string& name);
+
+		Workspace& GetWorkspace();
+		// Loss of one sample and its gradient over the prediction, scaled by scale
+		float EvalLoss(const float* prediction, const float* target, float scale, float* dPrediction) const;
+		void OptimizerStep();
+	};
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <engine/AppConfig.hpp>
+#include <engine/util/packet_tracking.hpp>
+#include <tbb/enumerable_thread_specific.h>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Input encodings of CpuNrcBackend, the same HashGrid, Identity, TriangleWave and Frequency encodings
+	// of the position and OneBlob, Identity and TriangleWave encodings of the direction that
+	// NNEncodingConfig selects for tiny-cuda-nn. The encoded values of both are concatenated.
+	// The hash grid runs on 8 samples at once with AVX2 gathers unless the isa is Scalar, samples
+	// outside of [0, 1]^3 and the rest of a block take the scalar path.
+	class CpuNrcEncoding
+	{
+	public:
+		// Position in [0, 1]^3 followed by the normalized direction angles in [0, 1]^2
+		static constexpr uint32_t sc_InputCount = 5;
+
+		CpuNrcEncoding(const AppConfig::NNEncodingConfig& config, PacketIsa isa);
+
+		uint32_t GetOutputCount() const;
+		// Trainable parameters, only the hash grid has any
+		size_t GetParamCount() const;
+		// Uniform in [-1e-4, 1e-4] like tiny-cuda-nn
+		void InitParams(float* params, std::mt19937& rng) const;
+
+		// Encodes count samples of sc_InputCount floats into GetOutputCount floats each
+		void Encode(const float* params, const float* input, float* output, uint32_t count) const;
+		// Adds the gradient of the parameters for dOutput, the gradient of the loss over the encoded
+		// samples, to gradParams. Runs in parallel over the samples, every thread collects its hash grid
+		// gradients in buckets of parameter ranges. The buckets are then added to gradParams in parallel
+		// over the ranges, so no two threads write the same parameter.
+		void Backward(const float* input, const float* dOutput, float* gradParams, uint32_t count);
+
+		bool IsHashGridVectorized() const;
+
+	private:
+		enum class Type
+		{
+			HashGrid,
+			Identity,
+			TriangleWave,
+			Frequency,
+			OneBlob
+		};
+
+		// Encoding of the inputs [inputOffset, inputOffset + inputCount) into the outputs
+		// [outputOffset, outputOffset + outputCount). frequencyCount is the bin count of OneBlob.
+		struct Part
+		{
+			Type type;
+			uint32_t inputOffset;
+			uint32_t inputCount;
+			uint32_t outputOffset;
+			uint32_t outputCount;
+			uint32_t frequencyCount;
+		};
+
+		// Dense levels index their cells directly, the others through the spatial hash of tiny-cuda-nn
+		struct HashGridLevel
+		{
+			float scale;
+			uint32_t resolution;
+			uint32_t size;
+			size_t paramOffset;
+			bool dense;
+		};
+
+		static constexpr uint32_t sc_HashGridLevelCount = 16;
+		static constexpr uint32_t sc_HashGridFeatureCount = 2;
+		static constexpr uint32_t sc_HashGridLog2Size = 19;
+		static constexpr uint32_t sc_HashGridBaseResolution = 16;
+		static constexpr float sc_HashGridPerLevelScale = 2.0f;
+		// Parameter ranges of the gradient buckets of Backward and samples that are bucketed at once,
+		// which gives sc_HashGridChunkSize * 128 gradients of 12 bytes
+		static constexpr uint32_t sc_HashGridBucketCount = 256;
+		static constexpr uint32_t sc_HashGridChunkSize = 2048;
+
+		// Gradient of the features of one hash grid entry, entry counts over all levels
+		struct HashGridGradient
+		{
+			uint32_t entry;
+			float grad[sc_HashGridFeatureCount];
+		};
+		using HashGridBuckets = std::vector<std::vector<HashGridGradient>>;
+
+		std::vector<Part> m_Parts;
+		std::vector<HashGridLevel> m_HashGridLevels;
+		uint32_t m_OutputCount = 0;
+		size_t m_ParamCount = 0;
+		bool m_HashGridAvx2;
+		// Entry >> m_HashGridBucketShift is the bucket of an entry
+		uint32_t m_HashGridBucketShift = 0;
+		tbb::enumerable_thread_specific<HashGridBuckets> m_HashGridBuckets;
+
+		void AddPart(Type type, uint32_t inputCount, uint32_t frequencyCount);
+		uint32_t GetHashGridIndex(const HashGridLevel& level, uint32_t x, uint32_t y, uint32_t z) const;
+		void EncodeHashGrid(const float* params, const float* input, float* output) const;
+		void EncodeHashGridBlock(const Part& part, const float* params, const float* input, float* output, uint32_t count) const;
+		void AddHashGridGradients(const Part& part, const float* input, const float* dOutput, HashGridBuckets& buckets) const;
+		// 8 samples, false without any output if one of them lies outside of [0, 1]^3
+		bool EncodeHashGridAvx2(const Part& part, const float* params, const float* input, float* output) const;
+		bool AddHashGridGradientsAvx2(const Part& part, const float* input, const float* dOutput, HashGridBuckets& buckets) const;
+	};
+}
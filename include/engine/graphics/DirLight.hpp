@@ -28,6 +28,8 @@ namespace en
 
 		float GetZenith() const;
 		float GetAzimuth() const;
+		// Direction the light travels in, the shaders trace shadow rays along its negation
+		glm::vec3 GetDir() const;
 
 		void SetZenith(float z);
 		void SetAzimuth(float a);
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <engine/graphics/vulkan/Buffer.hpp>
+#include <engine/util/AliasTable.hpp>
 
 namespace en
 {
@@ -18,7 +19,8 @@ namespace en
 			uint32_t height, 
 			const std::vector<float>& hdr4f,
 			const std::vector<float>& cdfX,
-			const std::vector<float>& cdfY);
+			const std::vector<float>& cdfY,
+			const AliasTable& aliasTable);
 
 		void Destroy();
 
@@ -52,6 +54,9 @@ namespace en
 		VkImageView m_CdfYImageView;
 		VkDeviceMemory m_CdfYImageMemory;
 
+		// Entries of the alias table over all texels
+		vk::Buffer m_AliasTableBuffer;
+
 		VkSampler m_Sampler;
 
 		VkDescriptorSet m_DescSet;
@@ -59,6 +64,7 @@ namespace en
 		void CreateColorImage(VkDevice device, VkQueue queue, const std::vector<float>& hdr4f);
 		void CreateCdfXImage(VkDevice device, VkQueue queue, const std::vector<float>& cdfX);
 		void CreateCdfYImage(VkDevice device, VkQueue queue, const std::vector<float>& cdfY);
+		void UploadAliasTable(const AliasTable& aliasTable);
 
 		void ChangeColorImageLayout(VkImageLayout layout, VkCommandBuffer commandBuffer, VkQueue queue);
 		void WriteBufferToColorImage(VkCommandBuffer commandBuffer, VkQueue queue, VkBuffer buffer);
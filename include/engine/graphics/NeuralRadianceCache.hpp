@@ -1,9 +1,11 @@
 #pragma once
 
-#include <tiny-cuda-nn/config.h>
-#include <engine/graphics/vulkan/Buffer.hpp>
-#include <vector>
+#include <engine/graphics/NrcBackend.hpp>
 #include <engine/AppConfig.hpp>
+#include <cuda_runtime.h>
+#include <future>
+#include <memory>
+#include <vector>
 
 namespace en
 {
@@ -12,46 +14,98 @@ namespace en
 	public:
 		NeuralRadianceCache(const AppConfig& appConfig);
 
+		// The buffers are cuda device memory for the tcnn backend and host memory if UsesHostMemory
+		// returns true. The cuda semaphores are timeline semaphores that are only used with device memory.
+		// The train buffers hold GetTrainSlotCount slots of the train samples. The infer buffers hold
+		// maxInferCount samples, a multiple of sc_BatchGranularity. dCuInferCount holds the number of
+		// samples that were packed to the front of the infer input. It is read on the device after the
+		// start semaphore and on the host only for host memory backends.
+		// Samples take GetInputSampleSize and GetOutputSampleSize bytes, see UsesHalfIo.
 		void Init(
-			uint32_t inferCount,
-			float* dCuInferInput, 
-			float* dCuInferOutput, 
-			float* dCuTrainInput, 
-			float* dCuTrainTarget,
+			uint32_t maxInferCount,
+			void* dCuInferInput, 
+			void* dCuInferOutput, 
+			void* dCuTrainInput, 
+			void* dCuTrainTarget,
+			const uint32_t* dCuInferCount,
 			cudaExternalSemaphore_t cudaStartSemaphore,
 			cudaExternalSemaphore_t cudaFinishedSemaphore);
 
-		void InferAndTrain(const uint32_t* inferFilter, bool train);
+		// Inference and training of the frame with syncValue, which the start semaphore reaches when the
+		// nrc buffers are written and the finished semaphore reaches when the infer output is written.
+		// The training reads train slot syncValue % GetTrainSlotCount. With pipelining it runs after the
+		// finished semaphore, concurrently to the next frame, and is awaited by the next call.
+		void InferAndTrain(bool train, uint64_t syncValue);
+		// Waits for a pipelined training step, the nrc buffers have to stay alive until then
+		void AwaitTraining();
 
 		void Destroy();
 
+		bool UsesHostMemory() const;
+		// Inputs and outputs are fp16 padded to sc_HalfInputStride and sc_HalfOutputStride halves per
+		// sample instead of sc_InputCount and sc_OutputCount floats. They are converted to floats batch
+		// by batch for the backend.
+		bool UsesHalfIo() const;
+		size_t GetInputSampleSize() const;
+		size_t GetOutputSampleSize() const;
 		float GetLoss() const;
 		float GetInferenceTime() const;
+		// Training time of the last serial InferAndTrain that trained, with pipelining the time the
+		// host waited for the previous training
 		float GetTrainTime() const;
-		size_t GetInferBatchCount() const;
+		// Training throughput of the last serial InferAndTrain that trained
+		float GetTrainSamplesPerSecond() const;
+		bool IsPipelined() const;
+		// Copies of the train samples, two with pipelining, so the next frame writes a different one
+		uint32_t GetTrainSlotCount() const;
+		// Samples of the last inference, for device memory backends of an inference that finished before
+		// the last one started
+		uint32_t GetInferCount() const;
 		size_t GetTrainBatchCount() const;
 		uint32_t GetInferBatchSize() const;
 		uint32_t GetTrainBatchSize() const;
 
 		static uint32_t sc_InputCount;
 		static uint32_t sc_OutputCount;
+		// Sample counts of the batches are padded to multiples of it, tiny-cuda-nn requires 128
+		static uint32_t sc_BatchGranularity;
+		// Halves per sample of the fp16 layout, 16 byte inputs and 8 byte outputs
+		static uint32_t sc_HalfInputStride;
+		static uint32_t sc_HalfOutputStride;
 
 	private:
+		// Samples [offset, offset + size) of the big buffers
+		struct Batch
+		{
+			uint32_t offset;
+			uint32_t size;
+		};
+
 		const uint32_t m_InferBatchSize = 0;
 		const uint32_t m_TrainBatchSize = 0;
 		const uint32_t m_TrainBatchCount = 0;
+		const bool m_HalfIo = false;
+		const bool m_Pipelined = false;
 
-		tcnn::TrainableModel m_Model;
+		std::unique_ptr<NrcBackend> m_Backend;
 
-		tcnn::GPUMatrix<float> m_InferInput;
-		tcnn::GPUMatrix<float> m_InferOutput;
-		tcnn::GPUMatrix<float> m_TrainInput;
-		tcnn::GPUMatrix<float> m_TrainTarget;
+		void* m_InferInput = nullptr;
+		void* m_InferOutput = nullptr;
+		void* m_TrainInput = nullptr;
+		void* m_TrainTarget = nullptr;
+		const uint32_t* m_InferCount = nullptr;
+		uint32_t m_MaxInferCount = 0;
+		uint32_t m_LastInferCount = 0;
+		// Pinned copy of the device infer count, valid once m_InferCountEvent completed
+		uint32_t* m_InferCountHost = nullptr;
+		cudaEvent_t m_InferCountEvent = nullptr;
 
-		std::vector<tcnn::GPUMatrix<float>> m_InferInputBatches;
-		std::vector<tcnn::GPUMatrix<float>> m_InferOutputBatches;
-		std::vector<tcnn::GPUMatrix<float>> m_TrainInputBatches;
-		std::vector<tcnn::GPUMatrix<float>> m_TrainTargetBatches;
+		std::vector<Batch> m_TrainBatches;
+
+		// Float batches of the fp16 layout in the memory of the backend. The output scratch holds the
+		// infer output and the train target.
+		float* m_InputScratch = nullptr;
+		float* m_OutputScratch = nullptr;
 
 		cudaExternalSemaphore_t m_CudaStartSemaphore;
 		cudaExternalSemaphore_t m_CudaFinishedSemaphore;
@@ -59,11 +113,22 @@ namespace en
 		float m_Loss = 0.0f;
 		double m_InferenceTime = 0.0;
 		double m_TrainTime = 0.0;
-		size_t m_TrainCounter = 0;
+		double m_TrainSamplesPerSecond = 0.0;
+
+		// Training that has been started but whose loss was not read yet, host memory backends run
+		// pipelined training in m_TrainFuture
+		bool m_TrainPending = false;
+		std::future<void> m_TrainFuture;
 
-		void Inference(const uint32_t* inferFilter);
-		void Train();
-		void AwaitCudaStartSemaphore();
-		void SignalCudaFinishedSemaphore();
+		void Inference();
+		void Train(uint32_t slot);
+		void StartTraining(uint32_t slot);
+		// dTotalCount is the device side count of valid samples in buffer for the fp16 conversion, or null
+		const float* GetBatchInput(const void* buffer, uint32_t offset, uint32_t count, const uint32_t* dTotalCount = nullptr);
+		const float* GetBatchTarget(const void* buffer, uint32_t offset, uint32_t count);
+		float* GetBatchOutput(void* buffer, uint32_t offset);
+		void StoreBatchOutput(void* buffer, uint32_t offset, uint32_t count, const uint32_t* dTotalCount = nullptr);
+		void AwaitCudaStartSemaphore(uint64_t value);
+		void SignalCudaFinishedSemaphore(uint64_t value);
 	};
 }
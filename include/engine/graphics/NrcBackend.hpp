@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+namespace en
+{
+	// Network and optimizer behind NeuralRadianceCache. Inputs, outputs and targets are sample major,
+	// NeuralRadianceCache::sc_InputCount and sc_OutputCount floats per sample. They are cuda device
+	// memory unless UsesHostMemory returns true.
+	class NrcBackend
+	{
+	public:
+		virtual ~NrcBackend() = default;
+
+		virtual bool UsesHostMemory() const = 0;
+
+		virtual void Inference(const float* input, float* output, uint32_t count) = 0;
+		// One optimizer step on a batch of count samples. Device memory backends may return before the
+		// step finished, later calls are ordered after it.
+		virtual void Train(const float* input, const float* target, uint32_t count) = 0;
+		// Loss of the batch of the last Train, waits for the step to finish
+		virtual float GetLastLoss() = 0;
+	};
+}
@@ -19,6 +19,7 @@ namespace en
 		void RenderImGui();
 
 		VkDescriptorSet GetDescriptorSet() const;
+		glm::vec3 GetPos() const;
 
 	private:
 		static VkDescriptorSetLayout m_DescSetLayout;
@@ -28,6 +28,10 @@ namespace en
 			float GetCV() const;
 		};
 
+		// Renders the reference image of the scene with CpuHpmRenderer into the same location that
+		// GenRefImages uses. Does nothing if it already exists. Needs no Vulkan device.
+		static void GenRefImagesCpu(const AppConfig& appConfig, uint32_t width, uint32_t height);
+
 		Reference(
 			uint32_t width,
 			uint32_t height,
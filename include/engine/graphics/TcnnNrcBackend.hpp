@@ -0,0 +1,33 @@
+#pragma once
+
+#include <tiny-cuda-nn/config.h>
+#include <engine/graphics/NrcBackend.hpp>
+#include <engine/AppConfig.hpp>
+#include <memory>
+
+namespace en
+{
+	// tiny-cuda-nn FullyFusedMLP on cuda memory imported from vulkan
+	class TcnnNrcBackend : public NrcBackend
+	{
+	public:
+		TcnnNrcBackend(const AppConfig& appConfig, uint32_t inputCount, uint32_t outputCount);
+
+		bool UsesHostMemory() const override;
+
+		void Inference(const float* input, float* output, uint32_t count) override;
+		void Train(const float* input, const float* target, uint32_t count) override;
+		float GetLastLoss() override;
+
+	private:
+		using TrainContext = decltype(tcnn::TrainableModel::trainer)::element_type::ForwardContext;
+
+		const uint32_t m_InputCount;
+		const uint32_t m_OutputCount;
+
+		tcnn::TrainableModel m_Model;
+		// Context of the last training step, its loss is only reduced on the host when it is asked for
+		std::unique_ptr<TrainContext> m_LastTrainContext;
+		float m_LastLoss = 0.0f;
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/MajorantGrid.hpp>
+#include <engine/objects/VolumeCache.hpp>
+#include <engine/objects/TransmittanceGrid.hpp>
+#include <engine/objects/SphericalTransmittanceGrid.hpp>
+#include <engine/objects/PhaseFunction.hpp>
+#include <engine/AppConfig.hpp>
+#include <engine/util/AliasTable.hpp>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace en
+{
+	// Host only path tracer evaluating the same estimator as mc/render.comp and path_trace.glsl. It
+	// loads its own copy of the scene and never touches Vulkan, so it also runs on machines without
+	// a GPU. Pixels are rendered in tiles that are distributed over all cores by the TBB scheduler.
+	class CpuHpmRenderer
+	{
+	public:
+		static constexpr uint32_t sc_TileSize = 16;
+
+		CpuHpmRenderer(uint32_t width, uint32_t height, uint32_t pathLength, const AppConfig& appConfig);
+
+		// Adds sampleCount samples per pixel to the accumulated image
+		void Render(uint32_t sampleCount);
+		void ExportOutputImageToFile(const std::string& filePath) const;
+
+		uint32_t GetSampleCount() const;
+
+		// Same projection as Camera::UpdateUniformBuffer. Resets the accumulated image.
+		void SetCamera(
+			const glm::vec3& pos,
+			const glm::vec3& viewDir,
+			const glm::vec3& up,
+			float aspectRatio,
+			float fov,
+			float nearPlane,
+			float farPlane);
+
+	private:
+		class Random;
+
+		// Occupied part of a shadow ray for the ray marching estimators
+		struct RayMarchSegment
+		{
+			glm::vec3 start;
+			glm::vec3 dir;
+			float tMin;
+			float tMax;
+			float controlOpticalDepth;
+			uint32_t stepCount;
+		};
+
+		uint32_t m_Width;
+		uint32_t m_Height;
+		uint32_t m_PathLength;
+
+		// Camera
+		glm::mat4 m_InvProjView;
+		glm::vec3 m_CameraPos;
+
+		// Volume
+		VolumeCache m_VolumeCache;
+		// Density is sampled through the same sparse layout as on the gpu
+		BrickGrid& m_BrickGrid;
+		const MajorantGrid& m_MajorantGrid;
+		const OccupancyGrid& m_OccupancyGrid;
+		// Mean densities of the majorant cells for ResidualControl::Mean
+		const DensityMipChain& m_DensityMipChain;
+		glm::vec3 m_VolumeSize;
+		glm::vec3 m_VolumePos;
+		float m_DensityFactor;
+		PhaseFunction m_PhaseFunction;
+		ShadowTransmittance m_ShadowTransmittance;
+		FreeFlightMode m_FreeFlightMode;
+
+		// Lights
+		glm::vec3 m_DirLightDir;
+		float m_DirLightStrength;
+		// Only built for TransmittanceMode::Cached
+		std::unique_ptr<TransmittanceGrid> m_DirLightTransmittanceGrid;
+		std::unique_ptr<SphericalTransmittanceGrid> m_PointLightTransmittanceGrid;
+		glm::vec3 m_PointLightPos;
+		glm::vec3 m_PointLightColor;
+		float m_PointLightStrength;
+
+		// Hdr env map as rgba floats with bilinear clamp to edge sampling like the HdrEnvMap sampler. The
+		// alpha channel and the alias table are the importance sampling tables from Hdr4fToAliasTable.
+		uint32_t m_HdrEnvMapWidth;
+		uint32_t m_HdrEnvMapHeight;
+		std::vector<float> m_HdrEnvMap4f;
+		AliasTable m_HdrEnvMapAliasTable;
+		float m_HdrEnvMapStrength;
+
+		// Sum of all samples as rgba per pixel
+		std::vector<double> m_Accumulation;
+		uint32_t m_SampleCount = 0;
+
+		glm::vec4 RenderPixel(uint32_t x, uint32_t y, Random& random) const;
+		glm::vec4 TracePath(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& didScatter, Random& random) const;
+
+		glm::vec2 FindEntryExit(const glm::vec3& ro, const glm::vec3& rd) const;
+		float FindOccupiedEntry(const glm::vec3& ro, const glm::vec3& rd) const;
+		float GetCellMean(const glm::ivec3& cell) const;
+		float GetDensity(const glm::vec3& pos) const;
+		float RatioTrack(const glm::vec3& start, const glm::vec3& end, Random& random) const;
+		float ResidualRatioTrack(const glm::vec3& start, const glm::vec3& end, Random& random) const;
+		bool InitRayMarch(const glm::vec3& start, const glm::vec3& end, RayMarchSegment& segment) const;
+		float RayMarchOpticalDepth(const RayMarchSegment& segment, Random& random) const;
+		float BiasedRayMarch(const glm::vec3& start, const glm::vec3& end, Random& random) const;
+		float UnbiasedRayMarch(const glm::vec3& start, const glm::vec3& end, Random& random) const;
+		float EstimateTransmittance(const glm::vec3& start, const glm::vec3& end, TransmittanceMode mode, Random& random) const;
+		glm::vec3 DeltaTrack(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& volumeExit, Random& random) const;
+		glm::vec3 DecompositionTrack(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& volumeExit, Random& random) const;
+		glm::vec3 SampleFreeFlight(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& volumeExit, Random& random) const;
+
+		float PhaseFunc(float cosTheta) const;
+		glm::vec3 NewRayDir(glm::vec3 oldRayDir, bool phaseFuncSampling, Random& random) const;
+
+		glm::vec3 TraceDirLight(const glm::vec3& pos, const glm::vec3& dir, Random& random) const;
+		glm::vec3 TracePointLight(const glm::vec3& pos, const glm::vec3& dir, Random& random) const;
+		glm::vec3 SampleHdrEnvMap(const glm::vec3& dir) const;
+		float GetHdrEnvMapPdf(const glm::vec3& dir) const;
+		glm::vec3 SampleHdrEnvMapDir(Random& random) const;
+		glm::vec3 SampleHdrEnvMap(const glm::vec3& pos, const glm::vec3& dir, uint32_t sampleCount, Random& random) const;
+		glm::vec3 TraceScene(const glm::vec3& pos, const glm::vec3& dir, Random& random) const;
+	};
+}
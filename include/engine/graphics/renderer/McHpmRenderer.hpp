@@ -13,7 +13,16 @@ namespace en
 		static void Init(VkDevice device);
 		static void Shutdown(VkDevice device);
 
-		McHpmRenderer(uint32_t width, uint32_t height, uint32_t pathLength, bool blend, const Camera* camera, const HpmScene& scene);
+		// reference ignores the density LOD mode, the shadow transmittance estimators and the free flight
+		// mode of the scene, which keeps reference images exact and the same for every configuration
+		McHpmRenderer(
+			uint32_t width,
+			uint32_t height,
+			uint32_t pathLength,
+			bool blend,
+			const Camera* camera,
+			const HpmScene& scene,
+			bool reference = false);
 
 		void Render(VkQueue queue);
 		void Destroy();
@@ -26,6 +35,8 @@ namespace en
 		VkImage GetImage() const;
 		VkImageView GetImageView() const;
 		bool IsBlending() const;
+		// Gpu time of the frame from the last EvaluateTimestampQueries in ms
+		float GetTotalTime() const;
 
 		void SetCamera(VkQueue queue, const Camera* camera);
 		void SetBlend(bool blend);
@@ -44,6 +55,28 @@ namespace en
 			float volumeG;
 
 			float hdrEnvMapStrength;
+
+			uint32_t volumeVoxelsX;
+			uint32_t volumeVoxelsY;
+			uint32_t volumeVoxelsZ;
+
+			uint32_t densityLodMode;
+			float densityLodSpread;
+
+			float volumePosX;
+			float volumePosY;
+			float volumePosZ;
+
+			VkBool32 traversalStats;
+
+			uint32_t dirLightTransmittance;
+			uint32_t pointLightTransmittance;
+			uint32_t hdrEnvMapTransmittance;
+			uint32_t residualControl;
+
+			uint32_t freeFlightMode;
+
+			uint32_t phaseFunc;
 		};
 
 		struct UniformData
@@ -58,6 +91,7 @@ namespace en
 		uint32_t m_RenderWidth;
 		uint32_t m_RenderHeight;
 		uint32_t m_PathLength;
+		bool m_Reference;
 
 		bool m_ShouldBlend = false;
 		uint32_t m_BlendIndex = 1;
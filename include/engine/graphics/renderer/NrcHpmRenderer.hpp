@@ -71,6 +71,30 @@ namespace en
 			float volumeG;
 
 			float hdrEnvMapStrength;
+
+			uint32_t volumeVoxelsX;
+			uint32_t volumeVoxelsY;
+			uint32_t volumeVoxelsZ;
+
+			uint32_t densityLodMode;
+			float densityLodSpread;
+
+			float volumePosX;
+			float volumePosY;
+			float volumePosZ;
+
+			VkBool32 traversalStats;
+
+			uint32_t dirLightTransmittance;
+			uint32_t pointLightTransmittance;
+			uint32_t hdrEnvMapTransmittance;
+			uint32_t residualControl;
+
+			uint32_t freeFlightMode;
+
+			uint32_t phaseFunc;
+
+			VkBool32 nrcHalfIo;
 		};
 
 		struct UniformData
@@ -78,6 +102,7 @@ namespace en
 			glm::vec4 random;
 			uint32_t showNrc;
 			float blendFactor;
+			uint32_t trainSlot;
 		};
 
 		static VkDescriptorSetLayout m_DescSetLayout;
@@ -101,12 +126,18 @@ namespace en
 		const Camera* m_Camera;
 		const HpmScene& m_HpmScene;
 		NeuralRadianceCache& m_Nrc;
+		// The nrc buffers are mapped host memory instead of cuda memory and no semaphores are shared
+		// with cuda, see NeuralRadianceCache::UsesHostMemory
+		const bool m_NrcHostMemory;
 
-		VkSemaphore m_CudaStartSemaphore;
-		cudaExternalSemaphore_t m_CuExtCudaStartSemaphore;
+		VkSemaphore m_CudaStartSemaphore = VK_NULL_HANDLE;
+		cudaExternalSemaphore_t m_CuExtCudaStartSemaphore = nullptr;
 
-		VkSemaphore m_CudaFinishedSemaphore;
-		cudaExternalSemaphore_t m_CuExtCudaFinishedSemaphore;
+		VkSemaphore m_CudaFinishedSemaphore = VK_NULL_HANDLE;
+		cudaExternalSemaphore_t m_CuExtCudaFinishedSemaphore = nullptr;
+
+		// Frame counter that both timeline semaphores reach once per frame
+		uint64_t m_CudaSyncValue = 0;
 
 		VkFence m_PreCudaFence = VK_NULL_HANDLE;
 		VkFence m_PostCudaFence = VK_NULL_HANDLE;
@@ -131,10 +162,17 @@ namespace en
 		cudaExternalMemory_t m_NrcTrainTargetCuExtMem;
 		void* m_NrcTrainTargetDCuBuffer;
 
-		VkDeviceSize m_NrcInferFilterBufferSize = 0;
-		void* m_NrcInferFilterData = nullptr;
-		vk::Buffer* m_NrcInferFilterStagingBuffer = nullptr;
-		vk::Buffer* m_NrcInferFilterBuffer = nullptr;
+		// Number of packed infer samples written by prep_infer_rays, read by cuda to size the inference
+		VkDeviceSize m_NrcInferCountBufferSize;
+		vk::Buffer* m_NrcInferCountBuffer = nullptr;
+		cudaExternalMemory_t m_NrcInferCountCuExtMem;
+		void* m_NrcInferCountDCuBuffer;
+		// Capacity of the infer buffers, the pixel count padded to NeuralRadianceCache::sc_BatchGranularity
+		uint32_t m_MaxNrcInferCount = 0;
+
+		// Index of each pixel's sample in the packed infer buffers
+		VkDeviceSize m_NrcInferIndexBufferSize = 0;
+		vk::Buffer* m_NrcInferIndexBuffer = nullptr;
 
 		VkDeviceSize m_NrcTrainRingBufferSize = 0;
 		vk::Buffer* m_NrcTrainRingBuffer;
@@ -186,13 +224,14 @@ namespace en
 		VkDescriptorSet m_DescSet;
 
 		const float c_TimestampPeriodInMS = VulkanAPI::GetTimestampPeriod() * 1e-6f;
-		const uint32_t c_QueryCount = 8;
+		const uint32_t c_QueryCount = 7;
 		std::vector<float> m_TimePeriods = std::vector<float>(c_QueryCount);
 		uint32_t m_QueryIndex = 0;
 		VkQueryPool m_QueryPool;
 
 		vk::CommandPool m_CommandPool;
-		VkCommandBuffer m_PreCudaCommandBuffer;
+		// Indexed by the train slot, each one clears only its slot of the train buffers
+		std::vector<VkCommandBuffer> m_PreCudaCommandBuffers;
 		VkCommandBuffer m_PostCudaCommandBuffer;
 		VkCommandBuffer m_RandomTasksCmdBuf;
 
@@ -201,7 +240,7 @@ namespace en
 		void CreateSyncObjects(VkDevice device);
 
 		void CreateNrcBuffers();
-		void CreateNrcInferFilterBuffer();
+		void CreateNrcInferIndexBuffer();
 		void CreateNrcTrainRingBuffer();
 
 		void CreatePipelineLayout(VkDevice device);
@@ -224,7 +263,8 @@ namespace en
 
 		void CreateQueryPool(VkDevice device);
 
-		void RecordPreCudaCommandBuffer();
+		void RecordPreCudaCommandBuffers();
+		void RecordPreCudaCommandBuffer(uint32_t trainSlot);
 		void RecordPostCudaCommandBuffer();
 	};
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -15,6 +15,7 @@ namespace en::vk
 			VkAccessFlags srcAccessMask,
 			VkAccessFlags dstAccessMask,
 			VkPipelineStageFlags srcStageMask,
-			VkPipelineStageFlags dstStageMask);
+			VkPipelineStageFlags dstStageMask,
+			uint32_t levelCount = 1);
 	};
 }
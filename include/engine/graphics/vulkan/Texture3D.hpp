@@ -2,15 +2,45 @@
 
 #include <vector>
 #include <array>
+#include <functional>
 #include <engine/graphics/common.hpp>
+#include <engine/graphics/vulkan/Buffer.hpp>
+#include <engine/objects/DensityGrid.hpp>
 
 namespace en::vk
 {
 	class Texture3D
 	{
 	public:
-		static Texture3D FromVDB(const std::string& fileName);
+		static Texture3D FromVDB(const std::string& fileName, VkFormat format = VK_FORMAT_R8_UNORM);
+		static uint32_t GetTexelSize(VkFormat format);
 
+		// Stores the density in the red channel of a single channel format.
+		// Supported formats are R8_UNORM, R16_SFLOAT, R32_SFLOAT and R8G8B8A8_UNORM (replicated rgb).
+		Texture3D(
+			const DensityGrid& densityGrid,
+			VkFormat format,
+			VkFilter filter,
+			VkSamplerAddressMode addressMode,
+			VkBorderColor borderColor);
+		// Uploads mipLevels[i] as mip level i. Every level has to be half the size of the previous one
+		// (rounded down), as produced by DensityMipChain.
+		Texture3D(
+			const std::vector<DensityGrid>& mipLevels,
+			VkFormat format,
+			VkFilter filter,
+			VkSamplerAddressMode addressMode,
+			VkBorderColor borderColor);
+		// Copies tightly packed texels of a single channel format, e.g. R32_UINT indices
+		Texture3D(
+			uint32_t width,
+			uint32_t height,
+			uint32_t depth,
+			VkFormat format,
+			const void* data,
+			VkFilter filter,
+			VkSamplerAddressMode addressMode,
+			VkBorderColor borderColor);
 		Texture3D(
 			const std::vector<std::vector<std::vector<float>>>& data, 
 			VkFilter filter, 
@@ -24,11 +54,18 @@ namespace en::vk
 
 		void Destroy();
 
+		// Overwrites the texels of a texture without mip levels with densityGrid of the same size like
+		// the DensityGrid constructor. The copy is recorded into commandBuffer. The staging buffer is kept
+		// between calls, so the previous update has to be finished on the device.
+		void Update(const DensityGrid& densityGrid, VkCommandBuffer commandBuffer);
+
 		uint32_t GetWidth() const;
 		uint32_t GetHeight() const;
 		uint32_t GetDepth() const;
+		uint32_t GetMipLevelCount() const;
 		uint32_t GetRealChannelCount() const;
 		size_t GetRealSizeInBytes() const;
+		VkFormat GetFormat() const;
 
 		VkImageView GetImageView() const;
 		VkSampler GetSampler() const;
@@ -38,6 +75,9 @@ namespace en::vk
 		uint32_t m_Height;
 		uint32_t m_Depth;
 		uint32_t m_RealChannelCount;
+		VkFormat m_Format;
+		uint32_t m_TexelSize;
+		uint32_t m_MipLevelCount = 1;
 
 		VkImage m_Image;
 		VkImageView m_ImageView;
@@ -45,8 +85,20 @@ namespace en::vk
 		VkImageLayout m_ImageLayout;
 		VkSampler m_Sampler;
 
-		void LoadToDevice(void* data, VkFilter filter, VkSamplerAddressMode addressMode, VkBorderColor borderColor);
+		// Persistently mapped, created by the first Update
+		Buffer* m_StagingBuffer = nullptr;
+		void* m_StagingMemory = nullptr;
+
+		size_t GetMipLevelOffset(uint32_t level) const;
+		void LoadToDevice(const void* data, VkFilter filter, VkSamplerAddressMode addressMode, VkBorderColor borderColor);
+		void LoadToDevice(
+			const std::function<void(void*)>& writeData,
+			VkFilter filter,
+			VkSamplerAddressMode addressMode,
+			VkBorderColor borderColor);
 		void ChangeLayout(VkImageLayout layout, VkCommandBuffer commandBuffer, VkQueue queue);
 		void WriteBufferToImage(VkCommandBuffer commandBuffer, VkQueue queue, VkBuffer buffer);
+		void RecordChangeLayout(VkImageLayout layout, VkCommandBuffer commandBuffer);
+		void RecordWriteBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer);
 	};
 }
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Sparse copy of a DensityGrid. Only bricks of sc_BrickSize^3 voxels that contain a non zero
+	// voxel are stored, packed into a 3d atlas. The brick index grid holds the packed atlas position
+	// of every brick of the volume. Empty bricks all point to the zero brick at the atlas origin, so
+	// lookups never branch. The layout is shared with getDensity in volume.glsl.
+	class BrickGrid
+	{
+	public:
+		static constexpr uint32_t sc_BrickSize = 8;
+
+		// Atlas brick coordinates are packed into 10 bits per axis
+		static uint32_t PackAtlasBrick(const glm::uvec3& atlasBrick);
+		static glm::uvec3 UnpackAtlasBrick(uint32_t packed);
+
+		BrickGrid(const DensityGrid& densityGrid);
+		// Takes an index grid and atlas that were built before, e.g. when loading them from a VolumeCache
+		BrickGrid(uint32_t width, uint32_t height, uint32_t depth, std::vector<uint32_t> brickIndices, DensityGrid atlas);
+
+		// Voxel resolution of the source grid
+		uint32_t GetWidth() const;
+		uint32_t GetHeight() const;
+		uint32_t GetDepth() const;
+		glm::uvec3 GetBrickCount() const;
+		// Number of atlas bricks including the zero brick
+		uint32_t GetAtlasBrickCount() const;
+		size_t GetSizeInBytes() const;
+
+		const std::vector<uint32_t>& GetBrickIndices() const;
+		DensityGrid& GetAtlas();
+		const DensityGrid& GetAtlas() const;
+
+		float GetValue(uint32_t x, uint32_t y, uint32_t z) const;
+		// Same lookup as DensityGrid::SampleNearest
+		float SampleNearest(float u, float v, float w) const;
+
+	private:
+		uint32_t m_Width;
+		uint32_t m_Height;
+		uint32_t m_Depth;
+		glm::uvec3 m_BrickCount;
+		uint32_t m_AtlasBrickCount = 0;
+
+		std::vector<uint32_t> m_BrickIndices;
+		DensityGrid m_Atlas;
+	};
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <tbb/cache_aligned_allocator.h>
+#include <glm/glm.hpp>
+#include <engine/util/MappedFile.hpp>
+
+namespace en
+{
+	// Dense float density grid stored in one contiguous, cache line aligned buffer.
+	// Voxels are stored x-major (index = x + width * (y + height * z)), which matches the
+	// layout expected by vkCmdCopyBufferToImage for 3d images. The voxels either live in an owned
+	// buffer or in a copy on write file mapping (see VolumeCache). Copies always own their voxels.
+	// FromVDB trims the grid to the bounding box of the non-zero voxels, the box of the file is kept as
+	// source box.
+	class DensityGrid
+	{
+	public:
+		static DensityGrid FromVDB(const std::string& fileName);
+
+		DensityGrid(uint32_t width, uint32_t height, uint32_t depth);
+		// Uses the voxels at byteOffset inside of the mapped file without copying them
+		DensityGrid(
+			uint32_t width,
+			uint32_t height,
+			uint32_t depth,
+			float maxValue,
+			const glm::ivec3& indexOffset,
+			std::shared_ptr<MappedFile> mappedFile,
+			size_t byteOffset);
+
+		DensityGrid(const DensityGrid& other);
+		DensityGrid(DensityGrid&& other) = default;
+		DensityGrid& operator=(const DensityGrid& other);
+		DensityGrid& operator=(DensityGrid&& other) = default;
+
+		uint32_t GetWidth() const;
+		uint32_t GetHeight() const;
+		uint32_t GetDepth() const;
+		size_t GetVoxelCount() const;
+		size_t GetSizeInBytes() const;
+		float GetMaxValue() const;
+		// VDB index space coordinate of voxel (0, 0, 0)
+		const glm::ivec3& GetIndexOffset() const;
+		// VDB index space box (file_bbox) the grid was trimmed from. Defaults to the grid itself.
+		const glm::ivec3& GetSourceOffset() const;
+		const glm::uvec3& GetSourceExtent() const;
+		void SetSourceBox(const glm::ivec3& sourceOffset, const glm::uvec3& sourceExtent);
+
+		float* GetData();
+		const float* GetData() const;
+
+		size_t GetIndex(uint32_t x, uint32_t y, uint32_t z) const;
+		float GetValue(uint32_t x, uint32_t y, uint32_t z) const;
+
+		// Nearest neighbour lookup at normalized texture coordinates. Coordinates outside of
+		// [0, 1) return 0, which mirrors VK_FILTER_NEAREST with a black clamp to border sampler.
+		float SampleNearest(float u, float v, float w) const;
+		// Trilinear lookup at normalized texture coordinates with voxel centers at (i + 0.5) / size,
+		// which mirrors VK_FILTER_LINEAR with a clamp to edge sampler
+		float SampleTrilinear(float u, float v, float w) const;
+
+	private:
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+		uint32_t m_Depth = 0;
+		float m_MaxValue = 0.0f;
+		glm::ivec3 m_IndexOffset = glm::ivec3(0);
+		glm::ivec3 m_SourceOffset = glm::ivec3(0);
+		glm::uvec3 m_SourceExtent = glm::uvec3(0);
+
+		std::vector<float, tbb::cache_aligned_allocator<float>> m_Storage;
+		std::shared_ptr<MappedFile> m_MappedFile;
+		float* m_Data = nullptr;
+	};
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/MajorantGrid.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Coarser levels of a DensityGrid for level of detail lookups. Level l stores the mean density of
+	// blocks of 2^l voxels per axis (voxels outside of the volume count as 0) and is addressed with
+	// the full resolution voxel coordinate shifted right by l. The level 1 extent is padded to a
+	// multiple of 2^(levelCount - 1), so that the levels form a complete Vulkan mip chain.
+	class DensityMipChain
+	{
+	public:
+		// Blocks never grow beyond a majorant cell. Every block then lies inside of one cell, whose
+		// majorant is the max over the block and therefore also bounds the block mean.
+		static constexpr uint32_t sc_MaxLevelCount = 3;
+		static_assert((1u << sc_MaxLevelCount) == MajorantGrid::sc_CellSize, "Mip levels must end at the majorant cell size");
+
+		static glm::uvec3 GetLevelExtent(const glm::uvec3& voxelExtent, uint32_t levelCount, uint32_t level);
+
+		DensityMipChain(const DensityGrid& densityGrid, uint32_t levelCount = sc_MaxLevelCount);
+		// Takes levels 1 to levels.size() that were built before, e.g. when loading them from a VolumeCache
+		DensityMipChain(std::vector<DensityGrid> levels);
+
+		uint32_t GetLevelCount() const;
+		// level is in [1, GetLevelCount()]
+		const DensityGrid& GetLevel(uint32_t level) const;
+		const std::vector<DensityGrid>& GetLevels() const;
+		size_t GetSizeInBytes() const;
+
+		// Mean density of the block around full resolution voxel (x, y, z)
+		float GetValue(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const;
+
+	private:
+		std::vector<DensityGrid> m_Levels;
+	};
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <glm/glm.hpp>
+
+namespace en
+{
+	// Coarse grid storing the maximum density of every block of cellSize^3 voxels. Delta and ratio
+	// tracking walk through it cell by cell and use the cell value as a local majorant instead of
+	// the global maximum, which removes most null collisions in the empty parts of the volume.
+	class MajorantGrid
+	{
+	public:
+		static constexpr uint32_t sc_CellSize = 8;
+
+		// DDA state of a ray walking through the cells. Positions are normalized texture coordinates
+		// and t is measured along the ray direction given to InitTraversal.
+		struct Traversal
+		{
+			glm::ivec3 cell;
+			glm::ivec3 step;
+			glm::vec3 tNext;
+			glm::vec3 tDelta;
+			float t;
+			float tEnd;
+		};
+
+		MajorantGrid(const DensityGrid& densityGrid, uint32_t cellSize = sc_CellSize);
+		// Takes cells that were built for densityGrid before, e.g. when loading them from a VolumeCache
+		MajorantGrid(const DensityGrid& densityGrid, DensityGrid cells, uint32_t cellSize);
+
+		// Returns false if the ray segment [0, tMax] does not overlap the volume
+		bool InitTraversal(const glm::vec3& uvwOrigin, const glm::vec3& uvwDir, float tMax, Traversal& traversal) const;
+		float GetCellMajorant(const Traversal& traversal) const;
+		float GetCellExit(const Traversal& traversal) const;
+		// Moves to the next cell along the ray. Returns false once the segment is left.
+		bool StepTraversal(Traversal& traversal) const;
+
+		// Delta tracks random rays through the volume with the global and with the local majorants
+		// and logs the average number of density fetches per ray for both.
+		void LogFetchStats(const DensityGrid& densityGrid, const glm::vec3& volumeSize, float densityFactor, uint32_t rayCount) const;
+
+		uint32_t GetCellSize() const;
+		// Extent of one cell in normalized texture coordinates
+		glm::vec3 GetCellUvwSize() const;
+		const DensityGrid& GetGrid() const;
+
+	private:
+		uint32_t m_CellSize;
+		glm::vec3 m_CellUvwSize;
+		DensityGrid m_Grid;
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/MajorantGrid.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Two level empty space skipping structure on top of a MajorantGrid. The fine level stores the
+	// minimum density of every majorant cell next to its maximum (the majorant), the coarse level is
+	// a bitmask with one bit per block of sc_BlockSize^3 cells that is set if any cell of the block
+	// has a non-zero majorant. Traversals jump over unset blocks in one step instead of walking
+	// through all of their cells.
+	class OccupancyGrid
+	{
+	public:
+		// Majorant cells per block along each axis
+		static constexpr uint32_t sc_BlockSize = 4;
+		// Blocks packed into one mask word along x
+		static constexpr uint32_t sc_MaskWordBits = 32;
+
+		// Cells visited by a traversal, split into the ones that were walked and the ones that were
+		// jumped over as part of an empty block
+		struct TraversalStats
+		{
+			size_t sampledCells = 0;
+			size_t skippedCells = 0;
+			size_t skippedBlocks = 0;
+		};
+
+		OccupancyGrid(const DensityGrid& densityGrid, const MajorantGrid& majorantGrid);
+		// Takes minimum cells that were built for majorantGrid before, e.g. when loading them from a VolumeCache
+		OccupancyGrid(const MajorantGrid& majorantGrid, DensityGrid minCells);
+
+		bool IsBlockOccupied(const glm::ivec3& block) const;
+		float GetCellMinimum(const glm::ivec3& cell) const;
+
+		// Same as MajorantGrid::InitTraversal and MajorantGrid::StepTraversal, but the traversal never
+		// stops in a cell of an empty block. InitTraversal returns false if the segment does not touch
+		// an occupied block, so it also finds the first cell worth sampling.
+		bool InitTraversal(const glm::vec3& uvwOrigin, const glm::vec3& uvwDir, float tMax, MajorantGrid::Traversal& traversal, TraversalStats* stats = nullptr) const;
+		bool StepTraversal(MajorantGrid::Traversal& traversal, TraversalStats* stats = nullptr) const;
+
+		// Walks random rays through the volume cell by cell and hierarchically and logs the cells
+		// visited per ray for both
+		void LogTraversalStats(uint32_t rayCount) const;
+
+		glm::uvec3 GetBlockCount() const;
+		// Extent of the mask as 3d grid of words. Word (x, y, z) holds the blocks
+		// (x * sc_MaskWordBits + bit, y, z).
+		glm::uvec3 GetMaskExtent() const;
+		const std::vector<uint32_t>& GetMask() const;
+		const DensityGrid& GetMinGrid() const;
+
+	private:
+		const MajorantGrid& m_MajorantGrid;
+		glm::ivec3 m_CellCount;
+		glm::uvec3 m_BlockCount;
+		glm::uvec3 m_MaskExtent;
+		std::vector<uint32_t> m_Mask;
+		DensityGrid m_MinGrid;
+
+		void BuildMask();
+		bool SkipEmptyBlocks(MajorantGrid::Traversal& traversal, TraversalStats* stats) const;
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <engine/AppConfig.hpp>
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Densities over cos theta in [-1, 1] that integrate to 1 there, like hg_phase_func in dir_gen.glsl.
+	// The density over solid angle is the value / (2 * pi). They are evaluated in double, since the
+	// forward peak of large droplets is only a few float steps of cos theta wide.
+	double HgPhaseFunc(double g, double cosTheta);
+	// Draine's phase function, Henyey-Greenstein with an alpha weighted cos^2 term
+	double DrainePhaseFunc(double g, double alpha, double cosTheta);
+	// Henyey-Greenstein + Draine blend fitted to Mie scattering on water droplets of 5 to 50 micrometers
+	// (Jendersie and d'Eon, An Approximate Mie Scattering Function for Fog and Cloud Rendering)
+	double ApproximateMiePhaseFunc(double dropletDiameter, double cosTheta);
+
+	// Orthonormal basis around a unit vector without a singular direction (Duff et al., Building an
+	// Orthonormal Basis, Revisited), onb in dir_gen.glsl
+	void BuildOrthonormalBasis(const glm::vec3& n, glm::vec3& b1, glm::vec3& b2);
+
+	// Phase function of the medium with tables for sampling and evaluating it on the gpu. Henyey-Greenstein
+	// is sampled in closed form, every other phase function through the inverse cdf table. Both tables
+	// are built for all of them and uploaded by VolumeData as one buffer:
+	// [0, sc_TableSize) holds 1 - cos theta at the cdf values i / (sc_TableSize - 1), sampling interpolates
+	// linearly between them, so every interval holds the same probability. 1 - cos theta keeps the
+	// precision of small angles, which cos theta in a float rounds to 1.
+	// [sc_TableSize, 2 * sc_TableSize) holds the density at x = i / (sc_TableSize - 1) with
+	// x = ((1 - cos theta) / 2)^(1/4), which spends most entries on the forward peak.
+	class PhaseFunction
+	{
+	public:
+		// PHASE_TABLE_SIZE in dir_gen.glsl
+		static constexpr uint32_t sc_TableSize = 4096;
+
+		// Henyey-Greenstein with asymmetry g
+		PhaseFunction(float g);
+		// Any density over cos theta, it is normalized while building the tables. mode only names the
+		// phase function and must not be HenyeyGreenstein.
+		PhaseFunction(PhaseFuncMode mode, const std::function<double(double)>& density);
+
+		// Density over cos theta, interpolated in the density table unless it is Henyey-Greenstein
+		float Eval(float cosTheta) const;
+		// 1 - cos theta for u in [0, 1]
+		float SampleOneMinusCosTheta(float u) const;
+		// Scattered direction of a unit direction for u0 and u1 in [0, 1], NewRayDir in dir_gen.glsl
+		glm::vec3 Sample(const glm::vec3& dir, float u0, float u1) const;
+
+		PhaseFuncMode GetMode() const;
+		// Asymmetry of Henyey-Greenstein, otherwise the mean cosine
+		float GetG() const;
+		const std::vector<float>& GetTable() const;
+
+	private:
+		PhaseFuncMode m_Mode;
+		float m_G;
+		std::vector<float> m_Table;
+
+		void BuildTables(const std::function<double(double)>& density);
+	};
+
+	// Phase function of the scene. g is the asymmetry of Henyey-Greenstein, tabulated phase functions
+	// are read from config.tablePath, see ReadFilePhaseFunc.
+	PhaseFunction CreatePhaseFunction(const PhaseFuncConfig& config, float g);
+}
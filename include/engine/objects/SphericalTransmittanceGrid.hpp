@@ -0,0 +1,60 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/DensityMipChain.hpp>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+namespace en
+{
+	// Precomputed transmittance from a point light on a spherical grid centered at the light. x and y
+	// are the octahedral map of the direction from the light and z the distance to it, linear up to
+	// the farthest corner of the volume. Every direction is marched outwards once through level
+	// TransmittanceGrid::sc_DensityLevel of a DensityMipChain, so the whole grid is built in one
+	// parallel pass over the directions.
+	class SphericalTransmittanceGrid
+	{
+	public:
+		// Texels of the octahedral map along x and y, and along the distance
+		static constexpr uint32_t sc_DirResolution = 128;
+		static constexpr uint32_t sc_DistanceResolution = 256;
+
+		// Normalized direction to octahedral map coordinates in [0, 1]^2 and back, OctEncode is
+		// oct_encode in path_trace.glsl
+		static glm::vec2 OctEncode(const glm::vec3& dir);
+		static glm::vec3 OctDecode(const glm::vec2& uv);
+
+		// voxelExtent, volumeSize and volumePos describe the full resolution volume the chain was built from
+		SphericalTransmittanceGrid(
+			const DensityMipChain& densityMipChain,
+			const glm::uvec3& voxelExtent,
+			const glm::vec3& volumeSize,
+			const glm::vec3& volumePos,
+			float densityFactor);
+
+		void BuildPointLight(const glm::vec3& lightPos);
+
+		// Trilinear clamp to edge lookup of the transmittance between the light and a world space
+		// position like the texture lookup in TracePointLight
+		float Sample(const glm::vec3& pos) const;
+
+		// Position of the last BuildPointLight
+		const glm::vec3& GetLightPos() const;
+		// Distance that z = 1 maps to, the distance from the light to the farthest corner of the volume
+		float GetMaxDistance() const;
+		const DensityGrid& GetGrid() const;
+
+	private:
+		const DensityGrid& m_Density;
+		glm::vec3 m_VoxelExtent;
+		glm::vec3 m_VolumeSize;
+		glm::vec3 m_VolumePos;
+		float m_DensityFactor;
+		glm::vec3 m_LightPos = glm::vec3(0.0f);
+		float m_MaxDistance = 0.0f;
+		DensityGrid m_Transmittance;
+
+		// Mean density of the cell around a world space position, 0 outside of the volume
+		float GetDensity(const glm::vec3& pos) const;
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/DensityMipChain.hpp>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+namespace en
+{
+	// Precomputed transmittance towards a light at the cell centers of a coarse grid over the volume
+	// (deep shadow grid). The cells are the blocks of level sc_DensityLevel of a DensityMipChain and
+	// their mean density is what the light is attenuated by. Shadow rays then cost one filtered lookup
+	// instead of a tracking loop, at the price of the resolution of the grid. The grid covers the
+	// padded extent of the level, so cell (x, y, z) starts at voxel (x, y, z) * sc_CellSize.
+	class TransmittanceGrid
+	{
+	public:
+		static constexpr uint32_t sc_DensityLevel = 2;
+		// Voxels per cell along each axis, TRANSMITTANCE_GRID_CELL_SIZE in path_trace.glsl
+		static constexpr uint32_t sc_CellSize = 1u << sc_DensityLevel;
+
+		// voxelExtent and volumeSize describe the full resolution volume the chain was built from
+		TransmittanceGrid(
+			const DensityMipChain& densityMipChain,
+			const glm::uvec3& voxelExtent,
+			const glm::vec3& volumeSize,
+			float densityFactor);
+
+		// Fills the grid with the transmittance along toLight from every cell center to the volume
+		// exit. The slices normal to the dominant axis of toLight are swept starting at the light.
+		// Every cell adds the optical depth of one step towards the light (trapezoidal rule) to the
+		// optical depth that is bilinearly interpolated on the previous slice, so every slice is built
+		// in parallel from the one before.
+		void BuildDirLight(const glm::vec3& toLight);
+
+		// Trilinear clamp to edge lookup at normalized volume coordinates like the linear sampler of the
+		// texture in TraceDirLight
+		float Sample(const glm::vec3& uvw) const;
+
+		// Direction of the last BuildDirLight, 0 before the first build
+		const glm::vec3& GetLightDir() const;
+		const DensityGrid& GetGrid() const;
+
+	private:
+		const DensityGrid& m_Density;
+		glm::ivec3 m_Extent;
+		// Scales normalized volume coordinates to normalized grid coordinates
+		glm::vec3 m_UvwScale;
+		// World space size of a cell
+		glm::vec3 m_CellSize;
+		float m_DensityFactor;
+		glm::vec3 m_LightDir = glm::vec3(0.0f);
+		DensityGrid m_Transmittance;
+	};
+}
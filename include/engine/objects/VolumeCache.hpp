@@ -0,0 +1,46 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/MajorantGrid.hpp>
+#include <engine/objects/BrickGrid.hpp>
+#include <engine/objects/DensityMipChain.hpp>
+#include <engine/objects/OccupancyGrid.hpp>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace en
+{
+	// Density, majorant, occupancy, brick grid and density mip chain of a VDB file, backed by a binary cache file next to it. The first
+	// load reads the VDB and writes the cache. Later loads map the cache and use the voxels in place,
+	// so uploading them streams straight from the page cache into the staging buffer. The cache is
+	// rebuilt if the content hash of the VDB, the cell size or the format version do not match.
+	class VolumeCache
+	{
+	public:
+		// Increment whenever the layout or the way the grids are built changes
+		static constexpr uint32_t sc_Version = 5;
+
+		static std::string GetCacheFilePath(const std::string& vdbFileName);
+
+		VolumeCache(const std::string& vdbFileName, uint32_t majorantCellSize = MajorantGrid::sc_CellSize);
+
+		DensityGrid& GetDensityGrid();
+		const DensityGrid& GetDensityGrid() const;
+		const MajorantGrid& GetMajorantGrid() const;
+		const OccupancyGrid& GetOccupancyGrid() const;
+		BrickGrid& GetBrickGrid();
+		const BrickGrid& GetBrickGrid() const;
+		const DensityMipChain& GetDensityMipChain() const;
+
+	private:
+		std::unique_ptr<DensityGrid> m_DensityGrid;
+		std::unique_ptr<MajorantGrid> m_MajorantGrid;
+		std::unique_ptr<OccupancyGrid> m_OccupancyGrid;
+		std::unique_ptr<BrickGrid> m_BrickGrid;
+		std::unique_ptr<DensityMipChain> m_DensityMipChain;
+
+		bool Load(const std::string& cacheFileName, uint64_t vdbHash, uint64_t vdbSize, uint32_t majorantCellSize);
+		void Store(const std::string& cacheFileName, uint64_t vdbHash, uint64_t vdbSize) const;
+	};
+}
@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <engine/graphics/vulkan/Buffer.hpp>
 #include <engine/graphics/Camera.hpp>
+#include <engine/AppConfig.hpp>
+#include <engine/objects/PhaseFunction.hpp>
 
 namespace en
 {
@@ -14,16 +16,52 @@ namespace en
 		static void Shutdown(VkDevice device);
 		static VkDescriptorSetLayout GetDescriptorSetLayout();
 
-		VolumeData(const vk::Texture3D* densityTex, float densityFactor, float g);
+		// densityTex is the brick atlas of a BrickGrid and brickIndexTex its index grid. extent is the
+		// voxel resolution of the volume and size and position describe its world space box.
+		// densityMipTex holds the levels of a DensityMipChain, its mip level i is density level i + 1.
+		// occupancyTex and minorantTex are the block mask and the minimum cells of an OccupancyGrid.
+		// The minimum cells and mip level 3 of densityMipTex are the control densities of residual ratio tracking.
+		// dirLightTransmittanceTex is the TransmittanceGrid towards the dir light and pointLightTransmittanceTex
+		// the SphericalTransmittanceGrid around the point light for TransmittanceMode::Cached.
+		// The tables of phaseFunction are uploaded to the phase table buffer.
+		VolumeData(
+			const vk::Texture3D* densityTex,
+			const vk::Texture3D* majorantTex,
+			const vk::Texture3D* brickIndexTex,
+			const vk::Texture3D* densityMipTex,
+			const vk::Texture3D* occupancyTex,
+			const vk::Texture3D* minorantTex,
+			const vk::Texture3D* dirLightTransmittanceTex,
+			const vk::Texture3D* pointLightTransmittanceTex,
+			VkExtent3D extent,
+			const glm::vec3& size,
+			const glm::vec3& position,
+			float densityFactor,
+			const PhaseFunction& phaseFunction,
+			DensityLodMode densityLodMode,
+			float densityLodSpread,
+			bool traversalStats,
+			const ShadowTransmittance& shadowTransmittance,
+			FreeFlightMode freeFlightMode);
 
 		void Destroy();
 
 		void RenderImGui();
 
 		float GetDensityFactor() const;
+		// Asymmetry of Henyey-Greenstein, otherwise the mean cosine of the phase function
 		float GetG() const;
+		PhaseFuncMode GetPhaseFuncMode() const;
+		DensityLodMode GetDensityLodMode() const;
+		float GetDensityLodSpread() const;
+		// Whether the shaders count traversed cells and density fetches in the traversal stats buffer
+		bool IsTraversalStatsEnabled() const;
+		const ShadowTransmittance& GetShadowTransmittance() const;
+		FreeFlightMode GetFreeFlightMode() const;
 		VkDescriptorSet GetDescriptorSet() const;
 		VkExtent3D GetExtent() const;
+		glm::vec3 GetSize() const;
+		glm::vec3 GetPosition() const;
 
 	private:
 		static VkDescriptorSetLayout m_DescriptorSetLayout;
@@ -31,10 +69,31 @@ namespace en
 
 		float m_DensityFactor = 0.0;
 		float m_G = 0.0;
+		PhaseFuncMode m_PhaseFuncMode = PhaseFuncMode::HenyeyGreenstein;
+		DensityLodMode m_DensityLodMode = DensityLodMode::Off;
+		float m_DensityLodSpread = 0.0f;
+		bool m_TraversalStats = false;
+		ShadowTransmittance m_ShadowTransmittance;
+		FreeFlightMode m_FreeFlightMode = FreeFlightMode::DeltaTracking;
 
 		VkDescriptorSet m_DescriptorSet;
 
+		VkExtent3D m_Extent;
+		glm::vec3 m_Size;
+		glm::vec3 m_Position;
 		const vk::Texture3D* m_DensityTex;
+		const vk::Texture3D* m_MajorantTex;
+		const vk::Texture3D* m_BrickIndexTex;
+		const vk::Texture3D* m_DensityMipTex;
+		const vk::Texture3D* m_OccupancyTex;
+		const vk::Texture3D* m_MinorantTex;
+		const vk::Texture3D* m_DirLightTransmittanceTex;
+		const vk::Texture3D* m_PointLightTransmittanceTex;
+
+		// Counters of the TRAVERSAL_STAT_* values in volume.glsl, accumulated until they are reset
+		vk::Buffer* m_TraversalStatsBuffer;
+		// PhaseFunction::GetTable, phaseTable in dir_gen.glsl
+		vk::Buffer* m_PhaseTableBuffer;
 
 		void UpdateDescriptorSet();
 	};
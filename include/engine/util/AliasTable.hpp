@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Vose alias table for sampling an index proportional to its weight with one lookup and one
+	// comparison. Entries are stored as flat array that is uploaded to the gpu as is, see
+	// hdrEnvMapAliasTable.
+	class AliasTable
+	{
+	public:
+		// Matches the std430 layout of AliasTableEntry in the shaders
+		struct Entry
+		{
+			// Probability of keeping the index itself instead of jumping to alias
+			float prob;
+			uint32_t alias;
+		};
+
+		AliasTable() = default;
+		// Builds the table with the sweep construction in parallel. Lights and heavies are split into
+		// chunks whose start state follows from prefix sums, so all chunks are paired independently.
+		AliasTable(const std::vector<float>& weights);
+
+		// u0 picks the entry and u1 decides between it and its alias. Both are in [0, 1).
+		uint32_t Sample(float u0, float u1) const;
+		// Exact probability of Sample returning index
+		float GetPmf(uint32_t index) const;
+
+		uint32_t GetSize() const;
+		const std::vector<Entry>& GetEntries() const;
+
+	private:
+		std::vector<Entry> m_Entries;
+		std::vector<float> m_Pmf;
+	};
+}
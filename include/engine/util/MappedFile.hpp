@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace en
+{
+	// Maps a whole file into the address space. Pages are only read from disk when they are touched,
+	// so large files can be consumed directly without an intermediate copy. With copyOnWrite the
+	// mapping is writable, but changes stay private to the process and never reach the file.
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& fileName, bool copyOnWrite = false);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		uint8_t* GetData();
+		const uint8_t* GetData() const;
+		size_t GetSize() const;
+
+	private:
+		uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+
+#ifdef _WIN32
+		void* m_FileHandle = nullptr;
+		void* m_MappingHandle = nullptr;
+#endif
+	};
+}
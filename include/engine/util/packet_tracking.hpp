@@ -0,0 +1,64 @@
+#pragma once
+
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/objects/MajorantGrid.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace en
+{
+	// Delta and ratio tracking through the majorant grid for many rays at once. Rays are processed in
+	// packets of 16 (AVX-512), 8 (AVX2) or 1 (scalar fallback) lanes that step through their cells
+	// independently, finished lanes are masked off. All backends share one kernel and the same
+	// random streams, so they only differ by floating point rounding.
+
+	enum class PacketIsa
+	{
+		Scalar,
+		Avx2,
+		Avx512
+	};
+
+	// Widest instruction set that is compiled in and supported by the running cpu
+	PacketIsa GetBestPacketIsa();
+	bool IsPacketIsaSupported(PacketIsa isa);
+	uint32_t GetPacketWidth(PacketIsa isa);
+	const char* GetPacketIsaName(PacketIsa isa);
+
+	// Structure of arrays in normalized texture coordinates of the density grid. The ray parameter t
+	// runs from 0 to tMax along the (not normalized) uvw direction.
+	struct TrackingRays
+	{
+		std::vector<float> originX;
+		std::vector<float> originY;
+		std::vector<float> originZ;
+		std::vector<float> dirX;
+		std::vector<float> dirY;
+		std::vector<float> dirZ;
+		std::vector<float> tMax;
+
+		void Resize(size_t count);
+		size_t GetCount() const;
+	};
+
+	// Writes the collision distance of every ray to tHit, or a negative value if the ray left the
+	// volume. Returns the number of density fetches.
+	size_t DeltaTrackPackets(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const TrackingRays& rays,
+		uint32_t seed,
+		float* tHit,
+		PacketIsa isa);
+
+	// Writes the ratio tracking transmittance estimate of every ray. Returns the number of density fetches.
+	size_t RatioTrackPackets(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const TrackingRays& rays,
+		uint32_t seed,
+		float* transmittance,
+		PacketIsa isa);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+namespace en
+{
+	size_t GetPeakRssBytes();
+	float GetPeakRssMB();
+}
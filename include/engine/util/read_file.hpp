@@ -3,12 +3,33 @@
 #include <vector>
 #include <string>
 #include <array>
+#include <engine/util/AliasTable.hpp>
 
 namespace en
 {
 	std::vector<char> ReadFileBinary(const std::string& fileName);
 	std::vector<std::vector<float>> ReadFileImageR(const std::string& fileName);
 	std::vector<std::vector<std::vector<float>>> ReadFileDensity3D(const std::string& fileName, size_t xSize, size_t ySize, size_t zSize);
-	std::vector<float> ReadFileHdr4f(const std::string& fileName, int& width, int& height, float max);
+	// Loads an rgba float image clamped to max. testOverwrite replaces every value with 1 instead, which
+	// the renderers used while debugging the env map lighting.
+	std::vector<float> ReadFileHdr4f(const std::string& fileName, int& width, int& height, float max, bool testOverwrite);
+	// Clamping pass of ReadFileHdr4f on the decoded image, parallel over rows. Also returns the
+	// largest value and its texel.
+	std::vector<float> ClampHdr4f(
+		const float* data,
+		size_t width,
+		size_t height,
+		float max,
+		bool testOverwrite,
+		float& maxVal,
+		size_t& maxX,
+		size_t& maxY);
+	// Returns the inverse cdf of x given y (width * height) and the inverse cdf of y (height) of the
+	// brightness
 	std::array<std::vector<float>, 2> Hdr4fToCdf(const std::vector<float>& hdr4f, size_t width, size_t height);
+	// Alias table over the texels weighted by brightness and solid angle. Overwrites the alpha channel
+	// with the density in uv space of sampling a texel and a uniform position inside of it.
+	AliasTable Hdr4fToAliasTable(std::vector<float>& hdr4f, size_t width, size_t height);
+	// Whitespace separated values of a phase function at theta = pi * i / (count - 1), in any scale
+	std::vector<float> ReadFilePhaseFunc(const std::string& fileName);
 }
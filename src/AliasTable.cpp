@@ -0,0 +1,185 @@
+#include <engine/util/AliasTable.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <functional>
+
+namespace en
+{
+	// Indices per task of the parallel passes
+	constexpr size_t c_AliasTableChunkSize = 1 << 14;
+
+	// Inclusive prefix sums of the scaled weights of indices in double, so the closed form residuals
+	// below stay exact enough for millions of entries
+	static std::vector<double> PrefixSum(const std::vector<float>& scaled, const std::vector<uint32_t>& indices)
+	{
+		const size_t chunkCount = (indices.size() + c_AliasTableChunkSize - 1) / c_AliasTableChunkSize;
+		std::vector<double> chunkOffsets(chunkCount + 1, 0.0);
+		tbb::parallel_for(size_t(0), chunkCount, [&](size_t chunk)
+			{
+				const size_t end = std::min((chunk + 1) * c_AliasTableChunkSize, indices.size());
+				double sum = 0.0;
+				for (size_t i = chunk * c_AliasTableChunkSize; i < end; i++) { sum += scaled[indices[i]]; }
+				chunkOffsets[chunk + 1] = sum;
+			});
+		for (size_t chunk = 0; chunk < chunkCount; chunk++) { chunkOffsets[chunk + 1] += chunkOffsets[chunk]; }
+
+		std::vector<double> sums(indices.size());
+		tbb::parallel_for(size_t(0), chunkCount, [&](size_t chunk)
+			{
+				const size_t end = std::min((chunk + 1) * c_AliasTableChunkSize, indices.size());
+				double sum = chunkOffsets[chunk];
+				for (size_t i = chunk * c_AliasTableChunkSize; i < end; i++)
+				{
+					sum += scaled[indices[i]];
+					sums[i] = sum;
+				}
+			});
+		return sums;
+	}
+
+	AliasTable::AliasTable(const std::vector<float>& weights) :
+		m_Entries(weights.size()),
+		m_Pmf(weights.size())
+	{
+		const size_t n = weights.size();
+		if (n == 0) { Log::Error("AliasTable needs at least one weight", true); }
+
+		const double weightSum = tbb::parallel_reduce(
+			tbb::blocked_range<size_t>(0, n, c_AliasTableChunkSize),
+			0.0,
+			[&](const tbb::blocked_range<size_t>& range, double sum)
+			{
+				for (size_t i = range.begin(); i < range.end(); i++) { sum += weights[i]; }
+				return sum;
+			},
+			std::plus<double>());
+
+		// All zero weights sample uniformly
+		if (weightSum <= 0.0)
+		{
+			tbb::parallel_for(size_t(0), n, [&](size_t i)
+				{
+					m_Entries[i] = { 1.0f, static_cast<uint32_t>(i) };
+					m_Pmf[i] = 1.0f / static_cast<float>(n);
+				});
+			return;
+		}
+
+		// Scale to a mean of 1 and split into lights (<= 1) and heavies (> 1) keeping the index order
+		const size_t chunkCount = (n + c_AliasTableChunkSize - 1) / c_AliasTableChunkSize;
+		std::vector<float> scaled(n);
+		std::vector<size_t> lightOffsets(chunkCount + 1, 0);
+		tbb::parallel_for(size_t(0), chunkCount, [&](size_t chunk)
+			{
+				const size_t end = std::min((chunk + 1) * c_AliasTableChunkSize, n);
+				size_t lightCount = 0;
+				for (size_t i = chunk * c_AliasTableChunkSize; i < end; i++)
+				{
+					scaled[i] = static_cast<float>(static_cast<double>(weights[i]) * static_cast<double>(n) / weightSum);
+					m_Pmf[i] = static_cast<float>(static_cast<double>(weights[i]) / weightSum);
+					if (scaled[i] <= 1.0f) { lightCount++; }
+				}
+				lightOffsets[chunk + 1] = lightCount;
+			});
+		for (size_t chunk = 0; chunk < chunkCount; chunk++) { lightOffsets[chunk + 1] += lightOffsets[chunk]; }
+
+		std::vector<uint32_t> lights(lightOffsets[chunkCount]);
+		std::vector<uint32_t> heavies(n - lights.size());
+		tbb::parallel_for(size_t(0), chunkCount, [&](size_t chunk)
+			{
+				const size_t begin = chunk * c_AliasTableChunkSize;
+				const size_t end = std::min(begin + c_AliasTableChunkSize, n);
+				size_t light = lightOffsets[chunk];
+				size_t heavy = begin - light;
+				for (size_t i = begin; i < end; i++)
+				{
+					if (scaled[i] <= 1.0f) { lights[light++] = static_cast<uint32_t>(i); }
+					else { heavies[heavy++] = static_cast<uint32_t>(i); }
+				}
+			});
+
+		// Rounding can leave no heavy, then all weights are 1
+		if (heavies.empty())
+		{
+			tbb::parallel_for(size_t(0), n, [&](size_t i) { m_Entries[i] = { 1.0f, static_cast<uint32_t>(i) }; });
+			return;
+		}
+
+		// The sequential sweep fills lights in order with the current heavy and turns the heavy into a
+		// light that aliases the next heavy once its residual drops to 1 or below. After i lights with
+		// heavy j as current one, the mass balance gives its residual in closed form, and because the
+		// residual grows with j the current heavy of any i is found by binary search.
+		const std::vector<double> lightSums = PrefixSum(scaled, lights);
+		const std::vector<double> heavySums = PrefixSum(scaled, heavies);
+		auto residual = [&](size_t i, size_t j)
+		{
+			const double lightSum = i > 0 ? lightSums[i - 1] : 0.0;
+			return lightSum + heavySums[j] - static_cast<double>(i) - static_cast<double>(j);
+		};
+		auto findHeavy = [&](size_t i)
+		{
+			size_t low = 0;
+			size_t high = heavies.size() - 1;
+			while (low < high)
+			{
+				const size_t mid = (low + high) / 2;
+				if (residual(i, mid) > 1.0) { high = mid; }
+				else { low = mid + 1; }
+			}
+			return low;
+		};
+
+		const size_t sweepChunkCount = (lights.size() + c_AliasTableChunkSize - 1) / c_AliasTableChunkSize;
+		tbb::parallel_for(size_t(0), sweepChunkCount, [&](size_t chunk)
+			{
+				const size_t begin = chunk * c_AliasTableChunkSize;
+				const size_t end = std::min(begin + c_AliasTableChunkSize, lights.size());
+				size_t j = findHeavy(begin);
+				for (size_t i = begin; i < end; i++)
+				{
+					const uint32_t light = lights[i];
+					m_Entries[light] = { scaled[light], heavies[j] };
+
+					double r = residual(i + 1, j);
+					while (r <= 1.0 && j + 1 < heavies.size())
+					{
+						m_Entries[heavies[j]] = { static_cast<float>(std::max(r, 0.0)), heavies[j + 1] };
+						j++;
+						r = residual(i + 1, j);
+					}
+				}
+			});
+
+		// Heavies left after the last light have a residual of 1 up to rounding
+		for (size_t j = findHeavy(lights.size()); j < heavies.size(); j++)
+		{
+			m_Entries[heavies[j]] = { 1.0f, heavies[j] };
+		}
+	}
+
+	uint32_t AliasTable::Sample(float u0, float u1) const
+	{
+		const uint32_t size = GetSize();
+		const uint32_t index = std::min(static_cast<uint32_t>(u0 * static_cast<float>(size)), size - 1);
+		const Entry& entry = m_Entries[index];
+		return u1 < entry.prob ? index : entry.alias;
+	}
+
+	float AliasTable::GetPmf(uint32_t index) const
+	{
+		return m_Pmf[index];
+	}
+
+	uint32_t AliasTable::GetSize() const
+	{
+		return static_cast<uint32_t>(m_Entries.size());
+	}
+
+	const std::vector<AliasTable::Entry>& AliasTable::GetEntries() const
+	{
+		return m_Entries;
+	}
+}
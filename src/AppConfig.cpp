@@ -4,6 +4,52 @@
 
 namespace en
 {
+	static TransmittanceMode ParseTransmittanceMode(const std::string& name, const std::string& value, bool allowCached)
+	{
+		if (value == "ratio") { return TransmittanceMode::RatioTracking; }
+		if (value == "residual") { return TransmittanceMode::ResidualRatioTracking; }
+		if (value == "biased-march") { return TransmittanceMode::BiasedRayMarching; }
+		if (value == "unbiased-march") { return TransmittanceMode::UnbiasedRayMarching; }
+		if (value == "cached" && allowCached) { return TransmittanceMode::Cached; }
+		Log::Error(
+			"AppConfig " + name + " has to be ratio, residual, biased-march" + (allowCached ? ", unbiased-march or cached" : " or unbiased-march"),
+			true);
+		return TransmittanceMode::RatioTracking;
+	}
+
+	static const char* GetTransmittanceModeName(TransmittanceMode mode)
+	{
+		switch (mode)
+		{
+		case TransmittanceMode::ResidualRatioTracking:
+			return "residual";
+		case TransmittanceMode::BiasedRayMarching:
+			return "biased-march";
+		case TransmittanceMode::UnbiasedRayMarching:
+			return "unbiased-march";
+		case TransmittanceMode::Cached:
+			return "cached";
+		default:
+			return "ratio";
+		}
+	}
+
+	bool ShadowTransmittance::UsesResidualRatioTracking() const
+	{
+		return
+			dirLight == TransmittanceMode::ResidualRatioTracking ||
+			pointLight == TransmittanceMode::ResidualRatioTracking ||
+			hdrEnvMap == TransmittanceMode::ResidualRatioTracking;
+	}
+
+	bool ShadowTransmittance::IsRatioTrackingOnly() const
+	{
+		return
+			dirLight == TransmittanceMode::RatioTracking &&
+			pointLight == TransmittanceMode::RatioTracking &&
+			hdrEnvMap == TransmittanceMode::RatioTracking;
+	}
+
 	AppConfig::NNEncodingConfig::NNEncodingConfig()
 	{
 	}
@@ -102,6 +148,7 @@ namespace en
 			hdrEnvMapStrength = 0.0f;
 			density = 0.6f;
 			dynamic = false;
+			densityFormat = VK_FORMAT_R8_UNORM;
 			break;
 		case 1:
 			dirLightStrength = 0.0f;
@@ -110,6 +157,7 @@ namespace en
 			hdrEnvMapStrength = 0.0f;
 			density = 0.6f;
 			dynamic = false;
+			densityFormat = VK_FORMAT_R8_UNORM;
 			break;
 		case 2:
 			dirLightStrength = 0.0f;
@@ -118,6 +166,7 @@ namespace en
 			hdrEnvMapStrength = 0.0;
 			density = 1.0f;
 			dynamic = false;
+			densityFormat = VK_FORMAT_R8_UNORM;
 			break;
 		case 3:
 			dirLightStrength = 16.0f;
@@ -126,6 +175,7 @@ namespace en
 			hdrEnvMapStrength = 0.0;
 			density = 0.25f;
 			dynamic = false;
+			densityFormat = VK_FORMAT_R8_UNORM;
 			break;
 		case 4:
 			dirLightStrength = 8.0f;
@@ -134,6 +184,7 @@ namespace en
 			hdrEnvMapStrength = 0.0;
 			density = 0.6f;
 			dynamic = false;
+			densityFormat = VK_FORMAT_R8_UNORM;
 			break;
 		case 5:
 			dirLightStrength = 0.0f;
@@ -142,6 +193,7 @@ namespace en
 			hdrEnvMapStrength = 1.0f;
 			density = 1.6f; // 0.8
 			dynamic = false;
+			densityFormat = VK_FORMAT_R8_UNORM;
 			break;
 		default:
 			Log::Error("HpmSceneConfig ID is invalid", true);
@@ -153,7 +205,7 @@ namespace en
 
 	AppConfig::AppConfig(const std::vector<char*>& argv)
 	{
-		if (argv.size() != 20) { Log::Error("Argument count does not match requirements for AppConfig", true); }
+		if (argv.size() < 20) { Log::Error("Argument count does not match requirements for AppConfig", true); }
 
 		size_t index = 1;
 
@@ -181,6 +233,13 @@ namespace en
 		trainRayLength = std::stoi(argv[index++]);
 		enableBenchmarkOnStart = std::stoi(argv[index++]);
 		enablePauseOnStart = std::stoi(argv[index++]);
+
+		while (index < argv.size()) { ParseOption(argv[index++]); }
+
+		if (phaseFunc.mode == PhaseFuncMode::Tabulated && phaseFunc.tablePath.empty())
+		{
+			Log::Error("AppConfig phase=tabulated needs a phase-table", true);
+		}
 	}
 
 	std::string AppConfig::GetName() const
@@ -203,6 +262,30 @@ namespace en
 		str += std::to_string(primaryRayLength) + "_";
 		str += std::to_string(primaryRayProb) + "_";
 		str += std::to_string(trainRayLength);
+		if (densityLodMode != DensityLodMode::Off)
+		{
+			str += densityLodMode == DensityLodMode::BounceDepth ? "_lodBounce" : "_lodFootprint";
+			if (densityLodMode == DensityLodMode::Footprint) { str += std::to_string(densityLodSpread); }
+		}
+		if (!shadowTransmittance.IsRatioTrackingOnly())
+		{
+			// Mode ids of the dir light, point light and env map
+			str += "_tr";
+			str += std::to_string(static_cast<uint32_t>(shadowTransmittance.dirLight));
+			str += std::to_string(static_cast<uint32_t>(shadowTransmittance.pointLight));
+			str += std::to_string(static_cast<uint32_t>(shadowTransmittance.hdrEnvMap));
+			if (shadowTransmittance.UsesResidualRatioTracking())
+			{
+				str += shadowTransmittance.residualControl == ResidualControl::Minimum ? "Min" : "Mean";
+			}
+		}
+		if (freeFlightMode == FreeFlightMode::DecompositionTracking) { str += "_ffDecomposition"; }
+		if (phaseFunc.mode == PhaseFuncMode::ApproximateMie) { str += "_phaseMie" + std::to_string(phaseFunc.mieDiameter); }
+		if (phaseFunc.mode == PhaseFuncMode::Tabulated) { str += "_phaseTabulated"; }
+		if (nrcBackend == NrcBackendMode::Cpu) { str += "_nrcCpu"; }
+		if (nrcHalfIo) { str += "_nrcFp16"; }
+		if (nrcPipelined) { str += "_nrcPipelined"; }
+		if (!hdrEnvMapTestOverwrite) { str += "_hdrRaw"; }
 		return str;
 	}
 
@@ -219,11 +302,143 @@ namespace en
 		ImGui::Text("Batch Sizes (%d, %d)", log2InferBatchSize, log2TrainBatchSize);
 		ImGui::Text("Train Batch Count %d", trainBatchCount);
 		ImGui::Text("Scene %d", scene.id);
+		ImGui::Text("Density format %s", scene.densityFormat == VK_FORMAT_R8_UNORM ? "R8_UNORM" : (scene.densityFormat == VK_FORMAT_R16_SFLOAT ? "R16_SFLOAT" : "R32_SFLOAT"));
 		ImGui::Text("Train ring buffer size %f", trainRingBufSize);
 		ImGui::Text("Train spp %d", trainSpp);
 		ImGui::Text("Primary ray length %d", primaryRayLength);
 		ImGui::Text("Primary ray prob %f", primaryRayProb);
 		ImGui::Text("Train ray length %d", trainRayLength);
+		ImGui::Text(
+			"Density LOD %s (spread %f)",
+			densityLodMode == DensityLodMode::Off ? "Off" : (densityLodMode == DensityLodMode::BounceDepth ? "Bounce depth" : "Footprint"),
+			densityLodSpread);
+		ImGui::Text("Traversal stats %s", traversalStats ? "On" : "Off");
+		ImGui::Text(
+			"Shadow transmittance dir %s, point %s, env %s (control %s)",
+			GetTransmittanceModeName(shadowTransmittance.dirLight),
+			GetTransmittanceModeName(shadowTransmittance.pointLight),
+			GetTransmittanceModeName(shadowTransmittance.hdrEnvMap),
+			shadowTransmittance.residualControl == ResidualControl::Minimum ? "min" : "mean");
+		ImGui::Text("Free flight %s", freeFlightMode == FreeFlightMode::DeltaTracking ? "delta tracking" : "decomposition tracking");
+		ImGui::Text(
+			"Phase function %s",
+			phaseFunc.mode == PhaseFuncMode::HenyeyGreenstein ? "Henyey-Greenstein" : (phaseFunc.mode == PhaseFuncMode::ApproximateMie ? "approximate Mie" : phaseFunc.tablePath.c_str()));
+		if (phaseFunc.mode == PhaseFuncMode::ApproximateMie) { ImGui::Text("Droplet diameter %f", phaseFunc.mieDiameter); }
+		ImGui::Text("NRC backend %s (threads %d)", nrcBackend == NrcBackendMode::Tcnn ? "tcnn" : "cpu", nrcThreadCount);
+		ImGui::Text("NRC io %s", nrcHalfIo ? "fp16" : "fp32");
+		ImGui::Text("NRC training %s", nrcPipelined ? "pipelined" : "serial");
+		ImGui::Text("Hdr env map test overwrite %s", hdrEnvMapTestOverwrite ? "On" : "Off");
 		ImGui::End();
 	}
+
+	void AppConfig::ParseOption(const std::string& option)
+	{
+		const size_t separator = option.find('=');
+		if (option.rfind("--", 0) != 0 || separator == std::string::npos)
+		{
+			Log::Error("AppConfig option " + option + " is not of the form --name=value", true);
+		}
+
+		const std::string name = option.substr(2, separator - 2);
+		const std::string value = option.substr(separator + 1);
+		if (name == "density-lod")
+		{
+			if (value == "off") { densityLodMode = DensityLodMode::Off; }
+			else if (value == "bounce") { densityLodMode = DensityLodMode::BounceDepth; }
+			else if (value == "footprint") { densityLodMode = DensityLodMode::Footprint; }
+			else { Log::Error("AppConfig density-lod has to be off, bounce or footprint", true); }
+		}
+		else if (name == "density-lod-spread")
+		{
+			densityLodSpread = std::stof(value);
+		}
+		else if (name == "traversal-stats")
+		{
+			if (value == "on") { traversalStats = true; }
+			else if (value == "off") { traversalStats = false; }
+			else { Log::Error("AppConfig traversal-stats has to be on or off", true); }
+		}
+		else if (name == "transmittance")
+		{
+			const TransmittanceMode mode = ParseTransmittanceMode(name, value, false);
+			shadowTransmittance.dirLight = mode;
+			shadowTransmittance.pointLight = mode;
+			shadowTransmittance.hdrEnvMap = mode;
+		}
+		else if (name == "transmittance-dir")
+		{
+			shadowTransmittance.dirLight = ParseTransmittanceMode(name, value, true);
+		}
+		else if (name == "transmittance-point")
+		{
+			shadowTransmittance.pointLight = ParseTransmittanceMode(name, value, true);
+		}
+		else if (name == "transmittance-env")
+		{
+			shadowTransmittance.hdrEnvMap = ParseTransmittanceMode(name, value, false);
+		}
+		else if (name == "residual-control")
+		{
+			if (value == "min") { shadowTransmittance.residualControl = ResidualControl::Minimum; }
+			else if (value == "mean") { shadowTransmittance.residualControl = ResidualControl::Mean; }
+			else { Log::Error("AppConfig residual-control has to be min or mean", true); }
+		}
+		else if (name == "free-flight")
+		{
+			if (value == "delta") { freeFlightMode = FreeFlightMode::DeltaTracking; }
+			else if (value == "decomposition") { freeFlightMode = FreeFlightMode::DecompositionTracking; }
+			else { Log::Error("AppConfig free-flight has to be delta or decomposition", true); }
+		}
+		else if (name == "phase")
+		{
+			if (value == "hg") { phaseFunc.mode = PhaseFuncMode::HenyeyGreenstein; }
+			else if (value == "mie") { phaseFunc.mode = PhaseFuncMode::ApproximateMie; }
+			else if (value == "tabulated") { phaseFunc.mode = PhaseFuncMode::Tabulated; }
+			else { Log::Error("AppConfig phase has to be hg, mie or tabulated", true); }
+		}
+		else if (name == "phase-mie-diameter")
+		{
+			phaseFunc.mieDiameter = std::stof(value);
+			if (phaseFunc.mieDiameter < 5.0f || phaseFunc.mieDiameter > 50.0f)
+			{
+				Log::Error("AppConfig phase-mie-diameter has to be in [5, 50]", true);
+			}
+		}
+		else if (name == "phase-table")
+		{
+			phaseFunc.tablePath = value;
+		}
+		else if (name == "nrc-backend")
+		{
+			if (value == "tcnn") { nrcBackend = NrcBackendMode::Tcnn; }
+			else if (value == "cpu") { nrcBackend = NrcBackendMode::Cpu; }
+			else { Log::Error("AppConfig nrc-backend has to be tcnn or cpu", true); }
+		}
+		else if (name == "nrc-threads")
+		{
+			nrcThreadCount = std::stoi(value);
+		}
+		else if (name == "nrc-io")
+		{
+			if (value == "fp32") { nrcHalfIo = false; }
+			else if (value == "fp16") { nrcHalfIo = true; }
+			else { Log::Error("AppConfig nrc-io has to be fp32 or fp16", true); }
+		}
+		else if (name == "nrc-pipeline")
+		{
+			if (value == "on") { nrcPipelined = true; }
+			else if (value == "off") { nrcPipelined = false; }
+			else { Log::Error("AppConfig nrc-pipeline has to be on or off", true); }
+		}
+		else if (name == "hdr-test-overwrite")
+		{
+			if (value == "on") { hdrEnvMapTestOverwrite = true; }
+			else if (value == "off") { hdrEnvMapTestOverwrite = false; }
+			else { Log::Error("AppConfig hdr-test-overwrite has to be on or off", true); }
+		}
+		else
+		{
+			Log::Error("AppConfig option " + name + " is unknown", true);
+		}
+	}
 }
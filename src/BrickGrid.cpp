@@ -0,0 +1,226 @@
+#include <engine/objects/BrickGrid.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace en
+{
+	constexpr uint32_t c_AtlasBrickBits = 10;
+	constexpr uint32_t c_AtlasBrickMask = (1u << c_AtlasBrickBits) - 1;
+
+	static glm::uvec3 GetBrickCountForExtent(uint32_t width, uint32_t height, uint32_t depth)
+	{
+		return (glm::uvec3(width, height, depth) + BrickGrid::sc_BrickSize - 1u) / BrickGrid::sc_BrickSize;
+	}
+
+	// Roughly cubic atlas, which keeps every axis far below the 3d image size limits
+	static glm::uvec3 GetAtlasBrickExtent(uint32_t atlasBrickCount)
+	{
+		const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(atlasBrickCount))));
+		const uint32_t depth = (atlasBrickCount + side * side - 1) / (side * side);
+		return glm::uvec3(side, side, depth);
+	}
+
+	uint32_t BrickGrid::PackAtlasBrick(const glm::uvec3& atlasBrick)
+	{
+		return atlasBrick.x | (atlasBrick.y << c_AtlasBrickBits) | (atlasBrick.z << (2 * c_AtlasBrickBits));
+	}
+
+	glm::uvec3 BrickGrid::UnpackAtlasBrick(uint32_t packed)
+	{
+		return glm::uvec3(
+			packed & c_AtlasBrickMask,
+			(packed >> c_AtlasBrickBits) & c_AtlasBrickMask,
+			packed >> (2 * c_AtlasBrickBits));
+	}
+
+	BrickGrid::BrickGrid(const DensityGrid& densityGrid) :
+		m_Width(densityGrid.GetWidth()),
+		m_Height(densityGrid.GetHeight()),
+		m_Depth(densityGrid.GetDepth()),
+		m_BrickCount(GetBrickCountForExtent(m_Width, m_Height, m_Depth)),
+		m_BrickIndices(static_cast<size_t>(m_BrickCount.x) * m_BrickCount.y * m_BrickCount.z, 0),
+		m_Atlas(0, 0, 0)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		auto getBrickIndex = [this](uint32_t bx, uint32_t by, uint32_t bz)
+		{
+			return bx + static_cast<size_t>(m_BrickCount.x) * (by + static_cast<size_t>(m_BrickCount.y) * bz);
+		};
+
+		// Find occupied bricks. m_BrickIndices temporarily holds a 0/1 flag.
+		tbb::parallel_for(0u, m_BrickCount.z, [&](uint32_t bz)
+			{
+				for (uint32_t by = 0; by < m_BrickCount.y; by++)
+				{
+					for (uint32_t bx = 0; bx < m_BrickCount.x; bx++)
+					{
+						const uint32_t x0 = bx * sc_BrickSize;
+						const uint32_t x1 = std::min(x0 + sc_BrickSize, m_Width);
+						bool occupied = false;
+						for (uint32_t z = bz * sc_BrickSize; z < std::min((bz + 1) * sc_BrickSize, m_Depth) && !occupied; z++)
+						{
+							for (uint32_t y = by * sc_BrickSize; y < std::min((by + 1) * sc_BrickSize, m_Height) && !occupied; y++)
+							{
+								const float* row = densityGrid.GetData() + densityGrid.GetIndex(0, y, z);
+								occupied = std::any_of(row + x0, row + x1, [](float value) { return value != 0.0f; });
+							}
+						}
+						m_BrickIndices[getBrickIndex(bx, by, bz)] = occupied ? 1 : 0;
+					}
+				}
+			});
+
+		// Assign atlas slots in brick order. Slot 0 is the zero brick.
+		std::vector<uint32_t> slots(m_BrickIndices.size());
+		m_AtlasBrickCount = 1;
+		for (size_t i = 0; i < m_BrickIndices.size(); i++)
+		{
+			slots[i] = m_BrickIndices[i] != 0 ? m_AtlasBrickCount++ : 0;
+		}
+
+		const glm::uvec3 atlasBrickExtent = GetAtlasBrickExtent(m_AtlasBrickCount);
+		if (glm::any(glm::greaterThan(atlasBrickExtent, glm::uvec3(c_AtlasBrickMask + 1))))
+		{
+			Log::Error("BrickGrid atlas exceeds the packable brick range", true);
+		}
+		m_Atlas = DensityGrid(
+			atlasBrickExtent.x * sc_BrickSize,
+			atlasBrickExtent.y * sc_BrickSize,
+			atlasBrickExtent.z * sc_BrickSize);
+
+		// Copy occupied bricks into their slots. Voxels of bricks at the upper volume border that lie
+		// outside of the volume stay zero and are never sampled.
+		tbb::parallel_for(0u, m_BrickCount.z, [&](uint32_t bz)
+			{
+				for (uint32_t by = 0; by < m_BrickCount.y; by++)
+				{
+					for (uint32_t bx = 0; bx < m_BrickCount.x; bx++)
+					{
+						const size_t brickIndex = getBrickIndex(bx, by, bz);
+						const uint32_t slot = slots[brickIndex];
+						const glm::uvec3 atlasBrick(
+							slot % atlasBrickExtent.x,
+							(slot / atlasBrickExtent.x) % atlasBrickExtent.y,
+							slot / (atlasBrickExtent.x * atlasBrickExtent.y));
+						m_BrickIndices[brickIndex] = PackAtlasBrick(atlasBrick);
+						if (slot == 0) { continue; }
+
+						const uint32_t x0 = bx * sc_BrickSize;
+						const uint32_t x1 = std::min(x0 + sc_BrickSize, m_Width);
+						for (uint32_t z = 0; z < sc_BrickSize && bz * sc_BrickSize + z < m_Depth; z++)
+						{
+							for (uint32_t y = 0; y < sc_BrickSize && by * sc_BrickSize + y < m_Height; y++)
+							{
+								const float* src = densityGrid.GetData() + densityGrid.GetIndex(0, by * sc_BrickSize + y, bz * sc_BrickSize + z);
+								float* dst = m_Atlas.GetData() + m_Atlas.GetIndex(
+									atlasBrick.x * sc_BrickSize,
+									atlasBrick.y * sc_BrickSize + y,
+									atlasBrick.z * sc_BrickSize + z);
+								std::copy(src + x0, src + x1, dst);
+							}
+						}
+					}
+				}
+			});
+
+		auto end = std::chrono::steady_clock::now();
+		const double elapsedMS = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+		Log::Info(
+			"Built brick grid with " + std::to_string(m_AtlasBrickCount - 1) + " of " + std::to_string(m_BrickIndices.size()) +
+			" bricks occupied (atlas " + std::to_string(m_Atlas.GetWidth()) + "x" + std::to_string(m_Atlas.GetHeight()) +
+			"x" + std::to_string(m_Atlas.GetDepth()) + ") in " + std::to_string(elapsedMS) + "ms");
+	}
+
+	BrickGrid::BrickGrid(uint32_t width, uint32_t height, uint32_t depth, std::vector<uint32_t> brickIndices, DensityGrid atlas) :
+		m_Width(width),
+		m_Height(height),
+		m_Depth(depth),
+		m_BrickCount(GetBrickCountForExtent(width, height, depth)),
+		m_BrickIndices(std::move(brickIndices)),
+		m_Atlas(std::move(atlas))
+	{
+		if (m_BrickIndices.size() != static_cast<size_t>(m_BrickCount.x) * m_BrickCount.y * m_BrickCount.z ||
+			m_Atlas.GetWidth() % sc_BrickSize != 0 ||
+			m_Atlas.GetHeight() % sc_BrickSize != 0 ||
+			m_Atlas.GetDepth() % sc_BrickSize != 0)
+		{
+			Log::Error("BrickGrid index grid or atlas do not match the volume", true);
+		}
+		// Only empty bricks point to the zero brick at the atlas origin
+		m_AtlasBrickCount = 1 + static_cast<uint32_t>(std::count_if(
+			m_BrickIndices.begin(),
+			m_BrickIndices.end(),
+			[](uint32_t packed) { return packed != 0; }));
+	}
+
+	uint32_t BrickGrid::GetWidth() const
+	{
+		return m_Width;
+	}
+
+	uint32_t BrickGrid::GetHeight() const
+	{
+		return m_Height;
+	}
+
+	uint32_t BrickGrid::GetDepth() const
+	{
+		return m_Depth;
+	}
+
+	glm::uvec3 BrickGrid::GetBrickCount() const
+	{
+		return m_BrickCount;
+	}
+
+	uint32_t BrickGrid::GetAtlasBrickCount() const
+	{
+		return m_AtlasBrickCount;
+	}
+
+	size_t BrickGrid::GetSizeInBytes() const
+	{
+		return m_BrickIndices.size() * sizeof(uint32_t) + m_Atlas.GetSizeInBytes();
+	}
+
+	const std::vector<uint32_t>& BrickGrid::GetBrickIndices() const
+	{
+		return m_BrickIndices;
+	}
+
+	DensityGrid& BrickGrid::GetAtlas()
+	{
+		return m_Atlas;
+	}
+
+	const DensityGrid& BrickGrid::GetAtlas() const
+	{
+		return m_Atlas;
+	}
+
+	float BrickGrid::GetValue(uint32_t x, uint32_t y, uint32_t z) const
+	{
+		const size_t brickIndex =
+			(x / sc_BrickSize) +
+			static_cast<size_t>(m_BrickCount.x) * ((y / sc_BrickSize) + static_cast<size_t>(m_BrickCount.y) * (z / sc_BrickSize));
+		const glm::uvec3 atlasBrick = UnpackAtlasBrick(m_BrickIndices[brickIndex]);
+		return m_Atlas.GetValue(
+			atlasBrick.x * sc_BrickSize + (x % sc_BrickSize),
+			atlasBrick.y * sc_BrickSize + (y % sc_BrickSize),
+			atlasBrick.z * sc_BrickSize + (z % sc_BrickSize));
+	}
+
+	float BrickGrid::SampleNearest(float u, float v, float w) const
+	{
+		if (u < 0.0f || v < 0.0f || w < 0.0f || u >= 1.0f || v >= 1.0f || w >= 1.0f) { return 0.0f; }
+
+		const uint32_t x = std::min(static_cast<uint32_t>(u * static_cast<float>(m_Width)), m_Width - 1);
+		const uint32_t y = std::min(static_cast<uint32_t>(v * static_cast<float>(m_Height)), m_Height - 1);
+		const uint32_t z = std::min(static_cast<uint32_t>(w * static_cast<float>(m_Depth)), m_Depth - 1);
+		return GetValue(x, y, z);
+	}
+}
@@ -10,7 +10,8 @@ namespace en::vk
 		VkAccessFlags srcAccessMask,
 		VkAccessFlags dstAccessMask,
 		VkPipelineStageFlags srcStageMask,
-		VkPipelineStageFlags dstStageMask)
+		VkPipelineStageFlags dstStageMask,
+		uint32_t levelCount)
 	{
 		VkImageMemoryBarrier imageMemoryBarrier;
 		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -24,7 +25,7 @@ namespace en::vk
 		imageMemoryBarrier.image = image;
 		imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
-		imageMemoryBarrier.subresourceRange.levelCount = 1;
+		imageMemoryBarrier.subresourceRange.levelCount = levelCount;
 		imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
 		imageMemoryBarrier.subresourceRange.layerCount = 1;
 
@@ -0,0 +1,727 @@
+#include <engine/graphics/renderer/CpuHpmRenderer.hpp>
+#include <engine/HpmSceneSetup.hpp>
+#include <engine/util/read_file.hpp>
+#include <engine/util/Log.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/blocked_range2d.h>
+#include <tinyexr.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace en
+{
+	constexpr float c_Pi = 3.14159265358979f;
+	// MAX_RAY_DISTANCE in the shader constants
+	constexpr float c_MaxRayDistance = 100000.0f;
+	// RAY_MARCH_* in path_trace.glsl
+	constexpr float c_RayMarchStepsPerOpticalDepth = 1.0f;
+	constexpr uint32_t c_RayMarchMaxSteps = 64;
+	constexpr uint32_t c_RayMarchMaxOrder = 8;
+	constexpr float c_RayMarchContinueProb = 0.5f;
+
+	// PCG32 generator. Every pixel sample gets its own stream, so the result does not depend on how
+	// the tiles are scheduled.
+	class CpuHpmRenderer::Random
+	{
+	public:
+		Random(uint64_t pixelIndex, uint64_t sampleIndex) :
+			m_State(0),
+			m_Inc((pixelIndex << 1u) | 1u)
+		{
+			Next();
+			m_State += sampleIndex * 0x9E3779B97F4A7C15ull;
+			Next();
+		}
+
+		// Uniform float in [0, maxVal)
+		float RandFloat(float maxVal)
+		{
+			return static_cast<float>(Next() >> 8) * (1.0f / 16777216.0f) * maxVal;
+		}
+
+	private:
+		uint64_t m_State;
+		uint64_t m_Inc;
+
+		uint32_t Next()
+		{
+			const uint64_t oldState = m_State;
+			m_State = oldState * 6364136223846793005ull + m_Inc;
+			const uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18u) ^ oldState) >> 27u);
+			const uint32_t rot = static_cast<uint32_t>(oldState >> 59u);
+			return (xorShifted >> rot) | (xorShifted << ((~rot + 1u) & 31u));
+		}
+	};
+
+	// Applies the quantization of the density texture format so that both renderers see the same medium
+	static void QuantizeDensity(DensityGrid& grid, VkFormat format)
+	{
+		float* data = grid.GetData();
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, grid.GetVoxelCount()), [&](const tbb::blocked_range<size_t>& range)
+			{
+				switch (format)
+				{
+				case VK_FORMAT_R8_UNORM:
+				case VK_FORMAT_R8G8B8A8_UNORM:
+					for (size_t i = range.begin(); i < range.end(); i++)
+					{
+						data[i] = static_cast<float>(static_cast<uint8_t>(data[i] * 255.0f)) / 255.0f;
+					}
+					break;
+				case VK_FORMAT_R16_SFLOAT:
+					for (size_t i = range.begin(); i < range.end(); i++)
+					{
+						data[i] = glm::unpackHalf1x16(glm::packHalf1x16(data[i]));
+					}
+					break;
+				default:
+					break;
+				}
+			});
+	}
+
+	CpuHpmRenderer::CpuHpmRenderer(uint32_t width, uint32_t height, uint32_t pathLength, const AppConfig& appConfig) :
+		m_Width(width),
+		m_Height(height),
+		m_PathLength(pathLength),
+		m_InvProjView(1.0f),
+		m_CameraPos(0.0f),
+		m_VolumeCache(HpmSceneSetup::sc_DensityFilePath),
+		m_BrickGrid(m_VolumeCache.GetBrickGrid()),
+		m_MajorantGrid(m_VolumeCache.GetMajorantGrid()),
+		m_OccupancyGrid(m_VolumeCache.GetOccupancyGrid()),
+		m_DensityMipChain(m_VolumeCache.GetDensityMipChain()),
+		m_VolumeSize(HpmSceneSetup::GetVolumeSize(m_VolumeCache.GetDensityGrid())),
+		m_VolumePos(HpmSceneSetup::GetVolumePosition(m_VolumeCache.GetDensityGrid())),
+		m_DensityFactor(appConfig.scene.density),
+		m_PhaseFunction(CreatePhaseFunction(appConfig.phaseFunc, HpmSceneSetup::sc_VolumeG)),
+		m_ShadowTransmittance(appConfig.shadowTransmittance),
+		m_FreeFlightMode(appConfig.freeFlightMode),
+		m_DirLightDir(VecFromAngles(HpmSceneSetup::sc_DirLightZenith, HpmSceneSetup::sc_DirLightAzimuth)),
+		m_DirLightStrength(appConfig.scene.dirLightStrength),
+		m_PointLightPos(HpmSceneSetup::sc_PointLightPos),
+		m_PointLightColor(HpmSceneSetup::sc_PointLightColor),
+		m_PointLightStrength(appConfig.scene.pointLightStrength),
+		m_HdrEnvMapStrength(appConfig.scene.hdrEnvMapStrength),
+		m_Accumulation(static_cast<size_t>(width) * height * 4, 0.0)
+	{
+		// The majorant grid is built from the unquantized values like in HpmScene. Cached voxels are
+		// mapped copy on write, so quantizing them never touches the cache file.
+		QuantizeDensity(m_BrickGrid.GetAtlas(), appConfig.scene.densityFormat);
+
+		int hdrWidth, hdrHeight;
+		m_HdrEnvMap4f = ReadFileHdr4f(
+			appConfig.scene.hdrEnvMapPath,
+			hdrWidth,
+			hdrHeight,
+			HpmSceneSetup::sc_HdrEnvMapMaxValue,
+			appConfig.hdrEnvMapTestOverwrite);
+		m_HdrEnvMapWidth = static_cast<uint32_t>(hdrWidth);
+		m_HdrEnvMapHeight = static_cast<uint32_t>(hdrHeight);
+		m_HdrEnvMapAliasTable = Hdr4fToAliasTable(m_HdrEnvMap4f, m_HdrEnvMapWidth, m_HdrEnvMapHeight);
+
+		if (m_ShadowTransmittance.dirLight == TransmittanceMode::Cached)
+		{
+			const DensityGrid& densityGrid = m_VolumeCache.GetDensityGrid();
+			m_DirLightTransmittanceGrid = std::make_unique<TransmittanceGrid>(
+				m_DensityMipChain,
+				glm::uvec3(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth()),
+				m_VolumeSize,
+				m_DensityFactor);
+			m_DirLightTransmittanceGrid->BuildDirLight(-glm::normalize(m_DirLightDir));
+		}
+
+		if (m_ShadowTransmittance.pointLight == TransmittanceMode::Cached)
+		{
+			const DensityGrid& densityGrid = m_VolumeCache.GetDensityGrid();
+			m_PointLightTransmittanceGrid = std::make_unique<SphericalTransmittanceGrid>(
+				m_DensityMipChain,
+				glm::uvec3(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth()),
+				m_VolumeSize,
+				m_VolumePos,
+				m_DensityFactor);
+			m_PointLightTransmittanceGrid->BuildPointLight(m_PointLightPos);
+		}
+	}
+
+	void CpuHpmRenderer::Render(uint32_t sampleCount)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// Tiles are small enough that there are many more of them than cores. Idle threads steal the
+		// remaining tiles from busy ones, which balances the very uneven cost of pixels inside and
+		// outside of the volume.
+		const tbb::blocked_range2d<uint32_t> tiles(0, m_Height, sc_TileSize, 0, m_Width, sc_TileSize);
+		tbb::parallel_for(tiles, [&](const tbb::blocked_range2d<uint32_t>& tile)
+			{
+				for (uint32_t y = tile.rows().begin(); y < tile.rows().end(); y++)
+				{
+					for (uint32_t x = tile.cols().begin(); x < tile.cols().end(); x++)
+					{
+						const size_t pixelIndex = (static_cast<size_t>(y) * m_Width) + x;
+						glm::vec4 sum(0.0f);
+						for (uint32_t sample = 0; sample < sampleCount; sample++)
+						{
+							Random random(pixelIndex, m_SampleCount + sample);
+							sum += RenderPixel(x, y, random);
+						}
+
+						double* accumulation = m_Accumulation.data() + (pixelIndex * 4);
+						for (int c = 0; c < 4; c++) { accumulation[c] += static_cast<double>(sum[c]); }
+					}
+				}
+			}, tbb::simple_partitioner());
+
+		m_SampleCount += sampleCount;
+
+		auto end = std::chrono::steady_clock::now();
+		const double elapsedMS = std::chrono::duration<double, std::milli>(end - start).count();
+		const double pixelSamples = static_cast<double>(m_Width) * m_Height * sampleCount;
+		Log::Info(
+			"CpuHpmRenderer rendered " + std::to_string(sampleCount) + "spp in " + std::to_string(elapsedMS) + "ms" +
+			" (" + std::to_string(pixelSamples / (elapsedMS * 1e3)) + " M samples/s)" +
+			" | total " + std::to_string(m_SampleCount) + "spp");
+	}
+
+	void CpuHpmRenderer::ExportOutputImageToFile(const std::string& filePath) const
+	{
+		// Mean of all samples, which is what the blending of McHpmRenderer converges to
+		std::vector<float> buffer(m_Accumulation.size());
+		const double norm = m_SampleCount > 0 ? 1.0 / static_cast<double>(m_SampleCount) : 0.0;
+		for (size_t i = 0; i < buffer.size(); i++)
+		{
+			buffer[i] = static_cast<float>(m_Accumulation[i] * norm);
+		}
+
+		if (TINYEXR_SUCCESS != SaveEXR(buffer.data(), m_Width, m_Height, 4, 0, filePath.c_str(), nullptr))
+		{
+			en::Log::Error("TINYEXR Error", true);
+		}
+	}
+
+	uint32_t CpuHpmRenderer::GetSampleCount() const
+	{
+		return m_SampleCount;
+	}
+
+	void CpuHpmRenderer::SetCamera(
+		const glm::vec3& pos,
+		const glm::vec3& viewDir,
+		const glm::vec3& up,
+		float aspectRatio,
+		float fov,
+		float nearPlane,
+		float farPlane)
+	{
+		const glm::mat4 projMat = glm::perspective(fov, aspectRatio, nearPlane, farPlane);
+		const glm::mat4 viewMat = glm::lookAt(pos, pos + viewDir, up);
+		m_InvProjView = glm::inverse(projMat * viewMat);
+		m_CameraPos = pos;
+
+		std::fill(m_Accumulation.begin(), m_Accumulation.end(), 0.0);
+		m_SampleCount = 0;
+	}
+
+	// Mirrors main from mc/render.comp
+	glm::vec4 CpuHpmRenderer::RenderPixel(uint32_t x, uint32_t y, Random& random) const
+	{
+		const glm::vec2 fragUV(static_cast<float>(x) / static_cast<float>(m_Width), static_cast<float>(y) / static_cast<float>(m_Height));
+		const glm::vec4 screenCoord((fragUV * 2.0f) - glm::vec2(1.0f), 0.0f, 1.0f);
+		const glm::vec4 worldPos = m_InvProjView * screenCoord;
+		const glm::vec3 pixelWorldPos = glm::vec3(worldPos) / worldPos.w;
+
+		const glm::vec3 ro = m_CameraPos;
+		const glm::vec3 rd = glm::normalize(pixelWorldPos - ro);
+
+		const float occupiedEntry = FindOccupiedEntry(ro, rd);
+
+		glm::vec4 outputColor;
+		bool didScatter = false;
+		if (occupiedEntry < 0.0f)
+		{
+			outputColor = glm::vec4(SampleHdrEnvMap(rd), 1.0f);
+		}
+		else
+		{
+			outputColor = TracePath(ro + (occupiedEntry * rd), rd, didScatter, random);
+			if (!didScatter) { outputColor = glm::vec4(SampleHdrEnvMap(rd), 1.0f); }
+		}
+		outputColor.w = didScatter ? 1.0f : 0.0f;
+
+		return outputColor;
+	}
+
+	glm::vec4 CpuHpmRenderer::TracePath(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& didScatter, Random& random) const
+	{
+		glm::vec3 scatteredLight(0.0f);
+
+		glm::vec3 currentPoint = rayOrigin + (FindEntryExit(rayOrigin, rayDir).x * rayDir);
+		glm::vec3 currentDir = rayDir;
+
+		float factor = 1.0f;
+
+		didScatter = false;
+		bool volumeExit = false;
+
+		for (uint32_t i = 0; i < m_PathLength; i++)
+		{
+			// Find new point
+			currentPoint = SampleFreeFlight(currentPoint, currentDir, volumeExit, random);
+			if (volumeExit) { break; }
+			didScatter = true;
+
+			// Proper weighting of light
+			factor *= 0.5f;
+
+			// Lighting
+			scatteredLight += TraceScene(currentPoint, currentDir, random) * factor;
+
+			// Find new dir by IS the PF
+			currentDir = NewRayDir(currentDir, true, random);
+		}
+
+		return glm::vec4(scatteredLight, factor);
+	}
+
+	glm::vec2 CpuHpmRenderer::FindEntryExit(const glm::vec3& ro, const glm::vec3& rd) const
+	{
+		glm::vec3 safeDir = rd;
+		for (int i = 0; i < 3; i++)
+		{
+			if (std::abs(safeDir[i]) < 1e-12f) { safeDir[i] = 1e-12f; }
+		}
+		const glm::vec3 invDir = 1.0f / safeDir;
+		const glm::vec3 t0 = (m_VolumePos - (m_VolumeSize / 2.0f) - ro) * invDir;
+		const glm::vec3 t1 = (m_VolumePos + (m_VolumeSize / 2.0f) - ro) * invDir;
+		const glm::vec3 tNearAxis = glm::min(t0, t1);
+		const glm::vec3 tFarAxis = glm::max(t0, t1);
+		const float tMin = std::max(std::max(tNearAxis.x, tNearAxis.y), std::max(tNearAxis.z, 0.0f));
+		const float tMax = std::min(std::min(tFarAxis.x, tFarAxis.y), tFarAxis.z);
+		return glm::vec2(tMin, tMax);
+	}
+
+	// Mirrors find_occupied_entry from volume.glsl
+	float CpuHpmRenderer::FindOccupiedEntry(const glm::vec3& ro, const glm::vec3& rd) const
+	{
+		MajorantGrid::Traversal it;
+		if (!m_OccupancyGrid.InitTraversal(((ro - m_VolumePos) / m_VolumeSize) + 0.5f, rd / m_VolumeSize, c_MaxRayDistance, it)) { return -1.0f; }
+		return it.t;
+	}
+
+	// Mirrors get_cell_mean from volume.glsl
+	float CpuHpmRenderer::GetCellMean(const glm::ivec3& cell) const
+	{
+		if (m_DensityMipChain.GetLevelCount() < DensityMipChain::sc_MaxLevelCount) { return m_DensityFactor * m_OccupancyGrid.GetCellMinimum(cell); }
+		return m_DensityFactor * m_DensityMipChain.GetLevel(DensityMipChain::sc_MaxLevelCount).GetValue(cell.x, cell.y, cell.z);
+	}
+
+	float CpuHpmRenderer::GetDensity(const glm::vec3& pos) const
+	{
+		const glm::vec3 uvw = ((pos - m_VolumePos) / m_VolumeSize) + 0.5f;
+		return m_DensityFactor * m_BrickGrid.SampleNearest(uvw.x, uvw.y, uvw.z);
+	}
+
+	float CpuHpmRenderer::RatioTrack(const glm::vec3& start, const glm::vec3& end, Random& random) const
+	{
+		const float tMax = glm::distance(end, start);
+		float transmittance = 1.0f;
+		if (tMax <= 0.0f) { return transmittance; }
+		const glm::vec3 dir = (end - start) / tMax;
+
+		MajorantGrid::Traversal it;
+		if (!m_OccupancyGrid.InitTraversal(((start - m_VolumePos) / m_VolumeSize) + 0.5f, dir / m_VolumeSize, tMax, it)) { return transmittance; }
+
+		uint32_t i = 0;
+		while (i < 128)
+		{
+			const float majorant = m_DensityFactor * m_MajorantGrid.GetCellMajorant(it);
+			const float cellExit = m_MajorantGrid.GetCellExit(it);
+			if (majorant > 0.0f)
+			{
+				it.t -= std::log(1.0f - random.RandFloat(1.0f)) / majorant;
+				if (it.t < cellExit)
+				{
+					i++;
+					transmittance *= 1.0f - (GetDensity(start + (it.t * dir)) / majorant);
+					continue;
+				}
+			}
+
+			if (!m_OccupancyGrid.StepTraversal(it)) { break; }
+		}
+
+		return transmittance;
+	}
+
+	// Mirrors ResidualRatioTrack from path_trace.glsl
+	float CpuHpmRenderer::ResidualRatioTrack(const glm::vec3& start, const glm::vec3& end, Random& random) const
+	{
+		const float tMax = glm::distance(end, start);
+		if (tMax <= 0.0f) { return 1.0f; }
+		const glm::vec3 dir = (end - start) / tMax;
+
+		MajorantGrid::Traversal it;
+		if (!m_OccupancyGrid.InitTraversal(((start - m_VolumePos) / m_VolumeSize) + 0.5f, dir / m_VolumeSize, tMax, it)) { return 1.0f; }
+
+		const bool meanControl = m_ShadowTransmittance.residualControl == ResidualControl::Mean;
+
+		float controlOpticalDepth = 0.0f;
+		float residualTransmittance = 1.0f;
+		uint32_t i = 0;
+		do
+		{
+			const float majorant = m_DensityFactor * m_MajorantGrid.GetCellMajorant(it);
+			if (majorant > 0.0f)
+			{
+				const float cellExit = m_MajorantGrid.GetCellExit(it);
+				const float minorant = m_DensityFactor * m_OccupancyGrid.GetCellMinimum(it.cell);
+				const float control = meanControl ? std::clamp(GetCellMean(it.cell), minorant, majorant) : minorant;
+				const float residualMajorant = std::max(majorant - control, control - minorant);
+				controlOpticalDepth += control * (cellExit - it.t);
+
+				while (residualMajorant > 0.0f && i < 128)
+				{
+					it.t -= std::log(1.0f - random.RandFloat(1.0f)) / residualMajorant;
+					if (it.t >= cellExit) { break; }
+
+					i++;
+					residualTransmittance *= 1.0f - ((GetDensity(start + (it.t * dir)) - control) / residualMajorant);
+				}
+			}
+		} while (i < 128 && m_OccupancyGrid.StepTraversal(it));
+
+		return std::exp(-controlOpticalDepth) * residualTransmittance;
+	}
+
+	// Mirrors init_ray_march from path_trace.glsl
+	bool CpuHpmRenderer::InitRayMarch(const glm::vec3& start, const glm::vec3& end, RayMarchSegment& segment) const
+	{
+		const float tMax = glm::distance(end, start);
+		if (tMax <= 0.0f) { return false; }
+		segment.start = start;
+		segment.dir = (end - start) / tMax;
+
+		MajorantGrid::Traversal it;
+		if (!m_OccupancyGrid.InitTraversal(((start - m_VolumePos) / m_VolumeSize) + 0.5f, segment.dir / m_VolumeSize, tMax, it)) { return false; }
+
+		float majorantOpticalDepth = 0.0f;
+		segment.controlOpticalDepth = 0.0f;
+		do
+		{
+			const float majorant = m_DensityFactor * m_MajorantGrid.GetCellMajorant(it);
+			if (majorant > 0.0f)
+			{
+				const float cellExit = m_MajorantGrid.GetCellExit(it);
+				if (majorantOpticalDepth == 0.0f) { segment.tMin = it.t; }
+				segment.tMax = cellExit;
+				majorantOpticalDepth += majorant * (cellExit - it.t);
+				segment.controlOpticalDepth += std::min(GetCellMean(it.cell), majorant) * (cellExit - it.t);
+			}
+		} while (m_OccupancyGrid.StepTraversal(it));
+
+		if (majorantOpticalDepth <= 0.0f) { return false; }
+		const float stepCount = std::ceil(majorantOpticalDepth * c_RayMarchStepsPerOpticalDepth);
+		segment.stepCount = static_cast<uint32_t>(std::clamp(stepCount, 1.0f, static_cast<float>(c_RayMarchMaxSteps)));
+		return true;
+	}
+
+	// Mirrors ray_march_optical_depth from path_trace.glsl
+	float CpuHpmRenderer::RayMarchOpticalDepth(const RayMarchSegment& segment, Random& random) const
+	{
+		const float stepSize = (segment.tMax - segment.tMin) / static_cast<float>(segment.stepCount);
+		const float jitter = random.RandFloat(1.0f);
+		float densitySum = 0.0f;
+		for (uint32_t i = 0; i < segment.stepCount; i++)
+		{
+			const float t = segment.tMin + ((static_cast<float>(i) + jitter) * stepSize);
+			densitySum += GetDensity(segment.start + (t * segment.dir));
+		}
+		return densitySum * stepSize;
+	}
+
+	// Mirrors BiasedRayMarch from path_trace.glsl
+	float CpuHpmRenderer::BiasedRayMarch(const glm::vec3& start, const glm::vec3& end, Random& random) const
+	{
+		RayMarchSegment segment;
+		if (!InitRayMarch(start, end, segment)) { return 1.0f; }
+		return std::exp(-RayMarchOpticalDepth(segment, random));
+	}
+
+	// Mirrors UnbiasedRayMarch from path_trace.glsl
+	float CpuHpmRenderer::UnbiasedRayMarch(const glm::vec3& start, const glm::vec3& end, Random& random) const
+	{
+		RayMarchSegment segment;
+		if (!InitRayMarch(start, end, segment)) { return 1.0f; }
+
+		float term = 1.0f;
+		float sum = 1.0f;
+		for (uint32_t k = 1; k <= c_RayMarchMaxOrder; k++)
+		{
+			if (k > 1)
+			{
+				if (random.RandFloat(1.0f) >= c_RayMarchContinueProb) { break; }
+				term /= c_RayMarchContinueProb;
+			}
+			term *= (segment.controlOpticalDepth - RayMarchOpticalDepth(segment, random)) / static_cast<float>(k);
+			sum += term;
+		}
+
+		return std::exp(-segment.controlOpticalDepth) * sum;
+	}
+
+	float CpuHpmRenderer::EstimateTransmittance(const glm::vec3& start, const glm::vec3& end, TransmittanceMode mode, Random& random) const
+	{
+		switch (mode)
+		{
+		case TransmittanceMode::ResidualRatioTracking:
+			return ResidualRatioTrack(start, end, random);
+		case TransmittanceMode::BiasedRayMarching:
+			return BiasedRayMarch(start, end, random);
+		case TransmittanceMode::UnbiasedRayMarching:
+			return UnbiasedRayMarch(start, end, random);
+		default:
+			return RatioTrack(start, end, random);
+		}
+	}
+
+	glm::vec3 CpuHpmRenderer::DeltaTrack(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& volumeExit, Random& random) const
+	{
+		volumeExit = false;
+
+		const float tMax = std::max(FindEntryExit(rayOrigin, rayDir).y, 0.0f);
+
+		MajorantGrid::Traversal it;
+		if (!m_OccupancyGrid.InitTraversal(((rayOrigin - m_VolumePos) / m_VolumeSize) + 0.5f, rayDir / m_VolumeSize, tMax, it))
+		{
+			volumeExit = true;
+			return rayOrigin + (random.RandFloat(tMax) * rayDir);
+		}
+
+		uint32_t i = 0;
+		while (i < 128)
+		{
+			const float majorant = m_DensityFactor * m_MajorantGrid.GetCellMajorant(it);
+			const float cellExit = m_MajorantGrid.GetCellExit(it);
+			if (majorant > 0.0f)
+			{
+				it.t -= std::log(1.0f - random.RandFloat(1.0f)) / majorant;
+				if (it.t < cellExit)
+				{
+					i++;
+					const glm::vec3 nextSamplePoint = rayOrigin + (it.t * rayDir);
+					const float u = random.RandFloat(1.0f);
+					if (u * majorant < m_DensityFactor * m_OccupancyGrid.GetCellMinimum(it.cell)) { return nextSamplePoint; }
+					if (GetDensity(nextSamplePoint) / majorant > u) { return nextSamplePoint; }
+					continue;
+				}
+			}
+
+			if (!m_OccupancyGrid.StepTraversal(it))
+			{
+				volumeExit = true;
+				break;
+			}
+		}
+
+		return rayOrigin + (random.RandFloat(tMax) * rayDir);
+	}
+
+	// Mirrors DecompositionTrack from path_trace.glsl
+	glm::vec3 CpuHpmRenderer::DecompositionTrack(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& volumeExit, Random& random) const
+	{
+		volumeExit = false;
+
+		const float tMax = std::max(FindEntryExit(rayOrigin, rayDir).y, 0.0f);
+
+		MajorantGrid::Traversal it;
+		if (!m_OccupancyGrid.InitTraversal(((rayOrigin - m_VolumePos) / m_VolumeSize) + 0.5f, rayDir / m_VolumeSize, tMax, it))
+		{
+			volumeExit = true;
+			return rayOrigin + (random.RandFloat(tMax) * rayDir);
+		}
+
+		uint32_t i = 0;
+		while (i < 128)
+		{
+			const float majorant = m_DensityFactor * m_MajorantGrid.GetCellMajorant(it);
+			const float cellExit = m_MajorantGrid.GetCellExit(it);
+			if (majorant > 0.0f)
+			{
+				const float minorant = m_DensityFactor * m_OccupancyGrid.GetCellMinimum(it.cell);
+				const float residualMajorant = majorant - minorant;
+
+				const float tControl = minorant > 0.0f ? it.t - (std::log(1.0f - random.RandFloat(1.0f)) / minorant) : cellExit;
+				const float tResidualEnd = std::min(tControl, cellExit);
+				while (residualMajorant > 0.0f && i < 128)
+				{
+					it.t -= std::log(1.0f - random.RandFloat(1.0f)) / residualMajorant;
+					if (it.t >= tResidualEnd) { break; }
+
+					i++;
+					const glm::vec3 nextSamplePoint = rayOrigin + (it.t * rayDir);
+					if ((GetDensity(nextSamplePoint) - minorant) / residualMajorant > random.RandFloat(1.0f)) { return nextSamplePoint; }
+				}
+
+				if (tControl < cellExit) { return rayOrigin + (tControl * rayDir); }
+			}
+
+			if (!m_OccupancyGrid.StepTraversal(it))
+			{
+				volumeExit = true;
+				break;
+			}
+		}
+
+		return rayOrigin + (random.RandFloat(tMax) * rayDir);
+	}
+
+	glm::vec3 CpuHpmRenderer::SampleFreeFlight(const glm::vec3& rayOrigin, const glm::vec3& rayDir, bool& volumeExit, Random& random) const
+	{
+		if (m_FreeFlightMode == FreeFlightMode::DecompositionTracking) { return DecompositionTrack(rayOrigin, rayDir, volumeExit, random); }
+		return DeltaTrack(rayOrigin, rayDir, volumeExit, random);
+	}
+
+	// Solid angle density like phase_func in dir_gen.glsl
+	float CpuHpmRenderer::PhaseFunc(float cosTheta) const
+	{
+		return m_PhaseFunction.Eval(cosTheta) / (2.0f * c_Pi);
+	}
+
+	// Mirrors NewRayDir from dir_gen.glsl
+	glm::vec3 CpuHpmRenderer::NewRayDir(glm::vec3 oldRayDir, bool phaseFuncSampling, Random& random) const
+	{
+		oldRayDir = glm::normalize(oldRayDir);
+
+		// Without phase function sampling the angle to oldRayDir is uniform in [0, pi]
+		const float oneMinusCosTheta = phaseFuncSampling ?
+			m_PhaseFunction.SampleOneMinusCosTheta(random.RandFloat(1.0f)) :
+			1.0f - std::cos(random.RandFloat(c_Pi));
+		const float cosTheta = 1.0f - oneMinusCosTheta;
+		const float sinTheta = std::sqrt(std::max(0.0f, oneMinusCosTheta * (2.0f - oneMinusCosTheta)));
+		const float phi = random.RandFloat(2.0f * c_Pi);
+
+		glm::vec3 b1;
+		glm::vec3 b2;
+		BuildOrthonormalBasis(oldRayDir, b1, b2);
+		return glm::normalize((sinTheta * std::cos(phi) * b1) + (sinTheta * std::sin(phi) * b2) + (cosTheta * oldRayDir));
+	}
+
+	glm::vec3 CpuHpmRenderer::TraceDirLight(const glm::vec3& pos, const glm::vec3& dir, Random& random) const
+	{
+		if (m_DirLightStrength == 0.0f) { return glm::vec3(0.0f); }
+
+		const glm::vec3 lightDir = -glm::normalize(m_DirLightDir);
+		float transmittance;
+		if (m_ShadowTransmittance.dirLight == TransmittanceMode::Cached)
+		{
+			transmittance = m_DirLightTransmittanceGrid->Sample(((pos - m_VolumePos) / m_VolumeSize) + 0.5f);
+		}
+		else
+		{
+			const glm::vec3 exit = pos + (std::max(FindEntryExit(pos, lightDir).y, 0.0f) * lightDir);
+			transmittance = EstimateTransmittance(pos, exit, m_ShadowTransmittance.dirLight, random);
+		}
+		const float phase = PhaseFunc(glm::dot(lightDir, dir));
+		return glm::vec3(1.0f) * transmittance * m_DirLightStrength * phase;
+	}
+
+	glm::vec3 CpuHpmRenderer::TracePointLight(const glm::vec3& pos, const glm::vec3& dir, Random& random) const
+	{
+		if (m_PointLightStrength == 0.0f) { return glm::vec3(0.0f); }
+
+		const float transmittance = m_ShadowTransmittance.pointLight == TransmittanceMode::Cached ?
+			m_PointLightTransmittanceGrid->Sample(pos) :
+			EstimateTransmittance(m_PointLightPos, pos, m_ShadowTransmittance.pointLight, random);
+		const float phase = PhaseFunc(glm::dot(glm::normalize(m_PointLightPos - pos), dir));
+		return m_PointLightColor * m_PointLightStrength * transmittance * phase;
+	}
+
+	glm::vec3 CpuHpmRenderer::SampleHdrEnvMap(const glm::vec3& dir) const
+	{
+		const glm::vec2 phiTheta(std::atan2(dir.z, dir.x), std::asin(glm::clamp(dir.y, -1.0f, 1.0f)));
+		const glm::vec2 uv = (phiTheta * glm::vec2(0.5f / c_Pi, 1.0f / c_Pi)) + 0.5f;
+
+		// Bilinear filtering with clamp to edge addressing
+		const float x = (uv.x * static_cast<float>(m_HdrEnvMapWidth)) - 0.5f;
+		const float y = (uv.y * static_cast<float>(m_HdrEnvMapHeight)) - 0.5f;
+		const float x0f = std::floor(x);
+		const float y0f = std::floor(y);
+		const float fx = x - x0f;
+		const float fy = y - y0f;
+
+		const int maxX = static_cast<int>(m_HdrEnvMapWidth) - 1;
+		const int maxY = static_cast<int>(m_HdrEnvMapHeight) - 1;
+		const int x0 = std::clamp(static_cast<int>(x0f), 0, maxX);
+		const int x1 = std::clamp(static_cast<int>(x0f) + 1, 0, maxX);
+		const int y0 = std::clamp(static_cast<int>(y0f), 0, maxY);
+		const int y1 = std::clamp(static_cast<int>(y0f) + 1, 0, maxY);
+
+		auto texel = [&](int tx, int ty)
+		{
+			const float* rgba = m_HdrEnvMap4f.data() + ((static_cast<size_t>(ty) * m_HdrEnvMapWidth + tx) * 4);
+			return glm::vec3(rgba[0], rgba[1], rgba[2]);
+		};
+
+		const glm::vec3 top = glm::mix(texel(x0, y0), texel(x1, y0), fx);
+		const glm::vec3 bottom = glm::mix(texel(x0, y1), texel(x1, y1), fx);
+		return glm::mix(top, bottom, fy) * m_HdrEnvMapStrength;
+	}
+
+	// Mirrors GetHdrEnvMapPdf from path_trace.glsl
+	float CpuHpmRenderer::GetHdrEnvMapPdf(const glm::vec3& dir) const
+	{
+		const float theta = std::asin(glm::clamp(dir.y, -1.0f, 1.0f));
+		const glm::vec2 uv = (glm::vec2(std::atan2(dir.z, dir.x), theta) * glm::vec2(0.5f / c_Pi, 1.0f / c_Pi)) + 0.5f;
+		const int x = std::clamp(static_cast<int>(uv.x * static_cast<float>(m_HdrEnvMapWidth)), 0, static_cast<int>(m_HdrEnvMapWidth) - 1);
+		const int y = std::clamp(static_cast<int>(uv.y * static_cast<float>(m_HdrEnvMapHeight)), 0, static_cast<int>(m_HdrEnvMapHeight) - 1);
+		const float uvPdf = m_HdrEnvMap4f[((static_cast<size_t>(y) * m_HdrEnvMapWidth + x) * 4) + 3];
+		return uvPdf / (2.0f * c_Pi * c_Pi * std::max(std::cos(theta), 1e-6f));
+	}
+
+	// Mirrors SampleHdrEnvMapDir from path_trace.glsl
+	glm::vec3 CpuHpmRenderer::SampleHdrEnvMapDir(Random& random) const
+	{
+		const float u0 = random.RandFloat(1.0f);
+		const float u1 = random.RandFloat(1.0f);
+		const uint32_t texel = m_HdrEnvMapAliasTable.Sample(u0, u1);
+		const uint32_t texelX = texel % m_HdrEnvMapWidth;
+		const uint32_t texelY = texel / m_HdrEnvMapWidth;
+
+		const float u = (static_cast<float>(texelX) + random.RandFloat(1.0f)) / static_cast<float>(m_HdrEnvMapWidth);
+		const float v = (static_cast<float>(texelY) + random.RandFloat(1.0f)) / static_cast<float>(m_HdrEnvMapHeight);
+		const float phi = (u - 0.5f) * 2.0f * c_Pi;
+		const float theta = (v - 0.5f) * c_Pi;
+		return glm::vec3(std::cos(theta) * std::cos(phi), std::sin(theta), std::cos(theta) * std::sin(phi));
+	}
+
+	// One sample MIS of env map and phase function sampling like SampleHdrEnvMap in path_trace.glsl
+	glm::vec3 CpuHpmRenderer::SampleHdrEnvMap(const glm::vec3& pos, const glm::vec3& dir, uint32_t sampleCount, Random& random) const
+	{
+		if (m_HdrEnvMapStrength == 0.0f) { return glm::vec3(0.0f); }
+
+		glm::vec3 light(0.0f);
+		for (uint32_t i = 0; i < sampleCount; i++)
+		{
+			const glm::vec3 lightDir = random.RandFloat(1.0f) < 0.5f ? SampleHdrEnvMapDir(random) : NewRayDir(dir, true, random);
+
+			const float phasePdf = PhaseFunc(glm::dot(lightDir, dir));
+			const float pdf = 0.5f * (GetHdrEnvMapPdf(lightDir) + phasePdf);
+			if (pdf <= 0.0f) { continue; }
+
+			const glm::vec3 exit = pos + (std::max(FindEntryExit(pos, lightDir).y, 0.0f) * lightDir);
+			const float transmittance = EstimateTransmittance(pos, exit, m_ShadowTransmittance.hdrEnvMap, random);
+			light += SampleHdrEnvMap(lightDir) * phasePdf * transmittance / pdf;
+		}
+
+		return light / static_cast<float>(sampleCount);
+	}
+
+	glm::vec3 CpuHpmRenderer::TraceScene(const glm::vec3& pos, const glm::vec3& dir, Random& random) const
+	{
+		return TraceDirLight(pos, dir, random) + TracePointLight(pos, dir, random) + SampleHdrEnvMap(pos, dir, 1, random);
+	}
+}
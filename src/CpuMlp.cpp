@@ -0,0 +1,250 @@
+#include <engine/graphics/CpuMlp.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace en
+{
+	// Register tile of the matrix products, 4 rows of 16 sums stay in registers while the products
+	// along the shared dimension are added to them
+	constexpr uint32_t c_TileRowCount = 4;
+	constexpr uint32_t c_TileColumnCount = 16;
+
+	// c[r][k] += sum_i a[r][i] b[i][k] for the rows [0, rowCount) of a and c and the columns
+	// [0, columnCount) of b and c. a has a row stride of aStride, b and c of columnStride.
+	template<uint32_t rowCount, uint32_t columnCount>
+	static void MatMulAddTile(const float* a, uint32_t aStride, uint32_t innerCount, const float* b, float* c, uint32_t columnStride)
+	{
+		float sums[c_TileRowCount][c_TileColumnCount];
+		for (uint32_t r = 0; r < rowCount; r++)
+		{
+			for (uint32_t k = 0; k < columnCount; k++) { sums[r][k] = c[(r * columnStride) + k]; }
+		}
+
+		for (uint32_t i = 0; i < innerCount; i++)
+		{
+			const float* bRow = b + (i * columnStride);
+			for (uint32_t r = 0; r < rowCount; r++)
+			{
+				const float aValue = a[(r * aStride) + i];
+				for (uint32_t k = 0; k < columnCount; k++) { sums[r][k] += aValue * bRow[k]; }
+			}
+		}
+
+		for (uint32_t r = 0; r < rowCount; r++)
+		{
+			for (uint32_t k = 0; k < columnCount; k++) { c[(r * columnStride) + k] = sums[r][k]; }
+		}
+	}
+
+	// Edge tiles with fewer rows or columns
+	static void MatMulAddEdge(const float* a, uint32_t aStride, uint32_t innerCount, const float* b, float* c, uint32_t columnStride, uint32_t rowCount, uint32_t columnCount)
+	{
+		for (uint32_t r = 0; r < rowCount; r++)
+		{
+			for (uint32_t i = 0; i < innerCount; i++)
+			{
+				const float aValue = a[(r * aStride) + i];
+				for (uint32_t k = 0; k < columnCount; k++) { c[(r * columnStride) + k] += aValue * b[(i * columnStride) + k]; }
+			}
+		}
+	}
+
+	// c += a b with a of rowCount x innerCount, b of innerCount x columnCount and c of rowCount x
+	// columnCount, all row major
+	static void MatMulAdd(const float* a, const float* b, float* c, uint32_t rowCount, uint32_t innerCount, uint32_t columnCount)
+	{
+		for (uint32_t r = 0; r < rowCount; r += c_TileRowCount)
+		{
+			const uint32_t tileRowCount = std::min(c_TileRowCount, rowCount - r);
+			for (uint32_t k = 0; k < columnCount; k += c_TileColumnCount)
+			{
+				const uint32_t tileColumnCount = std::min(c_TileColumnCount, columnCount - k);
+				const float* aTile = a + (r * innerCount);
+				float* cTile = c + (r * columnCount) + k;
+				if (tileRowCount == c_TileRowCount && tileColumnCount == c_TileColumnCount)
+				{
+					MatMulAddTile<c_TileRowCount, c_TileColumnCount>(aTile, innerCount, innerCount, b + k, cTile, columnCount);
+				}
+				else
+				{
+					MatMulAddEdge(aTile, innerCount, innerCount, b + k, cTile, columnCount, tileRowCount, tileColumnCount);
+				}
+			}
+		}
+	}
+
+	// c += a^T b with a of innerCount x rowCount, b of innerCount x columnCount and c of rowCount x
+	// columnCount, all row major. Used for the weight gradients, where a holds the layer inputs and b
+	// the output gradients of the samples.
+	static void MatMulTransposedAdd(const float* a, const float* b, float* c, uint32_t rowCount, uint32_t innerCount, uint32_t columnCount)
+	{
+		for (uint32_t r = 0; r < rowCount; r += c_TileRowCount)
+		{
+			const uint32_t tileRowCount = std::min(c_TileRowCount, rowCount - r);
+			for (uint32_t k = 0; k < columnCount; k += c_TileColumnCount)
+			{
+				const uint32_t tileColumnCount = std::min(c_TileColumnCount, columnCount - k);
+				float sums[c_TileRowCount][c_TileColumnCount] = {};
+				for (uint32_t i = 0; i < innerCount; i++)
+				{
+					const float* aRow = a + (i * rowCount) + r;
+					const float* bRow = b + (i * columnCount) + k;
+					if (tileRowCount == c_TileRowCount && tileColumnCount == c_TileColumnCount)
+					{
+						for (uint32_t tr = 0; tr < c_TileRowCount; tr++)
+						{
+							for (uint32_t tk = 0; tk < c_TileColumnCount; tk++) { sums[tr][tk] += aRow[tr] * bRow[tk]; }
+						}
+					}
+					else
+					{
+						for (uint32_t tr = 0; tr < tileRowCount; tr++)
+						{
+							for (uint32_t tk = 0; tk < tileColumnCount; tk++) { sums[tr][tk] += aRow[tr] * bRow[tk]; }
+						}
+					}
+				}
+
+				for (uint32_t tr = 0; tr < tileRowCount; tr++)
+				{
+					for (uint32_t tk = 0; tk < tileColumnCount; tk++) { c[((r + tr) * columnCount) + k + tk] += sums[tr][tk]; }
+				}
+			}
+		}
+	}
+
+	CpuMlp::CpuMlp(uint32_t inputCount, uint32_t outputCount, uint32_t width, uint32_t hiddenLayerCount)
+	{
+		size_t activationOffset = 0;
+		for (uint32_t i = 0; i <= hiddenLayerCount; i++)
+		{
+			Layer layer;
+			layer.inputCount = i == 0 ? inputCount : width;
+			layer.outputCount = i == hiddenLayerCount ? outputCount : width;
+			layer.paramOffset = m_ParamCount;
+			layer.activationOffset = activationOffset;
+			layer.transposedOffset = m_TransposedWeightCount;
+			m_Layers.push_back(layer);
+
+			m_ParamCount += (static_cast<size_t>(layer.inputCount) + 1) * layer.outputCount;
+			m_TransposedWeightCount += static_cast<size_t>(layer.inputCount) * layer.outputCount;
+			activationOffset += static_cast<size_t>(sc_BlockSize) * layer.inputCount;
+			m_DeltaCount = std::max(m_DeltaCount, static_cast<size_t>(sc_BlockSize) * std::max(layer.inputCount, layer.outputCount));
+		}
+		m_ActivationCount = activationOffset + (static_cast<size_t>(sc_BlockSize) * outputCount);
+	}
+
+	size_t CpuMlp::GetParamCount() const
+	{
+		return m_ParamCount;
+	}
+
+	void CpuMlp::InitParams(float* params, std::mt19937& rng) const
+	{
+		for (const Layer& layer : m_Layers)
+		{
+			const float limit = std::sqrt(6.0f / static_cast<float>(layer.inputCount + layer.outputCount));
+			std::uniform_real_distribution<float> dist(-limit, limit);
+
+			float* weights = params + layer.paramOffset;
+			const size_t weightCount = static_cast<size_t>(layer.inputCount) * layer.outputCount;
+			for (size_t i = 0; i < weightCount; i++) { weights[i] = dist(rng); }
+			std::fill(weights + weightCount, weights + weightCount + layer.outputCount, 0.0f);
+		}
+	}
+
+	size_t CpuMlp::GetActivationCount() const
+	{
+		return m_ActivationCount;
+	}
+
+	size_t CpuMlp::GetDeltaCount() const
+	{
+		return m_DeltaCount;
+	}
+
+	size_t CpuMlp::GetTransposedWeightCount() const
+	{
+		return m_TransposedWeightCount;
+	}
+
+	void CpuMlp::TransposeWeights(const float* params, float* transposedWeights) const
+	{
+		for (const Layer& layer : m_Layers)
+		{
+			const float* weights = params + layer.paramOffset;
+			float* transposed = transposedWeights + layer.transposedOffset;
+			for (uint32_t i = 0; i < layer.inputCount; i++)
+			{
+				for (uint32_t o = 0; o < layer.outputCount; o++) { transposed[(o * layer.inputCount) + i] = weights[(i * layer.outputCount) + o]; }
+			}
+		}
+	}
+
+	const float* CpuMlp::Forward(const float* params, float* activations, uint32_t count) const
+	{
+		for (size_t l = 0; l < m_Layers.size(); l++)
+		{
+			const Layer& layer = m_Layers[l];
+			const float* weights = params + layer.paramOffset;
+			const float* biases = weights + (static_cast<size_t>(layer.inputCount) * layer.outputCount);
+			const float* input = activations + layer.activationOffset;
+			float* output = activations + layer.activationOffset + (static_cast<size_t>(sc_BlockSize) * layer.inputCount);
+
+			for (uint32_t sample = 0; sample < count; sample++) { std::copy(biases, biases + layer.outputCount, output + (sample * layer.outputCount)); }
+			MatMulAdd(input, weights, output, count, layer.inputCount, layer.outputCount);
+
+			if (l + 1 < m_Layers.size())
+			{
+				for (uint32_t i = 0; i < count * layer.outputCount; i++) { output[i] = std::max(output[i], 0.0f); }
+			}
+		}
+
+		return activations + m_ActivationCount - (static_cast<size_t>(sc_BlockSize) * m_Layers.back().outputCount);
+	}
+
+	void CpuMlp::Backward(
+		const float* transposedWeights,
+		const float* activations,
+		float* dOutput,
+		float* scratch,
+		uint32_t count,
+		float* gradParams,
+		float* dInput) const
+	{
+		float* delta = dOutput;
+		float* nextDelta = scratch;
+		for (size_t l = m_Layers.size(); l-- > 0;)
+		{
+			const Layer& layer = m_Layers[l];
+			const size_t weightCount = static_cast<size_t>(layer.inputCount) * layer.outputCount;
+			float* weightGrads = gradParams + layer.paramOffset;
+			float* biasGrads = weightGrads + weightCount;
+			const float* input = activations + layer.activationOffset;
+
+			for (uint32_t sample = 0; sample < count; sample++)
+			{
+				const float* d = delta + (sample * layer.outputCount);
+				for (uint32_t o = 0; o < layer.outputCount; o++) { biasGrads[o] += d[o]; }
+			}
+			MatMulTransposedAdd(input, delta, weightGrads, layer.inputCount, count, layer.outputCount);
+
+			float* inputDelta = l > 0 ? nextDelta : dInput;
+			if (inputDelta == nullptr) { continue; }
+
+			std::fill(inputDelta, inputDelta + (count * layer.inputCount), 0.0f);
+			MatMulAdd(delta, transposedWeights + layer.transposedOffset, inputDelta, count, layer.outputCount, layer.inputCount);
+
+			// The input of a hidden layer is the output of a ReLU, which passes no gradient where it is 0
+			if (l > 0)
+			{
+				for (uint32_t i = 0; i < count * layer.inputCount; i++)
+				{
+					if (input[i] <= 0.0f) { inputDelta[i] = 0.0f; }
+				}
+			}
+
+			std::swap(delta, nextDelta);
+		}
+	}
+}
@@ -0,0 +1,247 @@
+#include <engine/graphics/CpuNrcBackend.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <random>
+
+namespace en
+{
+	// Added to the squared prediction of the relative losses like in tiny-cuda-nn
+	constexpr float c_RelativeLossEpsilon = 0.01f;
+
+	CpuNrcBackend::CpuNrcBackend(const AppConfig& appConfig, uint32_t inputCount, uint32_t outputCount) :
+		m_OutputCount(outputCount),
+		m_LossFn(ParseLossFn(appConfig.lossFn)),
+		m_LearningRate(appConfig.learningRate),
+		m_EmaDecay(appConfig.emaDecay),
+		m_Arena(appConfig.nrcThreadCount == 0 ? tbb::task_arena::automatic : static_cast<int>(appConfig.nrcThreadCount)),
+		m_Encoding(appConfig.encoding, GetBestPacketIsa()),
+		m_Mlp(m_Encoding.GetOutputCount(), outputCount, appConfig.nnWidth, appConfig.nnDepth)
+	{
+		if (inputCount != CpuNrcEncoding::sc_InputCount) { Log::Error("CpuNrcBackend requires " + std::to_string(CpuNrcEncoding::sc_InputCount) + " inputs", true); }
+		if (appConfig.optimizer != "Adam") { Log::Error("CpuNrcBackend only supports the Adam optimizer", true); }
+
+		const size_t paramCount = GetParamCount();
+		m_Params.resize(paramCount);
+		m_Gradients.resize(paramCount, 0.0f);
+		m_AdamM.resize(paramCount, 0.0f);
+		m_AdamV.resize(paramCount, 0.0f);
+
+		std::mt19937 rng(1337);
+		m_Encoding.InitParams(m_Params.data(), rng);
+		m_Mlp.InitParams(m_Params.data() + m_Encoding.GetParamCount(), rng);
+		m_EmaParams = m_Params;
+		m_TransposedWeights.resize(m_Mlp.GetTransposedWeightCount());
+
+		Log::Info(
+			"CpuNrcBackend: " + std::to_string(paramCount) + " parameters, " +
+			std::to_string(m_Encoding.GetOutputCount()) + " encoded inputs" + (m_Encoding.IsHashGridVectorized() ? " (avx2 hash grid), " : ", ") +
+			std::to_string(m_Arena.max_concurrency()) + " threads");
+	}
+
+	bool CpuNrcBackend::UsesHostMemory() const
+	{
+		return true;
+	}
+
+	void CpuNrcBackend::Inference(const float* input, float* output, uint32_t count)
+	{
+		const float* encodingParams = m_EmaParams.data();
+		const float* mlpParams = m_EmaParams.data() + m_Encoding.GetParamCount();
+		const uint32_t blockCount = (count + CpuMlp::sc_BlockSize - 1) / CpuMlp::sc_BlockSize;
+
+		m_Arena.execute([&]()
+			{
+				tbb::parallel_for(tbb::blocked_range<uint32_t>(0, blockCount), [&](const tbb::blocked_range<uint32_t>& range)
+					{
+						Workspace& workspace = GetWorkspace();
+						for (uint32_t block = range.begin(); block < range.end(); block++)
+						{
+							const uint32_t start = block * CpuMlp::sc_BlockSize;
+							const uint32_t blockSize = std::min(CpuMlp::sc_BlockSize, count - start);
+
+							m_Encoding.Encode(encodingParams, input + (start * CpuNrcEncoding::sc_InputCount), workspace.activations.data(), blockSize);
+							const float* prediction = m_Mlp.Forward(mlpParams, workspace.activations.data(), blockSize);
+							std::copy(prediction, prediction + (blockSize * m_OutputCount), output + (start * m_OutputCount));
+						}
+					});
+			});
+	}
+
+	void CpuNrcBackend::Train(const float* input, const float* target, uint32_t count)
+	{
+		const size_t encodingParamCount = m_Encoding.GetParamCount();
+		const size_t mlpParamCount = m_Mlp.GetParamCount();
+		const uint32_t encodedCount = m_Encoding.GetOutputCount();
+		const float* mlpParams = m_Params.data() + encodingParamCount;
+		const uint32_t blockCount = (count + CpuMlp::sc_BlockSize - 1) / CpuMlp::sc_BlockSize;
+
+		// Mean over every output of the batch
+		const float lossScale = 1.0f / static_cast<float>(count * m_OutputCount);
+
+		if (encodingParamCount > 0) { m_EncodedGradients.resize(static_cast<size_t>(count) * encodedCount); }
+		float* encodedGradients = encodingParamCount > 0 ? m_EncodedGradients.data() : nullptr;
+		m_Mlp.TransposeWeights(mlpParams, m_TransposedWeights.data());
+
+		float loss = 0.0f;
+		m_Arena.execute([&]()
+			{
+				for (std::vector<float>& gradients : m_MlpGradients) { std::fill(gradients.begin(), gradients.end(), 0.0f); }
+
+				// Forward and backward of the network, each thread sums the gradients of its blocks
+				loss = tbb::parallel_reduce(
+					tbb::blocked_range<uint32_t>(0, blockCount),
+					0.0f,
+					[&](const tbb::blocked_range<uint32_t>& range, float rangeLoss)
+					{
+						Workspace& workspace = GetWorkspace();
+						std::vector<float>& gradients = m_MlpGradients.local();
+						if (gradients.empty()) { gradients.resize(mlpParamCount, 0.0f); }
+
+						for (uint32_t block = range.begin(); block < range.end(); block++)
+						{
+							const uint32_t start = block * CpuMlp::sc_BlockSize;
+							const uint32_t blockSize = std::min(CpuMlp::sc_BlockSize, count - start);
+
+							m_Encoding.Encode(m_Params.data(), input + (start * CpuNrcEncoding::sc_InputCount), workspace.activations.data(), blockSize);
+							const float* prediction = m_Mlp.Forward(mlpParams, workspace.activations.data(), blockSize);
+							for (uint32_t sample = 0; sample < blockSize; sample++)
+							{
+								rangeLoss += EvalLoss(
+									prediction + (sample * m_OutputCount),
+									target + ((start + sample) * m_OutputCount),
+									lossScale,
+									workspace.deltas.data() + (sample * m_OutputCount));
+							}
+
+							m_Mlp.Backward(
+								m_TransposedWeights.data(),
+								workspace.activations.data(),
+								workspace.deltas.data(),
+								workspace.scratch.data(),
+								blockSize,
+								gradients.data(),
+								encodedGradients == nullptr ? nullptr : encodedGradients + (start * encodedCount));
+						}
+						return rangeLoss;
+					},
+					std::plus<float>());
+
+				tbb::parallel_for(tbb::blocked_range<size_t>(0, mlpParamCount), [&](const tbb::blocked_range<size_t>& range)
+					{
+						for (size_t i = range.begin(); i < range.end(); i++)
+						{
+							float gradient = 0.0f;
+							for (const std::vector<float>& gradients : m_MlpGradients) { gradient += gradients[i]; }
+							m_Gradients[encodingParamCount + i] = gradient;
+						}
+					});
+
+				if (encodedGradients != nullptr)
+				{
+					std::fill(m_Gradients.begin(), m_Gradients.begin() + encodingParamCount, 0.0f);
+					m_Encoding.Backward(input, encodedGradients, m_Gradients.data(), count);
+				}
+
+				OptimizerStep();
+			});
+
+		m_LastLoss = loss * lossScale;
+	}
+
+	float CpuNrcBackend::GetLastLoss()
+	{
+		return m_LastLoss;
+	}
+
+	size_t CpuNrcBackend::GetParamCount() const
+	{
+		return m_Encoding.GetParamCount() + m_Mlp.GetParamCount();
+	}
+
+	CpuNrcBackend::LossFn CpuNrcBackend::ParseLossFn(const std::string& name)
+	{
+		if (name == "L1") { return LossFn::L1; }
+		if (name == "L2") { return LossFn::L2; }
+		if (name == "RelativeL2") { return LossFn::RelativeL2; }
+		if (name == "RelativeL2Luminance") { return LossFn::RelativeL2Luminance; }
+		Log::Error("CpuNrcBackend loss has to be L1, L2, RelativeL2 or RelativeL2Luminance", true);
+		return LossFn::L2;
+	}
+
+	CpuNrcBackend::Workspace& CpuNrcBackend::GetWorkspace()
+	{
+		Workspace& workspace = m_Workspaces.local();
+		if (workspace.activations.empty())
+		{
+			workspace.activations.resize(m_Mlp.GetActivationCount());
+			workspace.deltas.resize(m_Mlp.GetDeltaCount());
+			workspace.scratch.resize(m_Mlp.GetDeltaCount());
+		}
+		return workspace;
+	}
+
+	float CpuNrcBackend::EvalLoss(const float* prediction, const float* target, float scale, float* dPrediction) const
+	{
+		// Relative losses divide by the prediction squared, which is treated as a constant in the gradient
+		const float luminance = (0.299f * prediction[0]) + (0.587f * prediction[1]) + (0.114f * prediction[2]);
+
+		float loss = 0.0f;
+		for (uint32_t i = 0; i < m_OutputCount; i++)
+		{
+			const float difference = prediction[i] - target[i];
+			switch (m_LossFn)
+			{
+			case LossFn::L1:
+				loss += std::abs(difference);
+				dPrediction[i] = scale * (difference > 0.0f ? 1.0f : (difference < 0.0f ? -1.0f : 0.0f));
+				break;
+			case LossFn::L2:
+				loss += difference * difference;
+				dPrediction[i] = scale * 2.0f * difference;
+				break;
+			case LossFn::RelativeL2:
+			case LossFn::RelativeL2Luminance:
+			{
+				const float normalization = m_LossFn == LossFn::RelativeL2
+					? (prediction[i] * prediction[i]) + c_RelativeLossEpsilon
+					: (luminance * luminance) + c_RelativeLossEpsilon;
+				loss += difference * difference / normalization;
+				dPrediction[i] = scale * 2.0f * difference / normalization;
+				break;
+			}
+			}
+		}
+		return loss;
+	}
+
+	void CpuNrcBackend::OptimizerStep()
+	{
+		m_Step++;
+		const double step = static_cast<double>(m_Step);
+		const float beta1Correction = static_cast<float>(1.0 - std::pow(sc_AdamBeta1, step));
+		const float beta2Correction = static_cast<float>(1.0 - std::pow(sc_AdamBeta2, step));
+
+		// The bias corrected average ema_t / (1 - decay^t) is updated directly, which weights the previous
+		// one by decay (1 - decay^(t - 1)) / (1 - decay^t) and the new parameters by the rest
+		const double emaCorrection = 1.0 - std::pow(static_cast<double>(m_EmaDecay), step);
+		const float emaNewWeight = static_cast<float>((1.0 - m_EmaDecay) / emaCorrection);
+		const float emaOldWeight = 1.0f - emaNewWeight;
+
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, m_Params.size()), [&](const tbb::blocked_range<size_t>& range)
+			{
+				for (size_t i = range.begin(); i < range.end(); i++)
+				{
+					const float gradient = m_Gradients[i];
+					m_AdamM[i] = (sc_AdamBeta1 * m_AdamM[i]) + ((1.0f - sc_AdamBeta1) * gradient);
+					m_AdamV[i] = (sc_AdamBeta2 * m_AdamV[i]) + ((1.0f - sc_AdamBeta2) * gradient * gradient);
+					m_Params[i] -= m_LearningRate * (m_AdamM[i] / beta1Correction) / (std::sqrt(m_AdamV[i] / beta2Correction) + sc_AdamEpsilon);
+					m_EmaParams[i] = (emaOldWeight * m_EmaParams[i]) + (emaNewWeight * m_Params[i]);
+				}
+			});
+	}
+}
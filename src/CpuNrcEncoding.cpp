@@ -0,0 +1,530 @@
+#include <engine/graphics/CpuNrcEncoding.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <cmath>
+
+// MSVC allows the intrinsics in any translation unit, other compilers need the NRC_HPM_AVX2 CMake option.
+// Without them EncodeHashGridAvx2 and AddHashGridGradientsAvx2 are declared but never defined or called.
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define EN_HASH_GRID_AVX2
+#include <immintrin.h>
+#endif
+
+namespace en
+{
+	constexpr float c_Pi = 3.14159265359f;
+
+	// Primes of the spatial hash of the tiny-cuda-nn grid encoding
+	constexpr uint32_t c_HashGridPrimes[3] = { 1u, 2654435761u, 805459861u };
+
+	// Integral of the quartic kernel 15/16 (1 - u^2)^2 with radius 1 / invRadius up to x
+	static float QuarticCdf(float x, float invRadius)
+	{
+		const float u = std::clamp(x * invRadius, -1.0f, 1.0f);
+		const float u2 = u * u;
+		return (15.0f / 16.0f * u * (1.0f - (2.0f / 3.0f * u2) + (0.2f * u2 * u2))) + 0.5f;
+	}
+
+	// 1 at integers and -1 halfway between them
+	static float TriangleWave(float x)
+	{
+		return std::abs((4.0f * (x - std::floor(x))) - 2.0f) - 1.0f;
+	}
+
+#if defined(EN_HASH_GRID_AVX2)
+	// Interpolation weights and entry indices of the 8 cell corners of 8 samples on one hash grid level
+	struct HashGridCornersAvx2
+	{
+		__m256 weight[8];
+		__m256i index[8];
+	};
+
+	// Gathers the position of 8 samples from inputs of inputStride floats, false if any of them lies
+	// outside of [0, 1]^3 or is nan
+	static bool LoadPositionsAvx2(const float* input, uint32_t inputStride, __m256 pos[3])
+	{
+		const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int32_t>(inputStride)));
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (uint32_t dim = 0; dim < 3; dim++)
+		{
+			pos[dim] = _mm256_i32gather_ps(input + dim, offsets, 4);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(pos[dim], _mm256_setzero_ps(), _CMP_GE_OQ));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(pos[dim], _mm256_set1_ps(1.0f), _CMP_LE_OQ));
+		}
+		return _mm256_movemask_ps(inside) == 0xFF;
+	}
+
+	// GetHashGridIndex and the weights of EncodeHashGrid for positions in [0, 1]^3
+	static void GetHashGridCornersAvx2(const __m256 pos[3], float scale, uint32_t resolution, uint32_t size, bool dense, HashGridCornersAvx2& corners)
+	{
+		__m256 frac[3];
+		__m256i cell[3];
+		for (uint32_t dim = 0; dim < 3; dim++)
+		{
+			const __m256 levelPos = _mm256_add_ps(_mm256_mul_ps(pos[dim], _mm256_set1_ps(scale)), _mm256_set1_ps(0.5f));
+			const __m256 cellPos = _mm256_floor_ps(levelPos);
+			frac[dim] = _mm256_sub_ps(levelPos, cellPos);
+			cell[dim] = _mm256_cvttps_epi32(cellPos);
+		}
+
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256i oneI = _mm256_set1_epi32(1);
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			__m256 weight = one;
+			__m256i coord[3];
+			for (uint32_t dim = 0; dim < 3; dim++)
+			{
+				const bool upper = ((corner >> dim) & 1) != 0;
+				weight = _mm256_mul_ps(weight, upper ? frac[dim] : _mm256_sub_ps(one, frac[dim]));
+				coord[dim] = upper ? _mm256_add_epi32(cell[dim], oneI) : cell[dim];
+			}
+			corners.weight[corner] = weight;
+
+			if (dense)
+			{
+				// Cells reach at most resolution along every axis, so the index stays below twice the
+				// size of at least resolution^3 and the modulo is one subtraction
+				const __m256i res = _mm256_set1_epi32(static_cast<int32_t>(resolution));
+				__m256i index = _mm256_add_epi32(coord[0], _mm256_mullo_epi32(_mm256_add_epi32(coord[1], _mm256_mullo_epi32(coord[2], res)), res));
+				const __m256i wrapped = _mm256_sub_epi32(index, _mm256_set1_epi32(static_cast<int32_t>(size)));
+				index = _mm256_blendv_epi8(index, wrapped, _mm256_cmpgt_epi32(index, _mm256_set1_epi32(static_cast<int32_t>(size - 1))));
+				corners.index[corner] = index;
+			}
+			else
+			{
+				__m256i hash = _mm256_mullo_epi32(coord[0], _mm256_set1_epi32(static_cast<int32_t>(c_HashGridPrimes[0])));
+				hash = _mm256_xor_si256(hash, _mm256_mullo_epi32(coord[1], _mm256_set1_epi32(static_cast<int32_t>(c_HashGridPrimes[1]))));
+				hash = _mm256_xor_si256(hash, _mm256_mullo_epi32(coord[2], _mm256_set1_epi32(static_cast<int32_t>(c_HashGridPrimes[2]))));
+				corners.index[corner] = _mm256_and_si256(hash, _mm256_set1_epi32(static_cast<int32_t>(size - 1)));
+			}
+		}
+	}
+
+	// Prefetches the entries of the corners of a level. Corners along x differ by 1 in the dense index
+	// and in the low bits of the hash (prime 1), so the even x corners cover most cache lines.
+	static void PrefetchHashGridCornersAvx2(const float* levelParams, const HashGridCornersAvx2& corners)
+	{
+		alignas(32) int32_t indices[8];
+		for (uint32_t corner = 0; corner < 8; corner += 2)
+		{
+			_mm256_store_si256(reinterpret_cast<__m256i*>(indices), corners.index[corner]);
+			for (uint32_t lane = 0; lane < 8; lane++)
+			{
+				_mm_prefetch(reinterpret_cast<const char*>(levelParams + (indices[lane] * 2)), _MM_HINT_T0);
+			}
+		}
+	}
+#endif
+
+	CpuNrcEncoding::CpuNrcEncoding(const AppConfig::NNEncodingConfig& config, PacketIsa isa) :
+		m_HashGridAvx2(false)
+	{
+#if defined(EN_HASH_GRID_AVX2)
+		m_HashGridAvx2 = isa != PacketIsa::Scalar && IsPacketIsaSupported(PacketIsa::Avx2);
+#else
+		static_cast<void>(isa);
+#endif
+
+		// Same parameters as the json config of NNEncodingConfig
+		switch (config.posID)
+		{
+		case 0:
+			AddPart(Type::HashGrid, 3, 0);
+			break;
+		case 1:
+			AddPart(Type::Identity, 3, 0);
+			break;
+		case 2:
+			AddPart(Type::TriangleWave, 3, 12);
+			break;
+		case 3:
+			AddPart(Type::Frequency, 3, 12);
+			break;
+		default:
+			Log::Error("CpuNrcEncoding posID is invalid", true);
+			break;
+		}
+
+		switch (config.dirID)
+		{
+		case 0:
+			AddPart(Type::OneBlob, 2, 4);
+			break;
+		case 1:
+			AddPart(Type::Identity, 2, 0);
+			break;
+		case 2:
+			AddPart(Type::TriangleWave, 2, 4);
+			break;
+		default:
+			Log::Error("CpuNrcEncoding dirID is invalid", true);
+			break;
+		}
+
+		// Smallest shift that puts every hash grid entry into one of the buckets
+		const size_t entryCount = m_ParamCount / sc_HashGridFeatureCount;
+		while ((entryCount >> m_HashGridBucketShift) >= sc_HashGridBucketCount) { m_HashGridBucketShift++; }
+	}
+
+	uint32_t CpuNrcEncoding::GetOutputCount() const
+	{
+		return m_OutputCount;
+	}
+
+	size_t CpuNrcEncoding::GetParamCount() const
+	{
+		return m_ParamCount;
+	}
+
+	void CpuNrcEncoding::InitParams(float* params, std::mt19937& rng) const
+	{
+		std::uniform_real_distribution<float> dist(-1e-4f, 1e-4f);
+		for (size_t i = 0; i < m_ParamCount; i++) { params[i] = dist(rng); }
+	}
+
+	void CpuNrcEncoding::Encode(const float* params, const float* input, float* output, uint32_t count) const
+	{
+		for (const Part& part : m_Parts)
+		{
+			if (part.type == Type::HashGrid) { EncodeHashGridBlock(part, params, input, output, count); }
+		}
+
+		for (uint32_t sample = 0; sample < count; sample++)
+		{
+			const float* sampleInput = input + (sample * sc_InputCount);
+			float* sampleOutput = output + (sample * m_OutputCount);
+
+			for (const Part& part : m_Parts)
+			{
+				const float* in = sampleInput + part.inputOffset;
+				float* out = sampleOutput + part.outputOffset;
+				const uint32_t frequencyCount = part.frequencyCount;
+
+				switch (part.type)
+				{
+				case Type::HashGrid:
+					break;
+				case Type::Identity:
+					for (uint32_t dim = 0; dim < part.inputCount; dim++) { out[dim] = in[dim]; }
+					break;
+				case Type::TriangleWave:
+					for (uint32_t dim = 0; dim < part.inputCount; dim++)
+					{
+						for (uint32_t f = 0; f < frequencyCount; f++)
+						{
+							out[(dim * frequencyCount) + f] = TriangleWave(std::ldexp(in[dim], static_cast<int>(f)));
+						}
+					}
+					break;
+				case Type::Frequency:
+					for (uint32_t dim = 0; dim < part.inputCount; dim++)
+					{
+						for (uint32_t f = 0; f < frequencyCount; f++)
+						{
+							const float x = std::ldexp(in[dim], static_cast<int>(f)) * c_Pi;
+							out[2 * ((dim * frequencyCount) + f)] = std::sin(x);
+							out[(2 * ((dim * frequencyCount) + f)) + 1] = std::cos(x);
+						}
+					}
+					break;
+				case Type::OneBlob:
+				{
+					// Bin k covers [k, k + 1) / binCount, the kernel is one bin wide
+					const float binCount = static_cast<float>(frequencyCount);
+					for (uint32_t dim = 0; dim < part.inputCount; dim++)
+					{
+						float leftCdf = QuarticCdf(-in[dim], binCount);
+						for (uint32_t bin = 0; bin < frequencyCount; bin++)
+						{
+							const float rightCdf = QuarticCdf((static_cast<float>(bin + 1) / binCount) - in[dim], binCount);
+							out[(dim * frequencyCount) + bin] = rightCdf - leftCdf;
+							leftCdf = rightCdf;
+						}
+					}
+					break;
+				}
+				}
+			}
+		}
+	}
+
+	void CpuNrcEncoding::Backward(const float* input, const float* dOutput, float* gradParams, uint32_t count)
+	{
+		for (const Part& part : m_Parts)
+		{
+			if (part.type != Type::HashGrid) { continue; }
+
+			// Chunks of samples keep the buckets of all threads in cache until they are added
+			for (uint32_t chunkStart = 0; chunkStart < count; chunkStart += sc_HashGridChunkSize)
+			{
+				const uint32_t chunkSize = std::min(sc_HashGridChunkSize, count - chunkStart);
+				for (HashGridBuckets& buckets : m_HashGridBuckets)
+				{
+					for (std::vector<HashGridGradient>& bucket : buckets) { bucket.clear(); }
+				}
+
+				// Groups of 8 samples for the AVX2 kernel
+				const uint32_t groupCount = (chunkSize + 7) / 8;
+				tbb::parallel_for(tbb::blocked_range<uint32_t>(0, groupCount), [&](const tbb::blocked_range<uint32_t>& range)
+					{
+						HashGridBuckets& buckets = m_HashGridBuckets.local();
+						if (buckets.empty()) { buckets.resize(sc_HashGridBucketCount); }
+
+						for (uint32_t group = range.begin(); group < range.end(); group++)
+						{
+							const uint32_t start = chunkStart + (group * 8);
+							const uint32_t groupSize = std::min(8u, count - start);
+							const float* groupInput = input + (start * sc_InputCount);
+							const float* groupDOutput = dOutput + (start * m_OutputCount);
+#if defined(EN_HASH_GRID_AVX2)
+							if (m_HashGridAvx2 && groupSize == 8 && AddHashGridGradientsAvx2(part, groupInput, groupDOutput, buckets)) { continue; }
+#endif
+							for (uint32_t sample = 0; sample < groupSize; sample++)
+							{
+								AddHashGridGradients(part, groupInput + (sample * sc_InputCount), groupDOutput + (sample * m_OutputCount), buckets);
+							}
+						}
+					});
+
+				tbb::parallel_for(0u, sc_HashGridBucketCount, [&](uint32_t bucket)
+					{
+						for (const HashGridBuckets& buckets : m_HashGridBuckets)
+						{
+							if (buckets.empty()) { continue; }
+							for (const HashGridGradient& gradient : buckets[bucket])
+							{
+								float* entryGrad = gradParams + (static_cast<size_t>(gradient.entry) * sc_HashGridFeatureCount);
+								for (uint32_t feature = 0; feature < sc_HashGridFeatureCount; feature++) { entryGrad[feature] += gradient.grad[feature]; }
+							}
+						}
+					});
+			}
+		}
+	}
+
+	bool CpuNrcEncoding::IsHashGridVectorized() const
+	{
+		return m_HashGridAvx2;
+	}
+
+	void CpuNrcEncoding::AddPart(Type type, uint32_t inputCount, uint32_t frequencyCount)
+	{
+		Part part;
+		part.type = type;
+		part.inputOffset = m_Parts.empty() ? 0 : m_Parts.back().inputOffset + m_Parts.back().inputCount;
+		part.inputCount = inputCount;
+		part.outputOffset = m_OutputCount;
+		part.frequencyCount = frequencyCount;
+
+		switch (type)
+		{
+		case Type::HashGrid:
+		{
+			// Level resolutions and sizes of the tiny-cuda-nn grid encoding
+			part.outputCount = sc_HashGridLevelCount * sc_HashGridFeatureCount;
+			const uint32_t maxSize = 1u << sc_HashGridLog2Size;
+			for (uint32_t levelIndex = 0; levelIndex < sc_HashGridLevelCount; levelIndex++)
+			{
+				HashGridLevel level;
+				level.scale = (std::exp2(static_cast<float>(levelIndex) * std::log2(sc_HashGridPerLevelScale)) * static_cast<float>(sc_HashGridBaseResolution)) - 1.0f;
+				level.resolution = static_cast<uint32_t>(std::ceil(level.scale)) + 1;
+				const uint64_t denseSize = static_cast<uint64_t>(level.resolution) * level.resolution * level.resolution;
+				level.dense = denseSize <= maxSize;
+				level.size = level.dense ? static_cast<uint32_t>(std::min<uint64_t>(((denseSize + 7) / 8) * 8, maxSize)) : maxSize;
+				level.paramOffset = m_ParamCount;
+				m_ParamCount += static_cast<size_t>(level.size) * sc_HashGridFeatureCount;
+				m_HashGridLevels.push_back(level);
+			}
+			break;
+		}
+		case Type::Identity:
+			part.outputCount = inputCount;
+			break;
+		case Type::Frequency:
+			part.outputCount = 2 * inputCount * frequencyCount;
+			break;
+		default:
+			part.outputCount = inputCount * frequencyCount;
+			break;
+		}
+
+		m_OutputCount += part.outputCount;
+		m_Parts.push_back(part);
+	}
+
+	uint32_t CpuNrcEncoding::GetHashGridIndex(const HashGridLevel& level, uint32_t x, uint32_t y, uint32_t z) const
+	{
+		if (level.dense) { return (x + (y * level.resolution) + (z * level.resolution * level.resolution)) % level.size; }
+		return ((x * c_HashGridPrimes[0]) ^ (y * c_HashGridPrimes[1]) ^ (z * c_HashGridPrimes[2])) & (level.size - 1);
+	}
+
+	void CpuNrcEncoding::EncodeHashGrid(const float* params, const float* input, float* output) const
+	{
+		for (uint32_t levelIndex = 0; levelIndex < sc_HashGridLevelCount; levelIndex++)
+		{
+			const HashGridLevel& level = m_HashGridLevels[levelIndex];
+			const float* levelParams = params + level.paramOffset;
+
+			float frac[3];
+			uint32_t cell[3];
+			for (uint32_t dim = 0; dim < 3; dim++)
+			{
+				const float pos = (input[dim] * level.scale) + 0.5f;
+				const float cellPos = std::floor(pos);
+				frac[dim] = pos - cellPos;
+				cell[dim] = static_cast<uint32_t>(static_cast<int32_t>(cellPos));
+			}
+
+			float features[sc_HashGridFeatureCount] = {};
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				float weight = 1.0f;
+				for (uint32_t dim = 0; dim < 3; dim++) { weight *= (corner >> dim) & 1 ? frac[dim] : 1.0f - frac[dim]; }
+
+				const uint32_t index = GetHashGridIndex(level, cell[0] + (corner & 1), cell[1] + ((corner >> 1) & 1), cell[2] + (corner >> 2));
+				for (uint32_t feature = 0; feature < sc_HashGridFeatureCount; feature++)
+				{
+					features[feature] += weight * levelParams[(index * sc_HashGridFeatureCount) + feature];
+				}
+			}
+
+			for (uint32_t feature = 0; feature < sc_HashGridFeatureCount; feature++)
+			{
+				output[(levelIndex * sc_HashGridFeatureCount) + feature] = features[feature];
+			}
+		}
+	}
+
+	void CpuNrcEncoding::EncodeHashGridBlock(const Part& part, const float* params, const float* input, float* output, uint32_t count) const
+	{
+		for (uint32_t start = 0; start < count; start += 8)
+		{
+			const uint32_t groupSize = std::min(8u, count - start);
+			const float* groupInput = input + (start * sc_InputCount);
+			float* groupOutput = output + (start * m_OutputCount);
+#if defined(EN_HASH_GRID_AVX2)
+			if (m_HashGridAvx2 && groupSize == 8 && EncodeHashGridAvx2(part, params, groupInput, groupOutput)) { continue; }
+#endif
+			for (uint32_t sample = 0; sample < groupSize; sample++)
+			{
+				EncodeHashGrid(params, groupInput + (sample * sc_InputCount) + part.inputOffset, groupOutput + (sample * m_OutputCount) + part.outputOffset);
+			}
+		}
+	}
+
+	void CpuNrcEncoding::AddHashGridGradients(const Part& part, const float* input, const float* dOutput, HashGridBuckets& buckets) const
+	{
+		const float* in = input + part.inputOffset;
+		for (uint32_t levelIndex = 0; levelIndex < sc_HashGridLevelCount; levelIndex++)
+		{
+			const HashGridLevel& level = m_HashGridLevels[levelIndex];
+			const uint32_t entryOffset = static_cast<uint32_t>(level.paramOffset / sc_HashGridFeatureCount);
+			const float* dOut = dOutput + part.outputOffset + (levelIndex * sc_HashGridFeatureCount);
+
+			float frac[3];
+			uint32_t cell[3];
+			for (uint32_t dim = 0; dim < 3; dim++)
+			{
+				const float pos = (in[dim] * level.scale) + 0.5f;
+				const float cellPos = std::floor(pos);
+				frac[dim] = pos - cellPos;
+				cell[dim] = static_cast<uint32_t>(static_cast<int32_t>(cellPos));
+			}
+
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				float weight = 1.0f;
+				for (uint32_t dim = 0; dim < 3; dim++) { weight *= (corner >> dim) & 1 ? frac[dim] : 1.0f - frac[dim]; }
+
+				HashGridGradient gradient;
+				gradient.entry = entryOffset + GetHashGridIndex(level, cell[0] + (corner & 1), cell[1] + ((corner >> 1) & 1), cell[2] + (corner >> 2));
+				for (uint32_t feature = 0; feature < sc_HashGridFeatureCount; feature++) { gradient.grad[feature] = weight * dOut[feature]; }
+				buckets[gradient.entry >> m_HashGridBucketShift].push_back(gradient);
+			}
+		}
+	}
+
+#if defined(EN_HASH_GRID_AVX2)
+	bool CpuNrcEncoding::EncodeHashGridAvx2(const Part& part, const float* params, const float* input, float* output) const
+	{
+		__m256 pos[3];
+		if (!LoadPositionsAvx2(input + part.inputOffset, sc_InputCount, pos)) { return false; }
+
+		// The corners of the next level are found and prefetched before the gathers of the current one
+		HashGridCornersAvx2 corners[2];
+		const HashGridLevel& firstLevel = m_HashGridLevels[0];
+		GetHashGridCornersAvx2(pos, firstLevel.scale, firstLevel.resolution, firstLevel.size, firstLevel.dense, corners[0]);
+
+		alignas(32) float features[sc_HashGridFeatureCount][8];
+		for (uint32_t levelIndex = 0; levelIndex < sc_HashGridLevelCount; levelIndex++)
+		{
+			const HashGridCornersAvx2& current = corners[levelIndex & 1];
+			if (levelIndex + 1 < sc_HashGridLevelCount)
+			{
+				const HashGridLevel& nextLevel = m_HashGridLevels[levelIndex + 1];
+				HashGridCornersAvx2& next = corners[(levelIndex + 1) & 1];
+				GetHashGridCornersAvx2(pos, nextLevel.scale, nextLevel.resolution, nextLevel.size, nextLevel.dense, next);
+				PrefetchHashGridCornersAvx2(params + nextLevel.paramOffset, next);
+			}
+
+			// Both features of an entry are gathered with a stride of 8 bytes
+			static_assert(sc_HashGridFeatureCount == 2);
+			const float* levelParams = params + m_HashGridLevels[levelIndex].paramOffset;
+			__m256 feature0 = _mm256_setzero_ps();
+			__m256 feature1 = _mm256_setzero_ps();
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				feature0 = _mm256_add_ps(feature0, _mm256_mul_ps(current.weight[corner], _mm256_i32gather_ps(levelParams, current.index[corner], 8)));
+				feature1 = _mm256_add_ps(feature1, _mm256_mul_ps(current.weight[corner], _mm256_i32gather_ps(levelParams + 1, current.index[corner], 8)));
+			}
+			_mm256_store_ps(features[0], feature0);
+			_mm256_store_ps(features[1], feature1);
+
+			for (uint32_t lane = 0; lane < 8; lane++)
+			{
+				float* out = output + (lane * m_OutputCount) + part.outputOffset + (levelIndex * sc_HashGridFeatureCount);
+				out[0] = features[0][lane];
+				out[1] = features[1][lane];
+			}
+		}
+
+		return true;
+	}
+
+	bool CpuNrcEncoding::AddHashGridGradientsAvx2(const Part& part, const float* input, const float* dOutput, HashGridBuckets& buckets) const
+	{
+		__m256 pos[3];
+		if (!LoadPositionsAvx2(input + part.inputOffset, sc_InputCount, pos)) { return false; }
+
+		const __m256i outputOffsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int32_t>(m_OutputCount)));
+		HashGridCornersAvx2 corners;
+		alignas(32) uint32_t entries[8];
+		alignas(32) float grads[sc_HashGridFeatureCount][8];
+		for (uint32_t levelIndex = 0; levelIndex < sc_HashGridLevelCount; levelIndex++)
+		{
+			const HashGridLevel& level = m_HashGridLevels[levelIndex];
+			GetHashGridCornersAvx2(pos, level.scale, level.resolution, level.size, level.dense, corners);
+
+			const float* dOut = dOutput + part.outputOffset + (levelIndex * sc_HashGridFeatureCount);
+			const __m256 dOut0 = _mm256_i32gather_ps(dOut, outputOffsets, 4);
+			const __m256 dOut1 = _mm256_i32gather_ps(dOut + 1, outputOffsets, 4);
+			const __m256i entryOffset = _mm256_set1_epi32(static_cast<int32_t>(level.paramOffset / sc_HashGridFeatureCount));
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				_mm256_store_si256(reinterpret_cast<__m256i*>(entries), _mm256_add_epi32(corners.index[corner], entryOffset));
+				_mm256_store_ps(grads[0], _mm256_mul_ps(corners.weight[corner], dOut0));
+				_mm256_store_ps(grads[1], _mm256_mul_ps(corners.weight[corner], dOut1));
+				for (uint32_t lane = 0; lane < 8; lane++)
+				{
+					buckets[entries[lane] >> m_HashGridBucketShift].push_back({ entries[lane], { grads[0][lane], grads[1][lane] } });
+				}
+			}
+		}
+
+		return true;
+	}
+#endif
+}
@@ -0,0 +1,323 @@
+#include <engine/objects/DensityGrid.hpp>
+#include <engine/util/Log.hpp>
+#include <engine/util/process_memory.hpp>
+#include <openvdb/openvdb.h>
+#include <openvdb/tree/LeafManager.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+namespace en
+{
+	DensityGrid DensityGrid::FromVDB(const std::string& fileName)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// Check if file exists
+		if (!std::filesystem::exists(fileName))
+			Log::Error(fileName + " does not exist", true);
+
+		// Load grids from file
+		Log::Info("Opening density VDB file");
+		openvdb::io::File file(fileName);
+		file.open();
+		openvdb::GridPtrVecPtr grids = file.getGrids();
+		file.close();
+
+		// Find density grid
+		openvdb::FloatGrid::Ptr densityGrid = nullptr;
+		for (size_t gridIdx = 0; gridIdx < grids->size(); gridIdx++)
+		{
+			openvdb::GridBase::Ptr gridBase = grids->at(gridIdx);
+			if (gridBase->isType<openvdb::FloatGrid>())
+			{
+				Log::Info("Found float grid");
+				for (auto metaIt = gridBase->beginMeta(); metaIt != gridBase->endMeta(); metaIt++)
+				{
+					Log::Info("\t" + metaIt->first + ": " + metaIt->second->str());
+				}
+				densityGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(gridBase);
+				break;
+			}
+		}
+
+		// Error check
+		if (densityGrid == nullptr) { en::Log::Error("No density volume found in vdb file", true); }
+
+		// Get size
+		const openvdb::Vec3i boxMin = densityGrid->metaValue<openvdb::Vec3i>("file_bbox_min");
+		const openvdb::Vec3i boxMax = densityGrid->metaValue<openvdb::Vec3i>("file_bbox_max");
+		const openvdb::Vec3i boxExtent = boxMax - boxMin + openvdb::Vec3i(1);
+		const openvdb::CoordBBox fileBBox(openvdb::Coord(boxMin), openvdb::Coord(boxMax));
+
+		// file_bbox also covers active voxels that are zero. Shrink it to the non-zero voxels, so that
+		// rays do not have to cross empty margins. Every thread grows its own box over a range of leaves.
+		using LeafManagerT = openvdb::tree::LeafManager<const openvdb::FloatTree>;
+		LeafManagerT leafManager(densityGrid->tree());
+		tbb::combinable<openvdb::CoordBBox> localBBox([]() { return openvdb::CoordBBox(); });
+
+		tbb::parallel_for(leafManager.leafRange(), [&](const LeafManagerT::LeafRange& range)
+			{
+				openvdb::CoordBBox& bbox = localBBox.local();
+				for (LeafManagerT::LeafRange::Iterator leafIt = range.begin(); leafIt; ++leafIt)
+				{
+					// Leaves that lie completely inside of the current box cannot grow it
+					if (bbox.isInside(leafIt->getNodeBoundingBox())) { continue; }
+					for (auto valIt = leafIt->cbeginValueOn(); valIt; ++valIt)
+					{
+						if (valIt.getValue() == 0.0f) { continue; }
+						const openvdb::Coord coord = valIt.getCoord();
+						if (fileBBox.isInside(coord)) { bbox.expand(coord); }
+					}
+				}
+			});
+
+		openvdb::CoordBBox activeBBox = localBBox.combine([](const openvdb::CoordBBox& a, openvdb::CoordBBox b)
+			{
+				b.expand(a);
+				return b;
+			});
+
+		openvdb::FloatTree::ValueOnCIter bboxTileIt = densityGrid->tree().cbeginValueOn();
+		bboxTileIt.setMaxDepth(openvdb::FloatTree::ValueOnCIter::LEAF_DEPTH - 1);
+		for (; bboxTileIt; ++bboxTileIt)
+		{
+			if (bboxTileIt.getValue() == 0.0f) { continue; }
+			openvdb::CoordBBox tileBBox;
+			bboxTileIt.getBoundingBox(tileBBox);
+			tileBBox.intersect(fileBBox);
+			if (!tileBBox.empty()) { activeBBox.expand(tileBBox); }
+		}
+
+		if (activeBBox.empty())
+		{
+			Log::Warn(fileName + " has no non-zero voxels, keeping file_bbox");
+			activeBBox = fileBBox;
+		}
+
+		const openvdb::Coord activeExtent = activeBBox.dim();
+		Log::Info(
+			"Trimmed file_bbox " + std::to_string(boxExtent.x()) + "x" + std::to_string(boxExtent.y()) + "x" + std::to_string(boxExtent.z()) +
+			" to non-zero voxels " + std::to_string(activeExtent.x()) + "x" + std::to_string(activeExtent.y()) + "x" + std::to_string(activeExtent.z()) +
+			" (" + std::to_string(100.0 * static_cast<double>(activeBBox.volume()) / static_cast<double>(fileBBox.volume())) + "% of the voxels)");
+
+		DensityGrid grid(activeExtent.x(), activeExtent.y(), activeExtent.z());
+		grid.m_IndexOffset = glm::ivec3(activeBBox.min().x(), activeBBox.min().y(), activeBBox.min().z());
+		grid.SetSourceBox(glm::ivec3(boxMin.x(), boxMin.y(), boxMin.z()), glm::uvec3(boxExtent.x(), boxExtent.y(), boxExtent.z()));
+		float* data = grid.GetData();
+
+		// Read active voxels from all leaf nodes in parallel. Leaves never overlap, so every thread
+		// writes a disjoint set of voxels.
+		tbb::combinable<float> localMaxVal([]() { return 0.0f; });
+
+		tbb::parallel_for(leafManager.leafRange(), [&](const LeafManagerT::LeafRange& range)
+			{
+				float& maxVal = localMaxVal.local();
+				for (LeafManagerT::LeafRange::Iterator leafIt = range.begin(); leafIt; ++leafIt)
+				{
+					for (auto valIt = leafIt->cbeginValueOn(); valIt; ++valIt)
+					{
+						const openvdb::Coord coord = valIt.getCoord();
+						if (!activeBBox.isInside(coord)) { continue; }
+
+						const float value = valIt.getValue();
+						maxVal = std::max(maxVal, value);
+
+						const openvdb::Coord local = coord - activeBBox.min();
+						data[grid.GetIndex(local.x(), local.y(), local.z())] = value;
+					}
+				}
+			});
+
+		// Active tiles above leaf level cover whole blocks of voxels. There are only a few of them,
+		// so they are collected serially and each block is filled in parallel over z.
+		openvdb::FloatTree::ValueOnCIter tileIt = densityGrid->tree().cbeginValueOn();
+		tileIt.setMaxDepth(openvdb::FloatTree::ValueOnCIter::LEAF_DEPTH - 1);
+		for (; tileIt; ++tileIt)
+		{
+			openvdb::CoordBBox tileBBox;
+			tileIt.getBoundingBox(tileBBox);
+			tileBBox.intersect(activeBBox);
+			if (tileBBox.empty()) { continue; }
+
+			const float value = tileIt.getValue();
+			localMaxVal.local() = std::max(localMaxVal.local(), value);
+
+			const openvdb::Coord tileMin = tileBBox.min() - activeBBox.min();
+			const openvdb::Coord tileMax = tileBBox.max() - activeBBox.min();
+			tbb::parallel_for(tileMin.z(), tileMax.z() + 1, [&](int z)
+				{
+					for (int y = tileMin.y(); y <= tileMax.y(); y++)
+					{
+						float* row = data + grid.GetIndex(0, y, z);
+						std::fill(row + tileMin.x(), row + tileMax.x() + 1, value);
+					}
+				});
+		}
+
+		grid.m_MaxValue = localMaxVal.combine([](float a, float b) { return std::max(a, b); });
+		if (grid.m_MaxValue != 0.0 && grid.m_MaxValue != 1.0) { Log::Error("VDB is not normalized", true); }
+
+		auto end = std::chrono::steady_clock::now();
+		const double elapsedMS = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+		Log::Info(
+			"Loaded " + fileName +
+			" (" + std::to_string(grid.m_Width) + "x" + std::to_string(grid.m_Height) + "x" + std::to_string(grid.m_Depth) + ")" +
+			" in " + std::to_string(elapsedMS) + "ms" +
+			" | Peak RSS: " + std::to_string(GetPeakRssMB()) + "MB");
+
+		return grid;
+	}
+
+	DensityGrid::DensityGrid(uint32_t width, uint32_t height, uint32_t depth) :
+		m_Width(width),
+		m_Height(height),
+		m_Depth(depth),
+		m_SourceExtent(width, height, depth),
+		m_Storage(static_cast<size_t>(width) * height * depth, 0.0f),
+		m_Data(m_Storage.data())
+	{
+	}
+
+	DensityGrid::DensityGrid(
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		float maxValue,
+		const glm::ivec3& indexOffset,
+		std::shared_ptr<MappedFile> mappedFile,
+		size_t byteOffset)
+		:
+		m_Width(width),
+		m_Height(height),
+		m_Depth(depth),
+		m_MaxValue(maxValue),
+		m_IndexOffset(indexOffset),
+		m_SourceOffset(indexOffset),
+		m_SourceExtent(width, height, depth),
+		m_MappedFile(std::move(mappedFile))
+	{
+		if (byteOffset % alignof(float) != 0 || byteOffset + GetSizeInBytes() > m_MappedFile->GetSize())
+		{
+			Log::Error("DensityGrid does not fit into the mapped file", true);
+		}
+		m_Data = reinterpret_cast<float*>(m_MappedFile->GetData() + byteOffset);
+	}
+
+	DensityGrid::DensityGrid(const DensityGrid& other) :
+		m_Width(other.m_Width),
+		m_Height(other.m_Height),
+		m_Depth(other.m_Depth),
+		m_MaxValue(other.m_MaxValue),
+		m_IndexOffset(other.m_IndexOffset),
+		m_SourceOffset(other.m_SourceOffset),
+		m_SourceExtent(other.m_SourceExtent),
+		m_Storage(other.m_Data, other.m_Data + other.GetVoxelCount()),
+		m_Data(m_Storage.data())
+	{
+	}
+
+	DensityGrid& DensityGrid::operator=(const DensityGrid& other)
+	{
+		if (this != &other) { *this = DensityGrid(other); }
+		return *this;
+	}
+
+	uint32_t DensityGrid::GetWidth() const
+	{
+		return m_Width;
+	}
+
+	uint32_t DensityGrid::GetHeight() const
+	{
+		return m_Height;
+	}
+
+	uint32_t DensityGrid::GetDepth() const
+	{
+		return m_Depth;
+	}
+
+	size_t DensityGrid::GetVoxelCount() const
+	{
+		return static_cast<size_t>(m_Width) * m_Height * m_Depth;
+	}
+
+	size_t DensityGrid::GetSizeInBytes() const
+	{
+		return GetVoxelCount() * sizeof(float);
+	}
+
+	float DensityGrid::GetMaxValue() const
+	{
+		return m_MaxValue;
+	}
+
+	const glm::ivec3& DensityGrid::GetIndexOffset() const
+	{
+		return m_IndexOffset;
+	}
+
+	const glm::ivec3& DensityGrid::GetSourceOffset() const
+	{
+		return m_SourceOffset;
+	}
+
+	const glm::uvec3& DensityGrid::GetSourceExtent() const
+	{
+		return m_SourceExtent;
+	}
+
+	void DensityGrid::SetSourceBox(const glm::ivec3& sourceOffset, const glm::uvec3& sourceExtent)
+	{
+		m_SourceOffset = sourceOffset;
+		m_SourceExtent = sourceExtent;
+	}
+
+	float* DensityGrid::GetData()
+	{
+		return m_Data;
+	}
+
+	const float* DensityGrid::GetData() const
+	{
+		return m_Data;
+	}
+
+	size_t DensityGrid::GetIndex(uint32_t x, uint32_t y, uint32_t z) const
+	{
+		return static_cast<size_t>(x) + static_cast<size_t>(m_Width) * (static_cast<size_t>(y) + static_cast<size_t>(m_Height) * z);
+	}
+
+	float DensityGrid::GetValue(uint32_t x, uint32_t y, uint32_t z) const
+	{
+		return m_Data[GetIndex(x, y, z)];
+	}
+	float DensityGrid::SampleNearest(float u, float v, float w) const
+	{
+		if (u < 0.0f || v < 0.0f || w < 0.0f || u >= 1.0f || v >= 1.0f || w >= 1.0f) { return 0.0f; }
+
+		const uint32_t x = std::min(static_cast<uint32_t>(u * static_cast<float>(m_Width)), m_Width - 1);
+		const uint32_t y = std::min(static_cast<uint32_t>(v * static_cast<float>(m_Height)), m_Height - 1);
+		const uint32_t z = std::min(static_cast<uint32_t>(w * static_cast<float>(m_Depth)), m_Depth - 1);
+		return m_Data[GetIndex(x, y, z)];
+	}
+
+	float DensityGrid::SampleTrilinear(float u, float v, float w) const
+	{
+		const glm::vec3 extent(m_Width, m_Height, m_Depth);
+		const glm::vec3 pos = glm::clamp((glm::vec3(u, v, w) * extent) - 0.5f, glm::vec3(0.0f), extent - 1.0f);
+		const glm::uvec3 c0(pos);
+		const glm::uvec3 c1 = glm::min(c0 + 1u, glm::uvec3(m_Width - 1, m_Height - 1, m_Depth - 1));
+		const glm::vec3 f = pos - glm::vec3(c0);
+
+		const float v00 = glm::mix(GetValue(c0.x, c0.y, c0.z), GetValue(c1.x, c0.y, c0.z), f.x);
+		const float v10 = glm::mix(GetValue(c0.x, c1.y, c0.z), GetValue(c1.x, c1.y, c0.z), f.x);
+		const float v01 = glm::mix(GetValue(c0.x, c0.y, c1.z), GetValue(c1.x, c0.y, c1.z), f.x);
+		const float v11 = glm::mix(GetValue(c0.x, c1.y, c1.z), GetValue(c1.x, c1.y, c1.z), f.x);
+		return glm::mix(glm::mix(v00, v10, f.y), glm::mix(v01, v11, f.y), f.z);
+	}
+}
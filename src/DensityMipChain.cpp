@@ -0,0 +1,107 @@
+#include <engine/objects/DensityMipChain.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <chrono>
+
+namespace en
+{
+	// Every target voxel averages its 2x2x2 children. Children outside of src count as 0, so the
+	// result is the mean over the whole block at every level.
+	static void DownsampleMean(const DensityGrid& src, DensityGrid& dst)
+	{
+		tbb::parallel_for(0u, dst.GetDepth(), [&](uint32_t z)
+			{
+				for (uint32_t y = 0; y < dst.GetHeight(); y++)
+				{
+					for (uint32_t x = 0; x < dst.GetWidth(); x++)
+					{
+						float sum = 0.0f;
+						for (uint32_t cz = 2 * z; cz < std::min(2 * z + 2, src.GetDepth()); cz++)
+						{
+							for (uint32_t cy = 2 * y; cy < std::min(2 * y + 2, src.GetHeight()); cy++)
+							{
+								for (uint32_t cx = 2 * x; cx < std::min(2 * x + 2, src.GetWidth()); cx++)
+								{
+									sum += src.GetValue(cx, cy, cz);
+								}
+							}
+						}
+						dst.GetData()[dst.GetIndex(x, y, z)] = sum * 0.125f;
+					}
+				}
+			});
+	}
+
+	glm::uvec3 DensityMipChain::GetLevelExtent(const glm::uvec3& voxelExtent, uint32_t levelCount, uint32_t level)
+	{
+		const uint32_t padding = 1u << (levelCount - 1);
+		const glm::uvec3 firstExtent = (((voxelExtent + 1u) / 2u) + padding - 1u) / padding * padding;
+		return firstExtent / (1u << (level - 1));
+	}
+
+	DensityMipChain::DensityMipChain(const DensityGrid& densityGrid, uint32_t levelCount)
+	{
+		if (levelCount == 0 || levelCount > sc_MaxLevelCount) { Log::Error("DensityMipChain level count is out of range", true); }
+
+		auto start = std::chrono::steady_clock::now();
+
+		const glm::uvec3 voxelExtent(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth());
+		m_Levels.reserve(levelCount);
+		for (uint32_t level = 1; level <= levelCount; level++)
+		{
+			const glm::uvec3 extent = GetLevelExtent(voxelExtent, levelCount, level);
+			DensityGrid grid(extent.x, extent.y, extent.z);
+			DownsampleMean(level == 1 ? densityGrid : m_Levels.back(), grid);
+			m_Levels.push_back(std::move(grid));
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		const double elapsedMS = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+		Log::Info(
+			"Built density mip chain with " + std::to_string(levelCount) + " levels (" +
+			std::to_string(static_cast<double>(GetSizeInBytes()) / (1024.0 * 1024.0)) + "MB) in " +
+			std::to_string(elapsedMS) + "ms");
+	}
+
+	DensityMipChain::DensityMipChain(std::vector<DensityGrid> levels) :
+		m_Levels(std::move(levels))
+	{
+		if (m_Levels.empty() || m_Levels.size() > sc_MaxLevelCount) { Log::Error("DensityMipChain level count is out of range", true); }
+		for (size_t i = 1; i < m_Levels.size(); i++)
+		{
+			if (m_Levels[i].GetWidth() != m_Levels[i - 1].GetWidth() / 2 ||
+				m_Levels[i].GetHeight() != m_Levels[i - 1].GetHeight() / 2 ||
+				m_Levels[i].GetDepth() != m_Levels[i - 1].GetDepth() / 2)
+			{
+				Log::Error("DensityMipChain levels do not form a mip chain", true);
+			}
+		}
+	}
+
+	uint32_t DensityMipChain::GetLevelCount() const
+	{
+		return static_cast<uint32_t>(m_Levels.size());
+	}
+
+	const DensityGrid& DensityMipChain::GetLevel(uint32_t level) const
+	{
+		return m_Levels[level - 1];
+	}
+
+	const std::vector<DensityGrid>& DensityMipChain::GetLevels() const
+	{
+		return m_Levels;
+	}
+
+	size_t DensityMipChain::GetSizeInBytes() const
+	{
+		size_t size = 0;
+		for (const DensityGrid& level : m_Levels) { size += level.GetSizeInBytes(); }
+		return size;
+	}
+
+	float DensityMipChain::GetValue(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const
+	{
+		return GetLevel(level).GetValue(x >> level, y >> level, z >> level);
+	}
+}
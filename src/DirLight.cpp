@@ -1,22 +1,7 @@
 #include <engine/graphics/DirLight.hpp>
-
-#ifndef GLM_ENABLE_EXPERIMENTAL
-#define GLM_ENABLE_EXPERIMENTAL
-#endif // !GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/transform.hpp>
+#include <engine/HpmSceneSetup.hpp>
 #include <imgui.h>
 
-glm::vec3 VecFromAngles(float zenith, float azimuth)
-{
-	// construct using vec4, discards w.
-	return glm::vec3(
-		// azimuth starts at positive x.
-		glm::rotate(azimuth, glm::vec3(0.0f, 1.0f, 0.0f)) *
-		glm::rotate(zenith, glm::vec3(1.0f, 0.0f, 0.0f)) *
-		glm::vec4(0, 1, 0, 1)
-	);
-}
-
 namespace en
 {
 	VkDescriptorSetLayout DirLight::m_DescriptorSetLayout;
@@ -141,6 +126,11 @@ namespace en
 		return m_DirLightData.m_Azimuth;
 	}
 
+	glm::vec3 DirLight::GetDir() const
+	{
+		return m_DirLightData.m_Dir;
+	}
+
 	void DirLight::SetZenith(float z)
 	{
 		m_DirLightData.m_Zenith = z;
@@ -35,10 +35,18 @@ namespace en
 		cdfYBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 		cdfYBinding.pImmutableSamplers = nullptr;
 
+		VkDescriptorSetLayoutBinding aliasTableBinding;
+		aliasTableBinding.binding = 3;
+		aliasTableBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		aliasTableBinding.descriptorCount = 1;
+		aliasTableBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		aliasTableBinding.pImmutableSamplers = nullptr;
+
 		std::vector<VkDescriptorSetLayoutBinding> bindings = { 
 			hdrTexBinding, 
 			cdfXBinding,
-			cdfYBinding
+			cdfYBinding,
+			aliasTableBinding
 		};
 
 		VkDescriptorSetLayoutCreateInfo layoutCI;
@@ -56,7 +64,11 @@ namespace en
 		imagePoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 		imagePoolSize.descriptorCount = 3;
 
-		std::vector<VkDescriptorPoolSize> poolSizes = { imagePoolSize };
+		VkDescriptorPoolSize storagePoolSize;
+		storagePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		storagePoolSize.descriptorCount = 1;
+
+		std::vector<VkDescriptorPoolSize> poolSizes = { imagePoolSize, storagePoolSize };
 
 		VkDescriptorPoolCreateInfo poolCI;
 		poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -87,7 +99,8 @@ namespace en
 		uint32_t height, 
 		const std::vector<float>& hdr4f,
 		const std::vector<float>& cdfX,
-		const std::vector<float>& cdfY)
+		const std::vector<float>& cdfY,
+		const AliasTable& aliasTable)
 		:
 		m_Strength(strength),
 		m_Width(width),
@@ -95,7 +108,12 @@ namespace en
 		m_RawColorSize(width * height * 4 * sizeof(float)),
 		m_RawCdfXSize(width * height * sizeof(float)),
 		m_RawCdfYSize(height * sizeof(float)),
-		m_ColorImageLayout(VK_IMAGE_LAYOUT_PREINITIALIZED)
+		m_ColorImageLayout(VK_IMAGE_LAYOUT_PREINITIALIZED),
+		m_AliasTableBuffer(
+			aliasTable.GetSize() * sizeof(AliasTable::Entry),
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			{})
 	{
 		VkDevice device = VulkanAPI::GetDevice();
 		VkQueue queue = VulkanAPI::GetGraphicsQueue();
@@ -104,6 +122,7 @@ namespace en
 		CreateColorImage(device, queue, hdr4f);
 		CreateCdfXImage(device, queue, cdfX);
 		CreateCdfYImage(device, queue, cdfY);
+		UploadAliasTable(aliasTable);
 
 		// Create Sampler
 		VkFilter filter = VK_FILTER_LINEAR;
@@ -195,7 +214,24 @@ namespace en
 		cdfYWrite.pBufferInfo = nullptr;
 		cdfYWrite.pTexelBufferView = nullptr;
 
-		std::vector<VkWriteDescriptorSet> writes = { hdrTexWrite, cdfXWrite, cdfYWrite };
+		VkDescriptorBufferInfo aliasTableBufferInfo;
+		aliasTableBufferInfo.buffer = m_AliasTableBuffer.GetVulkanHandle();
+		aliasTableBufferInfo.offset = 0;
+		aliasTableBufferInfo.range = m_AliasTableBuffer.GetUsedSize();
+
+		VkWriteDescriptorSet aliasTableWrite;
+		aliasTableWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		aliasTableWrite.pNext = nullptr;
+		aliasTableWrite.dstSet = m_DescSet;
+		aliasTableWrite.dstBinding = 3;
+		aliasTableWrite.dstArrayElement = 0;
+		aliasTableWrite.descriptorCount = 1;
+		aliasTableWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		aliasTableWrite.pImageInfo = nullptr;
+		aliasTableWrite.pBufferInfo = &aliasTableBufferInfo;
+		aliasTableWrite.pTexelBufferView = nullptr;
+
+		std::vector<VkWriteDescriptorSet> writes = { hdrTexWrite, cdfXWrite, cdfYWrite, aliasTableWrite };
 
 		vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, nullptr);
 	}
@@ -206,6 +242,8 @@ namespace en
 
 		vkDestroySampler(device, m_Sampler, nullptr);
 
+		m_AliasTableBuffer.Destroy();
+
 		vkFreeMemory(device, m_CdfYImageMemory, nullptr);
 		vkDestroyImageView(device, m_CdfYImageView, nullptr);
 		vkDestroyImage(device, m_CdfYImage, nullptr);
@@ -599,6 +637,22 @@ namespace en
 		commandPool.Destroy();
 	}
 
+	void HdrEnvMap::UploadAliasTable(const AliasTable& aliasTable)
+	{
+		const VkDeviceSize size = m_AliasTableBuffer.GetUsedSize();
+
+		vk::Buffer stagingBuffer(
+			size,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			{});
+		stagingBuffer.SetData(size, aliasTable.GetEntries().data(), 0, 0);
+
+		vk::Buffer::Copy(&stagingBuffer, &m_AliasTableBuffer, size);
+
+		stagingBuffer.Destroy();
+	}
+
 	void HdrEnvMap::ChangeColorImageLayout(VkImageLayout layout, VkCommandBuffer commandBuffer, VkQueue queue)
 	{
 		VkAccessFlags srcAccessMask;
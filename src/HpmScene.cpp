@@ -1,5 +1,7 @@
 #include <engine/HpmScene.hpp>
 #include <engine/util/read_file.hpp>
+#include <engine/util/Log.hpp>
+#include <chrono>
 
 namespace en
 {
@@ -25,24 +27,178 @@ namespace en
 		m_Dynamic(appConfig.scene.dynamic)
 	{
 		// Lighting
-		m_DirLight = new DirLight(-1.57f, 0.0f, glm::vec3(1.0f), appConfig.scene.dirLightStrength);
+		m_DirLight = new DirLight(sc_DirLightZenith, sc_DirLightAzimuth, glm::vec3(1.0f), appConfig.scene.dirLightStrength);
 		
-		m_PointLight = new PointLight(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f), appConfig.scene.pointLightStrength);
+		m_PointLight = new PointLight(sc_PointLightPos, sc_PointLightColor, appConfig.scene.pointLightStrength);
 
 		int hdrWidth, hdrHeight;
-		std::vector<float> hdr4fData = en::ReadFileHdr4f(appConfig.scene.hdrEnvMapPath, hdrWidth, hdrHeight, 10000.0f);
+		std::vector<float> hdr4fData = en::ReadFileHdr4f(
+			appConfig.scene.hdrEnvMapPath,
+			hdrWidth,
+			hdrHeight,
+			sc_HdrEnvMapMaxValue,
+			appConfig.hdrEnvMapTestOverwrite);
 		std::array<std::vector<float>, 2> hdrCdf = en::Hdr4fToCdf(hdr4fData, hdrWidth, hdrHeight);
+		AliasTable hdrAliasTable = en::Hdr4fToAliasTable(hdr4fData, hdrWidth, hdrHeight);
 		m_HdrEnvMap = new HdrEnvMap(
 			appConfig.scene.hdrEnvMapStrength,
 			hdrWidth,
 			hdrHeight,
 			hdr4fData,
 			hdrCdf[0],
-			hdrCdf[1]);
+			hdrCdf[1],
+			hdrAliasTable);
+
+		// Load data. Cached grids are mapped, so the texture upload reads them straight from the file.
+		// The density is uploaded as sparse brick atlas, see BrickGrid.
+		m_VolumeCache = new VolumeCache(sc_DensityFilePath);
+		const DensityGrid& densityGrid = m_VolumeCache->GetDensityGrid();
+		const BrickGrid& brickGrid = m_VolumeCache->GetBrickGrid();
+		m_Density3DTex = new vk::Texture3D(
+			brickGrid.GetAtlas(),
+			appConfig.scene.densityFormat,
+			VK_FILTER_NEAREST,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		m_Majorant3DTex = new vk::Texture3D(
+			m_VolumeCache->GetMajorantGrid().GetGrid(),
+			VK_FORMAT_R32_SFLOAT,
+			VK_FILTER_NEAREST,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		const glm::uvec3 brickCount = brickGrid.GetBrickCount();
+		m_BrickIndex3DTex = new vk::Texture3D(
+			brickCount.x,
+			brickCount.y,
+			brickCount.z,
+			VK_FORMAT_R32_UINT,
+			brickGrid.GetBrickIndices().data(),
+			VK_FILTER_NEAREST,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		m_DensityMip3DTex = new vk::Texture3D(
+			m_VolumeCache->GetDensityMipChain().GetLevels(),
+			appConfig.scene.densityFormat,
+			VK_FILTER_NEAREST,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		const OccupancyGrid& occupancyGrid = m_VolumeCache->GetOccupancyGrid();
+		const glm::uvec3 maskExtent = occupancyGrid.GetMaskExtent();
+		m_Occupancy3DTex = new vk::Texture3D(
+			maskExtent.x,
+			maskExtent.y,
+			maskExtent.z,
+			VK_FORMAT_R32_UINT,
+			occupancyGrid.GetMask().data(),
+			VK_FILTER_NEAREST,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		m_Minorant3DTex = new vk::Texture3D(
+			occupancyGrid.GetMinGrid(),
+			VK_FORMAT_R32_SFLOAT,
+			VK_FILTER_NEAREST,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		if (appConfig.shadowTransmittance.dirLight == TransmittanceMode::Cached)
+		{
+			m_DirLightTransmittanceGrid = new TransmittanceGrid(
+				m_VolumeCache->GetDensityMipChain(),
+				glm::uvec3(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth()),
+				VolumeData::GetSize(densityGrid),
+				appConfig.scene.density);
+			auto start = std::chrono::steady_clock::now();
+			m_DirLightTransmittanceGrid->BuildDirLight(-m_DirLight->GetDir());
+			auto end = std::chrono::steady_clock::now();
+			Log::Info("Built dir light transmittance grid in " + std::to_string(std::chrono::duration<double, std::milli>(end - start).count()) + "ms");
+
+			// Half floats are filterable on every device, unlike R32_SFLOAT
+			m_DirLightTransmittance3DTex = new vk::Texture3D(
+				m_DirLightTransmittanceGrid->GetGrid(),
+				VK_FORMAT_R16_SFLOAT,
+				VK_FILTER_LINEAR,
+				VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+				VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		}
+		else
+		{
+			DensityGrid unshadowed(1, 1, 1);
+			unshadowed.GetData()[0] = 1.0f;
+			m_DirLightTransmittance3DTex = new vk::Texture3D(
+				unshadowed,
+				VK_FORMAT_R16_SFLOAT,
+				VK_FILTER_LINEAR,
+				VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+				VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		}
+		if (appConfig.shadowTransmittance.pointLight == TransmittanceMode::Cached)
+		{
+			m_PointLightTransmittanceGrid = new SphericalTransmittanceGrid(
+				m_VolumeCache->GetDensityMipChain(),
+				glm::uvec3(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth()),
+				VolumeData::GetSize(densityGrid),
+				VolumeData::GetPosition(densityGrid),
+				appConfig.scene.density);
+			auto start = std::chrono::steady_clock::now();
+			m_PointLightTransmittanceGrid->BuildPointLight(m_PointLight->GetPos());
+			auto end = std::chrono::steady_clock::now();
+			Log::Info("Built point light transmittance grid in " + std::to_string(std::chrono::duration<double, std::milli>(end - start).count()) + "ms");
 
-		// Load data
-		m_Density3DTex = new vk::Texture3D(vk::Texture3D::FromVDB("data/volume/wdas_cloud_quarter.vdb"));
-		m_VolumeData = new VolumeData(m_Density3DTex, appConfig.scene.density, 0.8f);
+			m_PointLightTransmittance3DTex = new vk::Texture3D(
+				m_PointLightTransmittanceGrid->GetGrid(),
+				VK_FORMAT_R16_SFLOAT,
+				VK_FILTER_LINEAR,
+				VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+				VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		}
+		else
+		{
+			DensityGrid unshadowed(1, 1, 1);
+			unshadowed.GetData()[0] = 1.0f;
+			m_PointLightTransmittance3DTex = new vk::Texture3D(
+				unshadowed,
+				VK_FORMAT_R16_SFLOAT,
+				VK_FILTER_LINEAR,
+				VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+				VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+		}
+		const PhaseFunction phaseFunction = CreatePhaseFunction(appConfig.phaseFunc, sc_VolumeG);
+		m_VolumeData = new VolumeData(
+			m_Density3DTex,
+			m_Majorant3DTex,
+			m_BrickIndex3DTex,
+			m_DensityMip3DTex,
+			m_Occupancy3DTex,
+			m_Minorant3DTex,
+			m_DirLightTransmittance3DTex,
+			m_PointLightTransmittance3DTex,
+			{ densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth() },
+			GetVolumeSize(densityGrid),
+			GetVolumePosition(densityGrid),
+			appConfig.scene.density,
+			phaseFunction,
+			appConfig.densityLodMode,
+			appConfig.densityLodSpread,
+			appConfig.traversalStats,
+			appConfig.shadowTransmittance,
+			appConfig.freeFlightMode);
+
+		const double denseSizeMB =
+			static_cast<double>(densityGrid.GetVoxelCount() * vk::Texture3D::GetTexelSize(appConfig.scene.densityFormat)) / (1024.0 * 1024.0);
+		const double sparseSizeMB =
+			static_cast<double>(m_Density3DTex->GetRealSizeInBytes() + m_BrickIndex3DTex->GetRealSizeInBytes()) / (1024.0 * 1024.0);
+		Log::Info(
+			"Sparse density uses " + std::to_string(sparseSizeMB) + "MB instead of " + std::to_string(denseSizeMB) +
+			"MB (" + std::to_string(100.0 * sparseSizeMB / denseSizeMB) + "%)");
+
+		// Transmittance uploads, the fence starts signaled because nothing was uploaded yet
+		m_UploadCommandPool = new vk::CommandPool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, VulkanAPI::GetGraphicsQFI());
+		m_UploadCommandPool->AllocateBuffers(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+		VkFenceCreateInfo fenceCI{};
+		fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceCI.pNext = nullptr;
+		fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		ASSERT_VULKAN(vkCreateFence(VulkanAPI::GetDevice(), &fenceCI, nullptr, &m_UploadFence));
 
 		// Store desc sets
 		m_DescSets = {
@@ -55,17 +211,58 @@ namespace en
 
 	void HpmScene::Update(float deltaTime)
 	{
-		if (!m_Dynamic) { return; }
-		switch (m_ID)
+		if (m_Dynamic)
 		{
-		case 3:
-			m_DirLight->SetAzimuth(std::fmod(m_DirLight->GetAzimuth() + (deltaTime * 0.5f), 2.0f * 3.141));
-			break;
-		case 4:
-			break;
-		default:
-			break;
+			switch (m_ID)
+			{
+			case 3:
+				m_DirLight->SetAzimuth(std::fmod(m_DirLight->GetAzimuth() + (deltaTime * 0.5f), 2.0f * 3.141));
+				break;
+			case 4:
+				break;
+			default:
+				break;
+			}
 		}
+
+		// The lights also move when they are edited in the ui
+		const bool dirLightMoved =
+			m_DirLightTransmittanceGrid != nullptr && -m_DirLight->GetDir() != m_DirLightTransmittanceGrid->GetLightDir();
+		const bool pointLightMoved =
+			m_PointLightTransmittanceGrid != nullptr && m_PointLight->GetPos() != m_PointLightTransmittanceGrid->GetLightPos();
+		if (!dirLightMoved && !pointLightMoved) { return; }
+
+		// Usually signaled already, the previous upload ran before the last frame
+		VkDevice device = VulkanAPI::GetDevice();
+		ASSERT_VULKAN(vkWaitForFences(device, 1, &m_UploadFence, VK_TRUE, UINT64_MAX));
+		ASSERT_VULKAN(vkResetFences(device, 1, &m_UploadFence));
+
+		VkCommandBuffer commandBuffer = m_UploadCommandPool->GetBuffer(0);
+
+		VkCommandBufferBeginInfo beginInfo;
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.pNext = nullptr;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = nullptr;
+		ASSERT_VULKAN(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		if (dirLightMoved) { UpdateDirLightTransmittance(commandBuffer); }
+		if (pointLightMoved) { UpdatePointLightTransmittance(commandBuffer); }
+
+		ASSERT_VULKAN(vkEndCommandBuffer(commandBuffer));
+
+		// Not waited for, the layout transitions order the copies before the shader reads of the next frame
+		VkSubmitInfo submitInfo;
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = nullptr;
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.pWaitSemaphores = nullptr;
+		submitInfo.pWaitDstStageMask = nullptr;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = nullptr;
+		ASSERT_VULKAN(vkQueueSubmit(VulkanAPI::GetGraphicsQueue(), 1, &submitInfo, m_UploadFence));
 	}
 
 	void HpmScene::RenderImGui()
@@ -83,6 +280,37 @@ namespace en
 		m_Density3DTex->Destroy();
 		delete m_Density3DTex;
 
+		m_Majorant3DTex->Destroy();
+		delete m_Majorant3DTex;
+
+		m_BrickIndex3DTex->Destroy();
+		delete m_BrickIndex3DTex;
+
+		m_DensityMip3DTex->Destroy();
+		delete m_DensityMip3DTex;
+
+		m_Occupancy3DTex->Destroy();
+		delete m_Occupancy3DTex;
+
+		m_Minorant3DTex->Destroy();
+		delete m_Minorant3DTex;
+
+		m_DirLightTransmittance3DTex->Destroy();
+		delete m_DirLightTransmittance3DTex;
+
+		delete m_DirLightTransmittanceGrid;
+
+		m_PointLightTransmittance3DTex->Destroy();
+		delete m_PointLightTransmittance3DTex;
+
+		delete m_PointLightTransmittanceGrid;
+
+		vkDestroyFence(VulkanAPI::GetDevice(), m_UploadFence, nullptr);
+		m_UploadCommandPool->Destroy();
+		delete m_UploadCommandPool;
+
+		delete m_VolumeCache;
+
 		m_HdrEnvMap->Destroy();
 		delete m_HdrEnvMap;
 
@@ -93,6 +321,18 @@ namespace en
 		delete m_DirLight;
 	}
 
+	void HpmScene::UpdateDirLightTransmittance(VkCommandBuffer commandBuffer)
+	{
+		m_DirLightTransmittanceGrid->BuildDirLight(-m_DirLight->GetDir());
+		m_DirLightTransmittance3DTex->Update(m_DirLightTransmittanceGrid->GetGrid(), commandBuffer);
+	}
+
+	void HpmScene::UpdatePointLightTransmittance(VkCommandBuffer commandBuffer)
+	{
+		m_PointLightTransmittanceGrid->BuildPointLight(m_PointLight->GetPos());
+		m_PointLightTransmittance3DTex->Update(m_PointLightTransmittanceGrid->GetGrid(), commandBuffer);
+	}
+
 	bool HpmScene::IsDynamic() const
 	{
 		return m_Dynamic;
@@ -108,6 +348,16 @@ namespace en
 		return m_VolumeData;
 	}
 
+	const DensityGrid* HpmScene::GetDensityGrid() const
+	{
+		return &m_VolumeCache->GetDensityGrid();
+	}
+
+	const MajorantGrid* HpmScene::GetMajorantGrid() const
+	{
+		return &m_VolumeCache->GetMajorantGrid();
+	}
+
 	const HdrEnvMap* HpmScene::GetHdrEnvMap() const
 	{
 		return m_HdrEnvMap;
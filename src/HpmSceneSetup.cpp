@@ -0,0 +1,53 @@
+#include <engine/HpmSceneSetup.hpp>
+#include <engine/objects/DensityGrid.hpp>
+
+#ifndef GLM_ENABLE_EXPERIMENTAL
+#define GLM_ENABLE_EXPERIMENTAL
+#endif // !GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+glm::vec3 VecFromAngles(float zenith, float azimuth)
+{
+	// construct using vec4, discards w.
+	return glm::vec3(
+		// azimuth starts at positive x.
+		glm::rotate(azimuth, glm::vec3(0.0f, 1.0f, 0.0f)) *
+		glm::rotate(zenith, glm::vec3(1.0f, 0.0f, 0.0f)) *
+		glm::vec4(0, 1, 0, 1)
+	);
+}
+
+namespace en
+{
+	const std::string HpmSceneSetup::sc_DensityFilePath = "data/volume/wdas_cloud_quarter.vdb";
+	const glm::vec3 HpmSceneSetup::sc_PointLightPos = glm::vec3(0.0f, 0.0f, 0.0f);
+	const glm::vec3 HpmSceneSetup::sc_PointLightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+
+	const glm::vec3 HpmSceneSetup::sc_CameraPos = glm::vec3(64.0f, 0.0f, 0.0f);
+	const glm::vec3 HpmSceneSetup::sc_CameraViewDir = glm::vec3(-1.0f, 0.0f, 0.0f);
+	const glm::vec3 HpmSceneSetup::sc_CameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	const float HpmSceneSetup::sc_CameraFov = glm::radians(60.0f);
+
+	glm::vec3 HpmSceneSetup::GetVolumeSize(uint32_t width, uint32_t height, uint32_t depth)
+	{
+		return glm::normalize(glm::vec3(width, height, depth)) * 107.5f;
+	}
+
+	glm::vec3 HpmSceneSetup::GetVolumeSize(const DensityGrid& densityGrid)
+	{
+		const glm::vec3 sourceExtent(densityGrid.GetSourceExtent());
+		const glm::vec3 extent(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth());
+		return GetVolumeSize(densityGrid.GetSourceExtent().x, densityGrid.GetSourceExtent().y, densityGrid.GetSourceExtent().z) * extent / sourceExtent;
+	}
+
+	glm::vec3 HpmSceneSetup::GetVolumePosition(const DensityGrid& densityGrid)
+	{
+		const glm::vec3 sourceExtent(densityGrid.GetSourceExtent());
+		const glm::vec3 extent(densityGrid.GetWidth(), densityGrid.GetHeight(), densityGrid.GetDepth());
+		const glm::vec3 voxelSize =
+			GetVolumeSize(densityGrid.GetSourceExtent().x, densityGrid.GetSourceExtent().y, densityGrid.GetSourceExtent().z) / sourceExtent;
+		const glm::vec3 sourceCenter = glm::vec3(densityGrid.GetSourceOffset()) + (sourceExtent / 2.0f);
+		const glm::vec3 center = glm::vec3(densityGrid.GetIndexOffset()) + (extent / 2.0f);
+		return (center - sourceCenter) * voxelSize;
+	}
+}
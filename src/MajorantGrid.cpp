@@ -0,0 +1,230 @@
+#include <engine/objects/MajorantGrid.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <cmath>
+
+namespace en
+{
+	// Headroom for density textures that round to nearest (R16_SFLOAT) and may exceed the float max
+	constexpr float c_MajorantScale = 1.001f;
+
+	MajorantGrid::MajorantGrid(const DensityGrid& densityGrid, uint32_t cellSize) :
+		m_CellSize(cellSize),
+		m_CellUvwSize(
+			static_cast<float>(cellSize) / static_cast<float>(densityGrid.GetWidth()),
+			static_cast<float>(cellSize) / static_cast<float>(densityGrid.GetHeight()),
+			static_cast<float>(cellSize) / static_cast<float>(densityGrid.GetDepth())),
+		m_Grid(
+			(densityGrid.GetWidth() + cellSize - 1) / cellSize,
+			(densityGrid.GetHeight() + cellSize - 1) / cellSize,
+			(densityGrid.GetDepth() + cellSize - 1) / cellSize)
+	{
+		const int width = static_cast<int>(densityGrid.GetWidth());
+		const int height = static_cast<int>(densityGrid.GetHeight());
+		const int depth = static_cast<int>(densityGrid.GetDepth());
+		const int size = static_cast<int>(cellSize);
+
+		// Every cell also covers a one voxel border around its block so that sampling positions that
+		// round into a neighbouring voxel at cell boundaries are still bounded
+		tbb::parallel_for(0u, m_Grid.GetDepth(), [&](uint32_t cellZ)
+			{
+				for (uint32_t cellY = 0; cellY < m_Grid.GetHeight(); cellY++)
+				{
+					for (uint32_t cellX = 0; cellX < m_Grid.GetWidth(); cellX++)
+					{
+						const int x0 = std::max(static_cast<int>(cellX) * size - 1, 0);
+						const int y0 = std::max(static_cast<int>(cellY) * size - 1, 0);
+						const int z0 = std::max(static_cast<int>(cellZ) * size - 1, 0);
+						const int x1 = std::min((static_cast<int>(cellX) + 1) * size, width - 1);
+						const int y1 = std::min((static_cast<int>(cellY) + 1) * size, height - 1);
+						const int z1 = std::min((static_cast<int>(cellZ) + 1) * size, depth - 1);
+
+						float maxVal = 0.0f;
+						for (int z = z0; z <= z1; z++)
+						{
+							for (int y = y0; y <= y1; y++)
+							{
+								const float* row = densityGrid.GetData() + densityGrid.GetIndex(0, y, z);
+								maxVal = std::max(maxVal, *std::max_element(row + x0, row + x1 + 1));
+							}
+						}
+
+						m_Grid.GetData()[m_Grid.GetIndex(cellX, cellY, cellZ)] = maxVal * c_MajorantScale;
+					}
+				}
+			});
+
+		Log::Info(
+			"Built majorant grid (" + std::to_string(m_Grid.GetWidth()) + "x" + std::to_string(m_Grid.GetHeight()) +
+			"x" + std::to_string(m_Grid.GetDepth()) + ") with " + std::to_string(cellSize) + "^3 voxels per cell");
+	}
+
+	MajorantGrid::MajorantGrid(const DensityGrid& densityGrid, DensityGrid cells, uint32_t cellSize) :
+		m_CellSize(cellSize),
+		m_CellUvwSize(
+			static_cast<float>(cellSize) / static_cast<float>(densityGrid.GetWidth()),
+			static_cast<float>(cellSize) / static_cast<float>(densityGrid.GetHeight()),
+			static_cast<float>(cellSize) / static_cast<float>(densityGrid.GetDepth())),
+		m_Grid(std::move(cells))
+	{
+		if (m_Grid.GetWidth() != (densityGrid.GetWidth() + cellSize - 1) / cellSize ||
+			m_Grid.GetHeight() != (densityGrid.GetHeight() + cellSize - 1) / cellSize ||
+			m_Grid.GetDepth() != (densityGrid.GetDepth() + cellSize - 1) / cellSize)
+		{
+			Log::Error("Majorant cells do not match the density grid", true);
+		}
+	}
+
+	bool MajorantGrid::InitTraversal(const glm::vec3& uvwOrigin, const glm::vec3& uvwDir, float tMax, Traversal& traversal) const
+	{
+		// Avoid divisions by zero for axis aligned rays
+		glm::vec3 safeDir = uvwDir;
+		for (int i = 0; i < 3; i++)
+		{
+			if (std::abs(safeDir[i]) < 1e-12f) { safeDir[i] = 1e-12f; }
+		}
+		const glm::vec3 invDir = 1.0f / safeDir;
+
+		// Clip segment against the unit cube
+		const glm::vec3 t0 = -uvwOrigin * invDir;
+		const glm::vec3 t1 = (glm::vec3(1.0f) - uvwOrigin) * invDir;
+		const glm::vec3 tMinAxis = glm::min(t0, t1);
+		const glm::vec3 tMaxAxis = glm::max(t0, t1);
+		const float tNear = std::max(std::max(tMinAxis.x, tMinAxis.y), std::max(tMinAxis.z, 0.0f));
+		const float tFar = std::min(std::min(tMaxAxis.x, tMaxAxis.y), std::min(tMaxAxis.z, tMax));
+		// Written as a negation so that NaN directions are rejected as well
+		if (!(tNear < tFar)) { return false; }
+
+		const glm::ivec3 cellCount(m_Grid.GetWidth(), m_Grid.GetHeight(), m_Grid.GetDepth());
+		const glm::vec3 entry = uvwOrigin + tNear * uvwDir;
+		traversal.cell = glm::clamp(glm::ivec3(glm::floor(entry / m_CellUvwSize)), glm::ivec3(0), cellCount - 1);
+		traversal.step = glm::ivec3(glm::sign(safeDir));
+
+		const glm::vec3 boundary = (glm::vec3(traversal.cell) + glm::vec3(glm::greaterThan(traversal.step, glm::ivec3(0)))) * m_CellUvwSize;
+		traversal.tNext = (boundary - uvwOrigin) * invDir;
+		traversal.tDelta = m_CellUvwSize * glm::abs(invDir);
+		traversal.t = tNear;
+		traversal.tEnd = tFar;
+
+		return true;
+	}
+
+	float MajorantGrid::GetCellMajorant(const Traversal& traversal) const
+	{
+		return m_Grid.GetValue(traversal.cell.x, traversal.cell.y, traversal.cell.z);
+	}
+
+	float MajorantGrid::GetCellExit(const Traversal& traversal) const
+	{
+		return std::min(std::min(traversal.tNext.x, traversal.tNext.y), std::min(traversal.tNext.z, traversal.tEnd));
+	}
+
+	bool MajorantGrid::StepTraversal(Traversal& traversal) const
+	{
+		traversal.t = GetCellExit(traversal);
+		if (traversal.t >= traversal.tEnd) { return false; }
+
+		int axis = 0;
+		if (traversal.tNext.y < traversal.tNext[axis]) { axis = 1; }
+		if (traversal.tNext.z < traversal.tNext[axis]) { axis = 2; }
+
+		traversal.cell[axis] += traversal.step[axis];
+		traversal.tNext[axis] += traversal.tDelta[axis];
+
+		const int cellCount = static_cast<int>(axis == 0 ? m_Grid.GetWidth() : (axis == 1 ? m_Grid.GetHeight() : m_Grid.GetDepth()));
+		return traversal.cell[axis] >= 0 && traversal.cell[axis] < cellCount;
+	}
+
+	void MajorantGrid::LogFetchStats(const DensityGrid& densityGrid, const glm::vec3& volumeSize, float densityFactor, uint32_t rayCount) const
+	{
+		tbb::combinable<size_t> globalFetchCount([]() { return 0; });
+		tbb::combinable<size_t> localFetchCount([]() { return 0; });
+		const float globalMajorant = densityFactor * densityGrid.GetMaxValue();
+		const float radius = glm::length(volumeSize);
+
+		tbb::parallel_for(tbb::blocked_range<uint32_t>(0, rayCount), [&](const tbb::blocked_range<uint32_t>& range)
+			{
+				std::mt19937 rng(range.begin());
+				std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+				size_t& globalFetches = globalFetchCount.local();
+				size_t& localFetches = localFetchCount.local();
+
+				for (uint32_t i = range.begin(); i < range.end(); i++)
+				{
+					// Ray from a random point on a bounding sphere to a random point in the volume
+					const float cosTheta = 2.0f * dist(rng) - 1.0f;
+					const float phi = 2.0f * 3.14159265f * dist(rng);
+					const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+					const glm::vec3 origin = radius * glm::vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+					const glm::vec3 target = (glm::vec3(dist(rng), dist(rng), dist(rng)) - 0.5f) * volumeSize;
+					const glm::vec3 dir = glm::normalize(target - origin);
+
+					const glm::vec3 uvwOrigin = (origin / volumeSize) + 0.5f;
+					const glm::vec3 uvwDir = dir / volumeSize;
+
+					Traversal traversal;
+					if (!InitTraversal(uvwOrigin, uvwDir, 2.0f * radius, traversal)) { continue; }
+					const float tEnd = traversal.tEnd;
+
+					// Global majorant
+					float t = traversal.t;
+					while (globalMajorant > 0.0f)
+					{
+						t -= std::log(1.0f - dist(rng)) / globalMajorant;
+						if (t >= tEnd) { break; }
+						const glm::vec3 uvw = uvwOrigin + t * uvwDir;
+						globalFetches++;
+						if (densityFactor * densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) / globalMajorant > dist(rng)) { break; }
+					}
+
+					// Local majorants
+					while (true)
+					{
+						const float majorant = densityFactor * GetCellMajorant(traversal);
+						const float cellExit = GetCellExit(traversal);
+						if (majorant > 0.0f)
+						{
+							traversal.t -= std::log(1.0f - dist(rng)) / majorant;
+							if (traversal.t < cellExit)
+							{
+								const glm::vec3 uvw = uvwOrigin + traversal.t * uvwDir;
+								localFetches++;
+								if (densityFactor * densityGrid.SampleNearest(uvw.x, uvw.y, uvw.z) / majorant > dist(rng)) { break; }
+								continue;
+							}
+						}
+
+						if (!StepTraversal(traversal)) { break; }
+					}
+				}
+			});
+
+		const double globalAvg = static_cast<double>(globalFetchCount.combine(std::plus<size_t>())) / static_cast<double>(rayCount);
+		const double localAvg = static_cast<double>(localFetchCount.combine(std::plus<size_t>())) / static_cast<double>(rayCount);
+		const double reduction = globalAvg > 0.0 ? (1.0 - (localAvg / globalAvg)) * 100.0 : 0.0;
+		Log::Info(
+			"Density fetches per ray: global majorant " + std::to_string(globalAvg) +
+			" | majorant grid " + std::to_string(localAvg) +
+			" | reduction " + std::to_string(reduction) + "%");
+	}
+
+	uint32_t MajorantGrid::GetCellSize() const
+	{
+		return m_CellSize;
+	}
+
+	glm::vec3 MajorantGrid::GetCellUvwSize() const
+	{
+		return m_CellUvwSize;
+	}
+
+	const DensityGrid& MajorantGrid::GetGrid() const
+	{
+		return m_Grid;
+	}
+}
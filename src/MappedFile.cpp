@@ -0,0 +1,99 @@
+#include <engine/util/MappedFile.hpp>
+#include <engine/util/Log.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace en
+{
+	MappedFile::MappedFile(const std::string& fileName, bool copyOnWrite)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(
+			fileName.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr);
+		if (file == INVALID_HANDLE_VALUE) { Log::Error("Failed to open " + fileName + " for mapping", true); }
+		m_FileHandle = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) { Log::Error("Failed to get size of " + fileName, true); }
+		m_Size = static_cast<size_t>(size.QuadPart);
+
+		// Empty files cannot be mapped
+		if (m_Size == 0) { return; }
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) { Log::Error("Failed to create file mapping of " + fileName, true); }
+		m_MappingHandle = mapping;
+
+		m_Data = static_cast<uint8_t*>(MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+		if (m_Data == nullptr) { Log::Error("Failed to map " + fileName, true); }
+#else
+		const int file = open(fileName.c_str(), O_RDONLY);
+		if (file < 0) { Log::Error("Failed to open " + fileName + " for mapping", true); }
+
+		struct stat fileStat;
+		if (fstat(file, &fileStat) != 0)
+		{
+			close(file);
+			Log::Error("Failed to get size of " + fileName, true);
+		}
+		m_Size = static_cast<size_t>(fileStat.st_size);
+
+		if (m_Size > 0)
+		{
+			void* data = mmap(nullptr, m_Size, copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, file, 0);
+			if (data == MAP_FAILED)
+			{
+				close(file);
+				Log::Error("Failed to map " + fileName, true);
+			}
+			m_Data = static_cast<uint8_t*>(data);
+			madvise(m_Data, m_Size, MADV_SEQUENTIAL);
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		close(file);
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+#ifdef _WIN32
+		if (m_Data != nullptr) { UnmapViewOfFile(m_Data); }
+		if (m_MappingHandle != nullptr) { CloseHandle(m_MappingHandle); }
+		if (m_FileHandle != nullptr) { CloseHandle(m_FileHandle); }
+#else
+		if (m_Data != nullptr) { munmap(m_Data, m_Size); }
+#endif
+	}
+
+	uint8_t* MappedFile::GetData()
+	{
+		return m_Data;
+	}
+
+	const uint8_t* MappedFile::GetData() const
+	{
+		return m_Data;
+	}
+
+	size_t MappedFile::GetSize() const
+	{
+		return m_Size;
+	}
+}
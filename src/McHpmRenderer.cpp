@@ -78,10 +78,19 @@ namespace en
 		vkDestroyDescriptorSetLayout(device, s_DescSetLayout, nullptr);
 	}
 
-	McHpmRenderer::McHpmRenderer(uint32_t width, uint32_t height, uint32_t pathLength, bool blend, const Camera* camera, const HpmScene& scene) :
+	McHpmRenderer::McHpmRenderer(
+		uint32_t width,
+		uint32_t height,
+		uint32_t pathLength,
+		bool blend,
+		const Camera* camera,
+		const HpmScene& scene,
+		bool reference)
+		:
 		m_RenderWidth(width),
 		m_RenderHeight(height),
 		m_PathLength(pathLength),
+		m_Reference(reference),
 		m_ShouldBlend(blend),
 		m_Camera(camera),
 		m_HpmScene(scene),
@@ -357,6 +366,11 @@ namespace en
 		return m_ShouldBlend;
 	}
 
+	float McHpmRenderer::GetTotalTime() const
+	{
+		return m_TimePeriod;
+	}
+
 	void McHpmRenderer::SetCamera(VkQueue queue, const Camera* camera)
 	{
 		// Set members
@@ -431,9 +445,7 @@ namespace en
 
 	void McHpmRenderer::InitSpecializationConstants()
 	{
-		const VkExtent3D volumeSizeUI = m_HpmScene.GetVolumeData()->GetExtent();
-		glm::vec3 volumeSizeF = { volumeSizeUI.width, volumeSizeUI.height, volumeSizeUI.depth };
-		volumeSizeF = glm::normalize(volumeSizeF) * 107.5f;
+		const glm::vec3 volumeSizeF = m_HpmScene.GetVolumeData()->GetSize();
 
 		// Fill struct
 		m_SpecData.renderWidth = m_RenderWidth;
@@ -448,6 +460,33 @@ namespace en
 
 		m_SpecData.hdrEnvMapStrength = m_HpmScene.GetHdrEnvMap()->GetStrength();
 
+		const VkExtent3D volumeExtent = m_HpmScene.GetVolumeData()->GetExtent();
+		m_SpecData.volumeVoxelsX = volumeExtent.width;
+		m_SpecData.volumeVoxelsY = volumeExtent.height;
+		m_SpecData.volumeVoxelsZ = volumeExtent.depth;
+
+		const DensityLodMode densityLodMode = m_Reference ? DensityLodMode::Off : m_HpmScene.GetVolumeData()->GetDensityLodMode();
+		m_SpecData.densityLodMode = static_cast<uint32_t>(densityLodMode);
+		m_SpecData.densityLodSpread = m_HpmScene.GetVolumeData()->GetDensityLodSpread();
+
+		const glm::vec3 volumePos = m_HpmScene.GetVolumeData()->GetPosition();
+		m_SpecData.volumePosX = volumePos.x;
+		m_SpecData.volumePosY = volumePos.y;
+		m_SpecData.volumePosZ = volumePos.z;
+
+		m_SpecData.traversalStats = m_HpmScene.GetVolumeData()->IsTraversalStatsEnabled() ? VK_TRUE : VK_FALSE;
+
+		const ShadowTransmittance shadowTransmittance = m_Reference ? ShadowTransmittance() : m_HpmScene.GetVolumeData()->GetShadowTransmittance();
+		m_SpecData.dirLightTransmittance = static_cast<uint32_t>(shadowTransmittance.dirLight);
+		m_SpecData.pointLightTransmittance = static_cast<uint32_t>(shadowTransmittance.pointLight);
+		m_SpecData.hdrEnvMapTransmittance = static_cast<uint32_t>(shadowTransmittance.hdrEnvMap);
+		m_SpecData.residualControl = static_cast<uint32_t>(shadowTransmittance.residualControl);
+
+		const FreeFlightMode freeFlightMode = m_Reference ? FreeFlightMode::DeltaTracking : m_HpmScene.GetVolumeData()->GetFreeFlightMode();
+		m_SpecData.freeFlightMode = static_cast<uint32_t>(freeFlightMode);
+
+		m_SpecData.phaseFunc = static_cast<uint32_t>(m_HpmScene.GetVolumeData()->GetPhaseFuncMode());
+
 		// Init map entries
 		uint32_t mapEntryIndex = 0;
 
@@ -496,6 +535,81 @@ namespace en
 		hdrEnvMapStrengthEntry.offset = offsetof(SpecializationData, SpecializationData::hdrEnvMapStrength);
 		hdrEnvMapStrengthEntry.size = sizeof(float);
 
+		VkSpecializationMapEntry volumeVoxelsXEntry;
+		volumeVoxelsXEntry.constantID = mapEntryIndex++;
+		volumeVoxelsXEntry.offset = offsetof(SpecializationData, SpecializationData::volumeVoxelsX);
+		volumeVoxelsXEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry volumeVoxelsYEntry;
+		volumeVoxelsYEntry.constantID = mapEntryIndex++;
+		volumeVoxelsYEntry.offset = offsetof(SpecializationData, SpecializationData::volumeVoxelsY);
+		volumeVoxelsYEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry volumeVoxelsZEntry;
+		volumeVoxelsZEntry.constantID = mapEntryIndex++;
+		volumeVoxelsZEntry.offset = offsetof(SpecializationData, SpecializationData::volumeVoxelsZ);
+		volumeVoxelsZEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry densityLodModeEntry;
+		densityLodModeEntry.constantID = mapEntryIndex++;
+		densityLodModeEntry.offset = offsetof(SpecializationData, SpecializationData::densityLodMode);
+		densityLodModeEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry densityLodSpreadEntry;
+		densityLodSpreadEntry.constantID = mapEntryIndex++;
+		densityLodSpreadEntry.offset = offsetof(SpecializationData, SpecializationData::densityLodSpread);
+		densityLodSpreadEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry volumePosXEntry;
+		volumePosXEntry.constantID = mapEntryIndex++;
+		volumePosXEntry.offset = offsetof(SpecializationData, SpecializationData::volumePosX);
+		volumePosXEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry volumePosYEntry;
+		volumePosYEntry.constantID = mapEntryIndex++;
+		volumePosYEntry.offset = offsetof(SpecializationData, SpecializationData::volumePosY);
+		volumePosYEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry volumePosZEntry;
+		volumePosZEntry.constantID = mapEntryIndex++;
+		volumePosZEntry.offset = offsetof(SpecializationData, SpecializationData::volumePosZ);
+		volumePosZEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry traversalStatsEntry;
+		traversalStatsEntry.constantID = mapEntryIndex++;
+		traversalStatsEntry.offset = offsetof(SpecializationData, SpecializationData::traversalStats);
+		traversalStatsEntry.size = sizeof(VkBool32);
+
+		VkSpecializationMapEntry dirLightTransmittanceEntry;
+		dirLightTransmittanceEntry.constantID = mapEntryIndex++;
+		dirLightTransmittanceEntry.offset = offsetof(SpecializationData, SpecializationData::dirLightTransmittance);
+		dirLightTransmittanceEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry pointLightTransmittanceEntry;
+		pointLightTransmittanceEntry.constantID = mapEntryIndex++;
+		pointLightTransmittanceEntry.offset = offsetof(SpecializationData, SpecializationData::pointLightTransmittance);
+		pointLightTransmittanceEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry hdrEnvMapTransmittanceEntry;
+		hdrEnvMapTransmittanceEntry.constantID = mapEntryIndex++;
+		hdrEnvMapTransmittanceEntry.offset = offsetof(SpecializationData, SpecializationData::hdrEnvMapTransmittance);
+		hdrEnvMapTransmittanceEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry residualControlEntry;
+		residualControlEntry.constantID = mapEntryIndex++;
+		residualControlEntry.offset = offsetof(SpecializationData, SpecializationData::residualControl);
+		residualControlEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry freeFlightModeEntry;
+		freeFlightModeEntry.constantID = mapEntryIndex++;
+		freeFlightModeEntry.offset = offsetof(SpecializationData, SpecializationData::freeFlightMode);
+		freeFlightModeEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry phaseFuncEntry;
+		phaseFuncEntry.constantID = mapEntryIndex++;
+		phaseFuncEntry.offset = offsetof(SpecializationData, SpecializationData::phaseFunc);
+		phaseFuncEntry.size = sizeof(uint32_t);
+
 		m_SpecMapEntries = {
 			renderWidthEntry,
 			renderHeightEntry,
@@ -505,7 +619,22 @@ namespace en
 			volumeSizeZEntry,
 			volumeDensityFactorEntry,
 			volumeGEntry,
-			hdrEnvMapStrengthEntry
+			hdrEnvMapStrengthEntry,
+			volumeVoxelsXEntry,
+			volumeVoxelsYEntry,
+			volumeVoxelsZEntry,
+			densityLodModeEntry,
+			densityLodSpreadEntry,
+			volumePosXEntry,
+			volumePosYEntry,
+			volumePosZEntry,
+			traversalStatsEntry,
+			dirLightTransmittanceEntry,
+			pointLightTransmittanceEntry,
+			hdrEnvMapTransmittanceEntry,
+			residualControlEntry,
+			freeFlightModeEntry,
+			phaseFuncEntry
 		};
 
 		m_SpecInfo.mapEntryCount = m_SpecMapEntries.size();
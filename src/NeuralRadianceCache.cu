@@ -1,6 +1,10 @@
 #include <engine/cuda_common.hpp>
 #include <engine/graphics/NeuralRadianceCache.hpp>
+#include <engine/graphics/TcnnNrcBackend.hpp>
+#include <engine/graphics/CpuNrcBackend.hpp>
+#include <cuda_fp16.h>
 #include <random>
+#include <algorithm>
 #include <engine/util/Log.hpp>
 #include <__msvc_chrono.hpp>
 
@@ -8,116 +12,263 @@ namespace en
 {
 	uint32_t NeuralRadianceCache::sc_InputCount = 5;
 	uint32_t NeuralRadianceCache::sc_OutputCount = 3;
+	uint32_t NeuralRadianceCache::sc_BatchGranularity = 128;
+	uint32_t NeuralRadianceCache::sc_HalfInputStride = 8;
+	uint32_t NeuralRadianceCache::sc_HalfOutputStride = 4;
+
+	// Samples [offset, offset + count) of a big buffer without the samples at or after the device side
+	// totalCount, which may be null
+	__device__ bool IsValidSample(uint32_t i, uint32_t count, const uint32_t* totalCount, uint32_t offset)
+	{
+		return i < count && (totalCount == nullptr || offset + i < *totalCount);
+	}
+
+	// Sample major fp16 to floats, the halves after dstStride are padding
+	__global__ void UnpackHalfKernel(
+		const __half* src,
+		uint32_t srcStride,
+		float* dst,
+		uint32_t dstStride,
+		uint32_t count,
+		const uint32_t* totalCount,
+		uint32_t offset)
+	{
+		const uint32_t i = (blockIdx.x * blockDim.x) + threadIdx.x;
+		if (!IsValidSample(i, count, totalCount, offset)) { return; }
+		for (uint32_t c = 0; c < dstStride; c++) { dst[(i * dstStride) + c] = __half2float(src[(i * srcStride) + c]); }
+	}
+
+	// Sample major floats to fp16, the padding is zeroed
+	__global__ void PackHalfKernel(
+		const float* src,
+		uint32_t srcStride,
+		__half* dst,
+		uint32_t dstStride,
+		uint32_t count,
+		const uint32_t* totalCount,
+		uint32_t offset)
+	{
+		const uint32_t i = (blockIdx.x * blockDim.x) + threadIdx.x;
+		if (!IsValidSample(i, count, totalCount, offset)) { return; }
+		for (uint32_t c = 0; c < dstStride; c++) { dst[(i * dstStride) + c] = __float2half(c < srcStride ? src[(i * srcStride) + c] : 0.0f); }
+	}
+
+	// dTotalCount and offset are only used by the kernel, the host knows the exact count
+	static void UnpackHalf(
+		bool hostMemory,
+		const __half* src,
+		uint32_t srcStride,
+		float* dst,
+		uint32_t dstStride,
+		uint32_t count,
+		const uint32_t* dTotalCount,
+		uint32_t offset)
+	{
+		if (hostMemory)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				for (uint32_t c = 0; c < dstStride; c++) { dst[(i * dstStride) + c] = __half2float(src[(i * srcStride) + c]); }
+			}
+			return;
+		}
+
+		UnpackHalfKernel<<<(count + 127) / 128, 128>>>(src, srcStride, dst, dstStride, count, dTotalCount, offset);
+		ASSERT_CUDA(cudaGetLastError());
+	}
+
+	static void PackHalf(
+		bool hostMemory,
+		const float* src,
+		uint32_t srcStride,
+		__half* dst,
+		uint32_t dstStride,
+		uint32_t count,
+		const uint32_t* dTotalCount,
+		uint32_t offset)
+	{
+		if (hostMemory)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				for (uint32_t c = 0; c < dstStride; c++) { dst[(i * dstStride) + c] = __float2half(c < srcStride ? src[(i * srcStride) + c] : 0.0f); }
+			}
+			return;
+		}
+
+		PackHalfKernel<<<(count + 127) / 128, 128>>>(src, srcStride, dst, dstStride, count, dTotalCount, offset);
+		ASSERT_CUDA(cudaGetLastError());
+	}
 
 	NeuralRadianceCache::NeuralRadianceCache(const AppConfig& appConfig) :
 		m_InferBatchSize(2 << (appConfig.log2InferBatchSize - 1)),
 		m_TrainBatchSize(2 << (appConfig.log2TrainBatchSize - 1)),
-		m_TrainBatchCount(appConfig.trainBatchCount)
-	{
-		nlohmann::json modelConfig = {
-			{"loss", {
-				{"otype", appConfig.lossFn}
-			}},
-			{"optimizer", {
-				{"otype", "EMA"},
-				{"decay", appConfig.emaDecay},
-				{"nested", {
-					{"otype", appConfig.optimizer},
-					{"learning_rate", appConfig.learningRate},
-					//{"l2_reg", 0.0001},
-				}}
-			}},
-			appConfig.encoding.jsonConfig,
-			{"network", {
-				{"otype", "FullyFusedMLP"},
-				{"activation", "ReLU"},
-				{"output_activation", "None"},
-				{"n_neurons", appConfig.nnWidth},
-				{"n_hidden_layers", appConfig.nnDepth},
-			}},
-		};
-
-		m_Model = tcnn::create_from_config(sc_InputCount, sc_OutputCount, modelConfig);
+		m_TrainBatchCount(appConfig.trainBatchCount),
+		m_HalfIo(appConfig.nrcHalfIo),
+		m_Pipelined(appConfig.nrcPipelined)
+	{
+		switch (appConfig.nrcBackend)
+		{
+		case NrcBackendMode::Cpu:
+			m_Backend = std::make_unique<CpuNrcBackend>(appConfig, sc_InputCount, sc_OutputCount);
+			break;
+		default:
+			m_Backend = std::make_unique<TcnnNrcBackend>(appConfig, sc_InputCount, sc_OutputCount);
+			break;
+		}
 	}
 
 	void NeuralRadianceCache::Init(
-		uint32_t inferCount,
-		float* dCuInferInput,
-		float* dCuInferOutput,
-		float* dCuTrainInput,
-		float* dCuTrainTarget,
+		uint32_t maxInferCount,
+		void* dCuInferInput,
+		void* dCuInferOutput,
+		void* dCuTrainInput,
+		void* dCuTrainTarget,
+		const uint32_t* dCuInferCount,
 		cudaExternalSemaphore_t cudaStartSemaphore,
 		cudaExternalSemaphore_t cudaFinishedSemaphore)
 	{
 		// Check if sample counts are compatible
-		if (inferCount % 16 != 0) { en::Log::Error("NRC requires inferCount to be a multiple of 16", true); }
+		if (maxInferCount % sc_BatchGranularity != 0) { en::Log::Error("NRC requires maxInferCount to be a multiple of " + std::to_string(sc_BatchGranularity), true); }
 
 		// Init members
 		m_CudaStartSemaphore = cudaStartSemaphore;
 		m_CudaFinishedSemaphore = cudaFinishedSemaphore;
 
 		// Init big buffer
-		const uint32_t trainCount = m_TrainBatchCount * m_TrainBatchSize;
-
-		m_InferInput = tcnn::GPUMatrix<float>(dCuInferInput, sc_InputCount, inferCount);
-		m_InferOutput = tcnn::GPUMatrix<float>(dCuInferOutput, sc_OutputCount, inferCount);
-		m_TrainInput = tcnn::GPUMatrix<float>(dCuTrainInput, sc_InputCount, trainCount);
-		m_TrainTarget = tcnn::GPUMatrix<float>(dCuTrainTarget, sc_OutputCount, trainCount);
-
-		// Init infer buffers
-		const uint32_t inferBatchCount = inferCount / m_InferBatchSize;
-		const uint32_t inferLastBatchSize = inferCount - (inferBatchCount * m_InferBatchSize);
-		m_InferInputBatches.resize(inferBatchCount);
-		m_InferOutputBatches.resize(inferBatchCount);
-		
-		for (uint32_t i = 0; i < inferBatchCount; i++)
-		{
-			m_InferInputBatches[i] = m_InferInput.slice_cols(i * m_InferBatchSize, m_InferBatchSize);
-			m_InferOutputBatches[i] = m_InferOutput.slice_cols(i * m_InferBatchSize, m_InferBatchSize);
-		}
+		m_InferInput = dCuInferInput;
+		m_InferOutput = dCuInferOutput;
+		m_TrainInput = dCuTrainInput;
+		m_TrainTarget = dCuTrainTarget;
+		m_InferCount = dCuInferCount;
+		m_MaxInferCount = maxInferCount;
 
-		if (inferLastBatchSize > 0)
+		// Init train batches
+		for (uint32_t i = 0; i < m_TrainBatchCount; i++) { m_TrainBatches.push_back({ i * m_TrainBatchSize, m_TrainBatchSize }); }
+
+		// Init float batches of the fp16 layout
+		if (m_HalfIo)
 		{
-			m_InferInputBatches.push_back(m_InferInput.slice_cols(inferBatchCount * m_InferBatchSize, inferLastBatchSize));
-			m_InferOutputBatches.push_back(m_InferOutput.slice_cols(inferBatchCount * m_InferBatchSize, inferLastBatchSize));
+			const size_t scratchCount = std::max(m_InferBatchSize, m_TrainBatchSize);
+			if (m_Backend->UsesHostMemory())
+			{
+				m_InputScratch = new float[scratchCount * sc_InputCount];
+				m_OutputScratch = new float[scratchCount * sc_OutputCount];
+			}
+			else
+			{
+				ASSERT_CUDA(cudaMalloc(&m_InputScratch, scratchCount * sc_InputCount * sizeof(float)));
+				ASSERT_CUDA(cudaMalloc(&m_OutputScratch, scratchCount * sc_OutputCount * sizeof(float)));
+			}
 		}
 
-		// Init train buffers
-		m_TrainInputBatches.resize(m_TrainBatchCount);
-		m_TrainTargetBatches.resize(m_TrainBatchCount);
-
-		for (uint32_t i = 0; i < m_TrainBatchCount; i++)
+		// Infer count statistics of device memory backends
+		if (!m_Backend->UsesHostMemory())
 		{
-			m_TrainInputBatches[i] = m_TrainInput.slice_cols(i * m_TrainBatchSize, m_TrainBatchSize);
-			m_TrainTargetBatches[i] = m_TrainTarget.slice_cols(i * m_TrainBatchSize, m_TrainBatchSize);
+			ASSERT_CUDA(cudaMallocHost(&m_InferCountHost, sizeof(uint32_t)));
+			*m_InferCountHost = 0;
+			ASSERT_CUDA(cudaEventCreateWithFlags(&m_InferCountEvent, cudaEventDisableTiming));
 		}
 
-		en::Log::Info("Infer batch count: " + std::to_string(m_InferInputBatches.size()));
+		en::Log::Info("Max infer batch count: " + std::to_string((maxInferCount + m_InferBatchSize - 1) / m_InferBatchSize));
 	}
 
-	void NeuralRadianceCache::InferAndTrain(const uint32_t* inferFilter, bool train)
+	void NeuralRadianceCache::InferAndTrain(bool train, uint64_t syncValue)
 	{
-		AwaitCudaStartSemaphore();
+		// The previous pipelined training has to update the weights before the inference uses them
+		if (m_TrainPending)
+		{
+			auto start = std::chrono::steady_clock::now();
+			AwaitTraining();
+			auto end = std::chrono::steady_clock::now();
+			m_TrainTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+		}
+
+		if (!m_Backend->UsesHostMemory()) { AwaitCudaStartSemaphore(syncValue); }
 
 		auto start = std::chrono::steady_clock::now();
-		Inference(inferFilter);
+		Inference();
 		auto end = std::chrono::steady_clock::now();
 		double elapsed_ms = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
 		m_InferenceTime = elapsed_ms;
 
+		const uint32_t trainSlot = static_cast<uint32_t>(syncValue % GetTrainSlotCount());
+		if (m_Pipelined)
+		{
+			// Vulkan composites the frame and starts the next one while the training runs
+			if (!m_Backend->UsesHostMemory()) { SignalCudaFinishedSemaphore(syncValue); }
+			if (train) { StartTraining(trainSlot); }
+			return;
+		}
+
 		if (train) { 
 			auto start = std::chrono::steady_clock::now();
-			Train(); 
+			Train(trainSlot);
+			m_TrainPending = true;
+			AwaitTraining();
 			auto end = std::chrono::steady_clock::now();
 			double elapsed_ms = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
 			m_TrainTime = elapsed_ms;
+			m_TrainSamplesPerSecond = static_cast<double>(m_TrainBatchCount * m_TrainBatchSize) / (elapsed_ms / 1000.0);
 		}
 
-		SignalCudaFinishedSemaphore();
+		if (!m_Backend->UsesHostMemory()) { SignalCudaFinishedSemaphore(syncValue); }
+	}
+
+	void NeuralRadianceCache::AwaitTraining()
+	{
+		if (!m_TrainPending) { return; }
+
+		if (m_TrainFuture.valid()) { m_TrainFuture.get(); }
+		m_Loss = m_Backend->GetLastLoss();
+		m_TrainPending = false;
 	}
 
 	void NeuralRadianceCache::Destroy()
 	{
+		AwaitTraining();
+
+		if (m_InferCountHost != nullptr)
+		{
+			ASSERT_CUDA(cudaEventDestroy(m_InferCountEvent));
+			ASSERT_CUDA(cudaFreeHost(m_InferCountHost));
+			m_InferCountHost = nullptr;
+		}
+
+		if (!m_HalfIo) { return; }
+
+		if (m_Backend->UsesHostMemory())
+		{
+			delete[] m_InputScratch;
+			delete[] m_OutputScratch;
+		}
+		else
+		{
+			ASSERT_CUDA(cudaFree(m_InputScratch));
+			ASSERT_CUDA(cudaFree(m_OutputScratch));
+		}
+		m_InputScratch = nullptr;
+		m_OutputScratch = nullptr;
+	}
+
+	bool NeuralRadianceCache::UsesHostMemory() const
+	{
+		return m_Backend->UsesHostMemory();
+	}
+
+	bool NeuralRadianceCache::UsesHalfIo() const
+	{
+		return m_HalfIo;
+	}
+
+	size_t NeuralRadianceCache::GetInputSampleSize() const
+	{
+		return m_HalfIo ? sc_HalfInputStride * sizeof(__half) : sc_InputCount * sizeof(float);
+	}
+
+	size_t NeuralRadianceCache::GetOutputSampleSize() const
+	{
+		return m_HalfIo ? sc_HalfOutputStride * sizeof(__half) : sc_OutputCount * sizeof(float);
 	}
 
 	float NeuralRadianceCache::GetLoss() const
@@ -135,14 +286,29 @@ namespace en
 		return m_TrainTime;
 	}
 
-	size_t NeuralRadianceCache::GetInferBatchCount() const
+	float NeuralRadianceCache::GetTrainSamplesPerSecond() const
+	{
+		return m_TrainSamplesPerSecond;
+	}
+
+	bool NeuralRadianceCache::IsPipelined() const
+	{
+		return m_Pipelined;
+	}
+
+	uint32_t NeuralRadianceCache::GetTrainSlotCount() const
+	{
+		return m_Pipelined ? 2 : 1;
+	}
+
+	uint32_t NeuralRadianceCache::GetInferCount() const
 	{
-		return m_InferInputBatches.size();
+		return m_LastInferCount;
 	}
 
 	size_t NeuralRadianceCache::GetTrainBatchCount() const
 	{
-		return m_TrainInputBatches.size();
+		return m_TrainBatches.size();
 	}
 
 	uint32_t NeuralRadianceCache::GetInferBatchSize() const
@@ -155,46 +321,106 @@ namespace en
 		return m_TrainBatchSize;
 	}
 
-	void NeuralRadianceCache::Inference(const uint32_t* inferFilter)
+	void NeuralRadianceCache::Inference()
 	{
-		for (size_t i = 0; i < m_InferInputBatches.size(); i++)
+		// The count is written by prep_infer_rays. Host memory backends read it after the fence. Reading
+		// it back from the device would block the host until vulkan wrote it, so device memory backends
+		// infer up to the fixed upper bound instead and the fp16 conversions skip the samples after the
+		// count on the device. The count only comes back asynchronously for GetInferCount.
+		uint32_t inferCount = m_MaxInferCount;
+		const uint32_t* dTotalCount = nullptr;
+		if (m_Backend->UsesHostMemory())
 		{
-			if (inferFilter[i] > 0)
-			{
-				const tcnn::GPUMatrix<float>& inputBatch = m_InferInputBatches[i];
-				tcnn::GPUMatrix<float>& outputBatch = m_InferOutputBatches[i];
-				m_Model.network->inference(inputBatch, outputBatch);
-			}
+			inferCount = std::min(*m_InferCount, m_MaxInferCount);
+			m_LastInferCount = inferCount;
+		}
+		else
+		{
+			dTotalCount = m_InferCount;
+			if (cudaEventQuery(m_InferCountEvent) == cudaSuccess) { m_LastInferCount = std::min(*m_InferCountHost, m_MaxInferCount); }
+			ASSERT_CUDA(cudaMemcpyAsync(m_InferCountHost, m_InferCount, sizeof(uint32_t), cudaMemcpyDeviceToHost));
+			ASSERT_CUDA(cudaEventRecord(m_InferCountEvent));
+		}
+
+		// The last batch is padded to the granularity, the infer buffers have room for it
+		for (uint32_t offset = 0; offset < inferCount; offset += m_InferBatchSize)
+		{
+			const uint32_t remaining = inferCount - offset;
+			const uint32_t paddedRemaining = ((remaining + sc_BatchGranularity - 1) / sc_BatchGranularity) * sc_BatchGranularity;
+			const uint32_t count = std::min(m_InferBatchSize, paddedRemaining);
+			m_Backend->Inference(GetBatchInput(m_InferInput, offset, count, dTotalCount), GetBatchOutput(m_InferOutput, offset), count);
+			StoreBatchOutput(m_InferOutput, offset, count, dTotalCount);
 		}
 	}
 
-	void NeuralRadianceCache::Train()
+	void NeuralRadianceCache::Train(uint32_t slot)
 	{
-		for (size_t i = 0; i < m_TrainInputBatches.size(); i++)
+		const uint32_t slotOffset = slot * m_TrainBatchCount * m_TrainBatchSize;
+		for (const Batch& batch : m_TrainBatches)
 		{
-			const tcnn::GPUMatrix<float>& inputBatch = m_TrainInputBatches[i];
-			const tcnn::GPUMatrix<float>& targetBatch = m_TrainTargetBatches[i];
-			auto forwardContext = m_Model.trainer->training_step(inputBatch, targetBatch);
-			m_Loss = m_Model.trainer->loss(*forwardContext.get());
+			m_Backend->Train(
+				GetBatchInput(m_TrainInput, slotOffset + batch.offset, batch.size),
+				GetBatchTarget(m_TrainTarget, slotOffset + batch.offset, batch.size),
+				batch.size);
 		}
 	}
 
-	void NeuralRadianceCache::AwaitCudaStartSemaphore()
+	void NeuralRadianceCache::StartTraining(uint32_t slot)
+	{
+		// Device memory backends only enqueue the steps, host memory backends get their own thread
+		m_TrainPending = true;
+		if (m_Backend->UsesHostMemory()) { m_TrainFuture = std::async(std::launch::async, [this, slot]() { Train(slot); }); }
+		else { Train(slot); }
+	}
+
+	const float* NeuralRadianceCache::GetBatchInput(const void* buffer, uint32_t offset, uint32_t count, const uint32_t* dTotalCount)
+	{
+		if (!m_HalfIo) { return static_cast<const float*>(buffer) + (static_cast<size_t>(offset) * sc_InputCount); }
+
+		const __half* src = static_cast<const __half*>(buffer) + (static_cast<size_t>(offset) * sc_HalfInputStride);
+		UnpackHalf(m_Backend->UsesHostMemory(), src, sc_HalfInputStride, m_InputScratch, sc_InputCount, count, dTotalCount, offset);
+		return m_InputScratch;
+	}
+
+	const float* NeuralRadianceCache::GetBatchTarget(const void* buffer, uint32_t offset, uint32_t count)
+	{
+		if (!m_HalfIo) { return static_cast<const float*>(buffer) + (static_cast<size_t>(offset) * sc_OutputCount); }
+
+		const __half* src = static_cast<const __half*>(buffer) + (static_cast<size_t>(offset) * sc_HalfOutputStride);
+		UnpackHalf(m_Backend->UsesHostMemory(), src, sc_HalfOutputStride, m_OutputScratch, sc_OutputCount, count, nullptr, offset);
+		return m_OutputScratch;
+	}
+
+	float* NeuralRadianceCache::GetBatchOutput(void* buffer, uint32_t offset)
+	{
+		if (!m_HalfIo) { return static_cast<float*>(buffer) + (static_cast<size_t>(offset) * sc_OutputCount); }
+		return m_OutputScratch;
+	}
+
+	void NeuralRadianceCache::StoreBatchOutput(void* buffer, uint32_t offset, uint32_t count, const uint32_t* dTotalCount)
+	{
+		if (!m_HalfIo) { return; }
+
+		__half* dst = static_cast<__half*>(buffer) + (static_cast<size_t>(offset) * sc_HalfOutputStride);
+		PackHalf(m_Backend->UsesHostMemory(), m_OutputScratch, sc_OutputCount, dst, sc_HalfOutputStride, count, dTotalCount, offset);
+	}
+
+	void NeuralRadianceCache::AwaitCudaStartSemaphore(uint64_t value)
 	{
 		cudaExternalSemaphoreWaitParams extSemaphoreWaitParams;
 		memset(&extSemaphoreWaitParams, 0, sizeof(extSemaphoreWaitParams));
-		extSemaphoreWaitParams.params.fence.value = 0;
+		extSemaphoreWaitParams.params.fence.value = value;
 		extSemaphoreWaitParams.flags = 0;
 
 		cudaError_t error = cudaWaitExternalSemaphoresAsync(&m_CudaStartSemaphore, &extSemaphoreWaitParams, 1);
 		ASSERT_CUDA(error);
 	}
 
-	void NeuralRadianceCache::SignalCudaFinishedSemaphore()
+	void NeuralRadianceCache::SignalCudaFinishedSemaphore(uint64_t value)
 	{
 		cudaExternalSemaphoreSignalParams extSemaphoreSignalParams;
 		memset(&extSemaphoreSignalParams, 0, sizeof(extSemaphoreSignalParams));
-		extSemaphoreSignalParams.params.fence.value = 0;
+		extSemaphoreSignalParams.params.fence.value = value;
 		extSemaphoreSignalParams.flags = 0;
 
 		cudaError_t error = cudaSignalExternalSemaphoresAsync(&m_CudaFinishedSemaphore, &extSemaphoreSignalParams, 1);
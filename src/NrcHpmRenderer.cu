@@ -130,12 +130,12 @@ namespace en
 		nrcTrainTargetBufferBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 		nrcTrainTargetBufferBinding.pImmutableSamplers = nullptr;
 
-		VkDescriptorSetLayoutBinding nrcInferFilterBufferBinding;
-		nrcInferFilterBufferBinding.binding = bindingIndex++;
-		nrcInferFilterBufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		nrcInferFilterBufferBinding.descriptorCount = 1;
-		nrcInferFilterBufferBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-		nrcInferFilterBufferBinding.pImmutableSamplers = nullptr;
+		VkDescriptorSetLayoutBinding nrcInferIndexBufferBinding;
+		nrcInferIndexBufferBinding.binding = bindingIndex++;
+		nrcInferIndexBufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		nrcInferIndexBufferBinding.descriptorCount = 1;
+		nrcInferIndexBufferBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		nrcInferIndexBufferBinding.pImmutableSamplers = nullptr;
 
 		VkDescriptorSetLayoutBinding nrcTrainRingBufferBinding;
 		nrcTrainRingBufferBinding.binding = bindingIndex++;
@@ -151,6 +151,13 @@ namespace en
 		uniformBufferBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 		uniformBufferBinding.pImmutableSamplers = nullptr;
 
+		VkDescriptorSetLayoutBinding nrcInferCountBufferBinding;
+		nrcInferCountBufferBinding.binding = bindingIndex++;
+		nrcInferCountBufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		nrcInferCountBufferBinding.descriptorCount = 1;
+		nrcInferCountBufferBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		nrcInferCountBufferBinding.pImmutableSamplers = nullptr;
+
 		std::vector<VkDescriptorSetLayoutBinding> bindings = {
 			outputImageBinding,
 			primaryRayColorImageBinding,
@@ -161,9 +168,10 @@ namespace en
 			nrcInferOutputBufferBinding,
 			nrcTrainInputBufferBinding,
 			nrcTrainTargetBufferBinding,
-			nrcInferFilterBufferBinding,
+			nrcInferIndexBufferBinding,
 			nrcTrainRingBufferBinding,
-			uniformBufferBinding
+			uniformBufferBinding,
+			nrcInferCountBufferBinding
 		};
 
 		VkDescriptorSetLayoutCreateInfo layoutCI;
@@ -181,9 +189,10 @@ namespace en
 		storageImagePS.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 		storageImagePS.descriptorCount = 5;
 
+		// Bindings 5 to 10 and 12
 		VkDescriptorPoolSize storageBufferPS;
-		storageBufferPS.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-		storageBufferPS.descriptorCount = 6;
+		storageBufferPS.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		storageBufferPS.descriptorCount = 7;
 
 		VkDescriptorPoolSize uniformBufferPS;
 		uniformBufferPS.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -234,6 +243,7 @@ namespace en
 		m_Camera(camera),
 		m_HpmScene(hpmScene),
 		m_Nrc(nrc),
+		m_NrcHostMemory(nrc.UsesHostMemory()),
 		m_UniformBuffer(
 			sizeof(UniformData), 
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
@@ -257,20 +267,22 @@ namespace en
 
 		CreateNrcBuffers();
 		m_Nrc.Init(
-			m_RenderWidth * m_RenderHeight,
-			reinterpret_cast<float*>(m_NrcInferInputDCuBuffer),
-			reinterpret_cast<float*>(m_NrcInferOutputDCuBuffer),
-			reinterpret_cast<float*>(m_NrcTrainInputDCuBuffer),
-			reinterpret_cast<float*>(m_NrcTrainTargetDCuBuffer),
+			m_MaxNrcInferCount,
+			m_NrcInferInputDCuBuffer,
+			m_NrcInferOutputDCuBuffer,
+			m_NrcTrainInputDCuBuffer,
+			m_NrcTrainTargetDCuBuffer,
+			reinterpret_cast<const uint32_t*>(m_NrcInferCountDCuBuffer),
 			m_CuExtCudaStartSemaphore, 
 			m_CuExtCudaFinishedSemaphore);
-		CreateNrcInferFilterBuffer();
+		CreateNrcInferIndexBuffer();
 		CreateNrcTrainRingBuffer();
 
-		m_CommandPool.AllocateBuffers(3, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-		m_PreCudaCommandBuffer = m_CommandPool.GetBuffer(0);
-		m_PostCudaCommandBuffer = m_CommandPool.GetBuffer(1);
-		m_RandomTasksCmdBuf = m_CommandPool.GetBuffer(2);
+		// One pre cuda command buffer per train slot, the others follow the post cuda and random ones
+		m_CommandPool.AllocateBuffers(2 + m_Nrc.GetTrainSlotCount(), VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		m_PostCudaCommandBuffer = m_CommandPool.GetBuffer(0);
+		m_RandomTasksCmdBuf = m_CommandPool.GetBuffer(1);
+		for (uint32_t slot = 0; slot < m_Nrc.GetTrainSlotCount(); slot++) { m_PreCudaCommandBuffers.push_back(m_CommandPool.GetBuffer(2 + slot)); }
 
 		CreatePipelineLayout(device);
 
@@ -292,7 +304,7 @@ namespace en
 
 		CreateQueryPool(device);
 
-		RecordPreCudaCommandBuffer();
+		RecordPreCudaCommandBuffers();
 		RecordPostCudaCommandBuffer();
 	}
 
@@ -307,40 +319,69 @@ namespace en
 		// Generate random
 		m_UniformData.random = glm::linearRand(glm::vec4(0.0f), glm::vec4(1.0f));
 
+		// Frame value of the timeline semaphores and the train slot that the pre cuda commands clear and
+		// prep_train_rays writes. A pipelined training of the last frame only reads the other slot, on the
+		// device and in the training thread of host memory backends, which the next InferAndTrain awaits.
+		m_CudaSyncValue++;
+		m_UniformData.trainSlot = static_cast<uint32_t>(m_CudaSyncValue % m_Nrc.GetTrainSlotCount());
+
 		// Update uniform buffer
 		m_UniformBuffer.SetData(sizeof(UniformData), &m_UniformData, 0, 0);
 
 		// Update blending index
 		if (m_ShouldBlend) { m_BlendIndex++; }
 		
-		// Pre cuda
+		// Pre cuda waits for the inference of the last frame, which cuda runs after the training of the
+		// frame before it. So pipelined training can still read the train slot of the last frame, but
+		// not the one this frame writes.
+		const uint64_t preWaitValue = m_CudaSyncValue - 1;
+		VkTimelineSemaphoreSubmitInfo preTimelineSubmitInfo;
+		preTimelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		preTimelineSubmitInfo.pNext = nullptr;
+		preTimelineSubmitInfo.waitSemaphoreValueCount = 1;
+		preTimelineSubmitInfo.pWaitSemaphoreValues = &preWaitValue;
+		preTimelineSubmitInfo.signalSemaphoreValueCount = 1;
+		preTimelineSubmitInfo.pSignalSemaphoreValues = &m_CudaSyncValue;
+
+		VkPipelineStageFlags preWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
 		VkSubmitInfo submitInfo;
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.pNext = nullptr;
-		submitInfo.waitSemaphoreCount = 0;
-		submitInfo.pWaitSemaphores = nullptr;
-		submitInfo.pWaitDstStageMask = nullptr;
+		submitInfo.pNext = m_NrcHostMemory ? nullptr : &preTimelineSubmitInfo;
+		submitInfo.waitSemaphoreCount = m_NrcHostMemory ? 0 : 1;
+		submitInfo.pWaitSemaphores = m_NrcHostMemory ? nullptr : &m_CudaFinishedSemaphore;
+		submitInfo.pWaitDstStageMask = m_NrcHostMemory ? nullptr : &preWaitStage;
 		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_PreCudaCommandBuffer;
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &m_CudaStartSemaphore;
+		submitInfo.pCommandBuffers = &m_PreCudaCommandBuffers[m_UniformData.trainSlot];
+		submitInfo.signalSemaphoreCount = m_NrcHostMemory ? 0 : 1;
+		submitInfo.pSignalSemaphores = m_NrcHostMemory ? nullptr : &m_CudaStartSemaphore;
 
-		VkResult result = vkQueueSubmit(queue, 1, &submitInfo, m_PreCudaFence);
+		// Cuda only waits for the start semaphore, the infer count stays on the gpu. Host memory backends
+		// read the nrc buffers after the fence.
+		VkResult result = vkQueueSubmit(queue, 1, &submitInfo, m_NrcHostMemory ? m_PreCudaFence : VK_NULL_HANDLE);
 		ASSERT_VULKAN(result);
 
-		// Sync infer filter
-		ASSERT_VULKAN(vkWaitForFences(VulkanAPI::GetDevice(), 1, &m_PreCudaFence, VK_TRUE, UINT64_MAX));
-		m_NrcInferFilterStagingBuffer->GetData(m_NrcInferFilterBufferSize, m_NrcInferFilterData, 0, 0);
-		ASSERT_VULKAN(vkResetFences(VulkanAPI::GetDevice(), 1, &m_PreCudaFence));
+		if (m_NrcHostMemory)
+		{
+			ASSERT_VULKAN(vkWaitForFences(VulkanAPI::GetDevice(), 1, &m_PreCudaFence, VK_TRUE, UINT64_MAX));
+			ASSERT_VULKAN(vkResetFences(VulkanAPI::GetDevice(), 1, &m_PreCudaFence));
+		}
 
 		// Cuda
-		m_Nrc.InferAndTrain(reinterpret_cast<uint32_t*>(m_NrcInferFilterData), train);
+		m_Nrc.InferAndTrain(train, m_CudaSyncValue);
+
+		// Post cuda waits for the inference of this frame
+		VkTimelineSemaphoreSubmitInfo postTimelineSubmitInfo;
+		postTimelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		postTimelineSubmitInfo.pNext = nullptr;
+		postTimelineSubmitInfo.waitSemaphoreValueCount = 1;
+		postTimelineSubmitInfo.pWaitSemaphoreValues = &m_CudaSyncValue;
+		postTimelineSubmitInfo.signalSemaphoreValueCount = 0;
+		postTimelineSubmitInfo.pSignalSemaphoreValues = nullptr;
 
-		// Post cuda
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.pNext = nullptr;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &m_CudaFinishedSemaphore;
+		submitInfo.pNext = m_NrcHostMemory ? nullptr : &postTimelineSubmitInfo;
+		submitInfo.waitSemaphoreCount = m_NrcHostMemory ? 0 : 1;
+		submitInfo.pWaitSemaphores = m_NrcHostMemory ? nullptr : &m_CudaFinishedSemaphore;
 		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
 		submitInfo.pWaitDstStageMask = &waitStage;
 		submitInfo.commandBufferCount = 1;
@@ -356,6 +397,9 @@ namespace en
 	{
 		VkDevice device = VulkanAPI::GetDevice();
 
+		// Pipelined training may still read the nrc buffers
+		m_Nrc.AwaitTraining();
+
 		m_CommandPool.Destroy();
 
 		m_UniformBuffer.Destroy();
@@ -402,36 +446,52 @@ namespace en
 		m_NrcTrainRingBuffer->Destroy();
 		delete m_NrcTrainRingBuffer;
 
-		m_NrcInferFilterBuffer->Destroy();
-		delete m_NrcInferFilterBuffer;
-		m_NrcInferFilterStagingBuffer->Destroy();
-		delete m_NrcInferFilterStagingBuffer;
-		delete m_NrcInferFilterData;
+		m_NrcInferIndexBuffer->Destroy();
+		delete m_NrcInferIndexBuffer;
+
+		if (m_NrcHostMemory)
+		{
+			m_NrcInferCountBuffer->UnmapMemory();
+			m_NrcTrainTargetBuffer->UnmapMemory();
+			m_NrcTrainInputBuffer->UnmapMemory();
+			m_NrcInferOutputBuffer->UnmapMemory();
+			m_NrcInferInputBuffer->UnmapMemory();
+		}
+		else
+		{
+			ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcInferCountCuExtMem));
+			ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcTrainTargetCuExtMem));
+			ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcTrainInputCuExtMem));
+			ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcInferOutputCuExtMem));
+			ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcInferInputCuExtMem));
+		}
+
+		m_NrcInferCountBuffer->Destroy();
+		delete m_NrcInferCountBuffer;
 
 		m_NrcTrainTargetBuffer->Destroy();
 		delete m_NrcTrainTargetBuffer;
-		ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcTrainTargetCuExtMem));
 
 		m_NrcTrainInputBuffer->Destroy();
 		delete m_NrcTrainInputBuffer;
-		ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcTrainInputCuExtMem));
 
 		m_NrcInferOutputBuffer->Destroy();
 		delete m_NrcInferOutputBuffer;
-		ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcInferOutputCuExtMem));
 
 		m_NrcInferInputBuffer->Destroy();
 		delete m_NrcInferInputBuffer;
-		ASSERT_CUDA(cudaDestroyExternalMemory(m_NrcInferInputCuExtMem));
 
 		vkDestroyFence(device, m_PostCudaFence, nullptr);
 		vkDestroyFence(device, m_PreCudaFence, nullptr);
 
-		vkDestroySemaphore(device, m_CudaFinishedSemaphore, nullptr);
-		ASSERT_CUDA(cudaDestroyExternalSemaphore(m_CuExtCudaFinishedSemaphore));
-		
-		vkDestroySemaphore(device, m_CudaStartSemaphore, nullptr);
-		ASSERT_CUDA(cudaDestroyExternalSemaphore(m_CuExtCudaStartSemaphore));
+		if (!m_NrcHostMemory)
+		{
+			vkDestroySemaphore(device, m_CudaFinishedSemaphore, nullptr);
+			ASSERT_CUDA(cudaDestroyExternalSemaphore(m_CuExtCudaFinishedSemaphore));
+
+			vkDestroySemaphore(device, m_CudaStartSemaphore, nullptr);
+			ASSERT_CUDA(cudaDestroyExternalSemaphore(m_CuExtCudaStartSemaphore));
+		}
 	}
 
 	void NrcHpmRenderer::ExportOutputImageToFile(VkQueue queue, const std::string& filePath) const
@@ -522,12 +582,14 @@ namespace en
 		ImGui::Text("Clear Buffers Time %f ms", m_TimePeriods[periodIndex++]);
 		ImGui::Text("GenRays Time %f ms", m_TimePeriods[periodIndex++]);
 		ImGui::Text("PrepInferRays Time %f ms", m_TimePeriods[periodIndex++]);
-		ImGui::Text("Copy Infer Filter Time %f ms", m_TimePeriods[periodIndex++]);
 		ImGui::Text("PrepTrainRays Time %f ms", m_TimePeriods[periodIndex++]);
 		ImGui::Text("Cuda Time %f ms", m_TimePeriods[periodIndex++]);
 		ImGui::Text("Render Time %f ms", m_TimePeriods[periodIndex++]);
 		ImGui::Text("Total Time %f ms", m_TimePeriods[periodIndex++]);
 		ImGui::Text("Theoretical FPS %f", 1000.0f / m_TimePeriods[c_QueryCount - 1]);
+		ImGui::Text("NRC %s, train %f samples/s", m_NrcHostMemory ? "cpu" : "tcnn", m_Nrc.GetTrainSamplesPerSecond());
+		ImGui::Text("NRC infer samples %u", m_Nrc.GetInferCount());
+		ImGui::Text("NRC %s %f ms", m_Nrc.IsPipelined() ? "train wait" : "train", m_Nrc.GetTrainTime());
 
 		ImGui::Checkbox("Show NRC", reinterpret_cast<bool*>(&m_UniformData.showNrc));
 
@@ -614,7 +676,7 @@ namespace en
 		ASSERT_VULKAN(vkQueueWaitIdle(queue));
 
 		// Rerecord cmd buf
-		RecordPreCudaCommandBuffer();
+		RecordPreCudaCommandBuffers();
 		RecordPostCudaCommandBuffer();
 	}
 
@@ -667,49 +729,60 @@ namespace en
 	{
 		Log::Info("NrcHpmRenderer: Creating sync objects");
 
-		// Create vk semaphore
-		VkExportSemaphoreCreateInfoKHR vulkanExportSemaphoreCreateInfo = {};
-		vulkanExportSemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO_KHR;
-		vulkanExportSemaphoreCreateInfo.pNext = nullptr;
+		// Host memory backends run between the fence wait and the next submit without semaphores
+		if (!m_NrcHostMemory)
+		{
+			// Create vk semaphore
+			VkExportSemaphoreCreateInfoKHR vulkanExportSemaphoreCreateInfo = {};
+			vulkanExportSemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO_KHR;
+			vulkanExportSemaphoreCreateInfo.pNext = nullptr;
 #ifdef _WIN64
-		vulkanExportSemaphoreCreateInfo.handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32_BIT;
+			vulkanExportSemaphoreCreateInfo.handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32_BIT;
 #else
-		vulkanExportSemaphoreCreateInfo.handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+			vulkanExportSemaphoreCreateInfo.handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
 #endif
 
-		VkSemaphoreCreateInfo semaphoreCI;
-		semaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		semaphoreCI.pNext = &vulkanExportSemaphoreCreateInfo;
-		semaphoreCI.flags = 0;
+			// Timeline semaphores count the frames, see Render
+			VkSemaphoreTypeCreateInfo semaphoreTypeCI;
+			semaphoreTypeCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+			semaphoreTypeCI.pNext = &vulkanExportSemaphoreCreateInfo;
+			semaphoreTypeCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			semaphoreTypeCI.initialValue = 0;
 
-		VkResult result = vkCreateSemaphore(device, &semaphoreCI, nullptr, &m_CudaStartSemaphore);
-		ASSERT_VULKAN(result);
+			VkSemaphoreCreateInfo semaphoreCI;
+			semaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			semaphoreCI.pNext = &semaphoreTypeCI;
+			semaphoreCI.flags = 0;
 
-		result = vkCreateSemaphore(device, &semaphoreCI, nullptr, &m_CudaFinishedSemaphore);
-		ASSERT_VULKAN(result);
+			VkResult result = vkCreateSemaphore(device, &semaphoreCI, nullptr, &m_CudaStartSemaphore);
+			ASSERT_VULKAN(result);
 
-		// Export semaphore to cuda
-		cudaExternalSemaphoreHandleDesc extCudaSemaphoreHD{};
+			result = vkCreateSemaphore(device, &semaphoreCI, nullptr, &m_CudaFinishedSemaphore);
+			ASSERT_VULKAN(result);
+
+			// Export semaphore to cuda
+			cudaExternalSemaphoreHandleDesc extCudaSemaphoreHD{};
 #ifdef _WIN64
-		extCudaSemaphoreHD.type = cudaExternalSemaphoreHandleTypeOpaqueWin32;
+			extCudaSemaphoreHD.type = cudaExternalSemaphoreHandleTypeTimelineSemaphoreWin32;
 #else
-		extCudaSemaphoreHD.type = cudaExternalSemaphoreHandleTypeOpaqueFd;
+			extCudaSemaphoreHD.type = cudaExternalSemaphoreHandleTypeTimelineSemaphoreFd;
 #endif
 
 #ifdef _WIN64
-		extCudaSemaphoreHD.handle.win32.handle = GetSemaphoreHandle(device, m_CudaStartSemaphore);
-		ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaStartSemaphore, &extCudaSemaphoreHD));
+			extCudaSemaphoreHD.handle.win32.handle = GetSemaphoreHandle(device, m_CudaStartSemaphore);
+			ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaStartSemaphore, &extCudaSemaphoreHD));
 		
-		extCudaSemaphoreHD.handle.win32.handle = GetSemaphoreHandle(device, m_CudaFinishedSemaphore);
-		ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaFinishedSemaphore, &extCudaSemaphoreHD));
+			extCudaSemaphoreHD.handle.win32.handle = GetSemaphoreHandle(device, m_CudaFinishedSemaphore);
+			ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaFinishedSemaphore, &extCudaSemaphoreHD));
 #else
-		extCudaSemaphoreHD.handle.fd = GetSemaphoreHandle(device, m_CudaStartSemaphore);
-		ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaStartSemaphore, &extCudaSemaphoreHD));
+			extCudaSemaphoreHD.handle.fd = GetSemaphoreHandle(device, m_CudaStartSemaphore);
+			ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaStartSemaphore, &extCudaSemaphoreHD));
 		
-		extCudaSemaphoreHD.handle.fd= GetSemaphoreHandle(device, m_CudaFinishedSemaphore);
-		ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaFinishedSemaphore, &extCudaSemaphoreHD));
+			extCudaSemaphoreHD.handle.fd= GetSemaphoreHandle(device, m_CudaFinishedSemaphore);
+			ASSERT_CUDA(cudaImportExternalSemaphore(&m_CuExtCudaFinishedSemaphore, &extCudaSemaphoreHD));
 #endif
-	
+		}
+
 		// Create fence
 		VkFenceCreateInfo fenceCI{};
 		fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
@@ -723,15 +796,37 @@ namespace en
 	{
 		Log::Info("NrcHpmRenderer: Creating nrc buffers");
 
-		// Calculate sizes
-		const size_t inferCount = m_RenderWidth * m_RenderHeight;
-		//inferCount += m_Nrc.GetInferBatchSize() - (inferCount % m_Nrc.GetTrainBatchSize());
+		// Calculate sizes, the packed infer samples get room for the padding of the last batch
+		const uint32_t granularity = NeuralRadianceCache::sc_BatchGranularity;
+		m_MaxNrcInferCount = (((m_RenderWidth * m_RenderHeight) + granularity - 1) / granularity) * granularity;
+		const size_t inferCount = m_MaxNrcInferCount;
 		const size_t trainCount = m_TrainWidth * m_TrainHeight;
 
-		m_NrcInferInputBufferSize = inferCount * NeuralRadianceCache::sc_InputCount * sizeof(float);
-		m_NrcInferOutputBufferSize = inferCount * NeuralRadianceCache::sc_OutputCount * sizeof(float);
-		m_NrcTrainInputBufferSize = trainCount * NeuralRadianceCache::sc_InputCount * sizeof(float);
-		m_NrcTrainTargetBufferSize = trainCount * NeuralRadianceCache::sc_OutputCount * sizeof(float);
+		m_NrcInferInputBufferSize = inferCount * m_Nrc.GetInputSampleSize();
+		m_NrcInferOutputBufferSize = inferCount * m_Nrc.GetOutputSampleSize();
+		m_NrcTrainInputBufferSize = trainCount * m_Nrc.GetTrainSlotCount() * m_Nrc.GetInputSampleSize();
+		m_NrcTrainTargetBufferSize = trainCount * m_Nrc.GetTrainSlotCount() * m_Nrc.GetOutputSampleSize();
+		m_NrcInferCountBufferSize = sizeof(uint32_t);
+
+		// Host memory backends work on the mapped buffers, no cuda memory is imported
+		if (m_NrcHostMemory)
+		{
+			Log::Info("Creating host visible VkBuffers");
+			const VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			m_NrcInferInputBuffer = new vk::Buffer(m_NrcInferInputBufferSize, hostMemory, usage, {});
+			m_NrcInferOutputBuffer = new vk::Buffer(m_NrcInferOutputBufferSize, hostMemory, usage, {});
+			m_NrcTrainInputBuffer = new vk::Buffer(m_NrcTrainInputBufferSize, hostMemory, usage, {});
+			m_NrcTrainTargetBuffer = new vk::Buffer(m_NrcTrainTargetBufferSize, hostMemory, usage, {});
+			m_NrcInferCountBuffer = new vk::Buffer(m_NrcInferCountBufferSize, hostMemory, usage, {});
+
+			m_NrcInferInputBuffer->MapMemory(0, &m_NrcInferInputDCuBuffer);
+			m_NrcInferOutputBuffer->MapMemory(0, &m_NrcInferOutputDCuBuffer);
+			m_NrcTrainInputBuffer->MapMemory(0, &m_NrcTrainInputDCuBuffer);
+			m_NrcTrainTargetBuffer->MapMemory(0, &m_NrcTrainTargetDCuBuffer);
+			m_NrcInferCountBuffer->MapMemory(0, &m_NrcInferCountDCuBuffer);
+			return;
+		}
 
 		// Create buffers
 #ifdef _WIN64
@@ -769,6 +864,13 @@ namespace en
 			{},
 			extMemType);
 
+		m_NrcInferCountBuffer = new vk::Buffer(
+			m_NrcInferCountBufferSize,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			{},
+			extMemType);
+
 		// Get cuda external memory
 		Log::Info("Retreiving cuda external memory");
 #ifdef _WIN64
@@ -794,6 +896,11 @@ namespace en
 		cuExtMemHandleDesc.size = m_NrcTrainTargetBufferSize;
 		cudaResult = cudaImportExternalMemory(&m_NrcTrainTargetCuExtMem, &cuExtMemHandleDesc);
 		ASSERT_CUDA(cudaResult);
+
+		cuExtMemHandleDesc.handle.win32.handle = m_NrcInferCountBuffer->GetMemoryWin32Handle();
+		cuExtMemHandleDesc.size = m_NrcInferCountBufferSize;
+		cudaResult = cudaImportExternalMemory(&m_NrcInferCountCuExtMem, &cuExtMemHandleDesc);
+		ASSERT_CUDA(cudaResult);
 #else
 		cudaExternalMemoryHandleDesc cuExtMemHandleDesc{};
 		cuExtMemHandleDesc.type = cudaExternalMemoryHandleTypeOpaqueFd;
@@ -817,6 +924,11 @@ namespace en
 		cuExtMemHandleDesc.size = m_NrcTrainTargetBufferSize;
 		cudaResult = cudaImportExternalMemory(&m_NrcTrainTargetCuExtMem, &cuExtMemHandleDesc);
 		ASSERT_CUDA(cudaResult);
+
+		cuExtMemHandleDesc.handle.fd = m_NrcInferCountBuffer->GetMemoryFd();
+		cuExtMemHandleDesc.size = m_NrcInferCountBufferSize;
+		cudaResult = cudaImportExternalMemory(&m_NrcInferCountCuExtMem, &cuExtMemHandleDesc);
+		ASSERT_CUDA(cudaResult);
 #endif
 
 		// Get cuda buffer
@@ -840,23 +952,19 @@ namespace en
 		cudaExtBufferDesc.size = m_NrcTrainTargetBufferSize;
 		cudaResult = cudaExternalMemoryGetMappedBuffer(&m_NrcTrainTargetDCuBuffer, m_NrcTrainTargetCuExtMem, &cudaExtBufferDesc);
 		ASSERT_CUDA(cudaResult);
+
+		cudaExtBufferDesc.size = m_NrcInferCountBufferSize;
+		cudaResult = cudaExternalMemoryGetMappedBuffer(&m_NrcInferCountDCuBuffer, m_NrcInferCountCuExtMem, &cudaExtBufferDesc);
+		ASSERT_CUDA(cudaResult);
 	}
 
-	void NrcHpmRenderer::CreateNrcInferFilterBuffer()
+	void NrcHpmRenderer::CreateNrcInferIndexBuffer()
 	{
-		m_NrcInferFilterBufferSize = sizeof(uint32_t) * m_Nrc.GetInferBatchCount();
-		m_NrcInferFilterData = malloc(m_NrcInferFilterBufferSize);
-		
-		m_NrcInferFilterStagingBuffer = new vk::Buffer(
-			m_NrcInferFilterBufferSize,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			{});
-
-		m_NrcInferFilterBuffer = new vk::Buffer(
-			m_NrcInferFilterBufferSize,
+		m_NrcInferIndexBufferSize = sizeof(uint32_t) * m_RenderWidth * m_RenderHeight;
+		m_NrcInferIndexBuffer = new vk::Buffer(
+			m_NrcInferIndexBufferSize,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 			{});
 	}
 
@@ -929,9 +1037,7 @@ namespace en
 
 	void NrcHpmRenderer::InitSpecializationConstants()
 	{
-		const VkExtent3D volumeSizeUI = m_HpmScene.GetVolumeData()->GetExtent();
-		glm::vec3 volumeSizeF = { volumeSizeUI.width, volumeSizeUI.height, volumeSizeUI.depth };
-		volumeSizeF = glm::normalize(volumeSizeF) * 107.5f;
+		const glm::vec3 volumeSizeF = m_HpmScene.GetVolumeData()->GetSize();
 
 		// Fill struct
 		m_SpecData.renderWidth = m_RenderWidth;
@@ -957,6 +1063,33 @@ namespace en
 
 		m_SpecData.hdrEnvMapStrength = m_HpmScene.GetHdrEnvMap()->GetStrength();
 
+		const VkExtent3D volumeExtent = m_HpmScene.GetVolumeData()->GetExtent();
+		m_SpecData.volumeVoxelsX = volumeExtent.width;
+		m_SpecData.volumeVoxelsY = volumeExtent.height;
+		m_SpecData.volumeVoxelsZ = volumeExtent.depth;
+
+		m_SpecData.densityLodMode = static_cast<uint32_t>(m_HpmScene.GetVolumeData()->GetDensityLodMode());
+		m_SpecData.densityLodSpread = m_HpmScene.GetVolumeData()->GetDensityLodSpread();
+
+		const glm::vec3 volumePos = m_HpmScene.GetVolumeData()->GetPosition();
+		m_SpecData.volumePosX = volumePos.x;
+		m_SpecData.volumePosY = volumePos.y;
+		m_SpecData.volumePosZ = volumePos.z;
+
+		m_SpecData.traversalStats = m_HpmScene.GetVolumeData()->IsTraversalStatsEnabled() ? VK_TRUE : VK_FALSE;
+
+		const ShadowTransmittance& shadowTransmittance = m_HpmScene.GetVolumeData()->GetShadowTransmittance();
+		m_SpecData.dirLightTransmittance = static_cast<uint32_t>(shadowTransmittance.dirLight);
+		m_SpecData.pointLightTransmittance = static_cast<uint32_t>(shadowTransmittance.pointLight);
+		m_SpecData.hdrEnvMapTransmittance = static_cast<uint32_t>(shadowTransmittance.hdrEnvMap);
+		m_SpecData.residualControl = static_cast<uint32_t>(shadowTransmittance.residualControl);
+
+		m_SpecData.freeFlightMode = static_cast<uint32_t>(m_HpmScene.GetVolumeData()->GetFreeFlightMode());
+
+		m_SpecData.phaseFunc = static_cast<uint32_t>(m_HpmScene.GetVolumeData()->GetPhaseFuncMode());
+
+		m_SpecData.nrcHalfIo = m_Nrc.UsesHalfIo() ? VK_TRUE : VK_FALSE;
+
 		// Init map entries
 		uint32_t constantID = 0;
 
@@ -1055,6 +1188,86 @@ namespace en
 		hdrEnvMapStrengthEntry.offset = offsetof(SpecializationData, SpecializationData::hdrEnvMapStrength);
 		hdrEnvMapStrengthEntry.size = sizeof(float);
 
+		VkSpecializationMapEntry volumeVoxelsXEntry;
+		volumeVoxelsXEntry.constantID = constantID++;
+		volumeVoxelsXEntry.offset = offsetof(SpecializationData, SpecializationData::volumeVoxelsX);
+		volumeVoxelsXEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry volumeVoxelsYEntry;
+		volumeVoxelsYEntry.constantID = constantID++;
+		volumeVoxelsYEntry.offset = offsetof(SpecializationData, SpecializationData::volumeVoxelsY);
+		volumeVoxelsYEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry volumeVoxelsZEntry;
+		volumeVoxelsZEntry.constantID = constantID++;
+		volumeVoxelsZEntry.offset = offsetof(SpecializationData, SpecializationData::volumeVoxelsZ);
+		volumeVoxelsZEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry densityLodModeEntry;
+		densityLodModeEntry.constantID = constantID++;
+		densityLodModeEntry.offset = offsetof(SpecializationData, SpecializationData::densityLodMode);
+		densityLodModeEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry densityLodSpreadEntry;
+		densityLodSpreadEntry.constantID = constantID++;
+		densityLodSpreadEntry.offset = offsetof(SpecializationData, SpecializationData::densityLodSpread);
+		densityLodSpreadEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry volumePosXEntry;
+		volumePosXEntry.constantID = constantID++;
+		volumePosXEntry.offset = offsetof(SpecializationData, SpecializationData::volumePosX);
+		volumePosXEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry volumePosYEntry;
+		volumePosYEntry.constantID = constantID++;
+		volumePosYEntry.offset = offsetof(SpecializationData, SpecializationData::volumePosY);
+		volumePosYEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry volumePosZEntry;
+		volumePosZEntry.constantID = constantID++;
+		volumePosZEntry.offset = offsetof(SpecializationData, SpecializationData::volumePosZ);
+		volumePosZEntry.size = sizeof(float);
+
+		VkSpecializationMapEntry traversalStatsEntry;
+		traversalStatsEntry.constantID = constantID++;
+		traversalStatsEntry.offset = offsetof(SpecializationData, SpecializationData::traversalStats);
+		traversalStatsEntry.size = sizeof(VkBool32);
+
+		VkSpecializationMapEntry dirLightTransmittanceEntry;
+		dirLightTransmittanceEntry.constantID = constantID++;
+		dirLightTransmittanceEntry.offset = offsetof(SpecializationData, SpecializationData::dirLightTransmittance);
+		dirLightTransmittanceEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry pointLightTransmittanceEntry;
+		pointLightTransmittanceEntry.constantID = constantID++;
+		pointLightTransmittanceEntry.offset = offsetof(SpecializationData, SpecializationData::pointLightTransmittance);
+		pointLightTransmittanceEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry hdrEnvMapTransmittanceEntry;
+		hdrEnvMapTransmittanceEntry.constantID = constantID++;
+		hdrEnvMapTransmittanceEntry.offset = offsetof(SpecializationData, SpecializationData::hdrEnvMapTransmittance);
+		hdrEnvMapTransmittanceEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry residualControlEntry;
+		residualControlEntry.constantID = constantID++;
+		residualControlEntry.offset = offsetof(SpecializationData, SpecializationData::residualControl);
+		residualControlEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry freeFlightModeEntry;
+		freeFlightModeEntry.constantID = constantID++;
+		freeFlightModeEntry.offset = offsetof(SpecializationData, SpecializationData::freeFlightMode);
+		freeFlightModeEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry phaseFuncEntry;
+		phaseFuncEntry.constantID = constantID++;
+		phaseFuncEntry.offset = offsetof(SpecializationData, SpecializationData::phaseFunc);
+		phaseFuncEntry.size = sizeof(uint32_t);
+
+		VkSpecializationMapEntry nrcHalfIoEntry;
+		nrcHalfIoEntry.constantID = constantID++;
+		nrcHalfIoEntry.offset = offsetof(SpecializationData, SpecializationData::nrcHalfIo);
+		nrcHalfIoEntry.size = sizeof(VkBool32);
+
 		m_SpecMapEntries = {
 			renderWidthEntry,
 			renderHeightEntry,
@@ -1073,7 +1286,23 @@ namespace en
 			volumeSizeZEntry,
 			volumeDensityFactorEntry,
 			volumeGEntry,
-			hdrEnvMapStrengthEntry
+			hdrEnvMapStrengthEntry,
+			volumeVoxelsXEntry,
+			volumeVoxelsYEntry,
+			volumeVoxelsZEntry,
+			densityLodModeEntry,
+			densityLodSpreadEntry,
+			volumePosXEntry,
+			volumePosYEntry,
+			volumePosZEntry,
+			traversalStatsEntry,
+			dirLightTransmittanceEntry,
+			pointLightTransmittanceEntry,
+			hdrEnvMapTransmittanceEntry,
+			residualControlEntry,
+			freeFlightModeEntry,
+			phaseFuncEntry,
+			nrcHalfIoEntry
 		};
 
 		m_SpecInfo.mapEntryCount = m_SpecMapEntries.size();
@@ -1898,22 +2127,22 @@ namespace en
 		nrcTrainTargetBufferWrite.pBufferInfo = &nrcTrainTargetBufferInfo;
 		nrcTrainTargetBufferWrite.pTexelBufferView = nullptr;
 
-		VkDescriptorBufferInfo nrcInferFilterBufferInfo;
-		nrcInferFilterBufferInfo.buffer = m_NrcInferFilterBuffer->GetVulkanHandle();
-		nrcInferFilterBufferInfo.offset = 0;
-		nrcInferFilterBufferInfo.range = m_NrcInferFilterBufferSize;
-
-		VkWriteDescriptorSet nrcInferFilterBufferWrite;
-		nrcInferFilterBufferWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		nrcInferFilterBufferWrite.pNext = nullptr;
-		nrcInferFilterBufferWrite.dstSet = m_DescSet;
-		nrcInferFilterBufferWrite.dstBinding = bindingIndex++;
-		nrcInferFilterBufferWrite.dstArrayElement = 0;
-		nrcInferFilterBufferWrite.descriptorCount = 1;
-		nrcInferFilterBufferWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		nrcInferFilterBufferWrite.pImageInfo = nullptr;
-		nrcInferFilterBufferWrite.pBufferInfo = &nrcInferFilterBufferInfo;
-		nrcInferFilterBufferWrite.pTexelBufferView = nullptr;
+		VkDescriptorBufferInfo nrcInferIndexBufferInfo;
+		nrcInferIndexBufferInfo.buffer = m_NrcInferIndexBuffer->GetVulkanHandle();
+		nrcInferIndexBufferInfo.offset = 0;
+		nrcInferIndexBufferInfo.range = m_NrcInferIndexBufferSize;
+
+		VkWriteDescriptorSet nrcInferIndexBufferWrite;
+		nrcInferIndexBufferWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		nrcInferIndexBufferWrite.pNext = nullptr;
+		nrcInferIndexBufferWrite.dstSet = m_DescSet;
+		nrcInferIndexBufferWrite.dstBinding = bindingIndex++;
+		nrcInferIndexBufferWrite.dstArrayElement = 0;
+		nrcInferIndexBufferWrite.descriptorCount = 1;
+		nrcInferIndexBufferWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		nrcInferIndexBufferWrite.pImageInfo = nullptr;
+		nrcInferIndexBufferWrite.pBufferInfo = &nrcInferIndexBufferInfo;
+		nrcInferIndexBufferWrite.pTexelBufferView = nullptr;
 
 		VkDescriptorBufferInfo nrcTrainRingBufferInfo;
 		nrcTrainRingBufferInfo.buffer = m_NrcTrainRingBuffer->GetVulkanHandle();
@@ -1950,6 +2179,23 @@ namespace en
 		uniformBufferWrite.pBufferInfo = &uniformBufferInfo;
 		uniformBufferWrite.pTexelBufferView = nullptr;
 
+		VkDescriptorBufferInfo nrcInferCountBufferInfo;
+		nrcInferCountBufferInfo.buffer = m_NrcInferCountBuffer->GetVulkanHandle();
+		nrcInferCountBufferInfo.offset = 0;
+		nrcInferCountBufferInfo.range = m_NrcInferCountBufferSize;
+
+		VkWriteDescriptorSet nrcInferCountBufferWrite;
+		nrcInferCountBufferWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		nrcInferCountBufferWrite.pNext = nullptr;
+		nrcInferCountBufferWrite.dstSet = m_DescSet;
+		nrcInferCountBufferWrite.dstBinding = bindingIndex++;
+		nrcInferCountBufferWrite.dstArrayElement = 0;
+		nrcInferCountBufferWrite.descriptorCount = 1;
+		nrcInferCountBufferWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		nrcInferCountBufferWrite.pImageInfo = nullptr;
+		nrcInferCountBufferWrite.pBufferInfo = &nrcInferCountBufferInfo;
+		nrcInferCountBufferWrite.pTexelBufferView = nullptr;
+
 		// Write writes
 		std::vector<VkWriteDescriptorSet> writes = { 
 			outputImageWrite,
@@ -1961,9 +2207,10 @@ namespace en
 			nrcInferOutputBufferWrite,
 			nrcTrainInputBufferWrite,
 			nrcTrainTargetBufferWrite,
-			nrcInferFilterBufferWrite,
+			nrcInferIndexBufferWrite,
 			nrcTrainRingBufferWrite,
-			uniformBufferWrite
+			uniformBufferWrite,
+			nrcInferCountBufferWrite
 		};
 
 		vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, nullptr);
@@ -1982,8 +2229,14 @@ namespace en
 		ASSERT_VULKAN(vkCreateQueryPool(device, &queryPoolCI, nullptr, &m_QueryPool));
 	}
 
-	void NrcHpmRenderer::RecordPreCudaCommandBuffer()
+	void NrcHpmRenderer::RecordPreCudaCommandBuffers()
+	{
+		for (uint32_t slot = 0; slot < m_PreCudaCommandBuffers.size(); slot++) { RecordPreCudaCommandBuffer(slot); }
+	}
+
+	void NrcHpmRenderer::RecordPreCudaCommandBuffer(uint32_t trainSlot)
 	{
+		VkCommandBuffer commandBuffer = m_PreCudaCommandBuffers[trainSlot];
 		m_QueryIndex = 0;
 
 		// Begin
@@ -1993,7 +2246,7 @@ namespace en
 		beginInfo.flags = 0;
 		beginInfo.pInheritanceInfo = nullptr;
 		
-		VkResult result = vkBeginCommandBuffer(m_PreCudaCommandBuffer, &beginInfo);
+		VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
 		ASSERT_VULKAN(result);
 		
 		// Collect descriptor sets
@@ -2004,68 +2257,93 @@ namespace en
 
 		// Bind descriptor sets
 		vkCmdBindDescriptorSets(
-			m_PreCudaCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout,
+			commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout,
 			0, descSets.size(), descSets.data(),
 			0, nullptr);
 
 		// Reset query pool
-		vkCmdResetQueryPool(m_PreCudaCommandBuffer, m_QueryPool, 0, c_QueryCount);
+		vkCmdResetQueryPool(commandBuffer, m_QueryPool, 0, c_QueryCount);
 		
 		// Timestamp
-		vkCmdWriteTimestamp(m_PreCudaCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, m_QueryIndex++);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, m_QueryIndex++);
 
 		// Clear buffers
-		vkCmdFillBuffer(m_PreCudaCommandBuffer, m_NrcInferInputBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
-		vkCmdFillBuffer(m_PreCudaCommandBuffer, m_NrcInferOutputBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
-		vkCmdFillBuffer(m_PreCudaCommandBuffer, m_NrcTrainInputBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
-		vkCmdFillBuffer(m_PreCudaCommandBuffer, m_NrcTrainTargetBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
-		vkCmdFillBuffer(m_PreCudaCommandBuffer, m_NrcInferFilterBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
+		vkCmdFillBuffer(commandBuffer, m_NrcInferInputBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
+		vkCmdFillBuffer(commandBuffer, m_NrcInferOutputBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
+		// Only the train slot of this frame, pipelined training may still read the other one
+		const VkDeviceSize trainInputSlotSize = m_NrcTrainInputBufferSize / m_PreCudaCommandBuffers.size();
+		const VkDeviceSize trainTargetSlotSize = m_NrcTrainTargetBufferSize / m_PreCudaCommandBuffers.size();
+		vkCmdFillBuffer(commandBuffer, m_NrcTrainInputBuffer->GetVulkanHandle(), trainSlot * trainInputSlotSize, trainInputSlotSize, 0);
+		vkCmdFillBuffer(commandBuffer, m_NrcTrainTargetBuffer->GetVulkanHandle(), trainSlot * trainTargetSlotSize, trainTargetSlotSize, 0);
+		vkCmdFillBuffer(commandBuffer, m_NrcInferCountBuffer->GetVulkanHandle(), 0, VK_WHOLE_SIZE, 0);
+
+		// The fills have to land before the shaders write the buffers and count the infer samples
+		VkMemoryBarrier fillBarrier;
+		fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		fillBarrier.pNext = nullptr;
+		fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1,
+			&fillBarrier,
+			0,
+			nullptr,
+			0,
+			nullptr);
 
 		// Clear using shader
-		vkCmdBindPipeline(m_PreCudaCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ClearPipeline);
-		vkCmdDispatch(m_PreCudaCommandBuffer, 1, 1, 1);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ClearPipeline);
+		vkCmdDispatch(commandBuffer, 1, 1, 1);
 
 		// Timestamp
-		vkCmdWriteTimestamp(m_PreCudaCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
 
 		// Gen rays pipeline
-		vkCmdBindPipeline(m_PreCudaCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_GenRaysPipeline);
-		vkCmdDispatch(m_PreCudaCommandBuffer, m_RenderWidth / 32, m_RenderHeight, 1);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_GenRaysPipeline);
+		vkCmdDispatch(commandBuffer, m_RenderWidth / 32, m_RenderHeight, 1);
 
 		// Timestamp
-		vkCmdWriteTimestamp(m_PreCudaCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
 
 		// Prep infer rays
-		vkCmdBindPipeline(m_PreCudaCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PrepInferRaysPipeline);
-		vkCmdDispatch(m_PreCudaCommandBuffer, m_RenderWidth / 32, m_RenderHeight, 1);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PrepInferRaysPipeline);
+		vkCmdDispatch(commandBuffer, m_RenderWidth / 32, m_RenderHeight, 1);
 
-		// Timestamp
-		vkCmdWriteTimestamp(m_PreCudaCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
-
-		// Copy nrc infer filter buffer to host
-		VkBufferCopy nrcInferFilterCopy;
-		nrcInferFilterCopy.srcOffset = 0;
-		nrcInferFilterCopy.dstOffset = 0;
-		nrcInferFilterCopy.size = m_NrcInferFilterBufferSize;
-		vkCmdCopyBuffer(
-			m_PreCudaCommandBuffer, 
-			m_NrcInferFilterBuffer->GetVulkanHandle(), 
-			m_NrcInferFilterStagingBuffer->GetVulkanHandle(), 
-			1, 
-			&nrcInferFilterCopy);
 
 		// Timestamp
-		vkCmdWriteTimestamp(m_PreCudaCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
 
 		// Prep train rays
-		vkCmdBindPipeline(m_PreCudaCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PrepTrainRaysPipeline);
-		vkCmdDispatch(m_PreCudaCommandBuffer, m_TrainWidth / 32, m_TrainHeight, 1);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PrepTrainRaysPipeline);
+		vkCmdDispatch(commandBuffer, m_TrainWidth / 32, m_TrainHeight, 1);
 
 		// Timestamp
-		vkCmdWriteTimestamp(m_PreCudaCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_QueryPool, m_QueryIndex++);
+
+		// Make the infer count and the nrc inputs of host memory backends visible to the host
+		VkMemoryBarrier hostReadBarrier;
+		hostReadBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		hostReadBarrier.pNext = nullptr;
+		hostReadBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		hostReadBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT,
+			0,
+			1,
+			&hostReadBarrier,
+			0,
+			nullptr,
+			0,
+			nullptr);
 		
 		// End
-		result = vkEndCommandBuffer(m_PreCudaCommandBuffer);
+		result = vkEndCommandBuffer(commandBuffer);
 		ASSERT_VULKAN(result);
 	}
 
@@ -0,0 +1,316 @@
+#include <engine/objects/OccupancyGrid.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+namespace en
+{
+	// The minimum is rounded down to the steps of R8_UNORM, so it also bounds the quantized density
+	// that the shaders fetch
+	constexpr float c_MinQuantization = 255.0f;
+
+	OccupancyGrid::OccupancyGrid(const DensityGrid& densityGrid, const MajorantGrid& majorantGrid) :
+		m_MajorantGrid(majorantGrid),
+		m_CellCount(majorantGrid.GetGrid().GetWidth(), majorantGrid.GetGrid().GetHeight(), majorantGrid.GetGrid().GetDepth()),
+		m_MinGrid(majorantGrid.GetGrid().GetWidth(), majorantGrid.GetGrid().GetHeight(), majorantGrid.GetGrid().GetDepth())
+	{
+		const int width = static_cast<int>(densityGrid.GetWidth());
+		const int height = static_cast<int>(densityGrid.GetHeight());
+		const int depth = static_cast<int>(densityGrid.GetDepth());
+		const int size = static_cast<int>(majorantGrid.GetCellSize());
+
+		// Same voxels as the majorant of the cell, including the one voxel border
+		tbb::parallel_for(0u, m_MinGrid.GetDepth(), [&](uint32_t cellZ)
+			{
+				for (uint32_t cellY = 0; cellY < m_MinGrid.GetHeight(); cellY++)
+				{
+					for (uint32_t cellX = 0; cellX < m_MinGrid.GetWidth(); cellX++)
+					{
+						// Empty cells are skipped without reading their voxels
+						if (majorantGrid.GetGrid().GetValue(cellX, cellY, cellZ) <= 0.0f)
+						{
+							m_MinGrid.GetData()[m_MinGrid.GetIndex(cellX, cellY, cellZ)] = 0.0f;
+							continue;
+						}
+
+						const int x0 = std::max(static_cast<int>(cellX) * size - 1, 0);
+						const int y0 = std::max(static_cast<int>(cellY) * size - 1, 0);
+						const int z0 = std::max(static_cast<int>(cellZ) * size - 1, 0);
+						const int x1 = std::min((static_cast<int>(cellX) + 1) * size, width - 1);
+						const int y1 = std::min((static_cast<int>(cellY) + 1) * size, height - 1);
+						const int z1 = std::min((static_cast<int>(cellZ) + 1) * size, depth - 1);
+
+						float minVal = 1.0f;
+						for (int z = z0; z <= z1; z++)
+						{
+							for (int y = y0; y <= y1; y++)
+							{
+								const float* row = densityGrid.GetData() + densityGrid.GetIndex(0, y, z);
+								minVal = std::min(minVal, *std::min_element(row + x0, row + x1 + 1));
+							}
+						}
+
+						m_MinGrid.GetData()[m_MinGrid.GetIndex(cellX, cellY, cellZ)] =
+							std::max(std::floor(minVal * c_MinQuantization) / c_MinQuantization, 0.0f);
+					}
+				}
+			});
+
+		BuildMask();
+	}
+
+	OccupancyGrid::OccupancyGrid(const MajorantGrid& majorantGrid, DensityGrid minCells) :
+		m_MajorantGrid(majorantGrid),
+		m_CellCount(majorantGrid.GetGrid().GetWidth(), majorantGrid.GetGrid().GetHeight(), majorantGrid.GetGrid().GetDepth()),
+		m_MinGrid(std::move(minCells))
+	{
+		if (m_MinGrid.GetWidth() != majorantGrid.GetGrid().GetWidth() ||
+			m_MinGrid.GetHeight() != majorantGrid.GetGrid().GetHeight() ||
+			m_MinGrid.GetDepth() != majorantGrid.GetGrid().GetDepth())
+		{
+			Log::Error("Minimum cells do not match the majorant grid", true);
+		}
+
+		BuildMask();
+	}
+
+	bool OccupancyGrid::IsBlockOccupied(const glm::ivec3& block) const
+	{
+		const size_t word =
+			static_cast<size_t>(block.x / sc_MaskWordBits) +
+			static_cast<size_t>(m_MaskExtent.x) * (block.y + static_cast<size_t>(m_MaskExtent.y) * block.z);
+		return (m_Mask[word] >> (block.x % sc_MaskWordBits)) & 1u;
+	}
+
+	float OccupancyGrid::GetCellMinimum(const glm::ivec3& cell) const
+	{
+		return m_MinGrid.GetValue(cell.x, cell.y, cell.z);
+	}
+
+	bool OccupancyGrid::InitTraversal(const glm::vec3& uvwOrigin, const glm::vec3& uvwDir, float tMax, MajorantGrid::Traversal& traversal, TraversalStats* stats) const
+	{
+		if (!m_MajorantGrid.InitTraversal(uvwOrigin, uvwDir, tMax, traversal)) { return false; }
+		if (!SkipEmptyBlocks(traversal, stats)) { return false; }
+		if (stats != nullptr) { stats->sampledCells++; }
+		return true;
+	}
+
+	bool OccupancyGrid::StepTraversal(MajorantGrid::Traversal& traversal, TraversalStats* stats) const
+	{
+		traversal.t = m_MajorantGrid.GetCellExit(traversal);
+		if (traversal.t >= traversal.tEnd) { return false; }
+
+		int axis = 0;
+		if (traversal.tNext.y < traversal.tNext[axis]) { axis = 1; }
+		if (traversal.tNext.z < traversal.tNext[axis]) { axis = 2; }
+
+		traversal.cell[axis] += traversal.step[axis];
+		traversal.tNext[axis] += traversal.tDelta[axis];
+		if (traversal.cell[axis] < 0 || traversal.cell[axis] >= m_CellCount[axis]) { return false; }
+
+		// The block only changes when the step crossed a block boundary
+		const int cellInBlock = traversal.cell[axis] % static_cast<int>(sc_BlockSize);
+		if (cellInBlock == (traversal.step[axis] > 0 ? 0 : static_cast<int>(sc_BlockSize) - 1))
+		{
+			if (!SkipEmptyBlocks(traversal, stats)) { return false; }
+		}
+
+		if (stats != nullptr) { stats->sampledCells++; }
+		return true;
+	}
+
+	void OccupancyGrid::LogTraversalStats(uint32_t rayCount) const
+	{
+		tbb::combinable<size_t> flatCellCount([]() { return 0; });
+		tbb::combinable<TraversalStats> hierarchicalStats;
+
+		// Same rays for both walks, everything in normalized texture coordinates
+		const auto makeRay = [](uint32_t i, glm::vec3& uvwOrigin, glm::vec3& uvwDir)
+		{
+			std::minstd_rand rng(i + 1);
+			std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+			const float cosTheta = 2.0f * dist(rng) - 1.0f;
+			const float phi = 2.0f * 3.14159265f * dist(rng);
+			const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+			uvwOrigin = glm::vec3(0.5f) + glm::vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+			uvwDir = glm::normalize(glm::vec3(dist(rng), dist(rng), dist(rng)) - uvwOrigin);
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		tbb::parallel_for(tbb::blocked_range<uint32_t>(0, rayCount), [&](const tbb::blocked_range<uint32_t>& range)
+			{
+				size_t& cells = flatCellCount.local();
+				for (uint32_t i = range.begin(); i < range.end(); i++)
+				{
+					glm::vec3 uvwOrigin, uvwDir;
+					makeRay(i, uvwOrigin, uvwDir);
+					MajorantGrid::Traversal traversal;
+					if (!m_MajorantGrid.InitTraversal(uvwOrigin, uvwDir, 4.0f, traversal)) { continue; }
+					do { cells++; } while (m_MajorantGrid.StepTraversal(traversal));
+				}
+			});
+		auto end = std::chrono::steady_clock::now();
+		const double flatMS = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+
+		start = std::chrono::steady_clock::now();
+		tbb::parallel_for(tbb::blocked_range<uint32_t>(0, rayCount), [&](const tbb::blocked_range<uint32_t>& range)
+			{
+				TraversalStats& stats = hierarchicalStats.local();
+				for (uint32_t i = range.begin(); i < range.end(); i++)
+				{
+					glm::vec3 uvwOrigin, uvwDir;
+					makeRay(i, uvwOrigin, uvwDir);
+					MajorantGrid::Traversal traversal;
+					if (!InitTraversal(uvwOrigin, uvwDir, 4.0f, traversal, &stats)) { continue; }
+					while (StepTraversal(traversal, &stats)) {}
+				}
+			});
+		end = std::chrono::steady_clock::now();
+		const double hierarchicalMS = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+
+		const TraversalStats stats = hierarchicalStats.combine([](const TraversalStats& a, const TraversalStats& b)
+			{
+				TraversalStats sum;
+				sum.sampledCells = a.sampledCells + b.sampledCells;
+				sum.skippedCells = a.skippedCells + b.skippedCells;
+				sum.skippedBlocks = a.skippedBlocks + b.skippedBlocks;
+				return sum;
+			});
+		const double rays = static_cast<double>(rayCount);
+		const double flatAvg = static_cast<double>(flatCellCount.combine(std::plus<size_t>())) / rays;
+		Log::Info(
+			"Cells per ray: flat " + std::to_string(flatAvg) +
+			" | hierarchical sampled " + std::to_string(static_cast<double>(stats.sampledCells) / rays) +
+			", skipped " + std::to_string(static_cast<double>(stats.skippedCells) / rays) +
+			" in " + std::to_string(static_cast<double>(stats.skippedBlocks) / rays) + " blocks" +
+			" | " + std::to_string(flatMS) + "ms vs " + std::to_string(hierarchicalMS) + "ms");
+	}
+
+	glm::uvec3 OccupancyGrid::GetBlockCount() const
+	{
+		return m_BlockCount;
+	}
+
+	glm::uvec3 OccupancyGrid::GetMaskExtent() const
+	{
+		return m_MaskExtent;
+	}
+
+	const std::vector<uint32_t>& OccupancyGrid::GetMask() const
+	{
+		return m_Mask;
+	}
+
+	const DensityGrid& OccupancyGrid::GetMinGrid() const
+	{
+		return m_MinGrid;
+	}
+
+	void OccupancyGrid::BuildMask()
+	{
+		m_BlockCount = (glm::uvec3(m_CellCount) + sc_BlockSize - 1u) / sc_BlockSize;
+		m_MaskExtent = glm::uvec3((m_BlockCount.x + sc_MaskWordBits - 1) / sc_MaskWordBits, m_BlockCount.y, m_BlockCount.z);
+		m_Mask.assign(static_cast<size_t>(m_MaskExtent.x) * m_MaskExtent.y * m_MaskExtent.z, 0u);
+
+		// One mask row per task, so no two tasks write the same word
+		const DensityGrid& cells = m_MajorantGrid.GetGrid();
+		tbb::parallel_for(0u, m_BlockCount.y * m_BlockCount.z, [&](uint32_t row)
+			{
+				const uint32_t blockY = row % m_BlockCount.y;
+				const uint32_t blockZ = row / m_BlockCount.y;
+				for (uint32_t blockX = 0; blockX < m_BlockCount.x; blockX++)
+				{
+					bool occupied = false;
+					for (uint32_t z = blockZ * sc_BlockSize; z < std::min((blockZ + 1) * sc_BlockSize, cells.GetDepth()) && !occupied; z++)
+					{
+						for (uint32_t y = blockY * sc_BlockSize; y < std::min((blockY + 1) * sc_BlockSize, cells.GetHeight()) && !occupied; y++)
+						{
+							for (uint32_t x = blockX * sc_BlockSize; x < std::min((blockX + 1) * sc_BlockSize, cells.GetWidth()) && !occupied; x++)
+							{
+								occupied = cells.GetValue(x, y, z) > 0.0f;
+							}
+						}
+					}
+
+					if (occupied)
+					{
+						const size_t word = (blockX / sc_MaskWordBits) + static_cast<size_t>(m_MaskExtent.x) * row;
+						m_Mask[word] |= 1u << (blockX % sc_MaskWordBits);
+					}
+				}
+			});
+
+		size_t occupiedCount = 0;
+		for (const uint32_t word : m_Mask)
+		{
+			for (uint32_t bits = word; bits != 0; bits &= bits - 1) { occupiedCount++; }
+		}
+		const size_t blockCount = static_cast<size_t>(m_BlockCount.x) * m_BlockCount.y * m_BlockCount.z;
+		Log::Info(
+			"Built occupancy grid (" + std::to_string(m_BlockCount.x) + "x" + std::to_string(m_BlockCount.y) +
+			"x" + std::to_string(m_BlockCount.z) + " blocks of " + std::to_string(sc_BlockSize) + "^3 cells), " +
+			std::to_string(100.0 * static_cast<double>(occupiedCount) / static_cast<double>(blockCount)) + "% occupied");
+	}
+
+	bool OccupancyGrid::SkipEmptyBlocks(MajorantGrid::Traversal& traversal, TraversalStats* stats) const
+	{
+		const int blockSize = static_cast<int>(sc_BlockSize);
+		while (!IsBlockOccupied(traversal.cell / blockSize))
+		{
+			// Cells left to walk inside of the block on every axis and the ray parameter at which the
+			// walk would leave the block through each of them. This is the flat DDA fast forwarded, so
+			// both walks end up in the same cell.
+			glm::ivec3 cellsLeft;
+			glm::vec3 tExit;
+			for (int i = 0; i < 3; i++)
+			{
+				const int blockMin = traversal.cell[i] - (traversal.cell[i] % blockSize);
+				const int blockMax = std::min(blockMin + blockSize, m_CellCount[i]) - 1;
+				cellsLeft[i] = traversal.step[i] > 0 ? blockMax - traversal.cell[i] : traversal.cell[i] - blockMin;
+				tExit[i] = traversal.tNext[i] + static_cast<float>(cellsLeft[i]) * traversal.tDelta[i];
+			}
+
+			int axis = 0;
+			if (tExit.y < tExit[axis]) { axis = 1; }
+			if (tExit.z < tExit[axis]) { axis = 2; }
+			const float t = tExit[axis];
+
+			size_t skippedCells = 1 + cellsLeft[axis];
+			for (int i = 0; i < 3; i++)
+			{
+				if (i == axis) { continue; }
+				// Boundaries that the ray crosses on the other axes before it leaves the block. Crossings at
+				// exactly t are left to the next step, like the flat walk does for ties.
+				int crossings = 0;
+				if (traversal.tNext[i] < t)
+				{
+					// Truncation is the floor here, the quotient is positive
+					crossings = std::min(static_cast<int>((t - traversal.tNext[i]) / traversal.tDelta[i]) + 1, cellsLeft[i]);
+				}
+				traversal.cell[i] += crossings * traversal.step[i];
+				traversal.tNext[i] += static_cast<float>(crossings) * traversal.tDelta[i];
+				skippedCells += crossings;
+			}
+			traversal.cell[axis] += (cellsLeft[axis] + 1) * traversal.step[axis];
+			traversal.tNext[axis] = t + traversal.tDelta[axis];
+			traversal.t = std::min(t, traversal.tEnd);
+
+			if (stats != nullptr)
+			{
+				stats->skippedCells += skippedCells;
+				stats->skippedBlocks++;
+			}
+
+			if (t >= traversal.tEnd) { return false; }
+			if (traversal.cell[axis] < 0 || traversal.cell[axis] >= m_CellCount[axis]) { return false; }
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,210 @@
+#include <engine/objects/PhaseFunction.hpp>
+#include <engine/util/read_file.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <cmath>
+
+namespace en
+{
+	constexpr double c_Pi = 3.14159265358979323846;
+
+	// Intervals of the integration of the density while building the tables, evenly spaced in the
+	// warped coordinate of the density table
+	constexpr uint32_t c_PhaseFuncIntegrationSteps = 1 << 16;
+
+	// x = ((1 - cos theta) / 2)^(1/4) of the density table to cos theta
+	static double WarpToCosTheta(double x)
+	{
+		const double x2 = x * x;
+		return 1.0 - (2.0 * x2 * x2);
+	}
+
+	double HgPhaseFunc(double g, double cosTheta)
+	{
+		// 1 + g^2 - 2g cos theta without the cancellation for g and cos theta close to 1
+		const double denom = ((1.0 - g) * (1.0 - g)) + (2.0 * g * (1.0 - cosTheta));
+		return 0.5 * (1.0 - (g * g)) / (denom * std::sqrt(denom));
+	}
+
+	double DrainePhaseFunc(double g, double alpha, double cosTheta)
+	{
+		return HgPhaseFunc(g, cosTheta) * (1.0 + (alpha * cosTheta * cosTheta)) / (1.0 + (alpha * (1.0 + (2.0 * g * g)) / 3.0));
+	}
+
+	double ApproximateMiePhaseFunc(double dropletDiameter, double cosTheta)
+	{
+		const double d = dropletDiameter;
+		const double gHg = std::exp(-0.0990567 / (d - 1.67154));
+		const double gDraine = std::exp((-2.20679 / (d + 3.91029)) - 0.428934);
+		const double alpha = std::exp(3.62489 - (8.29288 / (d + 5.52825)));
+		const double wDraine = std::exp((-0.599085 / (d - 0.641583)) - 0.665888);
+		return ((1.0 - wDraine) * HgPhaseFunc(gHg, cosTheta)) + (wDraine * DrainePhaseFunc(gDraine, alpha, cosTheta));
+	}
+
+	void BuildOrthonormalBasis(const glm::vec3& n, glm::vec3& b1, glm::vec3& b2)
+	{
+		const float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+		const float a = -1.0f / (sign + n.z);
+		const float b = n.x * n.y * a;
+		b1 = glm::vec3(1.0f + (sign * n.x * n.x * a), sign * b, -sign * n.x);
+		b2 = glm::vec3(b, sign + (n.y * n.y * a), -n.y);
+	}
+
+	PhaseFunction::PhaseFunction(float g) :
+		m_Mode(PhaseFuncMode::HenyeyGreenstein),
+		m_G(g)
+	{
+		BuildTables([g](double cosTheta) { return HgPhaseFunc(g, cosTheta); });
+	}
+
+	PhaseFunction::PhaseFunction(PhaseFuncMode mode, const std::function<double(double)>& density) :
+		m_Mode(mode),
+		m_G(0.0f)
+	{
+		if (mode == PhaseFuncMode::HenyeyGreenstein) { Log::Error("PhaseFunction takes the asymmetry for Henyey-Greenstein", true); }
+		BuildTables(density);
+	}
+
+	float PhaseFunction::Eval(float cosTheta) const
+	{
+		if (m_Mode == PhaseFuncMode::HenyeyGreenstein) { return static_cast<float>(HgPhaseFunc(m_G, cosTheta)); }
+
+		const float x = std::sqrt(std::sqrt(std::clamp(0.5f - (0.5f * cosTheta), 0.0f, 1.0f))) * static_cast<float>(sc_TableSize - 1);
+		const uint32_t i = std::min(static_cast<uint32_t>(x), sc_TableSize - 2);
+		return glm::mix(m_Table[sc_TableSize + i], m_Table[sc_TableSize + i + 1], x - static_cast<float>(i));
+	}
+
+	float PhaseFunction::SampleOneMinusCosTheta(float u) const
+	{
+		if (m_Mode == PhaseFuncMode::HenyeyGreenstein)
+		{
+			// Inverse cdf (1 + g^2 - sqrTerm^2) / 2g subtracted from 1 and factored, so nothing cancels
+			if (std::abs(m_G) < 0.001f) { return 2.0f * u; }
+			const float sqrTerm = (1.0f - m_G * m_G) / (1.0f - m_G + (2.0f * m_G * u));
+			return std::clamp((1.0f - m_G) * (1.0f - u) * (sqrTerm + 1.0f - m_G) / (1.0f - m_G + (2.0f * m_G * u)), 0.0f, 2.0f);
+		}
+
+		const float t = std::clamp(u, 0.0f, 1.0f) * static_cast<float>(sc_TableSize - 1);
+		const uint32_t i = std::min(static_cast<uint32_t>(t), sc_TableSize - 2);
+		return glm::mix(m_Table[i], m_Table[i + 1], t - static_cast<float>(i));
+	}
+
+	glm::vec3 PhaseFunction::Sample(const glm::vec3& dir, float u0, float u1) const
+	{
+		const float oneMinusCosTheta = SampleOneMinusCosTheta(u0);
+		const float cosTheta = 1.0f - oneMinusCosTheta;
+		const float sinTheta = std::sqrt(std::max(0.0f, oneMinusCosTheta * (2.0f - oneMinusCosTheta)));
+		const float phi = 2.0f * static_cast<float>(c_Pi) * u1;
+
+		glm::vec3 b1;
+		glm::vec3 b2;
+		BuildOrthonormalBasis(dir, b1, b2);
+		return (sinTheta * std::cos(phi) * b1) + (sinTheta * std::sin(phi) * b2) + (cosTheta * dir);
+	}
+
+	PhaseFuncMode PhaseFunction::GetMode() const
+	{
+		return m_Mode;
+	}
+
+	float PhaseFunction::GetG() const
+	{
+		return m_G;
+	}
+
+	const std::vector<float>& PhaseFunction::GetTable() const
+	{
+		return m_Table;
+	}
+
+	void PhaseFunction::BuildTables(const std::function<double(double)>& density)
+	{
+		// Trapezoidal rule over cos theta on intervals that are even in the warped coordinate, so the
+		// forward peak is resolved. Interval j goes from cos theta at x_j down to x_(j + 1).
+		const uint32_t n = c_PhaseFuncIntegrationSteps;
+		std::vector<double> cosThetas(n + 1);
+		std::vector<double> densities(n + 1);
+		tbb::parallel_for(0u, n + 1, [&](uint32_t j)
+			{
+				cosThetas[j] = WarpToCosTheta(static_cast<double>(j) / static_cast<double>(n));
+				densities[j] = std::max(density(cosThetas[j]), 0.0);
+			});
+
+		// cdf[j] is the mass between cos theta -1 and cosThetas[j]
+		std::vector<double> cdf(n + 1);
+		cdf[n] = 0.0;
+		double meanCosine = 0.0;
+		for (uint32_t j = n; j > 0; j--)
+		{
+			const double mass = 0.5 * (densities[j - 1] + densities[j]) * (cosThetas[j - 1] - cosThetas[j]);
+			cdf[j - 1] = cdf[j] + mass;
+			meanCosine += mass * 0.5 * (cosThetas[j - 1] + cosThetas[j]);
+		}
+		const double totalMass = cdf[0];
+		if (!(totalMass > 0.0)) { Log::Error("PhaseFunction density has no mass", true); }
+
+		if (m_Mode != PhaseFuncMode::HenyeyGreenstein) { m_G = static_cast<float>(meanCosine / totalMass); }
+
+		m_Table.resize(2 * sc_TableSize);
+
+		// Inverse cdf, the cdf grows with j going down, density is constant inside of an interval
+		m_Table[0] = 2.0f;
+		m_Table[sc_TableSize - 1] = 0.0f;
+		uint32_t j = n;
+		for (uint32_t i = 1; i < sc_TableSize - 1; i++)
+		{
+			const double target = totalMass * static_cast<double>(i) / static_cast<double>(sc_TableSize - 1);
+			while (j > 0 && cdf[j - 1] < target) { j--; }
+			if (j == 0)
+			{
+				m_Table[i] = 0.0f;
+				continue;
+			}
+
+			// 1 - cos theta from the warped coordinate instead of cosThetas, which lost its small values
+			const double mass = cdf[j - 1] - cdf[j];
+			const double t = mass > 0.0 ? (target - cdf[j]) / mass : 0.0;
+			const double oneMinusCos0 = 1.0 - WarpToCosTheta(static_cast<double>(j - 1) / static_cast<double>(n));
+			const double oneMinusCos1 = 1.0 - WarpToCosTheta(static_cast<double>(j) / static_cast<double>(n));
+			m_Table[i] = static_cast<float>(oneMinusCos1 + (t * (oneMinusCos0 - oneMinusCos1)));
+		}
+
+		for (uint32_t i = 0; i < sc_TableSize; i++)
+		{
+			const double cosTheta = WarpToCosTheta(static_cast<double>(i) / static_cast<double>(sc_TableSize - 1));
+			m_Table[sc_TableSize + i] = static_cast<float>(std::max(density(cosTheta), 0.0) / totalMass);
+		}
+	}
+
+	PhaseFunction CreatePhaseFunction(const PhaseFuncConfig& config, float g)
+	{
+		switch (config.mode)
+		{
+		case PhaseFuncMode::ApproximateMie:
+		{
+			const float dropletDiameter = config.mieDiameter;
+			return PhaseFunction(
+				PhaseFuncMode::ApproximateMie,
+				[dropletDiameter](double cosTheta) { return ApproximateMiePhaseFunc(dropletDiameter, cosTheta); });
+		}
+		case PhaseFuncMode::Tabulated:
+		{
+			// Values over theta, linear in theta between them
+			const std::vector<float> values = ReadFilePhaseFunc(config.tablePath);
+			const double last = static_cast<double>(values.size() - 1);
+			return PhaseFunction(
+				PhaseFuncMode::Tabulated,
+				[values, last](double cosTheta)
+				{
+					const double t = std::acos(std::clamp(cosTheta, -1.0, 1.0)) / c_Pi * last;
+					const size_t i = std::min(static_cast<size_t>(t), values.size() - 2);
+					const double f = t - static_cast<double>(i);
+					return ((1.0 - f) * values[i]) + (f * values[i + 1]);
+				});
+		}
+		default:
+			return PhaseFunction(g);
+		}
+	}
+}
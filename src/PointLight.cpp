@@ -136,6 +136,11 @@ namespace en
 		}
 	}
 
+	glm::vec3 PointLight::GetPos() const
+	{
+		return m_UniformData.pos;
+	}
+
 	VkDescriptorSet PointLight::GetDescriptorSet() const
 	{
 		return m_DescSet;
@@ -1,12 +1,24 @@
 #include <engine/graphics/Reference.hpp>
 #include <filesystem>
+#include <algorithm>
 #include <engine/graphics/renderer/McHpmRenderer.hpp>
+#include <engine/graphics/renderer/CpuHpmRenderer.hpp>
+#include <engine/HpmSceneSetup.hpp>
 #include <engine/graphics/VulkanAPI.hpp>
 #include <engine/graphics/vulkan/CommandRecorder.hpp>
 #include <tinyexr.h>
 
 namespace en
 {
+	// Reference image setup shared by the GPU and the CPU generation
+	const uint32_t c_RefPathLength = 64;
+	const uint32_t c_RefFrameCount = 8192;
+
+	static std::string GetRefDirPath(uint32_t sceneID)
+	{
+		return "reference/" + std::to_string(sceneID) + "/";
+	}
+
 	float Reference::Result::GetBias() const
 	{
 		return ownMean - refMean;
@@ -124,6 +136,8 @@ namespace en
 			renderer.SetCamera(queue, m_RefCamera);
 			renderer.Render(queue);
 			ASSERT_VULKAN(vkQueueWaitIdle(queue));
+			// Time of this frame, so that the mse can be weighed against the render time
+			renderer.EvaluateTimestampQueries();
 
 			// Update
 			UpdateDescriptor(m_RefImageView, renderer.GetImageView());
@@ -450,13 +464,13 @@ namespace en
 		const float aspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
 
 		m_RefCamera = new en::Camera(
-			glm::vec3(64.0f, 0.0f, 0.0f),
-			glm::vec3(-1.0f, 0.0f, 0.0f),
-			glm::vec3(0.0f, 1.0f, 0.0f),
+			HpmSceneSetup::sc_CameraPos,
+			HpmSceneSetup::sc_CameraViewDir,
+			HpmSceneSetup::sc_CameraUp,
 			aspectRatio,
-			glm::radians(60.0f),
-			0.1f,
-			100.0f);
+			HpmSceneSetup::sc_CameraFov,
+			HpmSceneSetup::sc_CameraNearPlane,
+			HpmSceneSetup::sc_CameraFarPlane);
 	}
 
 	void Reference::CreateRefImages(VkQueue queue)
@@ -573,7 +587,7 @@ namespace en
 		const uint32_t sceneID = appConfig.scene.id;
 
 		// Create reference folder if not exists
-		std::string referenceDirPath = "reference/" + std::to_string(sceneID) + "/";
+		std::string referenceDirPath = GetRefDirPath(sceneID);
 #if __cplusplus >= 201703L
 		en::Log::Warn("C++ version lower then 17. Cant create reference data");
 #else
@@ -583,7 +597,7 @@ namespace en
 			en::Log::Info("Reference folder for scene " + std::to_string(sceneID) + " was not found. Creating reference images");
 
 			// Create reference renderer
-			McHpmRenderer refRenderer(m_Width, m_Height, 64, true, m_RefCamera, scene);
+			McHpmRenderer refRenderer(m_Width, m_Height, c_RefPathLength, true, m_RefCamera, scene, true);
 
 			// Create folder
 			try
@@ -600,7 +614,7 @@ namespace en
 				en::Log::Info("Generating reference image " + std::to_string(0));
 
 				// Generate reference image
-				const size_t referenceFrameCount = 8192;
+				const size_t referenceFrameCount = c_RefFrameCount;
 				for (size_t frame = 0; frame < referenceFrameCount; frame++)
 				{
 					if (frame % 1000 == 0)
@@ -687,6 +701,51 @@ namespace en
 		stagingBuffer.Destroy();
 	}
 
+	void Reference::GenRefImagesCpu(const AppConfig& appConfig, uint32_t width, uint32_t height)
+	{
+		const uint32_t sceneID = appConfig.scene.id;
+		const std::string referenceDirPath = GetRefDirPath(sceneID);
+		if (std::filesystem::exists(referenceDirPath + "0.exr"))
+		{
+			en::Log::Info("Reference image for scene " + std::to_string(sceneID) + " already exists");
+			return;
+		}
+
+		try
+		{
+			std::filesystem::create_directories(referenceDirPath);
+		}
+		catch (const std::filesystem::filesystem_error& e)
+		{
+			en::Log::Error(e.what(), true);
+		}
+
+		// Like the gpu reference, shadow rays always use ratio tracking and paths delta tracking, the
+		// biased estimators would otherwise end up in the reference
+		AppConfig refConfig = appConfig;
+		refConfig.shadowTransmittance = ShadowTransmittance();
+		refConfig.freeFlightMode = FreeFlightMode::DeltaTracking;
+		CpuHpmRenderer refRenderer(width, height, c_RefPathLength, refConfig);
+		refRenderer.SetCamera(
+			HpmSceneSetup::sc_CameraPos,
+			HpmSceneSetup::sc_CameraViewDir,
+			HpmSceneSetup::sc_CameraUp,
+			static_cast<float>(width) / static_cast<float>(height),
+			HpmSceneSetup::sc_CameraFov,
+			HpmSceneSetup::sc_CameraNearPlane,
+			HpmSceneSetup::sc_CameraFarPlane);
+
+		// Render in batches to report progress
+		en::Log::Info("Generating reference image " + std::to_string(0) + " on the CPU");
+		const uint32_t batchSize = 64;
+		while (refRenderer.GetSampleCount() < c_RefFrameCount)
+		{
+			refRenderer.Render(std::min(batchSize, c_RefFrameCount - refRenderer.GetSampleCount()));
+		}
+
+		refRenderer.ExportOutputImageToFile(referenceDirPath + std::to_string(0) + ".exr");
+	}
+
 	void Reference::CopyToRefImage(uint32_t imageIdx, VkImage srcImage, VkQueue queue)
 	{
 		VkCommandBufferBeginInfo beginInfo = {};
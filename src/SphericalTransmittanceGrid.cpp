@@ -0,0 +1,130 @@
+#include <engine/objects/SphericalTransmittanceGrid.hpp>
+#include <engine/objects/TransmittanceGrid.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <cmath>
+
+namespace en
+{
+	static const DensityGrid& GetDensityLevel(const DensityMipChain& densityMipChain)
+	{
+		if (densityMipChain.GetLevelCount() < TransmittanceGrid::sc_DensityLevel)
+		{
+			Log::Error("SphericalTransmittanceGrid needs density mip level " + std::to_string(TransmittanceGrid::sc_DensityLevel), true);
+		}
+		return densityMipChain.GetLevel(TransmittanceGrid::sc_DensityLevel);
+	}
+
+	static glm::vec2 SignNotZero(const glm::vec2& v)
+	{
+		return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	glm::vec2 SphericalTransmittanceGrid::OctEncode(const glm::vec3& dir)
+	{
+		const glm::vec3 n = dir / (std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z));
+		const glm::vec2 p = n.z >= 0.0f ? glm::vec2(n.x, n.y) : (1.0f - glm::abs(glm::vec2(n.y, n.x))) * SignNotZero(glm::vec2(n.x, n.y));
+		return (p * 0.5f) + 0.5f;
+	}
+
+	glm::vec3 SphericalTransmittanceGrid::OctDecode(const glm::vec2& uv)
+	{
+		const glm::vec2 p = (uv * 2.0f) - 1.0f;
+		glm::vec3 n(p, 1.0f - std::abs(p.x) - std::abs(p.y));
+		if (n.z < 0.0f)
+		{
+			const glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * SignNotZero(glm::vec2(n.x, n.y));
+			n.x = folded.x;
+			n.y = folded.y;
+		}
+		return glm::normalize(n);
+	}
+
+	SphericalTransmittanceGrid::SphericalTransmittanceGrid(
+		const DensityMipChain& densityMipChain,
+		const glm::uvec3& voxelExtent,
+		const glm::vec3& volumeSize,
+		const glm::vec3& volumePos,
+		float densityFactor)
+		:
+		m_Density(GetDensityLevel(densityMipChain)),
+		m_VoxelExtent(voxelExtent),
+		m_VolumeSize(volumeSize),
+		m_VolumePos(volumePos),
+		m_DensityFactor(densityFactor),
+		m_Transmittance(sc_DirResolution, sc_DirResolution, sc_DistanceResolution)
+	{
+	}
+
+	void SphericalTransmittanceGrid::BuildPointLight(const glm::vec3& lightPos)
+	{
+		m_LightPos = lightPos;
+		m_MaxDistance = glm::length(glm::abs(lightPos - m_VolumePos) + (0.5f * m_VolumeSize));
+
+		// Half a density cell per step, so every cell along a direction is seen
+		const glm::vec3 cellSize = m_VolumeSize / m_VoxelExtent * static_cast<float>(TransmittanceGrid::sc_CellSize);
+		const float maxStepSize = 0.5f * std::min(cellSize.x, std::min(cellSize.y, cellSize.z));
+		const float texelDistance = m_MaxDistance / static_cast<float>(sc_DistanceResolution);
+		const uint32_t stepsPerTexel = static_cast<uint32_t>(std::ceil(texelDistance / maxStepSize));
+		const float stepSize = texelDistance / static_cast<float>(stepsPerTexel);
+
+		tbb::parallel_for(0u, sc_DirResolution, [&](uint32_t y)
+			{
+				for (uint32_t x = 0; x < sc_DirResolution; x++)
+				{
+					const glm::vec2 uv(
+						(static_cast<float>(x) + 0.5f) / static_cast<float>(sc_DirResolution),
+						(static_cast<float>(y) + 0.5f) / static_cast<float>(sc_DirResolution));
+					const glm::vec3 dir = OctDecode(uv);
+
+					// Texel z lies at distance (z + 0.5) * texelDistance, the first one is reached after half a texel
+					float opticalDepth = 0.0f;
+					float t = 0.0f;
+					for (uint32_t z = 0; z < sc_DistanceResolution; z++)
+					{
+						const uint32_t stepCount = z == 0 ? (stepsPerTexel + 1) / 2 : stepsPerTexel;
+						const float texelStepSize = z == 0 ? 0.5f * texelDistance / static_cast<float>(stepCount) : stepSize;
+						for (uint32_t i = 0; i < stepCount; i++)
+						{
+							opticalDepth += GetDensity(lightPos + ((t + (0.5f * texelStepSize)) * dir)) * texelStepSize;
+							t += texelStepSize;
+						}
+						m_Transmittance.GetData()[m_Transmittance.GetIndex(x, y, z)] = std::exp(-opticalDepth);
+					}
+				}
+			});
+	}
+
+	float SphericalTransmittanceGrid::Sample(const glm::vec3& pos) const
+	{
+		const glm::vec3 toPos = pos - m_LightPos;
+		const float distance = glm::length(toPos);
+		const glm::vec2 uv = OctEncode(toPos / std::max(distance, 1e-6f));
+		return m_Transmittance.SampleTrilinear(uv.x, uv.y, distance / m_MaxDistance);
+	}
+
+	const glm::vec3& SphericalTransmittanceGrid::GetLightPos() const
+	{
+		return m_LightPos;
+	}
+
+	float SphericalTransmittanceGrid::GetMaxDistance() const
+	{
+		return m_MaxDistance;
+	}
+
+	const DensityGrid& SphericalTransmittanceGrid::GetGrid() const
+	{
+		return m_Transmittance;
+	}
+
+	float SphericalTransmittanceGrid::GetDensity(const glm::vec3& pos) const
+	{
+		const glm::vec3 uvw = ((pos - m_VolumePos) / m_VolumeSize) + 0.5f;
+		if (glm::any(glm::lessThan(uvw, glm::vec3(0.0f))) || glm::any(glm::greaterThanEqual(uvw, glm::vec3(1.0f)))) { return 0.0f; }
+
+		const glm::uvec3 cell = glm::uvec3(uvw * m_VoxelExtent) / TransmittanceGrid::sc_CellSize;
+		return m_DensityFactor * m_Density.GetValue(cell.x, cell.y, cell.z);
+	}
+}
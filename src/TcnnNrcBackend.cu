@@ -0,0 +1,64 @@
+#include <engine/graphics/TcnnNrcBackend.hpp>
+
+namespace en
+{
+	TcnnNrcBackend::TcnnNrcBackend(const AppConfig& appConfig, uint32_t inputCount, uint32_t outputCount) :
+		m_InputCount(inputCount),
+		m_OutputCount(outputCount)
+	{
+		nlohmann::json modelConfig = {
+			{"loss", {
+				{"otype", appConfig.lossFn}
+			}},
+			{"optimizer", {
+				{"otype", "EMA"},
+				{"decay", appConfig.emaDecay},
+				{"nested", {
+					{"otype", appConfig.optimizer},
+					{"learning_rate", appConfig.learningRate},
+					//{"l2_reg", 0.0001},
+				}}
+			}},
+			appConfig.encoding.jsonConfig,
+			{"network", {
+				{"otype", "FullyFusedMLP"},
+				{"activation", "ReLU"},
+				{"output_activation", "None"},
+				{"n_neurons", appConfig.nnWidth},
+				{"n_hidden_layers", appConfig.nnDepth},
+			}},
+		};
+
+		m_Model = tcnn::create_from_config(m_InputCount, m_OutputCount, modelConfig);
+	}
+
+	bool TcnnNrcBackend::UsesHostMemory() const
+	{
+		return false;
+	}
+
+	void TcnnNrcBackend::Inference(const float* input, float* output, uint32_t count)
+	{
+		const tcnn::GPUMatrix<float> inputMatrix(const_cast<float*>(input), m_InputCount, count);
+		tcnn::GPUMatrix<float> outputMatrix(output, m_OutputCount, count);
+		m_Model.network->inference(inputMatrix, outputMatrix);
+	}
+
+	void TcnnNrcBackend::Train(const float* input, const float* target, uint32_t count)
+	{
+		const tcnn::GPUMatrix<float> inputMatrix(const_cast<float*>(input), m_InputCount, count);
+		const tcnn::GPUMatrix<float> targetMatrix(const_cast<float*>(target), m_OutputCount, count);
+		m_LastTrainContext = m_Model.trainer->training_step(inputMatrix, targetMatrix);
+	}
+
+	float TcnnNrcBackend::GetLastLoss()
+	{
+		// The reduction synchronizes with the training step
+		if (m_LastTrainContext)
+		{
+			m_LastLoss = m_Model.trainer->loss(*m_LastTrainContext.get());
+			m_LastTrainContext.reset();
+		}
+		return m_LastLoss;
+	}
+}
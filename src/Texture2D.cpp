@@ -1,5 +1,4 @@
 #include <engine/graphics/vulkan/Texture2D.hpp>
-#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <engine/util/Log.hpp>
 #include <engine/graphics/VulkanAPI.hpp>
@@ -4,81 +4,179 @@
 #include <engine/graphics/vulkan/CommandPool.hpp>
 #include <engine/graphics/vulkan/Buffer.hpp>
 #include <array>
-#include <openvdb/openvdb.h>
-#include <filesystem>
+#include <tbb/parallel_for.h>
+#include <glm/gtc/packing.hpp>
 
 namespace en::vk
 {
-	Texture3D Texture3D::FromVDB(const std::string& fileName)
+	// Converts the density into the staging buffer, one z slice per task
+	static void WriteDensity(const DensityGrid& densityGrid, VkFormat format, void* mappedMemory)
 	{
-		// Check if file exists
-		if (!std::filesystem::exists(fileName))
-			Log::Error(fileName + " does not exist", true);
-
-		// Load grids from file
-		Log::Info("Opening density VDB file");
-		openvdb::io::File file(fileName);
-		file.open();
-		openvdb::GridPtrVecPtr grids = file.getGrids();
-		file.close();
-
-		// Find density grid
-		openvdb::FloatGrid::Ptr densityGrid = nullptr;
-		for (size_t gridIdx = 0; gridIdx < grids->size(); gridIdx++)
-		{
-			openvdb::GridBase::Ptr gridBase = grids->at(0);
-			if (gridBase->isType<openvdb::FloatGrid>())
+		const float* src = densityGrid.GetData();
+		const size_t sliceSize = static_cast<size_t>(densityGrid.GetWidth()) * densityGrid.GetHeight();
+		tbb::parallel_for(0u, densityGrid.GetDepth(), [&](uint32_t k)
 			{
-				Log::Info("Found float grid");
-				for (auto metaIt = gridBase->beginMeta(); metaIt != gridBase->endMeta(); metaIt++)
+				const size_t begin = k * sliceSize;
+				const size_t end = begin + sliceSize;
+				switch (format)
+				{
+				case VK_FORMAT_R8_UNORM:
 				{
-					Log::Info("\t" + metaIt->first + ": " + metaIt->second->str());
+					uint8_t* dst = reinterpret_cast<uint8_t*>(mappedMemory);
+					for (size_t i = begin; i < end; i++) { dst[i] = static_cast<uint8_t>(src[i] * 255.0f); }
+					break;
 				}
-				densityGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(gridBase);
-			}
-		}
+				case VK_FORMAT_R16_SFLOAT:
+				{
+					uint16_t* dst = reinterpret_cast<uint16_t*>(mappedMemory);
+					for (size_t i = begin; i < end; i++) { dst[i] = glm::packHalf1x16(src[i]); }
+					break;
+				}
+				case VK_FORMAT_R32_SFLOAT:
+				{
+					memcpy(reinterpret_cast<float*>(mappedMemory) + begin, src + begin, sliceSize * sizeof(float));
+					break;
+				}
+				case VK_FORMAT_R8G8B8A8_UNORM:
+				{
+					uint8_t* dst = reinterpret_cast<uint8_t*>(mappedMemory);
+					for (size_t i = begin; i < end; i++)
+					{
+						const uint8_t value = static_cast<uint8_t>(src[i] * 255.0f);
+						dst[4 * i + 0] = value;
+						dst[4 * i + 1] = value;
+						dst[4 * i + 2] = value;
+						dst[4 * i + 3] = 1;
+					}
+					break;
+				}
+				default:
+					break;
+				}
+			});
+	}
+
+	Texture3D Texture3D::FromVDB(const std::string& fileName, VkFormat format)
+	{
+		const DensityGrid densityGrid = DensityGrid::FromVDB(fileName);
+
+		// Return texture
+		return Texture3D(
+			densityGrid,
+			format,
+			VK_FILTER_NEAREST, 
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER, 
+			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+	}
 
-		// Error check
-		if (densityGrid == nullptr) { en::Log::Error("No density volume found in vdb file", true); }
-
-		// Get size
-		openvdb::Vec3i boxMin = densityGrid->metaValue<openvdb::Vec3i>("file_bbox_min");
-		openvdb::Vec3i boxMax = densityGrid->metaValue<openvdb::Vec3i>("file_bbox_max");
-		openvdb::Vec3i boxExtent = boxMax - boxMin + openvdb::Vec3i(1);
-		const size_t uniformVoxelCount = boxExtent.x() * boxExtent.y() * boxExtent.z();
-		
-		// Create 3d float array
-		std::vector<std::vector<std::vector<float>>> data(boxExtent.x());
-		for (std::vector<std::vector<float>>& vvf : data)
+	uint32_t Texture3D::GetTexelSize(VkFormat format)
+	{
+		switch (format)
 		{
-			vvf.resize(boxExtent.y());
-			for (std::vector<float>& vf : vvf) { vf.resize(boxExtent.z()); }
+		case VK_FORMAT_R8_UNORM:
+			return 1;
+		case VK_FORMAT_R16_SFLOAT:
+			return 2;
+		case VK_FORMAT_R32_SFLOAT:
+		case VK_FORMAT_R32_UINT:
+		case VK_FORMAT_R8G8B8A8_UNORM:
+			return 4;
+		default:
+			Log::Error("Texture3D format is not supported", true);
+			return 0;
 		}
+	}
+
+	Texture3D::Texture3D(
+		const DensityGrid& densityGrid,
+		VkFormat format,
+		VkFilter filter,
+		VkSamplerAddressMode addressMode,
+		VkBorderColor borderColor)
+		:
+		m_Width(densityGrid.GetWidth()),
+		m_Height(densityGrid.GetHeight()),
+		m_Depth(densityGrid.GetDepth()),
+		m_RealChannelCount(format == VK_FORMAT_R8G8B8A8_UNORM ? 4 : 1),
+		m_Format(format),
+		m_TexelSize(GetTexelSize(format)),
+		m_ImageLayout(VK_IMAGE_LAYOUT_PREINITIALIZED)
+	{
+		LoadToDevice(
+			[&densityGrid, this](void* mappedMemory) { WriteDensity(densityGrid, m_Format, mappedMemory); },
+			filter,
+			addressMode,
+			borderColor);
+
+		Log::Info(
+			"Texture3D (" + std::to_string(m_Width) + "x" + std::to_string(m_Height) + "x" + std::to_string(m_Depth) +
+			", " + std::to_string(m_TexelSize) + " byte texels) uses " +
+			std::to_string(static_cast<double>(GetRealSizeInBytes()) / (1024.0 * 1024.0)) + "MB");
+	}
 
-		// Read data from grid
-		float maxVal = 0.0;
-		for (auto valIt = densityGrid->cbeginValueOn(); valIt; ++valIt)
+	Texture3D::Texture3D(
+		const std::vector<DensityGrid>& mipLevels,
+		VkFormat format,
+		VkFilter filter,
+		VkSamplerAddressMode addressMode,
+		VkBorderColor borderColor)
+		:
+		m_Width(mipLevels[0].GetWidth()),
+		m_Height(mipLevels[0].GetHeight()),
+		m_Depth(mipLevels[0].GetDepth()),
+		m_RealChannelCount(format == VK_FORMAT_R8G8B8A8_UNORM ? 4 : 1),
+		m_Format(format),
+		m_TexelSize(GetTexelSize(format)),
+		m_MipLevelCount(static_cast<uint32_t>(mipLevels.size())),
+		m_ImageLayout(VK_IMAGE_LAYOUT_PREINITIALIZED)
+	{
+		for (uint32_t level = 1; level < m_MipLevelCount; level++)
 		{
-			const float value = valIt.getValue();
-			if (value > maxVal) { maxVal = value; }
-			
-			openvdb::CoordBBox bBox;
-			valIt.getBoundingBox(bBox);
-			for (auto bBoxIt = bBox.begin(); bBoxIt; ++bBoxIt)
+			if (mipLevels[level].GetWidth() != std::max(m_Width >> level, 1u) ||
+				mipLevels[level].GetHeight() != std::max(m_Height >> level, 1u) ||
+				mipLevels[level].GetDepth() != std::max(m_Depth >> level, 1u))
 			{
-				openvdb::Vec3i bBoxItPos = (*bBoxIt).asVec3i() - boxMin;
-				data[bBoxItPos.x()][bBoxItPos.y()][bBoxItPos.z()] = value;
+				Log::Error("Texture3D mip level " + std::to_string(level) + " has the wrong size", true);
 			}
 		}
 
-		if (maxVal != 0.0 && maxVal != 1.0) { Log::Error("VDB is not normalized", true); }
+		LoadToDevice(
+			[&mipLevels, this](void* mappedMemory)
+			{
+				for (uint32_t level = 0; level < m_MipLevelCount; level++)
+				{
+					WriteDensity(mipLevels[level], m_Format, reinterpret_cast<uint8_t*>(mappedMemory) + GetMipLevelOffset(level));
+				}
+			},
+			filter,
+			addressMode,
+			borderColor);
+
+		Log::Info(
+			"Texture3D (" + std::to_string(m_Width) + "x" + std::to_string(m_Height) + "x" + std::to_string(m_Depth) +
+			", " + std::to_string(m_MipLevelCount) + " mip levels, " + std::to_string(m_TexelSize) + " byte texels) uses " +
+			std::to_string(static_cast<double>(GetRealSizeInBytes()) / (1024.0 * 1024.0)) + "MB");
+	}
 
-		// Return texture
-		return Texture3D(
-			data, 
-			VK_FILTER_NEAREST, 
-			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER, 
-			VK_BORDER_COLOR_INT_OPAQUE_BLACK);
+	Texture3D::Texture3D(
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		VkFormat format,
+		const void* data,
+		VkFilter filter,
+		VkSamplerAddressMode addressMode,
+		VkBorderColor borderColor)
+		:
+		m_Width(width),
+		m_Height(height),
+		m_Depth(depth),
+		m_RealChannelCount(1),
+		m_Format(format),
+		m_TexelSize(GetTexelSize(format)),
+		m_ImageLayout(VK_IMAGE_LAYOUT_PREINITIALIZED)
+	{
+		LoadToDevice(data, filter, addressMode, borderColor);
 	}
 
 	Texture3D::Texture3D(
@@ -91,6 +189,8 @@ namespace en::vk
 		m_Height(data[0].size()),
 		m_Depth(data[0][0].size()),
 		m_RealChannelCount(4),
+		m_Format(VK_FORMAT_R8G8B8A8_UNORM),
+		m_TexelSize(4),
 		m_ImageLayout(VK_IMAGE_LAYOUT_PREINITIALIZED)
 	{
 		// TODO: check for homogenous size
@@ -126,6 +226,8 @@ namespace en::vk
 		m_Height(data[0][0].size()),
 		m_Depth(data[0][0][0].size()),
 		m_RealChannelCount(4),
+		m_Format(VK_FORMAT_R8G8B8A8_UNORM),
+		m_TexelSize(4),
 		m_ImageLayout(VK_IMAGE_LAYOUT_PREINITIALIZED)
 	{
 		// TODO: check for homogenous size
@@ -159,6 +261,40 @@ namespace en::vk
 		vkDestroySampler(device, m_Sampler, nullptr);
 		vkDestroyImageView(device, m_ImageView, nullptr);
 		vkDestroyImage(device, m_Image, nullptr);
+
+		if (m_StagingBuffer != nullptr)
+		{
+			m_StagingBuffer->UnmapMemory();
+			m_StagingBuffer->Destroy();
+			delete m_StagingBuffer;
+		}
+	}
+
+	void Texture3D::Update(const DensityGrid& densityGrid, VkCommandBuffer commandBuffer)
+	{
+		if (m_MipLevelCount != 1 ||
+			densityGrid.GetWidth() != m_Width ||
+			densityGrid.GetHeight() != m_Height ||
+			densityGrid.GetDepth() != m_Depth)
+		{
+			Log::Error("Texture3D can only be updated with a density grid of its own size", true);
+		}
+
+		if (m_StagingBuffer == nullptr)
+		{
+			m_StagingBuffer = new Buffer(
+				GetRealSizeInBytes(),
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				{});
+			m_StagingBuffer->MapMemory(0, &m_StagingMemory);
+		}
+
+		WriteDensity(densityGrid, m_Format, m_StagingMemory);
+
+		RecordChangeLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, commandBuffer);
+		RecordWriteBufferToImage(commandBuffer, m_StagingBuffer->GetVulkanHandle());
+		RecordChangeLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, commandBuffer);
 	}
 
 	uint32_t Texture3D::GetWidth() const
@@ -176,6 +312,11 @@ namespace en::vk
 		return m_Depth;
 	}
 
+	uint32_t Texture3D::GetMipLevelCount() const
+	{
+		return m_MipLevelCount;
+	}
+
 	uint32_t Texture3D::GetRealChannelCount() const
 	{
 		return m_RealChannelCount;
@@ -183,7 +324,12 @@ namespace en::vk
 
 	size_t Texture3D::GetRealSizeInBytes() const
 	{
-		return m_Width * m_Height * m_Depth * m_RealChannelCount;
+		return GetMipLevelOffset(m_MipLevelCount);
+	}
+
+	VkFormat Texture3D::GetFormat() const
+	{
+		return m_Format;
 	}
 
 	VkImageView Texture3D::GetImageView() const
@@ -196,10 +342,40 @@ namespace en::vk
 		return m_Sampler;
 	}
 
-	void Texture3D::LoadToDevice(void* data, VkFilter filter, VkSamplerAddressMode addressMode, VkBorderColor borderColor)
+	// Levels are tightly packed one after another in the staging buffer. Every level starts on a 4 byte
+	// boundary, which vkCmdCopyBufferToImage requires for single byte formats on some queues.
+	size_t Texture3D::GetMipLevelOffset(uint32_t level) const
+	{
+		size_t offset = 0;
+		for (uint32_t i = 0; i < level; i++)
+		{
+			offset = (offset + 3) / 4 * 4;
+			offset +=
+				static_cast<size_t>(std::max(m_Width >> i, 1u)) *
+				std::max(m_Height >> i, 1u) *
+				std::max(m_Depth >> i, 1u) *
+				m_TexelSize;
+		}
+		return offset;
+	}
+
+	void Texture3D::LoadToDevice(const void* data, VkFilter filter, VkSamplerAddressMode addressMode, VkBorderColor borderColor)
+	{
+		const size_t size = GetRealSizeInBytes();
+		LoadToDevice(
+			[data, size](void* mappedMemory) { memcpy(mappedMemory, data, size); },
+			filter,
+			addressMode,
+			borderColor);
+	}
+
+	void Texture3D::LoadToDevice(
+		const std::function<void(void*)>& writeData,
+		VkFilter filter,
+		VkSamplerAddressMode addressMode,
+		VkBorderColor borderColor)
 	{
 		VkDevice device = VulkanAPI::GetDevice();
-		VkDeviceSize size = static_cast<VkDeviceSize>(GetRealSizeInBytes());
 		VkQueue queue = VulkanAPI::GetGraphicsQueue(); // TODO: GetTransferQueue
 		VkResult result;
 
@@ -215,19 +391,20 @@ namespace en::vk
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			{});
 
-		stagingBuffer.SetData(size, data, 0, 0);
+		void* mappedMemory;
+		stagingBuffer.MapMemory(0, &mappedMemory);
+		writeData(mappedMemory);
+		stagingBuffer.UnmapMemory();
 
 		// Create Image
-		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
-
 		VkImageCreateInfo imageCreateInfo;
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageCreateInfo.pNext = nullptr;
 		imageCreateInfo.flags = 0;
 		imageCreateInfo.imageType = VK_IMAGE_TYPE_3D;
-		imageCreateInfo.format = format;
+		imageCreateInfo.format = m_Format;
 		imageCreateInfo.extent = { m_Width, m_Height, m_Depth };
-		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.mipLevels = m_MipLevelCount;
 		imageCreateInfo.arrayLayers = 1;
 		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -278,14 +455,14 @@ namespace en::vk
 		imageViewCreateInfo.flags = 0;
 		imageViewCreateInfo.image = m_Image;
 		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
-		imageViewCreateInfo.format = format;
+		imageViewCreateInfo.format = m_Format;
 		imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
 		imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
 		imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
 		imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 		imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.levelCount = m_MipLevelCount;
 		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
 		imageViewCreateInfo.subresourceRange.layerCount = 1;
 
@@ -299,7 +476,7 @@ namespace en::vk
 		samplerCreateInfo.flags = 0;
 		samplerCreateInfo.magFilter = filter;
 		samplerCreateInfo.minFilter = filter;
-		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerCreateInfo.mipmapMode = m_MipLevelCount > 1 ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		samplerCreateInfo.addressModeU = addressMode;
 		samplerCreateInfo.addressModeV = addressMode;
 		samplerCreateInfo.addressModeW = addressMode;
@@ -309,7 +486,7 @@ namespace en::vk
 		samplerCreateInfo.compareEnable = VK_FALSE;
 		samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 		samplerCreateInfo.minLod = 0.0f;
-		samplerCreateInfo.maxLod = 0.0f;
+		samplerCreateInfo.maxLod = static_cast<float>(m_MipLevelCount - 1);
 		samplerCreateInfo.borderColor = borderColor;
 		samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
 
@@ -319,27 +496,6 @@ namespace en::vk
 
 	void Texture3D::ChangeLayout(VkImageLayout layout, VkCommandBuffer commandBuffer, VkQueue queue)
 	{
-		VkAccessFlags srcAccessMask;
-		VkAccessFlags dstAccessMask;
-
-		VkPipelineStageFlags srcStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-		VkPipelineStageFlags dstStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-
-		if (m_ImageLayout == VK_IMAGE_LAYOUT_PREINITIALIZED && layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-		{
-			srcAccessMask = VK_ACCESS_NONE_KHR;
-			dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		}
-		else if (m_ImageLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-		{
-			srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		}
-		else
-		{
-			Log::Error("Unknown image layout transision in Texture2D", true);
-		}
-
 		VkCommandBufferBeginInfo beginInfo;
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		beginInfo.pNext = nullptr;
@@ -349,15 +505,7 @@ namespace en::vk
 		VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
 		ASSERT_VULKAN(result);
 
-		vk::CommandRecorder::ImageLayoutTransfer(
-			commandBuffer,
-			m_Image,
-			m_ImageLayout,
-			layout,
-			srcAccessMask,
-			dstAccessMask,
-			srcStageFlags,
-			dstStageFlags);
+		RecordChangeLayout(layout, commandBuffer);
 
 		result = vkEndCommandBuffer(commandBuffer);
 		ASSERT_VULKAN(result);
@@ -378,8 +526,6 @@ namespace en::vk
 
 		result = vkQueueWaitIdle(queue);
 		ASSERT_VULKAN(result);
-
-		m_ImageLayout = layout;
 	}
 
 	void Texture3D::WriteBufferToImage(VkCommandBuffer commandBuffer, VkQueue queue, VkBuffer buffer)
@@ -393,18 +539,7 @@ namespace en::vk
 		VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
 		ASSERT_VULKAN(result);
 
-		VkBufferImageCopy bufferImageCopy;
-		bufferImageCopy.bufferOffset = 0;
-		bufferImageCopy.bufferRowLength = 0;
-		bufferImageCopy.bufferImageHeight = 0;
-		bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		bufferImageCopy.imageSubresource.mipLevel = 0;
-		bufferImageCopy.imageSubresource.baseArrayLayer = 0;
-		bufferImageCopy.imageSubresource.layerCount = 1;
-		bufferImageCopy.imageOffset = { 0, 0, 0 };
-		bufferImageCopy.imageExtent = { m_Width, m_Height, m_Depth };
-
-		vkCmdCopyBufferToImage(commandBuffer, buffer, m_Image, m_ImageLayout, 1, &bufferImageCopy);
+		RecordWriteBufferToImage(commandBuffer, buffer);
 
 		result = vkEndCommandBuffer(commandBuffer);
 		ASSERT_VULKAN(result);
@@ -426,4 +561,66 @@ namespace en::vk
 		result = vkQueueWaitIdle(queue);
 		ASSERT_VULKAN(result);
 	}
+
+	void Texture3D::RecordChangeLayout(VkImageLayout layout, VkCommandBuffer commandBuffer)
+	{
+		VkAccessFlags srcAccessMask;
+		VkAccessFlags dstAccessMask;
+
+		VkPipelineStageFlags srcStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkPipelineStageFlags dstStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		if (m_ImageLayout == VK_IMAGE_LAYOUT_PREINITIALIZED && layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+		{
+			srcAccessMask = VK_ACCESS_NONE_KHR;
+			dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		}
+		else if (m_ImageLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		{
+			srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		}
+		else if (m_ImageLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+		{
+			srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		}
+		else
+		{
+			Log::Error("Unknown image layout transision in Texture2D", true);
+		}
+
+		vk::CommandRecorder::ImageLayoutTransfer(
+			commandBuffer,
+			m_Image,
+			m_ImageLayout,
+			layout,
+			srcAccessMask,
+			dstAccessMask,
+			srcStageFlags,
+			dstStageFlags,
+			m_MipLevelCount);
+
+		m_ImageLayout = layout;
+	}
+
+	void Texture3D::RecordWriteBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer)
+	{
+		std::vector<VkBufferImageCopy> bufferImageCopies(m_MipLevelCount);
+		for (uint32_t level = 0; level < m_MipLevelCount; level++)
+		{
+			VkBufferImageCopy& bufferImageCopy = bufferImageCopies[level];
+			bufferImageCopy.bufferOffset = GetMipLevelOffset(level);
+			bufferImageCopy.bufferRowLength = 0;
+			bufferImageCopy.bufferImageHeight = 0;
+			bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			bufferImageCopy.imageSubresource.mipLevel = level;
+			bufferImageCopy.imageSubresource.baseArrayLayer = 0;
+			bufferImageCopy.imageSubresource.layerCount = 1;
+			bufferImageCopy.imageOffset = { 0, 0, 0 };
+			bufferImageCopy.imageExtent = { std::max(m_Width >> level, 1u), std::max(m_Height >> level, 1u), std::max(m_Depth >> level, 1u) };
+		}
+
+		vkCmdCopyBufferToImage(commandBuffer, buffer, m_Image, m_ImageLayout, bufferImageCopies.size(), bufferImageCopies.data());
+	}
 }
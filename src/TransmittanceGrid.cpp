@@ -0,0 +1,147 @@
+#include <engine/objects/TransmittanceGrid.hpp>
+#include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace en
+{
+	static const DensityGrid& GetDensityLevel(const DensityMipChain& densityMipChain)
+	{
+		if (densityMipChain.GetLevelCount() < TransmittanceGrid::sc_DensityLevel)
+		{
+			Log::Error("TransmittanceGrid needs density mip level " + std::to_string(TransmittanceGrid::sc_DensityLevel), true);
+		}
+		return densityMipChain.GetLevel(TransmittanceGrid::sc_DensityLevel);
+	}
+
+	// Slice steps until a ray from a cell center in cell coordinates leaves the grid
+	static float GetExitSteps(const glm::vec3& center, const glm::vec3& step, const glm::ivec3& extent)
+	{
+		float exitSteps = std::numeric_limits<float>::max();
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (step[axis] > 0.0f) { exitSteps = std::min(exitSteps, (static_cast<float>(extent[axis]) - center[axis]) / step[axis]); }
+			else if (step[axis] < 0.0f) { exitSteps = std::min(exitSteps, -center[axis] / step[axis]); }
+		}
+		return exitSteps;
+	}
+
+	TransmittanceGrid::TransmittanceGrid(
+		const DensityMipChain& densityMipChain,
+		const glm::uvec3& voxelExtent,
+		const glm::vec3& volumeSize,
+		float densityFactor)
+		:
+		m_Density(GetDensityLevel(densityMipChain)),
+		m_Extent(m_Density.GetWidth(), m_Density.GetHeight(), m_Density.GetDepth()),
+		m_UvwScale(glm::vec3(voxelExtent) / (glm::vec3(m_Extent) * static_cast<float>(sc_CellSize))),
+		m_CellSize(volumeSize / glm::vec3(voxelExtent) * static_cast<float>(sc_CellSize)),
+		m_DensityFactor(densityFactor),
+		m_Transmittance(m_Density.GetWidth(), m_Density.GetHeight(), m_Density.GetDepth())
+	{
+	}
+
+	void TransmittanceGrid::BuildDirLight(const glm::vec3& toLight)
+	{
+		m_LightDir = toLight;
+
+		// One step moves a whole cell along the dominant axis and the fraction of a cell along the others
+		const glm::vec3 cellDir = glm::normalize(toLight) / m_CellSize;
+		int axis = 0;
+		if (std::abs(cellDir.y) > std::abs(cellDir[axis])) { axis = 1; }
+		if (std::abs(cellDir.z) > std::abs(cellDir[axis])) { axis = 2; }
+		const int axisU = (axis + 1) % 3;
+		const int axisV = (axis + 2) % 3;
+		const float stepLength = 1.0f / std::abs(cellDir[axis]);
+		const glm::vec3 step = cellDir * stepLength;
+		const int sliceStep = step[axis] > 0.0f ? 1 : -1;
+		const int firstSlice = sliceStep > 0 ? m_Extent[axis] - 1 : 0;
+
+		// Holds the optical depth until the sweep is done
+		float* opticalDepth = m_Transmittance.GetData();
+		auto getIndex = [&](int slice, int u, int v)
+		{
+			glm::ivec3 cell;
+			cell[axis] = slice;
+			cell[axisU] = u;
+			cell[axisV] = v;
+			return m_Transmittance.GetIndex(cell.x, cell.y, cell.z);
+		};
+
+		// Bilinear clamp to edge interpolation of a slice at cell coordinates, cell centers are at + 0.5
+		auto interpolate = [&](const float* data, int slice, float u, float v)
+		{
+			u = std::clamp(u - 0.5f, 0.0f, static_cast<float>(m_Extent[axisU] - 1));
+			v = std::clamp(v - 0.5f, 0.0f, static_cast<float>(m_Extent[axisV] - 1));
+			const int u0 = static_cast<int>(u);
+			const int v0 = static_cast<int>(v);
+			const int u1 = std::min(u0 + 1, m_Extent[axisU] - 1);
+			const int v1 = std::min(v0 + 1, m_Extent[axisV] - 1);
+			const float fu = u - static_cast<float>(u0);
+			const float fv = v - static_cast<float>(v0);
+			const float value0 = glm::mix(data[getIndex(slice, u0, v0)], data[getIndex(slice, u1, v0)], fu);
+			const float value1 = glm::mix(data[getIndex(slice, u0, v1)], data[getIndex(slice, u1, v1)], fu);
+			return glm::mix(value0, value1, fv);
+		};
+		// Points between the outer cell centers and a face, which the light enters through, fade the
+		// optical depth to 0 at the face instead of clamping it
+		auto interpolateOpticalDepth = [&](int slice, float u, float v)
+		{
+			const float uWeight = std::clamp(2.0f * std::min(u, static_cast<float>(m_Extent[axisU]) - u), 0.0f, 1.0f);
+			const float vWeight = std::clamp(2.0f * std::min(v, static_cast<float>(m_Extent[axisV]) - v), 0.0f, 1.0f);
+			return uWeight * vWeight * interpolate(opticalDepth, slice, u, v);
+		};
+
+		const float* density = m_Density.GetData();
+		for (int i = 0; i < m_Extent[axis]; i++)
+		{
+			const int slice = firstSlice - (i * sliceStep);
+			tbb::parallel_for(0, m_Extent[axisV], [&](int v)
+				{
+					for (int u = 0; u < m_Extent[axisU]; u++)
+					{
+						glm::vec3 center;
+						center[axis] = static_cast<float>(slice) + 0.5f;
+						center[axisU] = static_cast<float>(u) + 0.5f;
+						center[axisV] = static_cast<float>(v) + 0.5f;
+
+						const size_t index = getIndex(slice, u, v);
+						const float cellDensity = m_DensityFactor * density[index];
+						const float exitSteps = GetExitSteps(center, step, m_Extent);
+						if (exitSteps <= 1.0f)
+						{
+							opticalDepth[index] = cellDensity * exitSteps * stepLength;
+							continue;
+						}
+
+						const glm::vec3 upstream = center + step;
+						const int upstreamSlice = slice + sliceStep;
+						const float upstreamDensity = m_DensityFactor * interpolate(density, upstreamSlice, upstream[axisU], upstream[axisV]);
+						opticalDepth[index] =
+							interpolateOpticalDepth(upstreamSlice, upstream[axisU], upstream[axisV]) +
+							(0.5f * (cellDensity + upstreamDensity) * stepLength);
+					}
+				});
+		}
+
+		tbb::parallel_for(size_t(0), m_Transmittance.GetVoxelCount(), [&](size_t i) { opticalDepth[i] = std::exp(-opticalDepth[i]); });
+	}
+
+	float TransmittanceGrid::Sample(const glm::vec3& uvw) const
+	{
+		const glm::vec3 gridUvw = uvw * m_UvwScale;
+		return m_Transmittance.SampleTrilinear(gridUvw.x, gridUvw.y, gridUvw.z);
+	}
+
+	const glm::vec3& TransmittanceGrid::GetLightDir() const
+	{
+		return m_LightDir;
+	}
+
+	const DensityGrid& TransmittanceGrid::GetGrid() const
+	{
+		return m_Transmittance;
+	}
+}
@@ -0,0 +1,404 @@
+#include <engine/objects/VolumeCache.hpp>
+#include <engine/util/MappedFile.hpp>
+#include <engine/util/Log.hpp>
+#include <engine/util/process_memory.hpp>
+#include <tbb/parallel_for.h>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace en
+{
+	constexpr char c_CacheMagic[8] = { 'H', 'P', 'M', 'V', 'O', 'L', 0, 0 };
+	// Grids start on page boundaries inside of the file, which keeps the mapped voxels aligned
+	constexpr uint64_t c_CacheAlignment = 4096;
+	constexpr size_t c_HashChunkSize = 4 * 1024 * 1024;
+
+	// Native endianness, the cache is only meant to be read on the machine that wrote it
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t majorantCellSize;
+		uint64_t vdbHash;
+		uint64_t vdbSize;
+		uint64_t fileSize;
+
+		int32_t indexOffset[3];
+		int32_t sourceOffset[3];
+		uint32_t sourceExtent[3];
+		uint32_t densityExtent[3];
+		float densityMaxValue;
+		uint32_t majorantExtent[3];
+		uint32_t brickAtlasExtent[3];
+		uint64_t densityOffset;
+		uint64_t majorantOffset;
+		uint64_t minorantOffset;
+		uint64_t brickIndexOffset;
+		uint64_t brickAtlasOffset;
+		uint32_t densityMipLevelCount;
+		uint32_t densityMipExtent[3];
+		uint64_t densityMipOffsets[DensityMipChain::sc_MaxLevelCount];
+	};
+	static_assert(std::is_trivially_copyable<CacheHeader>::value);
+
+	static uint64_t AlignUp(uint64_t value)
+	{
+		return (value + c_CacheAlignment - 1) / c_CacheAlignment * c_CacheAlignment;
+	}
+
+	static uint64_t RotateLeft(uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	// 64 bit multiply rotate hash in the spirit of xxHash64. Not cryptographic, it only has to
+	// notice that the VDB file changed.
+	static uint64_t HashChunk(const uint8_t* data, size_t size, uint64_t seed)
+	{
+		constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+		uint64_t lanes[4] = { seed + prime1, seed + prime2, seed, seed - prime1 };
+		size_t offset = 0;
+		for (; offset + 32 <= size; offset += 32)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				uint64_t word;
+				std::memcpy(&word, data + offset + i * 8, 8);
+				lanes[i] = RotateLeft(lanes[i] + word * prime2, 31) * prime1;
+			}
+		}
+
+		uint64_t hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+		for (; offset < size; offset++)
+		{
+			hash = RotateLeft(hash ^ (data[offset] * prime1), 11) * prime2;
+		}
+
+		hash ^= size;
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		return hash;
+	}
+
+	// Chunks are hashed in parallel and combined in order, so the result does not depend on the
+	// number of threads
+	static uint64_t HashFile(const std::string& fileName, uint64_t& fileSize)
+	{
+		const MappedFile file(fileName);
+		fileSize = file.GetSize();
+
+		const size_t chunkCount = (file.GetSize() + c_HashChunkSize - 1) / c_HashChunkSize;
+		std::vector<uint64_t> chunkHashes(chunkCount);
+		tbb::parallel_for(static_cast<size_t>(0), chunkCount, [&](size_t chunk)
+			{
+				const size_t begin = chunk * c_HashChunkSize;
+				const size_t size = std::min(c_HashChunkSize, file.GetSize() - begin);
+				chunkHashes[chunk] = HashChunk(file.GetData() + begin, size, chunk);
+			});
+
+		return HashChunk(reinterpret_cast<const uint8_t*>(chunkHashes.data()), chunkHashes.size() * sizeof(uint64_t), fileSize);
+	}
+
+	std::string VolumeCache::GetCacheFilePath(const std::string& vdbFileName)
+	{
+		return vdbFileName + ".cache";
+	}
+
+	VolumeCache::VolumeCache(const std::string& vdbFileName, uint32_t majorantCellSize)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		if (!std::filesystem::exists(vdbFileName)) { Log::Error(vdbFileName + " does not exist", true); }
+
+		uint64_t vdbSize;
+		const uint64_t vdbHash = HashFile(vdbFileName, vdbSize);
+		const std::string cacheFileName = GetCacheFilePath(vdbFileName);
+
+		if (Load(cacheFileName, vdbHash, vdbSize, majorantCellSize))
+		{
+			auto end = std::chrono::steady_clock::now();
+			const double elapsedMS = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+			Log::Info(
+				"Mapped volume cache " + cacheFileName +
+				" in " + std::to_string(elapsedMS) + "ms" +
+				" | Peak RSS: " + std::to_string(GetPeakRssMB()) + "MB");
+			return;
+		}
+
+		m_DensityGrid = std::make_unique<DensityGrid>(DensityGrid::FromVDB(vdbFileName));
+		m_MajorantGrid = std::make_unique<MajorantGrid>(*m_DensityGrid, majorantCellSize);
+		m_OccupancyGrid = std::make_unique<OccupancyGrid>(*m_DensityGrid, *m_MajorantGrid);
+		m_BrickGrid = std::make_unique<BrickGrid>(*m_DensityGrid);
+		m_DensityMipChain = std::make_unique<DensityMipChain>(*m_DensityGrid);
+		Store(cacheFileName, vdbHash, vdbSize);
+	}
+
+	DensityGrid& VolumeCache::GetDensityGrid()
+	{
+		return *m_DensityGrid;
+	}
+
+	const DensityGrid& VolumeCache::GetDensityGrid() const
+	{
+		return *m_DensityGrid;
+	}
+
+	const MajorantGrid& VolumeCache::GetMajorantGrid() const
+	{
+		return *m_MajorantGrid;
+	}
+
+	const OccupancyGrid& VolumeCache::GetOccupancyGrid() const
+	{
+		return *m_OccupancyGrid;
+	}
+
+	BrickGrid& VolumeCache::GetBrickGrid()
+	{
+		return *m_BrickGrid;
+	}
+
+	const BrickGrid& VolumeCache::GetBrickGrid() const
+	{
+		return *m_BrickGrid;
+	}
+
+	const DensityMipChain& VolumeCache::GetDensityMipChain() const
+	{
+		return *m_DensityMipChain;
+	}
+
+	bool VolumeCache::Load(const std::string& cacheFileName, uint64_t vdbHash, uint64_t vdbSize, uint32_t majorantCellSize)
+	{
+		if (!std::filesystem::exists(cacheFileName))
+		{
+			Log::Info("No volume cache found at " + cacheFileName);
+			return false;
+		}
+
+		// Copy on write, so that users like CpuHpmRenderer can still quantize the voxels in place
+		std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(cacheFileName, true);
+		if (file->GetSize() < sizeof(CacheHeader))
+		{
+			Log::Warn("Volume cache " + cacheFileName + " is truncated, rebuilding it");
+			return false;
+		}
+
+		CacheHeader header;
+		std::memcpy(&header, file->GetData(), sizeof(CacheHeader));
+		if (std::memcmp(header.magic, c_CacheMagic, sizeof(c_CacheMagic)) != 0 ||
+			header.version != sc_Version ||
+			header.fileSize != file->GetSize())
+		{
+			Log::Warn("Volume cache " + cacheFileName + " has an unknown format, rebuilding it");
+			return false;
+		}
+		if (header.vdbHash != vdbHash || header.vdbSize != vdbSize || header.majorantCellSize != majorantCellSize)
+		{
+			Log::Info("Volume cache " + cacheFileName + " is outdated, rebuilding it");
+			return false;
+		}
+
+		const glm::ivec3 indexOffset(header.indexOffset[0], header.indexOffset[1], header.indexOffset[2]);
+		m_DensityGrid = std::make_unique<DensityGrid>(
+			header.densityExtent[0],
+			header.densityExtent[1],
+			header.densityExtent[2],
+			header.densityMaxValue,
+			indexOffset,
+			file,
+			header.densityOffset);
+		m_DensityGrid->SetSourceBox(
+			glm::ivec3(header.sourceOffset[0], header.sourceOffset[1], header.sourceOffset[2]),
+			glm::uvec3(header.sourceExtent[0], header.sourceExtent[1], header.sourceExtent[2]));
+
+		DensityGrid cells(
+			header.majorantExtent[0],
+			header.majorantExtent[1],
+			header.majorantExtent[2],
+			0.0f,
+			glm::ivec3(0),
+			file,
+			header.majorantOffset);
+		m_MajorantGrid = std::make_unique<MajorantGrid>(*m_DensityGrid, std::move(cells), majorantCellSize);
+
+		// The occupancy mask is rebuilt from the majorants, only the minimum cells are stored
+		DensityGrid minCells(
+			header.majorantExtent[0],
+			header.majorantExtent[1],
+			header.majorantExtent[2],
+			0.0f,
+			glm::ivec3(0),
+			file,
+			header.minorantOffset);
+		m_OccupancyGrid = std::make_unique<OccupancyGrid>(*m_MajorantGrid, std::move(minCells));
+
+		// The index grid is small, so it is copied out of the mapping
+		const glm::uvec3 brickCount =
+			(glm::uvec3(header.densityExtent[0], header.densityExtent[1], header.densityExtent[2]) + BrickGrid::sc_BrickSize - 1u) /
+			BrickGrid::sc_BrickSize;
+		const size_t brickIndexCount = static_cast<size_t>(brickCount.x) * brickCount.y * brickCount.z;
+		if (header.brickIndexOffset + brickIndexCount * sizeof(uint32_t) > file->GetSize())
+		{
+			Log::Warn("Volume cache " + cacheFileName + " is truncated, rebuilding it");
+			return false;
+		}
+		const uint32_t* brickIndexData = reinterpret_cast<const uint32_t*>(file->GetData() + header.brickIndexOffset);
+		std::vector<uint32_t> brickIndices(brickIndexData, brickIndexData + brickIndexCount);
+
+		DensityGrid brickAtlas(
+			header.brickAtlasExtent[0],
+			header.brickAtlasExtent[1],
+			header.brickAtlasExtent[2],
+			0.0f,
+			glm::ivec3(0),
+			file,
+			header.brickAtlasOffset);
+		m_BrickGrid = std::make_unique<BrickGrid>(
+			header.densityExtent[0],
+			header.densityExtent[1],
+			header.densityExtent[2],
+			std::move(brickIndices),
+			std::move(brickAtlas));
+
+		if (header.densityMipLevelCount == 0 || header.densityMipLevelCount > DensityMipChain::sc_MaxLevelCount)
+		{
+			Log::Warn("Volume cache " + cacheFileName + " has an unknown format, rebuilding it");
+			return false;
+		}
+		std::vector<DensityGrid> mipLevels;
+		mipLevels.reserve(header.densityMipLevelCount);
+		for (uint32_t level = 0; level < header.densityMipLevelCount; level++)
+		{
+			mipLevels.emplace_back(
+				header.densityMipExtent[0] >> level,
+				header.densityMipExtent[1] >> level,
+				header.densityMipExtent[2] >> level,
+				0.0f,
+				glm::ivec3(0),
+				file,
+				header.densityMipOffsets[level]);
+		}
+		m_DensityMipChain = std::make_unique<DensityMipChain>(std::move(mipLevels));
+
+		return true;
+	}
+
+	void VolumeCache::Store(const std::string& cacheFileName, uint64_t vdbHash, uint64_t vdbSize) const
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		const DensityGrid& cells = m_MajorantGrid->GetGrid();
+		const DensityGrid& minCells = m_OccupancyGrid->GetMinGrid();
+		const std::vector<uint32_t>& brickIndices = m_BrickGrid->GetBrickIndices();
+		const DensityGrid& brickAtlas = m_BrickGrid->GetAtlas();
+		const size_t brickIndexSize = brickIndices.size() * sizeof(uint32_t);
+		const std::vector<DensityGrid>& mipLevels = m_DensityMipChain->GetLevels();
+
+		CacheHeader header = {};
+		std::memcpy(header.magic, c_CacheMagic, sizeof(c_CacheMagic));
+		header.version = sc_Version;
+		header.majorantCellSize = m_MajorantGrid->GetCellSize();
+		header.vdbHash = vdbHash;
+		header.vdbSize = vdbSize;
+		header.indexOffset[0] = m_DensityGrid->GetIndexOffset().x;
+		header.indexOffset[1] = m_DensityGrid->GetIndexOffset().y;
+		header.indexOffset[2] = m_DensityGrid->GetIndexOffset().z;
+		header.sourceOffset[0] = m_DensityGrid->GetSourceOffset().x;
+		header.sourceOffset[1] = m_DensityGrid->GetSourceOffset().y;
+		header.sourceOffset[2] = m_DensityGrid->GetSourceOffset().z;
+		header.sourceExtent[0] = m_DensityGrid->GetSourceExtent().x;
+		header.sourceExtent[1] = m_DensityGrid->GetSourceExtent().y;
+		header.sourceExtent[2] = m_DensityGrid->GetSourceExtent().z;
+		header.densityExtent[0] = m_DensityGrid->GetWidth();
+		header.densityExtent[1] = m_DensityGrid->GetHeight();
+		header.densityExtent[2] = m_DensityGrid->GetDepth();
+		header.densityMaxValue = m_DensityGrid->GetMaxValue();
+		header.majorantExtent[0] = cells.GetWidth();
+		header.majorantExtent[1] = cells.GetHeight();
+		header.majorantExtent[2] = cells.GetDepth();
+		header.brickAtlasExtent[0] = brickAtlas.GetWidth();
+		header.brickAtlasExtent[1] = brickAtlas.GetHeight();
+		header.brickAtlasExtent[2] = brickAtlas.GetDepth();
+		header.densityOffset = AlignUp(sizeof(CacheHeader));
+		header.majorantOffset = AlignUp(header.densityOffset + m_DensityGrid->GetSizeInBytes());
+		header.brickIndexOffset = AlignUp(header.majorantOffset + cells.GetSizeInBytes());
+		header.brickAtlasOffset = AlignUp(header.brickIndexOffset + brickIndexSize);
+		header.densityMipLevelCount = m_DensityMipChain->GetLevelCount();
+		header.densityMipExtent[0] = mipLevels[0].GetWidth();
+		header.densityMipExtent[1] = mipLevels[0].GetHeight();
+		header.densityMipExtent[2] = mipLevels[0].GetDepth();
+		uint64_t fileEnd = header.brickAtlasOffset + brickAtlas.GetSizeInBytes();
+		for (size_t level = 0; level < mipLevels.size(); level++)
+		{
+			header.densityMipOffsets[level] = AlignUp(fileEnd);
+			fileEnd = header.densityMipOffsets[level] + mipLevels[level].GetSizeInBytes();
+		}
+		header.minorantOffset = AlignUp(fileEnd);
+		header.fileSize = header.minorantOffset + minCells.GetSizeInBytes();
+
+		// Write to a temporary file first, so that an interrupted run never leaves a cache behind that
+		// passes the header checks
+		const std::string tempFileName = cacheFileName + ".tmp";
+		{
+			std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				Log::Warn("Failed to create volume cache " + cacheFileName);
+				return;
+			}
+
+			const std::vector<char> padding(c_CacheAlignment, 0);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+			file.write(padding.data(), header.densityOffset - sizeof(CacheHeader));
+			file.write(reinterpret_cast<const char*>(m_DensityGrid->GetData()), m_DensityGrid->GetSizeInBytes());
+			file.write(padding.data(), header.majorantOffset - header.densityOffset - m_DensityGrid->GetSizeInBytes());
+			file.write(reinterpret_cast<const char*>(cells.GetData()), cells.GetSizeInBytes());
+			file.write(padding.data(), header.brickIndexOffset - header.majorantOffset - cells.GetSizeInBytes());
+			file.write(reinterpret_cast<const char*>(brickIndices.data()), brickIndexSize);
+			file.write(padding.data(), header.brickAtlasOffset - header.brickIndexOffset - brickIndexSize);
+			file.write(reinterpret_cast<const char*>(brickAtlas.GetData()), brickAtlas.GetSizeInBytes());
+			uint64_t written = header.brickAtlasOffset + brickAtlas.GetSizeInBytes();
+			for (size_t level = 0; level < mipLevels.size(); level++)
+			{
+				file.write(padding.data(), header.densityMipOffsets[level] - written);
+				file.write(reinterpret_cast<const char*>(mipLevels[level].GetData()), mipLevels[level].GetSizeInBytes());
+				written = header.densityMipOffsets[level] + mipLevels[level].GetSizeInBytes();
+			}
+			file.write(padding.data(), header.minorantOffset - written);
+			file.write(reinterpret_cast<const char*>(minCells.GetData()), minCells.GetSizeInBytes());
+
+			if (!file.good())
+			{
+				file.close();
+				std::filesystem::remove(tempFileName);
+				Log::Warn("Failed to write volume cache " + cacheFileName);
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempFileName, cacheFileName, error);
+		if (error)
+		{
+			std::filesystem::remove(tempFileName, error);
+			Log::Warn("Failed to replace volume cache " + cacheFileName);
+			return;
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		const double elapsedMS = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+		Log::Info(
+			"Wrote volume cache " + cacheFileName +
+			" (" + std::to_string(static_cast<double>(header.fileSize) / (1024.0 * 1024.0)) + "MB)" +
+			" in " + std::to_string(elapsedMS) + "ms");
+	}
+}
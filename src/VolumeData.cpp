@@ -1,10 +1,14 @@
 #include <engine/objects/VolumeData.hpp>
 #include <engine/graphics/VulkanAPI.hpp>
 #include <vector>
+#include <array>
 #include <imgui.h>
 
 namespace en
 {
+	// TRAVERSAL_STAT_* in volume.glsl
+	constexpr size_t c_TraversalStatCount = 6;
+
 	VkDescriptorSetLayout VolumeData::m_DescriptorSetLayout;
 	VkDescriptorPool VolumeData::m_DescriptorPool;
 
@@ -18,7 +22,80 @@ namespace en
 		densityTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 		densityTexBinding.pImmutableSamplers = nullptr;;
 
-		std::vector<VkDescriptorSetLayoutBinding> bindings = { densityTexBinding };
+		VkDescriptorSetLayoutBinding majorantTexBinding;
+		majorantTexBinding.binding = 1;
+		majorantTexBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		majorantTexBinding.descriptorCount = 1;
+		majorantTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		majorantTexBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding brickIndexTexBinding;
+		brickIndexTexBinding.binding = 2;
+		brickIndexTexBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		brickIndexTexBinding.descriptorCount = 1;
+		brickIndexTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		brickIndexTexBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding densityMipTexBinding;
+		densityMipTexBinding.binding = 3;
+		densityMipTexBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		densityMipTexBinding.descriptorCount = 1;
+		densityMipTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		densityMipTexBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding occupancyTexBinding;
+		occupancyTexBinding.binding = 4;
+		occupancyTexBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		occupancyTexBinding.descriptorCount = 1;
+		occupancyTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		occupancyTexBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding minorantTexBinding;
+		minorantTexBinding.binding = 5;
+		minorantTexBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		minorantTexBinding.descriptorCount = 1;
+		minorantTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		minorantTexBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding traversalStatsBinding;
+		traversalStatsBinding.binding = 6;
+		traversalStatsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		traversalStatsBinding.descriptorCount = 1;
+		traversalStatsBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		traversalStatsBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding dirLightTransmittanceTexBinding;
+		dirLightTransmittanceTexBinding.binding = 7;
+		dirLightTransmittanceTexBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		dirLightTransmittanceTexBinding.descriptorCount = 1;
+		dirLightTransmittanceTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		dirLightTransmittanceTexBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding pointLightTransmittanceTexBinding;
+		pointLightTransmittanceTexBinding.binding = 8;
+		pointLightTransmittanceTexBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		pointLightTransmittanceTexBinding.descriptorCount = 1;
+		pointLightTransmittanceTexBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		pointLightTransmittanceTexBinding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding phaseTableBinding;
+		phaseTableBinding.binding = 9;
+		phaseTableBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		phaseTableBinding.descriptorCount = 1;
+		phaseTableBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		phaseTableBinding.pImmutableSamplers = nullptr;
+
+		std::vector<VkDescriptorSetLayoutBinding> bindings = {
+			densityTexBinding,
+			majorantTexBinding,
+			brickIndexTexBinding,
+			densityMipTexBinding,
+			occupancyTexBinding,
+			minorantTexBinding,
+			traversalStatsBinding,
+			dirLightTransmittanceTexBinding,
+			pointLightTransmittanceTexBinding,
+			phaseTableBinding };
 
 		VkDescriptorSetLayoutCreateInfo layoutCI;
 		layoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -33,9 +110,13 @@ namespace en
 		// Create descriptor pool
 		VkDescriptorPoolSize densityTexPoolSize;
 		densityTexPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		densityTexPoolSize.descriptorCount = 1;
+		densityTexPoolSize.descriptorCount = 8;
 
-		std::vector<VkDescriptorPoolSize> poolSizes = { densityTexPoolSize };
+		VkDescriptorPoolSize storageBufferPoolSize;
+		storageBufferPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		storageBufferPoolSize.descriptorCount = 2;
+
+		std::vector<VkDescriptorPoolSize> poolSizes = { densityTexPoolSize, storageBufferPoolSize };
 
 		VkDescriptorPoolCreateInfo poolCI;
 		poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -60,11 +141,72 @@ namespace en
 		return m_DescriptorSetLayout;
 	}
 
-	VolumeData::VolumeData(const vk::Texture3D* densityTex, float densityFactor, float g) :
+	VolumeData::VolumeData(
+		const vk::Texture3D* densityTex,
+		const vk::Texture3D* majorantTex,
+		const vk::Texture3D* brickIndexTex,
+		const vk::Texture3D* densityMipTex,
+		const vk::Texture3D* occupancyTex,
+		const vk::Texture3D* minorantTex,
+		const vk::Texture3D* dirLightTransmittanceTex,
+		const vk::Texture3D* pointLightTransmittanceTex,
+		VkExtent3D extent,
+		const glm::vec3& size,
+		const glm::vec3& position,
+		float densityFactor,
+		const PhaseFunction& phaseFunction,
+		DensityLodMode densityLodMode,
+		float densityLodSpread,
+		bool traversalStats,
+		const ShadowTransmittance& shadowTransmittance,
+		FreeFlightMode freeFlightMode)
+		:
 		m_DensityFactor(densityFactor),
-		m_G(g),
-		m_DensityTex(densityTex)
+		m_G(phaseFunction.GetG()),
+		m_PhaseFuncMode(phaseFunction.GetMode()),
+		m_DensityLodMode(densityLodMode),
+		m_DensityLodSpread(densityLodSpread),
+		m_TraversalStats(traversalStats),
+		m_ShadowTransmittance(shadowTransmittance),
+		m_FreeFlightMode(freeFlightMode),
+		m_Extent(extent),
+		m_Size(size),
+		m_Position(position),
+		m_DensityTex(densityTex),
+		m_MajorantTex(majorantTex),
+		m_BrickIndexTex(brickIndexTex),
+		m_DensityMipTex(densityMipTex),
+		m_OccupancyTex(occupancyTex),
+		m_MinorantTex(minorantTex),
+		m_DirLightTransmittanceTex(dirLightTransmittanceTex),
+		m_PointLightTransmittanceTex(pointLightTransmittanceTex)
 	{
+		// Host visible, so that RenderImGui can read and reset the counters without a command buffer
+		m_TraversalStatsBuffer = new vk::Buffer(
+			c_TraversalStatCount * sizeof(uint32_t),
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			{});
+		const std::array<uint32_t, c_TraversalStatCount> zeros = {};
+		m_TraversalStatsBuffer->SetData(sizeof(zeros), zeros.data(), 0, 0);
+
+		// Read by every scattering event, so it lives in device memory
+		const std::vector<float>& phaseTable = phaseFunction.GetTable();
+		const VkDeviceSize phaseTableSize = phaseTable.size() * sizeof(float);
+		m_PhaseTableBuffer = new vk::Buffer(
+			phaseTableSize,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			{});
+		vk::Buffer stagingBuffer(
+			phaseTableSize,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			{});
+		stagingBuffer.SetData(phaseTableSize, phaseTable.data(), 0, 0);
+		vk::Buffer::Copy(&stagingBuffer, m_PhaseTableBuffer, phaseTableSize);
+		stagingBuffer.Destroy();
+
 		// Create and update descriptor set
 		VkDescriptorSetAllocateInfo descSetAI;
 		descSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -81,6 +223,11 @@ namespace en
 
 	void VolumeData::Destroy()
 	{
+		m_TraversalStatsBuffer->Destroy();
+		delete m_TraversalStatsBuffer;
+
+		m_PhaseTableBuffer->Destroy();
+		delete m_PhaseTableBuffer;
 	}
 
 	void VolumeData::RenderImGui()
@@ -88,6 +235,29 @@ namespace en
 		ImGui::Begin("HPM Volume");
 		ImGui::Text("Density Factor %f", m_DensityFactor);
 		ImGui::Text("G %f", m_G);
+
+		if (m_TraversalStats)
+		{
+			// Counts since the last call, the counters are reset every frame so that they do not overflow
+			std::array<uint32_t, c_TraversalStatCount> counts;
+			m_TraversalStatsBuffer->GetData(sizeof(counts), counts.data(), 0, 0);
+			const std::array<uint32_t, c_TraversalStatCount> zeros = {};
+			m_TraversalStatsBuffer->SetData(sizeof(zeros), zeros.data(), 0, 0);
+
+			const uint32_t sampledCells = counts[0];
+			const uint32_t skippedCells = counts[1];
+			const uint32_t walkedCells = sampledCells + skippedCells;
+			ImGui::Text("Sampled cells %u", sampledCells);
+			ImGui::Text("Skipped cells %u (%u blocks)", skippedCells, counts[2]);
+			ImGui::Text("Skipped %f%% of the cells", walkedCells > 0 ? 100.0 * skippedCells / walkedCells : 0.0);
+			ImGui::Text("Density fetches %u", counts[3]);
+			ImGui::Text(
+				"Free flight steps %u for %u collisions (%f per collision)",
+				counts[4],
+				counts[5],
+				counts[5] > 0 ? static_cast<double>(counts[4]) / counts[5] : 0.0);
+		}
+
 		ImGui::End();
 	}
 
@@ -101,6 +271,36 @@ namespace en
 		return m_G;
 	}
 
+	PhaseFuncMode VolumeData::GetPhaseFuncMode() const
+	{
+		return m_PhaseFuncMode;
+	}
+
+	DensityLodMode VolumeData::GetDensityLodMode() const
+	{
+		return m_DensityLodMode;
+	}
+
+	float VolumeData::GetDensityLodSpread() const
+	{
+		return m_DensityLodSpread;
+	}
+
+	bool VolumeData::IsTraversalStatsEnabled() const
+	{
+		return m_TraversalStats;
+	}
+
+	const ShadowTransmittance& VolumeData::GetShadowTransmittance() const
+	{
+		return m_ShadowTransmittance;
+	}
+
+	FreeFlightMode VolumeData::GetFreeFlightMode() const
+	{
+		return m_FreeFlightMode;
+	}
+
 	VkDescriptorSet VolumeData::GetDescriptorSet() const
 	{
 		return m_DescriptorSet;
@@ -108,11 +308,17 @@ namespace en
 
 	VkExtent3D VolumeData::GetExtent() const
 	{
-		return { 
-			m_DensityTex->GetWidth(), 
-			m_DensityTex->GetHeight(), 
-			m_DensityTex->GetDepth()
-		};
+		return m_Extent;
+	}
+
+	glm::vec3 VolumeData::GetSize() const
+	{
+		return m_Size;
+	}
+
+	glm::vec3 VolumeData::GetPosition() const
+	{
+		return m_Position;
 	}
 
 	void VolumeData::UpdateDescriptorSet()
@@ -135,8 +341,180 @@ namespace en
 		densityTexWrite.pBufferInfo = nullptr;
 		densityTexWrite.pTexelBufferView = nullptr;
 
+		// Majorant tex
+		VkDescriptorImageInfo majorantTexImageInfo;
+		majorantTexImageInfo.sampler = m_MajorantTex->GetSampler();
+		majorantTexImageInfo.imageView = m_MajorantTex->GetImageView();
+		majorantTexImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet majorantTexWrite;
+		majorantTexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		majorantTexWrite.pNext = nullptr;
+		majorantTexWrite.dstSet = m_DescriptorSet;
+		majorantTexWrite.dstBinding = 1;
+		majorantTexWrite.dstArrayElement = 0;
+		majorantTexWrite.descriptorCount = 1;
+		majorantTexWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		majorantTexWrite.pImageInfo = &majorantTexImageInfo;
+		majorantTexWrite.pBufferInfo = nullptr;
+		majorantTexWrite.pTexelBufferView = nullptr;
+
+		// Brick index tex
+		VkDescriptorImageInfo brickIndexTexImageInfo;
+		brickIndexTexImageInfo.sampler = m_BrickIndexTex->GetSampler();
+		brickIndexTexImageInfo.imageView = m_BrickIndexTex->GetImageView();
+		brickIndexTexImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet brickIndexTexWrite;
+		brickIndexTexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		brickIndexTexWrite.pNext = nullptr;
+		brickIndexTexWrite.dstSet = m_DescriptorSet;
+		brickIndexTexWrite.dstBinding = 2;
+		brickIndexTexWrite.dstArrayElement = 0;
+		brickIndexTexWrite.descriptorCount = 1;
+		brickIndexTexWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		brickIndexTexWrite.pImageInfo = &brickIndexTexImageInfo;
+		brickIndexTexWrite.pBufferInfo = nullptr;
+		brickIndexTexWrite.pTexelBufferView = nullptr;
+
+		// Density mip tex
+		VkDescriptorImageInfo densityMipTexImageInfo;
+		densityMipTexImageInfo.sampler = m_DensityMipTex->GetSampler();
+		densityMipTexImageInfo.imageView = m_DensityMipTex->GetImageView();
+		densityMipTexImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet densityMipTexWrite;
+		densityMipTexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		densityMipTexWrite.pNext = nullptr;
+		densityMipTexWrite.dstSet = m_DescriptorSet;
+		densityMipTexWrite.dstBinding = 3;
+		densityMipTexWrite.dstArrayElement = 0;
+		densityMipTexWrite.descriptorCount = 1;
+		densityMipTexWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		densityMipTexWrite.pImageInfo = &densityMipTexImageInfo;
+		densityMipTexWrite.pBufferInfo = nullptr;
+		densityMipTexWrite.pTexelBufferView = nullptr;
+
+		// Occupancy tex
+		VkDescriptorImageInfo occupancyTexImageInfo;
+		occupancyTexImageInfo.sampler = m_OccupancyTex->GetSampler();
+		occupancyTexImageInfo.imageView = m_OccupancyTex->GetImageView();
+		occupancyTexImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet occupancyTexWrite;
+		occupancyTexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		occupancyTexWrite.pNext = nullptr;
+		occupancyTexWrite.dstSet = m_DescriptorSet;
+		occupancyTexWrite.dstBinding = 4;
+		occupancyTexWrite.dstArrayElement = 0;
+		occupancyTexWrite.descriptorCount = 1;
+		occupancyTexWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		occupancyTexWrite.pImageInfo = &occupancyTexImageInfo;
+		occupancyTexWrite.pBufferInfo = nullptr;
+		occupancyTexWrite.pTexelBufferView = nullptr;
+
+		// Minorant tex
+		VkDescriptorImageInfo minorantTexImageInfo;
+		minorantTexImageInfo.sampler = m_MinorantTex->GetSampler();
+		minorantTexImageInfo.imageView = m_MinorantTex->GetImageView();
+		minorantTexImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet minorantTexWrite;
+		minorantTexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		minorantTexWrite.pNext = nullptr;
+		minorantTexWrite.dstSet = m_DescriptorSet;
+		minorantTexWrite.dstBinding = 5;
+		minorantTexWrite.dstArrayElement = 0;
+		minorantTexWrite.descriptorCount = 1;
+		minorantTexWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		minorantTexWrite.pImageInfo = &minorantTexImageInfo;
+		minorantTexWrite.pBufferInfo = nullptr;
+		minorantTexWrite.pTexelBufferView = nullptr;
+
+		// Traversal stats buffer
+		VkDescriptorBufferInfo traversalStatsBufferInfo;
+		traversalStatsBufferInfo.buffer = m_TraversalStatsBuffer->GetVulkanHandle();
+		traversalStatsBufferInfo.offset = 0;
+		traversalStatsBufferInfo.range = m_TraversalStatsBuffer->GetUsedSize();
+
+		VkWriteDescriptorSet traversalStatsWrite;
+		traversalStatsWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		traversalStatsWrite.pNext = nullptr;
+		traversalStatsWrite.dstSet = m_DescriptorSet;
+		traversalStatsWrite.dstBinding = 6;
+		traversalStatsWrite.dstArrayElement = 0;
+		traversalStatsWrite.descriptorCount = 1;
+		traversalStatsWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		traversalStatsWrite.pImageInfo = nullptr;
+		traversalStatsWrite.pBufferInfo = &traversalStatsBufferInfo;
+		traversalStatsWrite.pTexelBufferView = nullptr;
+
+		// Dir light transmittance tex
+		VkDescriptorImageInfo dirLightTransmittanceTexImageInfo;
+		dirLightTransmittanceTexImageInfo.sampler = m_DirLightTransmittanceTex->GetSampler();
+		dirLightTransmittanceTexImageInfo.imageView = m_DirLightTransmittanceTex->GetImageView();
+		dirLightTransmittanceTexImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet dirLightTransmittanceTexWrite;
+		dirLightTransmittanceTexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		dirLightTransmittanceTexWrite.pNext = nullptr;
+		dirLightTransmittanceTexWrite.dstSet = m_DescriptorSet;
+		dirLightTransmittanceTexWrite.dstBinding = 7;
+		dirLightTransmittanceTexWrite.dstArrayElement = 0;
+		dirLightTransmittanceTexWrite.descriptorCount = 1;
+		dirLightTransmittanceTexWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		dirLightTransmittanceTexWrite.pImageInfo = &dirLightTransmittanceTexImageInfo;
+		dirLightTransmittanceTexWrite.pBufferInfo = nullptr;
+		dirLightTransmittanceTexWrite.pTexelBufferView = nullptr;
+
+		// Point light transmittance tex
+		VkDescriptorImageInfo pointLightTransmittanceTexImageInfo;
+		pointLightTransmittanceTexImageInfo.sampler = m_PointLightTransmittanceTex->GetSampler();
+		pointLightTransmittanceTexImageInfo.imageView = m_PointLightTransmittanceTex->GetImageView();
+		pointLightTransmittanceTexImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet pointLightTransmittanceTexWrite;
+		pointLightTransmittanceTexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		pointLightTransmittanceTexWrite.pNext = nullptr;
+		pointLightTransmittanceTexWrite.dstSet = m_DescriptorSet;
+		pointLightTransmittanceTexWrite.dstBinding = 8;
+		pointLightTransmittanceTexWrite.dstArrayElement = 0;
+		pointLightTransmittanceTexWrite.descriptorCount = 1;
+		pointLightTransmittanceTexWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		pointLightTransmittanceTexWrite.pImageInfo = &pointLightTransmittanceTexImageInfo;
+		pointLightTransmittanceTexWrite.pBufferInfo = nullptr;
+		pointLightTransmittanceTexWrite.pTexelBufferView = nullptr;
+
+		// Phase table buffer
+		VkDescriptorBufferInfo phaseTableBufferInfo;
+		phaseTableBufferInfo.buffer = m_PhaseTableBuffer->GetVulkanHandle();
+		phaseTableBufferInfo.offset = 0;
+		phaseTableBufferInfo.range = m_PhaseTableBuffer->GetUsedSize();
+
+		VkWriteDescriptorSet phaseTableWrite;
+		phaseTableWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		phaseTableWrite.pNext = nullptr;
+		phaseTableWrite.dstSet = m_DescriptorSet;
+		phaseTableWrite.dstBinding = 9;
+		phaseTableWrite.dstArrayElement = 0;
+		phaseTableWrite.descriptorCount = 1;
+		phaseTableWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		phaseTableWrite.pImageInfo = nullptr;
+		phaseTableWrite.pBufferInfo = &phaseTableBufferInfo;
+		phaseTableWrite.pTexelBufferView = nullptr;
+
 		// Update
-		std::vector<VkWriteDescriptorSet> writes = { densityTexWrite };
+		std::vector<VkWriteDescriptorSet> writes = {
+			densityTexWrite,
+			majorantTexWrite,
+			brickIndexTexWrite,
+			densityMipTexWrite,
+			occupancyTexWrite,
+			minorantTexWrite,
+			traversalStatsWrite,
+			dirLightTransmittanceTexWrite,
+			pointLightTransmittanceTexWrite,
+			phaseTableWrite };
 
 		vkUpdateDescriptorSets(VulkanAPI::GetDevice(), writes.size(), writes.data(), 0, nullptr);
 	}
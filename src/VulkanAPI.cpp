@@ -444,10 +444,28 @@ namespace en
 		atomicFloatFeatures.sparseImageFloat32Atomics = VK_FALSE;
 		atomicFloatFeatures.sparseImageFloat32AtomicAdd = VK_FALSE;
 
+		// Timeline semaphores shared with cuda
+		VkPhysicalDeviceTimelineSemaphoreFeatures supportedTimelineSemaphoreFeatures{};
+		supportedTimelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+		VkPhysicalDeviceFeatures2 supportedFeatures2{};
+		supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures2.pNext = &supportedTimelineSemaphoreFeatures;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+		if (supportedTimelineSemaphoreFeatures.timelineSemaphore != VK_TRUE)
+		{
+			Log::Error("Physical device does not support timeline semaphores, which the semaphores shared with cuda need", true);
+		}
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures;
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineSemaphoreFeatures.pNext = &atomicFloatFeatures;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
 		// Time query reset
 		VkPhysicalDeviceHostQueryResetFeatures queryResetFeatures;
 		queryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES;
-		queryResetFeatures.pNext = &atomicFloatFeatures;
+		queryResetFeatures.pNext = &timelineSemaphoreFeatures;
 		queryResetFeatures.hostQueryReset = VK_TRUE;
 
 		// Create
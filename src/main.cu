@@ -153,11 +153,15 @@ void Benchmark(const en::Camera* camera, VkQueue queue, size_t frameCount, Bench
 		std::to_string(nrcHpmRenderer->GetTrainTime())
 	);
 
+	// MSE times frame time is proportional to the time needed to reach a given MSE by accumulating
+	// frames, which compares estimators at equal MSE, e.g. the shadow transmittance modes
 	logFileMc.WriteLine(
 		std::to_string(frameCount) + " " +
 		std::to_string(mcResult.mse) + " " +
 		std::to_string(mcResult.GetRelBias()) + " " +
-		std::to_string(mcResult.GetCV())
+		std::to_string(mcResult.GetCV()) + " " +
+		std::to_string(mcHpmRenderer->GetTotalTime()) + " " +
+		std::to_string(mcResult.mse * mcHpmRenderer->GetTotalTime())
 	);
 }
 
@@ -209,13 +213,13 @@ bool RunAppConfigInstance(const en::AppConfig& appConfig)
 
 	const float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
 	en::Camera camera(
-		glm::vec3(64.0f, 0.0f, 0.0f),
-		glm::vec3(-1.0f, 0.0f, 0.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f),
+		en::HpmSceneSetup::sc_CameraPos,
+		en::HpmSceneSetup::sc_CameraViewDir,
+		en::HpmSceneSetup::sc_CameraUp,
 		aspectRatio,
-		glm::radians(60.0f),
-		0.1f,
-		100.0f);
+		en::HpmSceneSetup::sc_CameraFov,
+		en::HpmSceneSetup::sc_CameraNearPlane,
+		en::HpmSceneSetup::sc_CameraFarPlane);
 
 	// Init reference
 	if (!hpmScene.IsDynamic()) { reference = new en::Reference(width, height, appConfig, hpmScene, queue); }
@@ -540,7 +544,12 @@ int main(int argc, char** argv)
 	// Read arguments for app config
 	std::vector<char*> myargv(argc);
 	std::memcpy(myargv.data(), argv, sizeof(char*) * argc);
-	if (argc == 1)
+
+	// "--cpu-reference" only renders the reference image of the scene on the CPU. No GPU is needed.
+	const bool cpuReference = argc > 1 && std::string(argv[1]) == "--cpu-reference";
+	if (cpuReference) { myargv.erase(myargv.begin() + 1); }
+
+	if (myargv.size() == 1)
 	{
 		en::Log::Info("No arguments found. Loading defaults");
 		myargv = { 
@@ -557,6 +566,12 @@ int main(int argc, char** argv)
 	// Create app config
 	en::AppConfig appConfig(myargv);
 
+	if (cpuReference)
+	{
+		en::Reference::GenRefImagesCpu(appConfig, 1920, 1080);
+		return 0;
+	}
+
 	// Run
 	bool restartRunConfig;
 	do {
@@ -0,0 +1,621 @@
+#include <engine/util/packet_tracking.hpp>
+#include <engine/util/Log.hpp>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+// MSVC allows the intrinsics of every instruction set in any translation unit. Other compilers only
+// provide the ones enabled on the command line, see the NRC_HPM_AVX2 and NRC_HPM_AVX512 CMake options.
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define EN_PACKET_TRACKING_AVX2
+#endif
+#if defined(_MSC_VER) || defined(__AVX512F__)
+#define EN_PACKET_TRACKING_AVX512
+#endif
+
+#if defined(EN_PACKET_TRACKING_AVX2) || defined(EN_PACKET_TRACKING_AVX512)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace en
+{
+	// Density fetches per ray before tracking gives up, like in path_trace.glsl
+	constexpr int32_t c_MaxFetchCount = 128;
+
+	// Grids and constants shared by all lanes
+	struct TrackingVolume
+	{
+		const float* density;
+		int32_t width;
+		int32_t height;
+		int32_t depth;
+		const float* majorant;
+		int32_t cellCount[3];
+		float cellUvwSize[3];
+		float densityFactor;
+	};
+
+	// One step of the PCG LCG followed by its RXS-M-XS output permutation
+	static uint32_t HashU32(uint32_t state)
+	{
+		state = state * 747796405u + 2891336453u;
+		const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	//
+	// Backends. Every backend provides the same set of functions on float (F), int (I) and mask (M)
+	// vectors of sc_Width lanes.
+	//
+
+	struct ScalarBackend
+	{
+		static constexpr uint32_t sc_Width = 1;
+		using F = float;
+		using I = int32_t;
+		using M = bool;
+
+		static F Load(const float* p) { return *p; }
+		static I LoadI(const int32_t* p) { return *p; }
+		static void Store(float* p, F a) { *p = a; }
+		static F Set(float a) { return a; }
+		static I SetI(int32_t a) { return a; }
+
+		static F Add(F a, F b) { return a + b; }
+		static F Sub(F a, F b) { return a - b; }
+		static F Mul(F a, F b) { return a * b; }
+		static F Div(F a, F b) { return a / b; }
+		static F Min(F a, F b) { return std::min(a, b); }
+		static F Max(F a, F b) { return std::max(a, b); }
+		static F Abs(F a) { return std::abs(a); }
+		static F Select(M m, F a, F b) { return m ? a : b; }
+		static M CmpLt(F a, F b) { return a < b; }
+		static M CmpGt(F a, F b) { return a > b; }
+		static M CmpGe(F a, F b) { return a >= b; }
+		static I FloorToInt(F a) { return static_cast<int32_t>(std::floor(a)); }
+		static I TruncToInt(F a) { return static_cast<int32_t>(a); }
+		static F ToFloat(I a) { return static_cast<float>(a); }
+		static I AsInt(F a) { I i; std::memcpy(&i, &a, sizeof(I)); return i; }
+		static F AsFloat(I a) { F f; std::memcpy(&f, &a, sizeof(F)); return f; }
+		static F Gather(const float* base, I index, M m) { return m ? base[index] : 0.0f; }
+
+		static I AddI(I a, I b) { return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+		static I SubI(I a, I b) { return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+		static I MulI(I a, I b) { return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+		static I MinI(I a, I b) { return std::min(a, b); }
+		static I MaxI(I a, I b) { return std::max(a, b); }
+		static I AndI(I a, I b) { return a & b; }
+		static I OrI(I a, I b) { return a | b; }
+		static I XorI(I a, I b) { return a ^ b; }
+		static I ShiftRightI(I a, int32_t count) { return static_cast<int32_t>(static_cast<uint32_t>(a) >> count); }
+		static I ShiftRightVarI(I a, I count) { return static_cast<int32_t>(static_cast<uint32_t>(a) >> count); }
+		static I SelectI(M m, I a, I b) { return m ? a : b; }
+		static M CmpLtI(I a, I b) { return a < b; }
+		static M CmpGtI(I a, I b) { return a > b; }
+
+		static M And(M a, M b) { return a && b; }
+		static M Or(M a, M b) { return a || b; }
+		static M AndNot(M a, M b) { return a && !b; }
+		static bool Any(M m) { return m; }
+	};
+
+#if defined(EN_PACKET_TRACKING_AVX2)
+	struct Avx2Backend
+	{
+		static constexpr uint32_t sc_Width = 8;
+		using F = __m256;
+		using I = __m256i;
+		using M = __m256;
+
+		static F Load(const float* p) { return _mm256_load_ps(p); }
+		static I LoadI(const int32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+		static void Store(float* p, F a) { _mm256_store_ps(p, a); }
+		static F Set(float a) { return _mm256_set1_ps(a); }
+		static I SetI(int32_t a) { return _mm256_set1_epi32(a); }
+
+		static F Add(F a, F b) { return _mm256_add_ps(a, b); }
+		static F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+		static F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+		static F Div(F a, F b) { return _mm256_div_ps(a, b); }
+		static F Min(F a, F b) { return _mm256_min_ps(a, b); }
+		static F Max(F a, F b) { return _mm256_max_ps(a, b); }
+		static F Abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+		static F Select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+		static M CmpLt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static M CmpGt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static M CmpGe(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static I FloorToInt(F a) { return _mm256_cvttps_epi32(_mm256_floor_ps(a)); }
+		static I TruncToInt(F a) { return _mm256_cvttps_epi32(a); }
+		static F ToFloat(I a) { return _mm256_cvtepi32_ps(a); }
+		static I AsInt(F a) { return _mm256_castps_si256(a); }
+		static F AsFloat(I a) { return _mm256_castsi256_ps(a); }
+		static F Gather(const float* base, I index, M m) { return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, index, m, 4); }
+
+		static I AddI(I a, I b) { return _mm256_add_epi32(a, b); }
+		static I SubI(I a, I b) { return _mm256_sub_epi32(a, b); }
+		static I MulI(I a, I b) { return _mm256_mullo_epi32(a, b); }
+		static I MinI(I a, I b) { return _mm256_min_epi32(a, b); }
+		static I MaxI(I a, I b) { return _mm256_max_epi32(a, b); }
+		static I AndI(I a, I b) { return _mm256_and_si256(a, b); }
+		static I OrI(I a, I b) { return _mm256_or_si256(a, b); }
+		static I XorI(I a, I b) { return _mm256_xor_si256(a, b); }
+		static I ShiftRightI(I a, int32_t count) { return _mm256_srli_epi32(a, count); }
+		static I ShiftRightVarI(I a, I count) { return _mm256_srlv_epi32(a, count); }
+		static I SelectI(M m, I a, I b) { return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(b), _mm256_castsi256_ps(a), m)); }
+		static M CmpLtI(I a, I b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a)); }
+		static M CmpGtI(I a, I b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b)); }
+
+		static M And(M a, M b) { return _mm256_and_ps(a, b); }
+		static M Or(M a, M b) { return _mm256_or_ps(a, b); }
+		static M AndNot(M a, M b) { return _mm256_andnot_ps(b, a); }
+		static bool Any(M m) { return _mm256_movemask_ps(m) != 0; }
+	};
+#endif
+
+#if defined(EN_PACKET_TRACKING_AVX512)
+	struct Avx512Backend
+	{
+		static constexpr uint32_t sc_Width = 16;
+		using F = __m512;
+		using I = __m512i;
+		using M = __mmask16;
+
+		static F Load(const float* p) { return _mm512_load_ps(p); }
+		static I LoadI(const int32_t* p) { return _mm512_load_si512(p); }
+		static void Store(float* p, F a) { _mm512_store_ps(p, a); }
+		static F Set(float a) { return _mm512_set1_ps(a); }
+		static I SetI(int32_t a) { return _mm512_set1_epi32(a); }
+
+		static F Add(F a, F b) { return _mm512_add_ps(a, b); }
+		static F Sub(F a, F b) { return _mm512_sub_ps(a, b); }
+		static F Mul(F a, F b) { return _mm512_mul_ps(a, b); }
+		static F Div(F a, F b) { return _mm512_div_ps(a, b); }
+		static F Min(F a, F b) { return _mm512_min_ps(a, b); }
+		static F Max(F a, F b) { return _mm512_max_ps(a, b); }
+		static F Abs(F a) { return _mm512_abs_ps(a); }
+		static F Select(M m, F a, F b) { return _mm512_mask_blend_ps(m, b, a); }
+		static M CmpLt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+		static M CmpGt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+		static M CmpGe(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+		static I FloorToInt(F a) { return _mm512_cvttps_epi32(_mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)); }
+		static I TruncToInt(F a) { return _mm512_cvttps_epi32(a); }
+		static F ToFloat(I a) { return _mm512_cvtepi32_ps(a); }
+		static I AsInt(F a) { return _mm512_castps_si512(a); }
+		static F AsFloat(I a) { return _mm512_castsi512_ps(a); }
+		static F Gather(const float* base, I index, M m) { return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, index, base, 4); }
+
+		static I AddI(I a, I b) { return _mm512_add_epi32(a, b); }
+		static I SubI(I a, I b) { return _mm512_sub_epi32(a, b); }
+		static I MulI(I a, I b) { return _mm512_mullo_epi32(a, b); }
+		static I MinI(I a, I b) { return _mm512_min_epi32(a, b); }
+		static I MaxI(I a, I b) { return _mm512_max_epi32(a, b); }
+		static I AndI(I a, I b) { return _mm512_and_si512(a, b); }
+		static I OrI(I a, I b) { return _mm512_or_si512(a, b); }
+		static I XorI(I a, I b) { return _mm512_xor_si512(a, b); }
+		static I ShiftRightI(I a, int32_t count) { return _mm512_srli_epi32(a, count); }
+		static I ShiftRightVarI(I a, I count) { return _mm512_srlv_epi32(a, count); }
+		static I SelectI(M m, I a, I b) { return _mm512_mask_blend_epi32(m, b, a); }
+		static M CmpLtI(I a, I b) { return _mm512_cmplt_epi32_mask(a, b); }
+		static M CmpGtI(I a, I b) { return _mm512_cmpgt_epi32_mask(a, b); }
+
+		static M And(M a, M b) { return static_cast<M>(a & b); }
+		static M Or(M a, M b) { return static_cast<M>(a | b); }
+		static M AndNot(M a, M b) { return static_cast<M>(a & ~b); }
+		static bool Any(M m) { return m != 0; }
+	};
+#endif
+
+	//
+	// Kernel
+	//
+
+	// Natural logarithm for positive normal floats (cephes logf), relative error below 1e-7
+	template<typename B>
+	static typename B::F Log(typename B::F x)
+	{
+		using F = typename B::F;
+		using I = typename B::I;
+		using M = typename B::M;
+
+		// Split into exponent and mantissa in [0.5, 1)
+		const I bits = B::AsInt(x);
+		I e = B::SubI(B::ShiftRightI(bits, 23), B::SetI(126));
+		F m = B::AsFloat(B::OrI(B::AndI(bits, B::SetI(0x007FFFFF)), B::SetI(0x3F000000)));
+
+		const M small = B::CmpLt(m, B::Set(0.707106781186547524f));
+		e = B::SelectI(small, B::SubI(e, B::SetI(1)), e);
+		m = B::Sub(B::Select(small, B::Add(m, m), m), B::Set(1.0f));
+
+		const F z = B::Mul(m, m);
+		F y = B::Set(7.0376836292e-2f);
+		y = B::Add(B::Mul(y, m), B::Set(-1.1514610310e-1f));
+		y = B::Add(B::Mul(y, m), B::Set(1.1676998740e-1f));
+		y = B::Add(B::Mul(y, m), B::Set(-1.2420140846e-1f));
+		y = B::Add(B::Mul(y, m), B::Set(1.4249322787e-1f));
+		y = B::Add(B::Mul(y, m), B::Set(-1.6668057665e-1f));
+		y = B::Add(B::Mul(y, m), B::Set(2.0000714765e-1f));
+		y = B::Add(B::Mul(y, m), B::Set(-2.4999993993e-1f));
+		y = B::Add(B::Mul(y, m), B::Set(3.3333331174e-1f));
+		y = B::Mul(B::Mul(y, m), z);
+
+		const F fe = B::ToFloat(e);
+		y = B::Add(y, B::Mul(fe, B::Set(-2.12194440e-4f)));
+		y = B::Sub(y, B::Mul(z, B::Set(0.5f)));
+		return B::Add(B::Add(m, y), B::Mul(fe, B::Set(0.693359375f)));
+	}
+
+	// Uniform floats in [0, 1). Only lanes in m advance their state.
+	template<typename B>
+	static typename B::F NextRandom(typename B::I& state, typename B::M m)
+	{
+		using I = typename B::I;
+
+		const I advanced = B::AddI(B::MulI(state, B::SetI(747796405)), B::SetI(static_cast<int32_t>(2891336453u)));
+		state = B::SelectI(m, advanced, state);
+
+		const I shift = B::AddI(B::ShiftRightI(state, 28), B::SetI(4));
+		I word = B::MulI(B::XorI(B::ShiftRightVarI(state, shift), state), B::SetI(277803737));
+		word = B::XorI(B::ShiftRightI(word, 22), word);
+		return B::Mul(B::ToFloat(B::ShiftRightI(word, 8)), B::Set(1.0f / 16777216.0f));
+	}
+
+	// Nearest density lookup like DensityGrid::SampleNearest, scaled by the density factor
+	template<typename B>
+	static typename B::F SampleDensity(const TrackingVolume& volume, const typename B::F* uvw, typename B::M m)
+	{
+		using F = typename B::F;
+		using I = typename B::I;
+
+		const F zero = B::Set(0.0f);
+		const F one = B::Set(1.0f);
+		for (int a = 0; a < 3; a++)
+		{
+			m = B::And(m, B::And(B::CmpGe(uvw[a], zero), B::CmpLt(uvw[a], one)));
+		}
+
+		const I x = B::MinI(B::TruncToInt(B::Mul(uvw[0], B::Set(static_cast<float>(volume.width)))), B::SetI(volume.width - 1));
+		const I y = B::MinI(B::TruncToInt(B::Mul(uvw[1], B::Set(static_cast<float>(volume.height)))), B::SetI(volume.height - 1));
+		const I z = B::MinI(B::TruncToInt(B::Mul(uvw[2], B::Set(static_cast<float>(volume.depth)))), B::SetI(volume.depth - 1));
+		const I index = B::AddI(x, B::MulI(B::SetI(volume.width), B::AddI(y, B::MulI(B::SetI(volume.height), z))));
+
+		return B::Mul(B::Set(volume.densityFactor), B::Gather(volume.density, index, m));
+	}
+
+	// Vectorized version of the local majorant loops of CpuHpmRenderer::DeltaTrack and RatioTrack.
+	// Every iteration either samples a free flight distance inside the current cell or moves a lane to
+	// its next cell. Lanes that hit, leave the volume or reach the fetch limit are masked off.
+	template<typename B, bool RatioTracking>
+	static size_t TrackPackets(const TrackingVolume& volume, const TrackingRays& rays, uint32_t seed, float* result)
+	{
+		using F = typename B::F;
+		using I = typename B::I;
+		using M = typename B::M;
+		constexpr uint32_t width = B::sc_Width;
+
+		alignas(64) float laneData[7][width];
+		alignas(64) int32_t laneState[width];
+		alignas(64) float laneResult[width];
+		alignas(64) float laneFetches[width];
+
+		const F zero = B::Set(0.0f);
+		const F one = B::Set(1.0f);
+		const uint32_t seedHash = HashU32(seed);
+		const size_t rayCount = rays.GetCount();
+		size_t fetchCount = 0;
+
+		for (size_t base = 0; base < rayCount; base += width)
+		{
+			// Gather packet. Padding lanes get an empty segment and are inactive from the start.
+			const uint32_t laneCount = static_cast<uint32_t>(std::min<size_t>(width, rayCount - base));
+			const std::vector<float>* sources[7] = { &rays.originX, &rays.originY, &rays.originZ, &rays.dirX, &rays.dirY, &rays.dirZ, &rays.tMax };
+			for (uint32_t lane = 0; lane < width; lane++)
+			{
+				for (int i = 0; i < 7; i++)
+				{
+					laneData[i][lane] = lane < laneCount ? (*sources[i])[base + lane] : (i == 3 ? 1.0f : 0.0f);
+				}
+				laneState[lane] = static_cast<int32_t>(HashU32(static_cast<uint32_t>(base + lane) ^ seedHash));
+			}
+
+			F o[3] = { B::Load(laneData[0]), B::Load(laneData[1]), B::Load(laneData[2]) };
+			F d[3] = { B::Load(laneData[3]), B::Load(laneData[4]), B::Load(laneData[5]) };
+			const F tMax = B::Load(laneData[6]);
+			I state = B::LoadI(laneState);
+
+			// Clip against the unit cube and set up the DDA like MajorantGrid::InitTraversal
+			F invDir[3];
+			M positiveDir[3];
+			F tNear = zero;
+			F tFar = tMax;
+			for (int a = 0; a < 3; a++)
+			{
+				const F safeDir = B::Select(B::CmpLt(B::Abs(d[a]), B::Set(1e-12f)), B::Set(1e-12f), d[a]);
+				invDir[a] = B::Div(one, safeDir);
+				positiveDir[a] = B::CmpGt(safeDir, zero);
+				const F t0 = B::Mul(B::Sub(zero, o[a]), invDir[a]);
+				const F t1 = B::Mul(B::Sub(one, o[a]), invDir[a]);
+				tNear = B::Max(tNear, B::Min(t0, t1));
+				tFar = B::Min(tFar, B::Max(t0, t1));
+			}
+			M active = B::CmpLt(tNear, tFar);
+
+			I cell[3];
+			I cellStep[3];
+			F tNext[3];
+			F tDelta[3];
+			for (int a = 0; a < 3; a++)
+			{
+				const F cellUvwSize = B::Set(volume.cellUvwSize[a]);
+				const F entry = B::Add(o[a], B::Mul(tNear, d[a]));
+				cell[a] = B::MinI(B::MaxI(B::FloorToInt(B::Div(entry, cellUvwSize)), B::SetI(0)), B::SetI(volume.cellCount[a] - 1));
+				cellStep[a] = B::SelectI(positiveDir[a], B::SetI(1), B::SetI(-1));
+				const F boundary = B::Mul(B::ToFloat(B::AddI(cell[a], B::SelectI(positiveDir[a], B::SetI(1), B::SetI(0)))), cellUvwSize);
+				tNext[a] = B::Mul(B::Sub(boundary, o[a]), invDir[a]);
+				tDelta[a] = B::Mul(cellUvwSize, B::Abs(invDir[a]));
+			}
+
+			F t = tNear;
+			const F tEnd = tFar;
+			F packetResult = RatioTracking ? one : B::Set(-1.0f);
+			I fetches = B::SetI(0);
+
+			while (B::Any(active))
+			{
+				const I cellIndex = B::AddI(cell[0], B::MulI(B::SetI(volume.cellCount[0]), B::AddI(cell[1], B::MulI(B::SetI(volume.cellCount[1]), cell[2]))));
+				const F majorant = B::Mul(B::Set(volume.densityFactor), B::Gather(volume.majorant, cellIndex, active));
+				const F cellExit = B::Min(B::Min(tNext[0], tNext[1]), B::Min(tNext[2], tEnd));
+
+				// Exponential free flight with the local majorant
+				const M hasMajorant = B::And(active, B::CmpGt(majorant, zero));
+				const F u = NextRandom<B>(state, hasMajorant);
+				const F safeMajorant = B::Select(hasMajorant, majorant, one);
+				const F tSample = B::Sub(t, B::Div(Log<B>(B::Sub(one, u)), safeMajorant));
+				const M sampled = B::And(hasMajorant, B::CmpLt(tSample, cellExit));
+				t = B::Select(sampled, tSample, t);
+
+				if (B::Any(sampled))
+				{
+					const F uvw[3] = { B::Add(o[0], B::Mul(t, d[0])), B::Add(o[1], B::Mul(t, d[1])), B::Add(o[2], B::Mul(t, d[2])) };
+					const F densityRatio = B::Div(SampleDensity<B>(volume, uvw, sampled), safeMajorant);
+					fetches = B::AddI(fetches, B::SelectI(sampled, B::SetI(1), B::SetI(0)));
+
+					if (RatioTracking)
+					{
+						packetResult = B::Select(sampled, B::Mul(packetResult, B::Sub(one, densityRatio)), packetResult);
+					}
+					else
+					{
+						const F uCollision = NextRandom<B>(state, sampled);
+						const M hit = B::And(sampled, B::CmpGt(densityRatio, uCollision));
+						packetResult = B::Select(hit, t, packetResult);
+						active = B::AndNot(active, hit);
+					}
+
+					// Delta tracking falls back to a random point on the segment like the shaders
+					const M capped = B::And(active, B::CmpGtI(fetches, B::SetI(c_MaxFetchCount - 1)));
+					if (!RatioTracking && B::Any(capped))
+					{
+						const F uFallback = NextRandom<B>(state, capped);
+						packetResult = B::Select(capped, B::Mul(uFallback, tMax), packetResult);
+					}
+					active = B::AndNot(active, capped);
+				}
+
+				// Lanes that sampled past their cell exit move on to the next cell
+				const M stepping = B::AndNot(active, sampled);
+				if (B::Any(stepping))
+				{
+					t = B::Select(stepping, cellExit, t);
+					const M beforeEnd = B::CmpLt(cellExit, tEnd);
+
+					const M isY = B::CmpLt(tNext[1], tNext[0]);
+					const M isZ = B::CmpLt(tNext[2], B::Select(isY, tNext[1], tNext[0]));
+					const M axisMask[3] = { B::AndNot(B::AndNot(stepping, isY), isZ), B::AndNot(B::And(stepping, isY), isZ), B::And(stepping, isZ) };
+
+					M inside = beforeEnd;
+					for (int a = 0; a < 3; a++)
+					{
+						cell[a] = B::SelectI(axisMask[a], B::AddI(cell[a], cellStep[a]), cell[a]);
+						tNext[a] = B::Select(axisMask[a], B::Add(tNext[a], tDelta[a]), tNext[a]);
+						inside = B::And(inside, B::And(B::CmpGtI(cell[a], B::SetI(-1)), B::CmpLtI(cell[a], B::SetI(volume.cellCount[a]))));
+					}
+
+					active = B::AndNot(active, B::AndNot(stepping, inside));
+				}
+			}
+
+			B::Store(laneResult, packetResult);
+			B::Store(laneFetches, B::ToFloat(fetches));
+			for (uint32_t lane = 0; lane < laneCount; lane++)
+			{
+				result[base + lane] = laneResult[lane];
+				fetchCount += static_cast<size_t>(laneFetches[lane]);
+			}
+		}
+
+		return fetchCount;
+	}
+
+	static TrackingVolume GetTrackingVolume(const DensityGrid& densityGrid, const MajorantGrid& majorantGrid, float densityFactor)
+	{
+		// Gathers use 32 bit indices
+		if (densityGrid.GetVoxelCount() > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+		{
+			Log::Error("Density grid is too large for packet tracking", true);
+		}
+
+		const DensityGrid& cells = majorantGrid.GetGrid();
+		const float cellSize = static_cast<float>(majorantGrid.GetCellSize());
+
+		TrackingVolume volume;
+		volume.density = densityGrid.GetData();
+		volume.width = static_cast<int32_t>(densityGrid.GetWidth());
+		volume.height = static_cast<int32_t>(densityGrid.GetHeight());
+		volume.depth = static_cast<int32_t>(densityGrid.GetDepth());
+		volume.majorant = cells.GetData();
+		volume.cellCount[0] = static_cast<int32_t>(cells.GetWidth());
+		volume.cellCount[1] = static_cast<int32_t>(cells.GetHeight());
+		volume.cellCount[2] = static_cast<int32_t>(cells.GetDepth());
+		volume.cellUvwSize[0] = cellSize / static_cast<float>(densityGrid.GetWidth());
+		volume.cellUvwSize[1] = cellSize / static_cast<float>(densityGrid.GetHeight());
+		volume.cellUvwSize[2] = cellSize / static_cast<float>(densityGrid.GetDepth());
+		volume.densityFactor = densityFactor;
+		return volume;
+	}
+
+	template<bool RatioTracking>
+	static size_t DispatchTrackPackets(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const TrackingRays& rays,
+		uint32_t seed,
+		float* result,
+		PacketIsa isa)
+	{
+		if (!IsPacketIsaSupported(isa)) { Log::Error(std::string(GetPacketIsaName(isa)) + " packet tracking is not supported", true); }
+
+		const TrackingVolume volume = GetTrackingVolume(densityGrid, majorantGrid, densityFactor);
+		switch (isa)
+		{
+#if defined(EN_PACKET_TRACKING_AVX512)
+		case PacketIsa::Avx512:
+			return TrackPackets<Avx512Backend, RatioTracking>(volume, rays, seed, result);
+#endif
+#if defined(EN_PACKET_TRACKING_AVX2)
+		case PacketIsa::Avx2:
+			return TrackPackets<Avx2Backend, RatioTracking>(volume, rays, seed, result);
+#endif
+		default:
+			return TrackPackets<ScalarBackend, RatioTracking>(volume, rays, seed, result);
+		}
+	}
+
+	//
+	// Public interface
+	//
+
+	static bool CpuSupportsAvx2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, 7, 0);
+		const bool avx2 = (info[1] & (1 << 5)) != 0;
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		return avx2 && osxsave && (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	static bool CpuSupportsAvx512()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, 7, 0);
+		const bool avx512f = (info[1] & (1 << 16)) != 0;
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		return avx512f && osxsave && (_xgetbv(0) & 0xE6) == 0xE6;
+#else
+		return __builtin_cpu_supports("avx512f");
+#endif
+	}
+
+	PacketIsa GetBestPacketIsa()
+	{
+		if (IsPacketIsaSupported(PacketIsa::Avx512)) { return PacketIsa::Avx512; }
+		if (IsPacketIsaSupported(PacketIsa::Avx2)) { return PacketIsa::Avx2; }
+		return PacketIsa::Scalar;
+	}
+
+	bool IsPacketIsaSupported(PacketIsa isa)
+	{
+		switch (isa)
+		{
+#if defined(EN_PACKET_TRACKING_AVX512)
+		case PacketIsa::Avx512:
+			return CpuSupportsAvx512();
+#endif
+#if defined(EN_PACKET_TRACKING_AVX2)
+		case PacketIsa::Avx2:
+			return CpuSupportsAvx2();
+#endif
+		case PacketIsa::Scalar:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint32_t GetPacketWidth(PacketIsa isa)
+	{
+		switch (isa)
+		{
+		case PacketIsa::Avx512:
+			return 16;
+		case PacketIsa::Avx2:
+			return 8;
+		default:
+			return 1;
+		}
+	}
+
+	const char* GetPacketIsaName(PacketIsa isa)
+	{
+		switch (isa)
+		{
+		case PacketIsa::Avx512:
+			return "AVX-512";
+		case PacketIsa::Avx2:
+			return "AVX2";
+		default:
+			return "Scalar";
+		}
+	}
+
+	void TrackingRays::Resize(size_t count)
+	{
+		originX.resize(count);
+		originY.resize(count);
+		originZ.resize(count);
+		dirX.resize(count);
+		dirY.resize(count);
+		dirZ.resize(count);
+		tMax.resize(count);
+	}
+
+	size_t TrackingRays::GetCount() const
+	{
+		return tMax.size();
+	}
+
+	size_t DeltaTrackPackets(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const TrackingRays& rays,
+		uint32_t seed,
+		float* tHit,
+		PacketIsa isa)
+	{
+		return DispatchTrackPackets<false>(densityGrid, majorantGrid, densityFactor, rays, seed, tHit, isa);
+	}
+
+	size_t RatioTrackPackets(
+		const DensityGrid& densityGrid,
+		const MajorantGrid& majorantGrid,
+		float densityFactor,
+		const TrackingRays& rays,
+		uint32_t seed,
+		float* transmittance,
+		PacketIsa isa)
+	{
+		return DispatchTrackPackets<true>(densityGrid, majorantGrid, densityFactor, rays, seed, transmittance, isa);
+	}
+}
@@ -0,0 +1,36 @@
+#include <engine/util/process_memory.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace en
+{
+	size_t GetPeakRssBytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+		return static_cast<size_t>(counters.PeakWorkingSetSize);
+#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss); // bytes on macOS
+#else
+		return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on linux
+#endif
+#endif
+	}
+
+	float GetPeakRssMB()
+	{
+		return static_cast<float>(GetPeakRssBytes()) / (1024.0f * 1024.0f);
+	}
+}
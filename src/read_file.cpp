@@ -1,12 +1,22 @@
 #include <engine/util/read_file.hpp>
+#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <engine/util/Log.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
 #include <fstream>
 #include <thread>
 #include <array>
 #include <cmath>
 #include <cstring>
 
+// Every x64 compiler provides sse, one register holds one rgba texel
+#if defined(_M_X64) || defined(__SSE2__)
+#define EN_READ_FILE_SSE
+#include <immintrin.h>
+#endif
+
 namespace en
 {
 	std::vector<char> ReadFileBinary(const std::string& fileName)
@@ -79,7 +89,7 @@ namespace en
 		return density3D;
 	}
 
-	std::vector<float> ReadFileHdr4f(const std::string& fileName, int& width, int& height, float max)
+	std::vector<float> ReadFileHdr4f(const std::string& fileName, int& width, int& height, float max, bool testOverwrite)
 	{
 		// Check if file is valid
 		if (fileName.empty())
@@ -99,126 +109,166 @@ namespace en
 			Log::Error("Failed to load Hdr4f from File: " + fileName, true);
 		}
 
-		const size_t floatCount = width * height * 4;
-		const size_t rawSize = floatCount * sizeof(float);
+		float maxVal;
+		size_t maxX;
+		size_t maxY;
+		std::vector<float> hdrData = ClampHdr4f(data, width, height, max, testOverwrite, maxVal, maxX, maxY);
+		stbi_image_free(data);
 
-		std::vector<float> hdrData(floatCount);
-		std::memcpy(hdrData.data(), data, rawSize);
+		en::Log::Info(fileName + " at (" + std::to_string(maxX) + "," + std::to_string(maxY) + ") max float: " + std::to_string(maxVal));
 
-		float maxVal = 0.0f;
-		size_t maxX = 0;
-		size_t maxY = 0;
-		for (size_t x = 0; x < width; x++)
-		{
-			for (size_t y = 0; y < height; y++)
+		return hdrData;
+	}
+
+	std::vector<float> ClampHdr4f(
+		const float* data,
+		size_t width,
+		size_t height,
+		float max,
+		bool testOverwrite,
+		float& maxVal,
+		size_t& maxX,
+		size_t& maxY)
+	{
+		// Rows are clamped in parallel. Every rgba texel is one sse vector, so the loop is branch free
+		// and the maximum is searched per row and only located for the brightest row afterwards.
+		std::vector<float> hdrData(width * height * 4);
+		std::vector<float> rowMax(height);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, height), [&](const tbb::blocked_range<size_t>& rows)
 			{
-				for (size_t c = 0; c < 4; c++)
+				for (size_t y = rows.begin(); y < rows.end(); y++)
 				{
-					const size_t linearIndex = (y * width * 4) + (x * 4) + c;
-					const float current = hdrData[linearIndex];
-					if (current > maxVal)
+					const float* src = data + (y * width * 4);
+					float* dst = hdrData.data() + (y * width * 4);
+#if defined(EN_READ_FILE_SSE)
+					const __m128 clampValue = _mm_set1_ps(testOverwrite ? 1.0f : max);
+					const __m128 one = _mm_set1_ps(1.0f);
+					__m128 texelMax = _mm_setzero_ps();
+					for (size_t x = 0; x < width; x++)
 					{
-						maxVal = current;
-						maxX = x;
-						maxY = y;
+						const __m128 texel = _mm_loadu_ps(src + (x * 4));
+						texelMax = _mm_max_ps(texelMax, texel);
+						_mm_storeu_ps(dst + (x * 4), testOverwrite ? one : _mm_min_ps(texel, clampValue));
 					}
-
-					// Clamp
-					hdrData[linearIndex] = std::min(max, hdrData[linearIndex]);
-
-					// Test overwrite
-					hdrData[linearIndex] = 1.0f;
+					alignas(16) float lanes[4];
+					_mm_store_ps(lanes, texelMax);
+					rowMax[y] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#else
+					float maxValue = 0.0f;
+					for (size_t i = 0; i < width * 4; i++)
+					{
+						maxValue = std::max(maxValue, src[i]);
+						dst[i] = testOverwrite ? 1.0f : std::min(max, src[i]);
+					}
+					rowMax[y] = maxValue;
+#endif
 				}
-			}
-		}
-		
-		en::Log::Info(fileName + " at (" + std::to_string(maxX) + "," + std::to_string(maxY) + ") max float: " + std::to_string(maxVal));
+			});
+
+		maxY = static_cast<size_t>(std::max_element(rowMax.begin(), rowMax.end()) - rowMax.begin());
+		maxVal = rowMax[maxY];
+		const float* maxRow = data + (maxY * width * 4);
+		maxX = static_cast<size_t>(std::max_element(maxRow, maxRow + (width * 4)) - maxRow) / 4;
 
 		return hdrData;
 	}
 
-	std::vector<float> InvertCdf(const std::vector<float>& cdf)
+	// Inverts the unnormalized cdf with total sum into invCdf with one pass
+	static void InvertCdf(const float* cdf, size_t size, float sum, float* invCdf)
 	{
-		std::vector<float> invCdf(cdf.size());
-
 		size_t p = 0;
-		for (size_t i = 0; i < invCdf.size(); i++)
+		for (size_t i = 0; i < size; i++)
 		{
-			const float threshold = static_cast<float>(i) / static_cast<float>(invCdf.size());
-			while (cdf[p] < threshold)
+			const float threshold = (static_cast<float>(i) / static_cast<float>(size)) * sum;
+			while (p + 1 < size && cdf[p] < threshold)
 			{
 				p++;
 			}
-			invCdf[i] = static_cast<float>(p) / static_cast<float>(cdf.size());
+			invCdf[i] = static_cast<float>(p) / static_cast<float>(size);
 		}
-
-		return invCdf;
 	}
 
 	std::array<std::vector<float>, 2> Hdr4fToCdf(const std::vector<float>& hdr4f, size_t width, size_t height)
 	{
-		std::vector<std::vector<float>> cdfX(height);
-		for (std::vector<float>& cdfXgivenY : cdfX)
-		{
-			cdfXgivenY.resize(width);
-		}
-
-		std::vector<float> pdfY(height);
-
-		// Get cdf of x given y
-		for (size_t y = 0; y < height; y++)
-		{
-			float brightnessSum = 0.0f;
-			for (size_t x = 0; x < width; x++)
-			{
-				const float r = hdr4f[(y * width * 4) + (x * 4) + 0];
-				const float g = hdr4f[(y * width * 4) + (x * 4) + 1];
-				const float b = hdr4f[(y * width * 4) + (x * 4) + 2];
-				//const float a = hdr4f[(y * width * 4) + (x * 4) + 3];
-			
-				const float brightness = r + g + b;
-				brightnessSum += brightness;
-
-				cdfX[y][x] = brightnessSum;
-			}
-
-			// Norm
-			for (size_t x = 0; x < width; x++)
+		// The cdf of x given y is a prefix sum of the brightness of every row, which is computed and
+		// inverted in parallel over rows into flat arrays
+		std::vector<float> cdfX(width * height);
+		std::vector<float> invCdfX(width * height);
+		std::vector<float> rowSums(height);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, height), [&](const tbb::blocked_range<size_t>& rows)
 			{
-				cdfX[y][x] /= brightnessSum;
-			}
-
-			// Store pdf unorm of y
-			pdfY[y] = brightnessSum;
-		}
+				for (size_t y = rows.begin(); y < rows.end(); y++)
+				{
+					const float* row = hdr4f.data() + (y * width * 4);
+					float* cdf = cdfX.data() + (y * width);
+					float brightnessSum = 0.0f;
+					for (size_t x = 0; x < width; x++)
+					{
+						brightnessSum += row[(x * 4) + 0] + row[(x * 4) + 1] + row[(x * 4) + 2];
+						cdf[x] = brightnessSum;
+					}
+					rowSums[y] = brightnessSum;
+					InvertCdf(cdf, width, brightnessSum, invCdfX.data() + (y * width));
+				}
+			});
 
-		// Get cdf unorm of y
 		std::vector<float> cdfY(height);
-
 		float brightnessSum = 0.0f;
 		for (size_t y = 0; y < height; y++)
 		{
-			brightnessSum += pdfY[y];
+			brightnessSum += rowSums[y];
 			cdfY[y] = brightnessSum;
 		}
 
-		// Norm cdf of y
-		for (size_t y = 0; y < height; y++)
-		{
-			cdfY[y] /= cdfY[height - 1];
-		}
+		std::vector<float> invCdfY(height);
+		InvertCdf(cdfY.data(), height, brightnessSum, invCdfY.data());
 
-		std::vector<float> invCdfX(width * height);
+		return { std::move(invCdfX), std::move(invCdfY) };
+	}
 
-		for (size_t y = 0; y < height; y++)
-		{
-			std::vector<float> invCdfXgivenY = InvertCdf(cdfX[y]);
-			for (size_t x = 0; x < width; x++)
+	AliasTable Hdr4fToAliasTable(std::vector<float>& hdr4f, size_t width, size_t height)
+	{
+		// Texels are weighted by brightness times solid angle, which is proportional to the cosine of the
+		// latitude of their row
+		std::vector<float> weights(width * height);
+		tbb::parallel_for(size_t(0), height, [&](size_t y)
 			{
-				invCdfX[(y * width) + x] = invCdfXgivenY[x];
-			}
-		}
+				const float theta = ((static_cast<float>(y) + 0.5f) / static_cast<float>(height) - 0.5f) * 3.14159265358979f;
+				const float cosTheta = std::cos(theta);
+				for (size_t x = 0; x < width; x++)
+				{
+					const float* rgba = hdr4f.data() + (((y * width) + x) * 4);
+					weights[(y * width) + x] = (rgba[0] + rgba[1] + rgba[2]) * cosTheta;
+				}
+			});
 
-		return { invCdfX, InvertCdf(cdfY) };
+		AliasTable aliasTable(weights);
+
+		// Store the density in uv space of picking a texel and a uniform position inside of it, so
+		// shaders can weight env map samples with a single fetch
+		const float texelCount = static_cast<float>(width * height);
+		tbb::parallel_for(size_t(0), width * height, [&](size_t i)
+			{
+				hdr4f[(i * 4) + 3] = aliasTable.GetPmf(static_cast<uint32_t>(i)) * texelCount;
+			});
+
+		return aliasTable;
+	}
+
+	std::vector<float> ReadFilePhaseFunc(const std::string& fileName)
+	{
+		std::ifstream file(fileName);
+		if (!file.is_open())
+			Log::Error("Failed to open file " + fileName, true);
+
+		std::vector<float> values;
+		float value;
+		while (file >> value) { values.push_back(value); }
+		if (!file.eof())
+			Log::Error("Phase function " + fileName + " contains a value that is not a number", true);
+		if (values.size() < 2)
+			Log::Error("Phase function " + fileName + " needs at least 2 values", true);
+
+		return values;
 	}
 }